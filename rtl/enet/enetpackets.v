@@ -373,10 +373,13 @@ module	enetpackets(i_wb_clk, i_reset,
 	always @(posedge i_wb_clk)
 		txsel <= i_wb_addr[MAW];
 
+	// Receive memory reads are only valid within a received packet.  Once
+	// rx_valid is set, the receiver leaves the memory alone until it's
+	// cleared, even if another packet starts arriving (rx_busy).
 	initial	rx_wb_valid = 0;
 	always @(posedge i_wb_clk)
-	if (rx_busy || i_wb_addr[MAW]
-			||(i_wb_addr[(MAW-1):0] <= { rx_len[(MAW+1):2] }))
+	if (!rx_valid || i_wb_addr[MAW]
+			||({ i_wb_addr[(MAW-1):0], 2'b00 } >= rx_len))
 		rx_wb_valid <= 0;
 	else
 		rx_wb_valid <= 1'b1;
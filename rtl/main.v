@@ -186,8 +186,14 @@ module	main(i_clk, i_reset,
 	//
 	// Baudrate :   1000000
 	// Clock    :  81247960
+`ifdef	FASTUART
+	// Simulation only: run the debugging bus at FASTUART clocks per baud,
+	// so host tools needn't wait on the real baud rate
+	localparam [23:0] BUSUART = `FASTUART;
+`else
 	localparam [23:0] BUSUART = 24'h51;	//   1000000 baud
-	localparam	DBGBUSBITS = $clog2(BUSUART);
+`endif
+	localparam	DBGBUSBITS = $clog2(BUSUART+1);
 	//
 	// Maximum command is 6 bytes, where each byte takes 10 baud clocks
 	// and each baud clock requires DBGBUSBITS to represent.  Here,
@@ -50,6 +50,9 @@
 
 #ifdef	OLEDRGB_ACCESS
 #include "oledsim.h"
+#ifdef	OLED_VIEWER
+#include "oledview.h"
+#endif
 #endif
 
 #include "testb.h"
@@ -59,6 +62,17 @@
 
 #include "main_tb.cpp"
 
+#ifdef	OLEDRGB_ACCESS
+static	OLEDSIM	*oled_stats = NULL;
+
+static	void	oled_report(void) {
+	if (oled_stats) {
+		oled_stats->dump_log(stderr);
+		oled_stats->report(stderr);
+	}
+}
+#endif
+
 void	usage(void) {
 	fprintf(stderr, "USAGE: main_tb <options> [zipcpu-elf-file]\n");
 	fprintf(stderr,
@@ -73,6 +87,21 @@ void	usage(void) {
 "\t\t\"sectors\" within this image.\n\n"
 #endif
 "\t-d\tSets the debugging flag\n"
+#ifdef	OLEDRGB_ACCESS
+#ifdef	OLED_VIEWER
+"\t-g\tOpens a window to view the OLED display\n"
+#endif
+"\t-o <filename>\n"
+"\t\tWrites each OLED frame, as it changes, to <filename>.  Names ending\n"
+"\t\tin .png or .ppm give images of that type, others raw RGB.  A %%d\n"
+"\t\twithin the name is replaced by the frame number.\n\n"
+"\t-l <level>\n"
+"\t\tPrints OLED events, as they happen, up to the given level: 1 for\n"
+"\t\terrors (the default), 2 for state changes, 3 for commands, 4 for\n"
+"\t\tpixels, and 5 for every SPI pin change.\n\n"
+"\t-s\tReports OLED command statistics, and the last OLED events, on\n"
+"\t\texit\n"
+#endif
 "\t-t <filename>\n"
 "\t\tTurns on tracing, sends the trace to <filename>--assumed to\n"
 "\t\tbe a vcd file\n"
@@ -80,18 +109,22 @@ void	usage(void) {
 }
 
 int	main(int argc, char **argv) {
-#ifdef	OLEDRGB_ACCESS
-	Gtk::Main	main_instance(argc, argv);
-#endif
 	Verilated::commandArgs(argc, argv);
 
 	const	char *elfload = NULL,
 #ifdef	SDSPI_ACCESS
 			*sdimage_file = NULL,
+#endif
+#ifdef	OLEDRGB_ACCESS
+			*oled_file = NULL,
 #endif
 			*profile_file = NULL,
 			*trace_file = NULL; // "trace.vcd";
-	bool	debug_flag = false, willexit = false;
+	bool	debug_flag = false, willexit = false, oled_view = false,
+		oled_report_flag = false;
+#ifdef	OLEDRGB_ACCESS
+	int	oled_level = OLED_LOG_ERR;
+#endif
 	FILE	*profile_fp;
 
 	MAINTB	*tb = new MAINTB;
@@ -108,6 +141,13 @@ int	main(int argc, char **argv) {
 					trace_file = "trace.vcd";
 				break;
 			case 'f': profile_file = "pfile.bin"; break;
+#ifdef	OLEDRGB_ACCESS
+			case 'g': oled_view = true; break;
+			case 'o': oled_file = argv[++argn]; j=1000; break;
+			case 'l': oled_level = atoi(argv[++argn]); j=1000;
+				break;
+			case 's': oled_report_flag = true; break;
+#endif
 			case 't': trace_file = argv[++argn]; j=1000; break;
 			case 'h': usage(); exit(0); break;
 			default:
@@ -156,6 +196,26 @@ int	main(int argc, char **argv) {
 		profile_fp = NULL;
 
 
+#ifdef	OLEDRGB_ACCESS
+	tb->m_oledrgb.print_level(oled_level);
+	if (oled_level > OLED_LOG_CMD)
+		tb->m_oledrgb.log_level(oled_level);
+	if (oled_report_flag) {
+		// Simulations often end via exit(), from a SIM instruction
+		oled_stats = &tb->m_oledrgb;
+		atexit(oled_report);
+	}
+	if (oled_file)
+		tb->m_oledrgb.dump(oled_file);
+	if (oled_view) {
+#ifdef	OLED_VIEWER
+		oledview_start(tb->m_oledrgb);
+#else
+		fprintf(stderr, "WARNING: Built without an OLED viewer\n");
+#endif
+	}
+#endif
+
 	tb->reset();
 #ifdef	SDSPI_ACCESS
 	tb->setsdcard(sdimage_file);
@@ -167,13 +227,9 @@ int	main(int argc, char **argv) {
 		fprintf(stderr, "ERR: Design has no ZipCPU\n");
 		exit(EXIT_FAILURE);
 #endif
-		tb->loadelf(elfload);
-
-		ELFSECTION	**secpp;
 		uint32_t	entry;
 
-		elfread(elfload, entry, secpp);
-		free(secpp);
+		entry = tb->loadelf(elfload);
 
 		printf("Attempting to start from 0x%08x\n", entry);
 		tb->m_core->cpu_ipc = entry;
@@ -210,9 +266,6 @@ int	main(int argc, char **argv) {
 		tb->m_core->VVAR(_swic__DOT__cpu_halt) = 0;
 	}
 
-#ifdef	OLEDRGB_ACCESS
-	Gtk::Main::run(tb->m_oledrgb);
-#else
 	if (profile_fp) {
 		unsigned long	last_instruction_tick = 0, now = 0;
 		while((!willexit)||(!tb->done())) {
@@ -240,7 +293,6 @@ int	main(int argc, char **argv) {
 	} else
 		while(true)
 			tb->tick();
-#endif
 
 	tb->close();
 	delete tb;
@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	bytequeue.h
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	A single producer, single consumer, lock-free byte queue.  This
+//		is used to pass characters between the simulation thread and
+//	the socket I/O threads of the UART simulators, so that the simulation
+//	thread never needs to make a system call to move a character.
+//
+//	Only one thread may ever push(), and only one (other) thread may ever
+//	pop().  Either thread may ask for the fill or the available space,
+//	although the answer is only exact from the thread that owns that end.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015-2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	BYTEQUEUE_H
+#define	BYTEQUEUE_H
+
+#include <atomic>
+
+template<unsigned LGLEN> class BYTEQUEUE {
+	static	const	unsigned	LEN = (1u<<LGLEN), MSK = LEN-1;
+	char			m_buf[LEN];
+	// m_head is only written by the producer, m_tail only by the consumer.
+	// Both are free running, only their difference matters.
+	std::atomic<unsigned>	m_head, m_tail;
+public:
+	BYTEQUEUE(void) : m_head(0), m_tail(0) {}
+
+	unsigned	fill(void) const {
+		return m_head.load(std::memory_order_acquire)
+			- m_tail.load(std::memory_order_acquire); }
+	unsigned	space(void) const { return LEN - fill(); }
+	bool		empty(void) const { return fill() == 0; }
+
+	// Producer side
+	bool	push(const char ch) {
+		unsigned	h = m_head.load(std::memory_order_relaxed);
+
+		if (h - m_tail.load(std::memory_order_acquire) >= LEN)
+			return false;
+		m_buf[h & MSK] = ch;
+		m_head.store(h+1, std::memory_order_release);
+		return true;
+	}
+
+	unsigned	push(const char *buf, unsigned len) {
+		unsigned	h = m_head.load(std::memory_order_relaxed),
+				av = LEN - (h - m_tail.load(std::memory_order_acquire));
+
+		if (len > av)
+			len = av;
+		for(unsigned k=0; k<len; k++)
+			m_buf[(h+k) & MSK] = buf[k];
+		m_head.store(h+len, std::memory_order_release);
+		return len;
+	}
+
+	// Consumer side.  Returns the next byte, or -1 if the queue is empty
+	int	pop(void) {
+		unsigned	t = m_tail.load(std::memory_order_relaxed);
+
+		if (t == m_head.load(std::memory_order_acquire))
+			return -1;
+		int	ch = m_buf[t & MSK] & 0x0ff;
+		m_tail.store(t+1, std::memory_order_release);
+		return ch;
+	}
+
+	unsigned	pop(char *buf, unsigned len) {
+		unsigned	t = m_tail.load(std::memory_order_relaxed),
+				av = m_head.load(std::memory_order_acquire) - t;
+
+		if (len > av)
+			len = av;
+		for(unsigned k=0; k<len; k++)
+			buf[k] = m_buf[(t+k) & MSK];
+		m_tail.store(t+len, std::memory_order_release);
+		return len;
+	}
+};
+
+#endif
@@ -51,8 +51,26 @@
 #include <ctype.h>
 #include <assert.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "dbluartsim.h"
 
+// How long the I/O thread waits on the sockets before checking again for any
+// characters the design may have sent, in milliseconds
+#define	DBLUART_POLLMS	1
+
+// Every DBLUARTSIM still in existence.  Simulations usually end with exit(),
+// from a SIM instruction, without ever deleting their DBLUARTSIMs, so each is
+// killed here instead.  That gives its I/O thread the chance to pass on the
+// last of what the design sent.
+static std::vector<DBLUARTSIM *>	dbluartsims;
+
+static void	dbluartsim_atexit(void) {
+	for(auto u : dbluartsims)
+		u->kill();
+}
+
 int	DBLUARTSIM::setup_listener(const int port) {
 	struct	sockaddr_in	my_addr;
 	int	skt;
@@ -103,7 +121,7 @@ DBLUARTSIM::DBLUARTSIM(const int port, const bool copy_to_stdout)
 	m_con = m_cmd = -1;
 	m_skt = setup_listener(port);
 	m_console = setup_listener(port+1);
-	m_rxpos = m_cmdpos = m_conpos = m_ilen = 0;
+	m_cmdpos = m_conpos = 0;
 	m_started_flag = false;
 	setup(25);	// Set us up for (default) 8N1 w/ a baud rate of CLK/25
 	m_rx_baudcounter = 0;
@@ -111,9 +129,47 @@ DBLUARTSIM::DBLUARTSIM(const int port, const bool copy_to_stdout)
 	m_rx_state = RXIDLE;
 	m_tx_state = TXIDLE;
 	m_cllen = 0;
+
+	m_done = false;
+	m_iothread = new std::thread(&DBLUARTSIM::iothread, this);
+
+	static	bool	registered = false;
+	if (!registered) {
+		atexit(dbluartsim_atexit);
+		registered = true;
+	} dbluartsims.push_back(this);
+}
+
+DBLUARTSIM::~DBLUARTSIM(void) {
+	kill();
+	dbluartsims.erase(std::remove(dbluartsims.begin(), dbluartsims.end(), this),
+		dbluartsims.end());
 }
 
 void	DBLUARTSIM::kill(void) {
+	// Shut down the I/O thread before touching its sockets
+	m_done = true;
+	if (m_iothread) {
+		m_iothread->join();
+		delete m_iothread;
+		m_iothread = NULL;
+	}
+
+	// Anything the design sent that the I/O thread never got to
+	{
+		int	ch;
+		while((ch = m_outq.pop()) >= 0)
+			received(ch);
+
+		// ... including any final partial line for the console
+		if ((m_con < 0)&&(m_conpos > 0)) {
+			m_conbuf[m_conpos] = '\0';
+			printf("%s", m_conbuf);
+			m_conpos = 0;
+		}
+		fflush(stdout);
+	}
+
 	// Close any active connection
 	if (m_con >= 0)	    {
 		const	char	*SIM_CLOSED = "\n[SIM] Connection-Closed\n";
@@ -213,40 +269,43 @@ void	DBLUARTSIM::poll_accept(void) {
 	// End of trying to accept more connections
 }
 
-void	DBLUARTSIM::poll_read(void) {
+void	DBLUARTSIM::poll_read(const int timeout_ms) {
 	struct	pollfd	pb[2];
 	int		npb = 0, r;
+	char		rxbuf[DBLPIPEBUFLEN];
+	unsigned	space = m_inq.space();
 
-	if (m_cmd >= 0) {
+	// Only read what we have room for.  The rest can wait in the kernel
+	// until the design catches up.
+	if (space > sizeof(rxbuf))
+		space = sizeof(rxbuf);
+
+	if ((m_cmd >= 0)&&(space > 0)) {
 		pb[npb].fd = m_cmd;
 		pb[npb].events = POLLIN;
 		npb++;
-	} if (m_con >= 0) {
+	} if ((m_con >= 0)&&(space > 0)) {
 		pb[npb].fd = m_con;
 		pb[npb].events = POLLIN;
 		npb++;
 	}
 
-	if (npb == 0)
-		return;
-
-	r = poll(pb, npb, 0);
+	// With nothing to poll, this just sleeps for the timeout
+	r = poll(pb, npb, timeout_ms);
 	if (r < 0)
 		perror("Polling error:");
-	else if (r == 0)
+	if (r <= 0)
 		return;
 
 	// printf("POLL = %d\n", r);
 	for(int i=0; i<npb; i++) {
-		if (pb[i].revents & POLLIN) {
+		if (pb[i].revents & (POLLIN|POLLHUP|POLLERR)) {
 			int	nr;
-			nr =recv(pb[i].fd, &m_rxbuf[m_ilen],
-					sizeof(m_rxbuf)-m_ilen,
-					MSG_DONTWAIT);
+			nr =recv(pb[i].fd, rxbuf, space, MSG_DONTWAIT);
 
 			if (pb[i].fd == m_cmd) {
 				for(int j=0; j<nr; j++) {
-					m_cmdline[m_cllen] = m_rxbuf[j+m_ilen];
+					m_cmdline[m_cllen] = rxbuf[j];
 					if (m_cmdline[m_cllen] != '\r') {
 						if (m_cmdline[m_cllen] == '\n'){
 							m_cmdline[m_cllen]='\0';
@@ -260,7 +319,7 @@ void	DBLUARTSIM::poll_read(void) {
 						m_cllen = 0;
 					}
 					
-					m_rxbuf[j+m_ilen] |= 0x80;
+					rxbuf[j] |= 0x80;
 				} m_cmdline[m_cllen] = '\0';
 
 
@@ -270,8 +329,9 @@ void	DBLUARTSIM::poll_read(void) {
 					m_cllen = 0;
 				}
 			} if (nr > 0) {
-				m_ilen += nr;
-				if (m_ilen == sizeof(m_rxbuf))
+				m_inq.push(rxbuf, nr);
+				space -= nr;
+				if (space == 0)
 					break;
 			} else if (nr <= 0) {
 				close(pb[i].fd);
@@ -281,7 +341,26 @@ void	DBLUARTSIM::poll_read(void) {
 					m_con = -1;
 			}
 		}
-	} m_rxpos = 0;
+	}
+}
+
+void	DBLUARTSIM::iothread(void) {
+	char	buf[DBLPIPEBUFLEN];
+
+	while(!m_done) {
+		unsigned	nr;
+
+		// First, forward everything the design has sent us
+		nr = m_outq.pop(buf, sizeof(buf));
+		for(unsigned k=0; k<nr; k++)
+			received(buf[k]);
+
+		poll_accept();
+
+		// If the design was just talking to us, it's likely to have
+		// more to say, so don't block waiting on the host.
+		poll_read((nr > 0) ? 0 : DBLUART_POLLMS);
+	}
 }
 
 void	DBLUARTSIM::received(const char ch) {
@@ -331,25 +410,13 @@ void	DBLUARTSIM::received(const char ch) {
 }
 
 int	DBLUARTSIM::next(void) {
-	// If our transmit buffer is empty, see if we can
-	// fill it.
-	if (m_ilen == 0)
-		poll_read();
-	if (m_ilen <= 0)
-		return -1;
-
-	int	nval;
-	nval = m_rxbuf[m_rxpos++];
-	m_ilen--;
-
-	return nval & 0x0ff;
+	// Anything waiting from the host?  -1 if not.
+	return m_inq.pop();
 }
 
 int	DBLUARTSIM::tick(int i_tx) {
 	int	o_rx = 1;
 
-	poll_accept();
-
 	if ((!i_tx)&&(m_last_tx))
 		m_rx_changectr = 0;
 	else	m_rx_changectr++;
@@ -368,7 +435,10 @@ int	DBLUARTSIM::tick(int i_tx) {
 			char	ch;
 			m_rx_state = RXIDLE;
 			ch = (m_rx_data >> (32-m_nbits-m_nstop-m_nparity))&0x0ff;
-			received(ch);
+			// Hand the character to the I/O thread.  Should the
+			// host fall that far behind, wait rather than drop it.
+			while((!m_outq.push(ch))&&(!m_done))
+				std::this_thread::yield();
 		} else {
 			m_rx_busy = (m_rx_busy << 1)|1;
 			// Low order bit is transmitted first, in this
@@ -51,8 +51,11 @@
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <signal.h>
+#include <atomic>
+#include <thread>
 
 #include "port.h"
+#include "bytequeue.h"
 
 #define	TXIDLE	0
 #define	TXDATA	1
@@ -60,6 +63,7 @@
 #define	RXDATA	1
 
 #define	DBLPIPEBUFLEN	256
+#define	DBLUART_LGQUEUE	12
 
 class	DBLUARTSIM	{
 	bool	m_debug;
@@ -73,10 +77,9 @@ public:
 		m_con;	// Connection to the console port FD
 	char	m_conbuf[DBLPIPEBUFLEN],
 		m_cmdbuf[DBLPIPEBUFLEN],
-		m_rxbuf[DBLPIPEBUFLEN],
 		m_cmdline[DBLPIPEBUFLEN],
 		m_intransit_data;
-	int	m_ilen, m_rxpos, m_cmdpos, m_conpos, m_cllen;
+	int	m_cmdpos, m_conpos, m_cllen;
 	bool	m_started_flag;
 	bool	m_copy;
 	//
@@ -91,15 +94,25 @@ public:
 	int	m_tx_baudcounter, m_tx_state, m_tx_busy;
 	unsigned	m_rx_data, m_tx_data;
 
+	// Characters on their way from the host into the design (m_inq),
+	// and from the design back out to the host (m_outq).  These are the
+	// only things the simulation thread ever touches--the sockets above
+	// all belong to the I/O thread.
+	BYTEQUEUE<DBLUART_LGQUEUE>	m_inq, m_outq;
+	std::thread		*m_iothread;
+	std::atomic<bool>	m_done;
+
 	void	poll_accept(void);
-	void	poll_read(void);
+	void	poll_read(const int timeout_ms);
+	void	iothread(void);
 public:
 	// The DBLUARTSIM constructor takes one argument: the base port on the
 	// localhost to listen in on.  Once started, connections may be made
 	// to this port to get the output from the port.
 	DBLUARTSIM(const int port = FPGAPORT, const bool copy_to_stdout=true);
-	// kill() closes any active connection and the socket.  Once killed,
-	// no further output will be sent to the port.
+	virtual	~DBLUARTSIM(void);
+	// kill() stops the I/O thread, then closes any active connection and
+	// the socket.  Once killed, no further output will be sent to the port.
 	virtual	void	kill(void);
 
 	// The operator() function is called on every tick.  The input is the
@@ -129,9 +142,13 @@ public:
 	// whether we are connected to the network or not.  If not connected
 	// to the network, then we assume m_conrd and m_conwr refer to 
 	// your more traditional file descriptors, and use them as such.
+	//
+	// tick() itself never makes a system call.  It only ever hands
+	// characters to, or takes them from, the I/O thread's queues.
 	int	tick(const int i_tx);
 
-	// Having just received a character, report it as received
+	// Having just received a character, report it as received.  This
+	// is called from the I/O thread.
 	void	received(const char ch);
 	//
 	// Get the next character to transmit (if any)
@@ -0,0 +1,1002 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	enetpackets_tb.cpp
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	A load test for the enetpackets Verilog module.  This drives
+//		line rate MII traffic into the receive side of the core, while
+//	a simple bus master (standing in for the CPU) drains each packet from
+//	the receive buffer and queues packets for transmission.  Everything the
+//	core transmits is captured off of the wire and checked.
+//
+//	The receive traffic may be of a fixed size, uniformly distributed
+//	between two sizes, or an IMIX (7:4:1 of 64, 594, and 1518 octets).  A
+//	given percentage of the frames may have their CRC corrupted, and
+//	another percentage may be runts.  Each frame carries a sequence
+//	number, so we can tell which frames were dropped.
+//
+//	When complete, the test reports frames per (simulated) second, drops,
+//	and the latency through each stage of the receive pipeline.  This
+//	latter requires the core to be Verilated with RXSCOPE set, so that the
+//	pipeline's internal valid signals are present on o_debug.  The rtl
+//	Makefile does this for us.
+//
+//	Like enetctrl_tb, if the last line output is "SUCCESS" (or the return
+//	code is EXIT_SUCCESS), then no frame was corrupted and no bad frame
+//	was accepted.  Drops, by themselves, are reported but not failures.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015-2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <assert.h>
+#include <vector>
+#include <deque>
+
+#include "verilated.h"
+#include "verilated_vcd_c.h"
+#include "Venetpackets.h"
+#include "tbclock.h"
+
+const int	BOMBCOUNT = 2048;
+
+// The default MEMORY_ADDRESS_WIDTH of 12 gives us 1k words per buffer
+#define	MAW		10
+#define	TXMEM		(1<<MAW)
+#define	MAXFRAME	1518	// Octets, not including the CRC
+#define	ETHERTYPE	0x88b5	// Local experimental, so the IP check skips it
+
+#define	RXCMD		0
+#define	TXCMD		1
+#define	MACHI		2
+#define	MACLO		3
+
+#define	RX_VALID	0x04000
+#define	RX_BUSY		0x08000
+#define	RX_MISS		0x10000
+#define	RX_ERR		0x20000
+#define	RX_CRCERR	0x40000
+#define	TX_BUSY		0x04000
+#define	TX_CMD		0x04000
+
+//
+// With RXSCOPE set, o_debug carries the internal valid signals of each
+// receive stage
+#define	DBG_EOP(D)	(((D)>>30)&1)
+#define	DBG_RXWR(D)	(((D)>>29)&1)
+#define	DBG_NPRE(D)	(((D)>>28)&1)
+#define	DBG_RXCRC(D)	(((D)>>23)&1)
+#define	DBG_RXMAC(D)	(((D)>>16)&1)
+
+static	const	uint8_t	HWMAC[6] = { 0xa2, 0x00, 0x0c, 0xc5, 0x44, 0x12 },
+			BROADCAST[6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff },
+			PEERMAC[6] = { 0x02, 0x1a, 0x2b, 0x3c, 0x4d, 0x5e };
+
+static	uint32_t	crctable[256];
+
+static	void	build_crctable(void) {
+	for(unsigned k=0; k<256; k++) {
+		uint32_t	c = k;
+		for(int b=0; b<8; b++)
+			c = (c & 1) ? (c >> 1) ^ 0xedb88320 : (c >> 1);
+		crctable[k] = c;
+	}
+}
+
+static	uint32_t	ethcrc(const uint8_t *buf, unsigned len) {
+	uint32_t	crc = 0xffffffff;
+
+	for(unsigned k=0; k<len; k++)
+		crc = crctable[(crc ^ buf[k]) & 0x0ff] ^ (crc >> 8);
+	return ~crc;
+}
+
+//
+// LATSTAT
+//
+// Accumulates min/mean/max statistics for one latency measurement
+class	LATSTAT {
+public:
+	unsigned long	m_count, m_min, m_max;
+	double		m_sum;
+
+	LATSTAT(void) { m_count = 0; m_min = 0; m_max = 0; m_sum = 0.0; }
+
+	void	add(unsigned long v) {
+		if ((m_count == 0)||(v < m_min))
+			m_min = v;
+		if (v > m_max)
+			m_max = v;
+		m_sum += v;
+		m_count++;
+	}
+
+	void	report(FILE *fp, const char *name, const char *units) {
+		if (m_count == 0)
+			fprintf(fp, "  %-28s (no samples)\n", name);
+		else
+			fprintf(fp, "  %-28s %8lu %8.1f %8lu  %s\n", name,
+				m_min, m_sum / m_count, m_max, units);
+	}
+};
+
+typedef	enum	{ FR_GOOD, FR_CRCERR, FR_RUNT } FRAMEKIND;
+
+typedef	struct	FRAME_S {
+	FRAMEKIND	m_kind;
+	unsigned	m_len;		// Octets, not counting the CRC
+	bool		m_received, m_corrupt;
+	uint8_t		m_data[MAXFRAME+4];
+} FRAME;
+
+class	ENETPACKETS_TB {
+	Venetpackets	*m_core;
+	VerilatedVcdC	*m_trace;
+	uint64_t	m_time_ps;
+	TBCLOCK		m_wb_clk, m_rx_clk, m_tx_clk;
+	bool		m_bomb;
+	uint32_t	m_seed;
+
+public:
+	// Traffic configuration
+	unsigned	m_nframes, m_minlen, m_maxlen, m_ipg,
+			m_crcpct, m_runtpct, m_ntx;
+	bool		m_imix, m_readback;
+
+	// Receive generator state
+	std::vector<FRAME *>	m_frames;
+	bool		m_rx_enabled;
+	unsigned	m_rx_next, m_rx_pos, m_rx_nibbles, m_rx_gap;
+	uint8_t		m_rx_wire[8+MAXFRAME+4];
+	uint64_t	m_rx_first_ps, m_rx_last_ps, m_rx_octets;
+
+	// Receive pipeline latency, measured in RX clocks
+	unsigned long	m_rx_ticks, m_rx_sof, m_rx_eof;
+	unsigned	m_rx_seen;	// Stages seen so far this frame
+	unsigned	m_last_debug;
+	LATSTAT		m_lat_pre, m_lat_crc, m_lat_mac, m_lat_wr, m_lat_eop,
+			m_lat_int, m_lat_svc;
+	uint64_t	m_eop_ps;
+	bool		m_eop_pending, m_last_rx_int;
+
+	// Transmit monitor state
+	std::deque<FRAME *>	m_txq;
+	std::vector<uint8_t>	m_tx_wire;
+	bool		m_tx_last_en;
+	uint64_t	m_tx_cmd_ps, m_tx_sof_ps, m_tx_eof_ps,
+			m_tx_first_ps, m_tx_last_ps, m_tx_octets;
+	unsigned	m_tx_sent, m_tx_captured, m_tx_bad;
+	LATSTAT		m_lat_txstart, m_lat_txwire, m_lat_txdone;
+
+	// Received frame accounting
+	unsigned	m_rx_received, m_rx_corrupt, m_rx_unknown,
+			m_miss_flags, m_err_flags, m_crc_flags;
+
+	ENETPACKETS_TB(void) {
+		m_core = new Venetpackets;
+		Verilated::traceEverOn(true);
+		m_trace = NULL;
+		m_time_ps = 0;
+		m_bomb = false;
+		m_seed = 0x12345678;
+
+		m_wb_clk.init(12308);	// 81.25 MHz, as in main_tb
+		m_rx_clk.init(40000);	// 25 MHz, 100Mb/s MII
+		m_tx_clk.init(40000);
+
+		m_nframes = 1000;
+		m_minlen  = 60;
+		m_maxlen  = 60;
+		m_ipg     = 24;	// 12 octets, the minimum interframe gap
+		m_crcpct  = 0;
+		m_runtpct = 0;
+		m_ntx     = 100;
+		m_imix    = false;
+		m_readback= true;
+
+		m_rx_enabled = false;
+		m_rx_next = 0; m_rx_pos = 0; m_rx_nibbles = 0; m_rx_gap = 0;
+		m_rx_first_ps = m_rx_last_ps = 0; m_rx_octets = 0;
+		m_rx_ticks = 0; m_rx_sof = m_rx_eof = 0; m_rx_seen = 0;
+		m_last_debug = 0;
+		m_eop_ps = 0; m_eop_pending = false; m_last_rx_int = false;
+
+		m_tx_last_en = false;
+		m_tx_cmd_ps = m_tx_sof_ps = m_tx_eof_ps = 0;
+		m_tx_first_ps = m_tx_last_ps = 0; m_tx_octets = 0;
+		m_tx_sent = 0; m_tx_captured = 0; m_tx_bad = 0;
+
+		m_rx_received = m_rx_corrupt = m_rx_unknown = 0;
+		m_miss_flags = m_err_flags = m_crc_flags = 0;
+
+		m_core->i_net_col   = 0;
+		m_core->i_net_crs   = 0;	// Full duplex
+		m_core->i_net_dv    = 0;
+		m_core->i_net_rxd   = 0;
+		m_core->i_net_rxerr = 0;
+		m_core->i_wb_cyc    = 0;
+		m_core->i_wb_stb    = 0;
+		m_core->i_ctrl_cyc  = 0;
+		m_core->i_ctrl_stb  = 0;
+		build_crctable();
+	}
+
+	~ENETPACKETS_TB(void) {
+		if (m_trace) {
+			m_trace->close();
+			delete	m_trace;
+		}
+		for(unsigned k=0; k<m_frames.size(); k++)
+			delete	m_frames[k];
+		for(unsigned k=0; k<m_txq.size(); k++)
+			delete	m_txq[k];
+		delete	m_core;
+	}
+
+	void	trace(const char *fname) {
+		if (!m_trace) {
+			m_trace = new VerilatedVcdC;
+			m_core->trace(m_trace, 99);
+			m_trace->open(fname);
+		}
+	}
+
+	void	seed(uint32_t s) { m_seed = (s) ? s : 1; }
+
+	uint32_t	rnd(void) {	// xorshift32
+		m_seed ^= m_seed << 13;
+		m_seed ^= m_seed >> 17;
+		m_seed ^= m_seed << 5;
+		return m_seed;
+	}
+
+	double	sim_seconds(uint64_t ps) { return ps * 1e-12; }
+
+	////////////////////////////////////////////////////////////////////////
+	//
+	// Frame construction
+	//
+	unsigned	pick_length(void) {
+		if (m_imix) {
+			unsigned r = rnd() % 12;
+			if (r < 7)	return 60;
+			if (r < 11)	return 590;
+			return 1514;
+		} else if (m_maxlen > m_minlen)
+			return m_minlen + (rnd() % (m_maxlen - m_minlen + 1));
+		return m_minlen;
+	}
+
+	void	fill_frame(FRAME *f, const uint8_t *dst, const uint8_t *src,
+			unsigned seq, unsigned len) {
+		f->m_len = len;
+		f->m_received = false;
+		f->m_corrupt  = false;
+		memcpy(&f->m_data[0], dst, 6);
+		memcpy(&f->m_data[6], src, 6);
+		f->m_data[12] = (ETHERTYPE >> 8) & 0x0ff;
+		f->m_data[13] =  ETHERTYPE       & 0x0ff;
+		f->m_data[14] = (seq >> 24) & 0x0ff;
+		f->m_data[15] = (seq >> 16) & 0x0ff;
+		f->m_data[16] = (seq >>  8) & 0x0ff;
+		f->m_data[17] =  seq        & 0x0ff;
+		for(unsigned k=18; k<len; k++)
+			f->m_data[k] = rnd() & 0x0ff;
+	}
+
+	void	build_rx_frames(void) {
+		for(unsigned seq=0; seq<m_nframes; seq++) {
+			FRAME	*f = new FRAME;
+			unsigned	r = rnd() % 100, len;
+			uint32_t	crc;
+
+			if (r < m_runtpct) {
+				f->m_kind = FR_RUNT;
+				len = 18 + (rnd() % 42);	// 18..59
+			} else if (r < m_runtpct + m_crcpct) {
+				f->m_kind = FR_CRCERR;
+				len = pick_length();
+			} else {
+				f->m_kind = FR_GOOD;
+				len = pick_length();
+			}
+
+			fill_frame(f, ((seq & 0x0f)==0x0f) ? BROADCAST : HWMAC,
+				PEERMAC, seq, len);
+			crc = ethcrc(f->m_data, len);
+			if (f->m_kind == FR_CRCERR)
+				crc ^= 1u << (rnd() & 31);
+			for(int k=0; k<4; k++)
+				f->m_data[len+k] = (crc >> (8*k)) & 0x0ff;
+			m_frames.push_back(f);
+		}
+	}
+
+	void	build_tx_frames(void) {
+		for(unsigned seq=0; seq<m_ntx; seq++) {
+			FRAME	*f = new FRAME;
+
+			f->m_kind = FR_GOOD;
+			fill_frame(f, PEERMAC, HWMAC, seq, pick_length());
+			m_txq.push_back(f);
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////
+	//
+	// The MII receive generator.  Called on the falling edge of the RX
+	// clock, so that the core sees stable inputs on its next rising edge.
+	//
+	void	rx_generator(void) {
+		if (m_rx_gap > 0) {
+			m_rx_gap--;
+			m_core->i_net_dv  = 0;
+			m_core->i_net_rxd = 0;
+			return;
+		}
+
+		if (m_rx_nibbles == 0) {
+			FRAME	*f;
+
+			if ((!m_rx_enabled)||(m_rx_next >= m_frames.size())) {
+				m_core->i_net_dv  = 0;
+				m_core->i_net_rxd = 0;
+				return;
+			}
+
+			// Load the next frame, preamble and all, onto the wire
+			f = m_frames[m_rx_next];
+			for(int k=0; k<7; k++)
+				m_rx_wire[k] = 0x55;
+			m_rx_wire[7] = 0xd5;
+			memcpy(&m_rx_wire[8], f->m_data, f->m_len+4);
+			m_rx_nibbles = 2*(8 + f->m_len + 4);
+			m_rx_pos = 0;
+			m_rx_octets += f->m_len + 4;
+			if (m_rx_next == 0)
+				m_rx_first_ps = m_time_ps;
+		}
+
+		// MII sends the low nibble of each octet first
+		m_core->i_net_dv  = 1;
+		m_core->i_net_rxd = (m_rx_pos & 1)
+				? (m_rx_wire[m_rx_pos>>1] >> 4) & 0x0f
+				:  m_rx_wire[m_rx_pos>>1] & 0x0f;
+		m_rx_pos++;
+		if (m_rx_pos >= m_rx_nibbles) {
+			m_rx_nibbles = 0;
+			m_rx_gap = m_ipg;
+			m_rx_next++;
+			m_rx_last_ps = m_time_ps;
+		}
+	}
+
+	//
+	// Watch the internal receive pipeline, via o_debug, and record when
+	// each stage first goes valid for the current frame.
+	void	rx_monitor(void) {
+		unsigned	dbg = m_core->o_debug;
+		bool		dv  = m_core->i_net_dv;
+
+		m_rx_ticks++;
+		if ((dv)&&(!(m_last_debug & 0x80000000))) {
+			m_rx_sof  = m_rx_ticks;
+			m_rx_seen = 0;
+		} else if ((!dv)&&(m_last_debug & 0x80000000))
+			m_rx_eof = m_rx_ticks;
+
+		// Preamble removal, CRC, MAC, and memory write stages
+		if ((DBG_NPRE(dbg))&&(!(m_rx_seen & 1))) {
+			m_rx_seen |= 1;
+			m_lat_pre.add(m_rx_ticks - m_rx_sof);
+		} if ((DBG_RXCRC(dbg))&&(!(m_rx_seen & 2))&&(m_rx_seen & 1)) {
+			m_rx_seen |= 2;
+			m_lat_crc.add(m_rx_ticks - m_rx_sof);
+		} if ((DBG_RXMAC(dbg))&&(!(m_rx_seen & 4))&&(m_rx_seen & 2)) {
+			m_rx_seen |= 4;
+			m_lat_mac.add(m_rx_ticks - m_rx_sof);
+		} if ((DBG_RXWR(dbg))&&(!(m_rx_seen & 8))&&(m_rx_seen & 4)) {
+			m_rx_seen |= 8;
+			m_lat_wr.add(m_rx_ticks - m_rx_sof);
+		} if ((DBG_EOP(dbg))&&(!(m_last_debug & 0x40000000))) {
+			m_lat_eop.add(m_rx_ticks - m_rx_eof);
+			m_eop_ps = m_time_ps;
+			m_eop_pending = true;
+		}
+
+		// Keep the prior dv in the (otherwise unused) top bit
+		m_last_debug = (dbg & 0x7fffffff) | ((dv) ? 0x80000000 : 0);
+	}
+
+	////////////////////////////////////////////////////////////////////////
+	//
+	// The MII transmit monitor.  Captures the transmitted nibbles, and
+	// checks each frame once it ends.
+	//
+	void	tx_monitor(void) {
+		bool	en = m_core->o_net_tx_en;
+
+		if ((en)&&(!m_tx_last_en)) {
+			m_tx_sof_ps = m_time_ps;
+			m_lat_txstart.add((m_time_ps - m_tx_cmd_ps)/1000);
+			m_tx_wire.clear();
+		}
+
+		if (en)
+			m_tx_wire.push_back(m_core->o_net_txd & 0x0f);
+		else if (m_tx_last_en) {
+			m_tx_eof_ps = m_time_ps;
+			m_lat_txwire.add((m_tx_eof_ps - m_tx_sof_ps)/1000);
+			tx_check();
+		}
+
+		m_tx_last_en = en;
+	}
+
+	void	tx_check(void) {
+		std::vector<uint8_t>	oct;
+		unsigned	k, nib;
+		FRAME		*f;
+
+		if (m_txq.size() == 0) {
+			printf("TX: Unexpected frame on the wire\n");
+			m_tx_bad++;
+			return;
+		}
+
+		f = m_txq.front();
+		m_txq.pop_front();
+
+		// Find the start of frame delimiter
+		for(nib=0; nib+1<m_tx_wire.size(); nib++)
+			if ((m_tx_wire[nib] == 0x5)&&(m_tx_wire[nib+1] == 0xd))
+				break;
+		nib += 2;
+		for(k=nib; k+1<m_tx_wire.size(); k+=2)
+			oct.push_back(m_tx_wire[k] | (m_tx_wire[k+1]<<4));
+
+		m_tx_captured++;
+		m_tx_octets += oct.size();
+		if (m_tx_first_ps == 0)
+			m_tx_first_ps = m_tx_sof_ps;
+		m_tx_last_ps = m_time_ps;
+
+		// Frames shorter than 60 octets get padded by the core
+		unsigned	explen = (f->m_len < 60) ? 60 : f->m_len;
+		bool		bad = false;
+
+		if (oct.size() != explen + 4)
+			bad = true;
+		else if (ethcrc(oct.data(), explen) != (uint32_t)(oct[explen]
+				| (oct[explen+1]<<8) | (oct[explen+2]<<16)
+				| (oct[explen+3]<<24)))
+			bad = true;
+		else if (memcmp(oct.data(), f->m_data, f->m_len) != 0)
+			bad = true;
+
+		if (bad) {
+			printf("TX: Frame %u (%u octets) mismatch, %u octets on wire\n",
+				m_tx_captured-1, f->m_len, (unsigned)oct.size());
+			m_tx_bad++;
+		}
+		delete	f;
+	}
+
+	////////////////////////////////////////////////////////////////////////
+	//
+	// Clocking
+	//
+	void	tick(void) {
+		unsigned long	mintime = m_wb_clk.time_to_edge();
+
+		if (m_rx_clk.time_to_edge() < mintime)
+			mintime = m_rx_clk.time_to_edge();
+		if (m_tx_clk.time_to_edge() < mintime)
+			mintime = m_tx_clk.time_to_edge();
+
+		m_core->eval();
+		if (m_trace) m_trace->dump(m_time_ps+1);
+
+		m_core->i_wb_clk     = m_wb_clk.advance(mintime);
+		m_core->i_net_rx_clk = m_rx_clk.advance(mintime);
+		m_core->i_net_tx_clk = m_tx_clk.advance(mintime);
+
+		m_time_ps += mintime;
+		m_core->eval();
+		if (m_trace) m_trace->dump(m_time_ps);
+
+		if (m_rx_clk.falling_edge()) {
+			rx_monitor();
+			rx_generator();
+		}
+
+		if (m_tx_clk.falling_edge())
+			tx_monitor();
+
+		if (m_wb_clk.falling_edge()) {
+			// Only count an interrupt that rises after the end of
+			// the packet, not one left over from a prior packet
+			if ((m_eop_pending)&&(m_core->o_rx_int)&&(!m_last_rx_int)) {
+				m_lat_int.add((m_time_ps - m_eop_ps)/1000);
+				m_eop_pending = false;
+			}
+			m_last_rx_int = m_core->o_rx_int;
+		}
+	}
+
+	// Advance through one full cycle of the bus clock
+	void	wb_tick(void) {
+		do {
+			tick();
+		} while(!m_wb_clk.falling_edge());
+	}
+
+	////////////////////////////////////////////////////////////////////////
+	//
+	// Bus access, standing in for the CPU.  Neither bus of this core
+	// ever stalls, and both acknowledge one clock after the request.
+	//
+	unsigned ctrl_read(unsigned a) {
+		int		errcount = 0;
+		unsigned	result;
+
+		m_core->i_ctrl_cyc = 1;
+		m_core->i_ctrl_stb = 1;
+		m_core->i_ctrl_we  = 0;
+		m_core->i_ctrl_addr= a & 7;
+		m_core->i_ctrl_sel = 0x0f;
+		wb_tick();
+		m_core->i_ctrl_stb = 0;
+
+		while((errcount++ < BOMBCOUNT)&&(!m_core->o_ctrl_ack))
+			wb_tick();
+		result = m_core->o_ctrl_data;
+		m_core->i_ctrl_cyc = 0;
+
+		if (errcount >= BOMBCOUNT) {
+			printf("SETTING ERR TO TRUE--NO CTRL ACK\n");
+			m_bomb = true;
+		}
+		return result;
+	}
+
+	void	ctrl_write(unsigned a, unsigned v) {
+		int		errcount = 0;
+
+		m_core->i_ctrl_cyc = 1;
+		m_core->i_ctrl_stb = 1;
+		m_core->i_ctrl_we  = 1;
+		m_core->i_ctrl_addr= a & 7;
+		m_core->i_ctrl_data= v;
+		m_core->i_ctrl_sel = 0x0f;
+		wb_tick();
+		m_core->i_ctrl_stb = 0;
+
+		while((errcount++ < BOMBCOUNT)&&(!m_core->o_ctrl_ack))
+			wb_tick();
+		m_core->i_ctrl_cyc = 0;
+		m_core->i_ctrl_we  = 0;
+
+		if (errcount >= BOMBCOUNT) {
+			printf("SETTING ERR TO TRUE--NO CTRL ACK\n");
+			m_bomb = true;
+		}
+	}
+
+	// A pipelined burst read from packet memory
+	void	mem_read(unsigned a, unsigned len, unsigned *buf) {
+		unsigned	rdidx = 0, errcount = 0;
+
+		m_core->i_wb_cyc = 1;
+		m_core->i_wb_we  = 0;
+		m_core->i_wb_sel = 0x0f;
+		for(unsigned k=0; k<len; k++) {
+			m_core->i_wb_stb = 1;
+			m_core->i_wb_addr= (a+k) & ((2<<MAW)-1);
+			wb_tick();
+			if (m_core->o_wb_ack)
+				buf[rdidx++] = m_core->o_wb_data;
+		}
+		m_core->i_wb_stb = 0;
+
+		while((rdidx < len)&&(errcount++ < (unsigned)BOMBCOUNT)) {
+			wb_tick();
+			if (m_core->o_wb_ack)
+				buf[rdidx++] = m_core->o_wb_data;
+		}
+		m_core->i_wb_cyc = 0;
+
+		if (errcount >= (unsigned)BOMBCOUNT) {
+			printf("SETTING ERR TO TRUE--MISSING MEM ACKS\n");
+			m_bomb = true;
+		}
+	}
+
+	// A pipelined burst write to packet memory
+	void	mem_write(unsigned a, unsigned len, const unsigned *buf) {
+		unsigned	nacks = 0, errcount = 0;
+
+		m_core->i_wb_cyc = 1;
+		m_core->i_wb_we  = 1;
+		m_core->i_wb_sel = 0x0f;
+		for(unsigned k=0; k<len; k++) {
+			m_core->i_wb_stb = 1;
+			m_core->i_wb_addr= (a+k) & ((2<<MAW)-1);
+			m_core->i_wb_data= buf[k];
+			wb_tick();
+			if (m_core->o_wb_ack)
+				nacks++;
+		}
+		m_core->i_wb_stb = 0;
+
+		while((nacks < len)&&(errcount++ < (unsigned)BOMBCOUNT)) {
+			wb_tick();
+			if (m_core->o_wb_ack)
+				nacks++;
+		}
+		m_core->i_wb_cyc = 0;
+		m_core->i_wb_we  = 0;
+
+		if (errcount >= (unsigned)BOMBCOUNT) {
+			printf("SETTING ERR TO TRUE--MISSING MEM ACKS\n");
+			m_bomb = true;
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////
+	//
+	// The "driver": what the CPU would otherwise be doing
+	//
+	void	reset(void) {
+		m_core->i_reset = 1;
+		wb_tick();
+		m_core->i_reset = 0;
+		wb_tick();
+
+		// Set our MAC address, then take the core out of reset with
+		// the hardware MAC, CRC, and IP checks enabled
+		ctrl_write(MACHI, (HWMAC[0]<<8) | HWMAC[1]);
+		ctrl_write(MACLO, (HWMAC[2]<<24) | (HWMAC[3]<<16)
+				| (HWMAC[4]<<8) | HWMAC[5]);
+		ctrl_write(TXCMD, 0);
+		for(int k=0; k<64; k++)
+			wb_tick();
+	}
+
+	void	rx_service(unsigned rxcmd) {
+		unsigned	buf[TXMEM], rxlen, seq;
+		const uint8_t	*ptr;
+		uint8_t		oct[4*TXMEM];
+		uint64_t	start_ps = m_time_ps;
+
+		if (rxcmd & RX_MISS)	m_miss_flags++;
+		if (rxcmd & RX_ERR)	m_err_flags++;
+		if (rxcmd & RX_CRCERR)	m_crc_flags++;
+
+		if (0 == (rxcmd & RX_VALID)) {
+			// Clear any sticky error flags, and move on
+			if (rxcmd & (RX_MISS|RX_ERR|RX_CRCERR))
+				ctrl_write(RXCMD, rxcmd & (RX_MISS|RX_ERR|RX_CRCERR));
+			return;
+		}
+
+		rxlen = rxcmd & 0x03fff;
+		if ((m_readback)&&(rxlen > 0)&&(rxlen <= 4*TXMEM)) {
+			mem_read(0, (rxlen+3)/4, buf);
+			for(unsigned k=0; k<(rxlen+3)/4; k++) {
+				oct[4*k  ] = (buf[k]>>24) & 0x0ff;
+				oct[4*k+1] = (buf[k]>>16) & 0x0ff;
+				oct[4*k+2] = (buf[k]>> 8) & 0x0ff;
+				oct[4*k+3] =  buf[k]      & 0x0ff;
+			}
+		} else {
+			// Just read the header, so we know which frame this is
+			mem_read(0, 3, buf);
+			for(unsigned k=0; k<3; k++) {
+				oct[4*k  ] = (buf[k]>>24) & 0x0ff;
+				oct[4*k+1] = (buf[k]>>16) & 0x0ff;
+				oct[4*k+2] = (buf[k]>> 8) & 0x0ff;
+				oct[4*k+3] =  buf[k]      & 0x0ff;
+			}
+		}
+
+		// Release the buffer (and clear any errors) for the next frame
+		ctrl_write(RXCMD, RX_VALID | (rxcmd & (RX_MISS|RX_ERR|RX_CRCERR)));
+		m_lat_svc.add((m_time_ps - start_ps)/1000);
+
+		// With the hardware MAC enabled, the destination MAC has been
+		// removed: the buffer starts with the source MAC and EtherType
+		ptr = oct;
+		seq = (ptr[8]<<24) | (ptr[9]<<16) | (ptr[10]<<8) | ptr[11];
+		if (seq >= m_frames.size()) {
+			printf("RX: Unknown frame received, seq = 0x%08x\n", seq);
+			m_rx_unknown++;
+			return;
+		}
+
+		FRAME	*f = m_frames[seq];
+		f->m_received = true;
+		m_rx_received++;
+		if (rxlen != f->m_len - 6)
+			f->m_corrupt = true;
+		else if ((m_readback)&&(memcmp(ptr, &f->m_data[6], rxlen)!=0))
+			f->m_corrupt = true;
+		if (f->m_corrupt) {
+			printf("RX: Frame %u corrupt, len %u (expected %u)\n",
+				seq, rxlen, f->m_len - 6);
+			m_rx_corrupt++;
+		}
+	}
+
+	void	tx_start(void) {
+		unsigned	buf[TXMEM], nw;
+		FRAME		*f;
+		const uint8_t	*d;
+
+		f = m_txq[m_tx_sent - m_tx_captured];
+
+		// The core inserts our source MAC, so the buffer holds the
+		// destination MAC, followed by the EtherType and then payload
+		d = f->m_data;
+		unsigned	blen = f->m_len - 6, k;
+		uint8_t		oct[4*TXMEM];
+
+		memcpy(&oct[0], &d[0], 6);
+		memcpy(&oct[6], &d[12], f->m_len-12);
+		nw = (blen+3)/4;
+		memset(&oct[blen], 0, 4*nw - blen);
+		for(k=0; k<nw; k++)
+			buf[k] = (oct[4*k]<<24) | (oct[4*k+1]<<16)
+				| (oct[4*k+2]<<8) | oct[4*k+3];
+
+		mem_write(TXMEM, nw, buf);
+		m_tx_cmd_ps = m_time_ps;
+		ctrl_write(TXCMD, TX_CMD | blen);
+		m_tx_sent++;
+	}
+
+	bool	run(void) {
+		unsigned	rxcmd, txcmd;
+		bool		tx_was_busy = false;
+		unsigned long	idle = 0, stuck = 0;
+		unsigned	progress, last_progress = 0;
+
+		build_rx_frames();
+		build_tx_frames();
+
+		reset();
+		m_rx_enabled = true;
+
+		while(!m_bomb) {
+			rxcmd = ctrl_read(RXCMD);
+			rx_service(rxcmd);
+
+			txcmd = ctrl_read(TXCMD);
+			if (tx_was_busy && !(txcmd & TX_BUSY))
+				m_lat_txdone.add((m_time_ps - m_tx_eof_ps)/1000);
+			tx_was_busy = (txcmd & TX_BUSY) ? true : false;
+
+			if ((!tx_was_busy)&&(m_tx_sent == m_tx_captured)
+					&&(m_tx_sent < m_ntx)) {
+				tx_start();
+				tx_was_busy = true;
+			}
+
+			if ((m_rx_next >= m_frames.size())
+					&&(m_tx_captured >= m_ntx)
+					&&(!(rxcmd & (RX_VALID|RX_BUSY)))) {
+				// Allow the pipeline to drain before quitting
+				if (++idle > 256)
+					break;
+			} else
+				idle = 0;
+
+			// Bomb if nothing moves for a (simulated) few ms
+			progress = m_rx_next + m_rx_received + m_tx_captured;
+			if (progress != last_progress)
+				stuck = 0;
+			else if (++stuck > 20000) {
+				printf("SETTING ERR TO TRUE--NO PROGRESS\n");
+				m_bomb = true;
+			}
+			last_progress = progress;
+		}
+
+		return !m_bomb;
+	}
+
+	////////////////////////////////////////////////////////////////////////
+	//
+	// The final report
+	//
+	bool	report(FILE *fp) {
+		unsigned	good = 0, good_rx = 0, crc = 0, crc_rx = 0,
+				runt = 0, runt_rx = 0;
+		double		rxsec, txsec;
+
+		for(unsigned k=0; k<m_frames.size(); k++) {
+			FRAME	*f = m_frames[k];
+			switch(f->m_kind) {
+			case FR_GOOD:	good++; if (f->m_received) good_rx++;
+				break;
+			case FR_CRCERR: crc++;  if (f->m_received) crc_rx++;
+				break;
+			case FR_RUNT:	runt++; if (f->m_received) runt_rx++;
+				break;
+			}
+		}
+
+		rxsec = sim_seconds(m_rx_last_ps - m_rx_first_ps);
+		txsec = sim_seconds(m_tx_last_ps - m_tx_first_ps);
+
+		fprintf(fp, "\nENETPACKETS LOAD TEST\n");
+		fprintf(fp, "Simulated time: %.6f s\n", sim_seconds(m_time_ps));
+		fprintf(fp, "\nRX: %u frames offered, %lu octets, in %.6f s"
+			" (%.2f Mb/s offered)\n", (unsigned)m_frames.size(),
+			(unsigned long)m_rx_octets, rxsec,
+			(rxsec > 0) ? 8e-6 * m_rx_octets / rxsec : 0.0);
+		fprintf(fp, "  Good frames      %8u offered %8u received %8u dropped\n",
+			good, good_rx, good - good_rx);
+		fprintf(fp, "  CRC errors       %8u offered %8u accepted\n",
+			crc, crc_rx);
+		fprintf(fp, "  Runts            %8u offered %8u accepted\n",
+			runt, runt_rx);
+		fprintf(fp, "  Corrupt frames   %8u\n", m_rx_corrupt);
+		fprintf(fp, "  Unknown frames   %8u\n", m_rx_unknown);
+		fprintf(fp, "  Status flags     %8u MISS %8u ERR %8u CRCERR\n",
+			m_miss_flags, m_err_flags, m_crc_flags);
+		if (rxsec > 0)
+			fprintf(fp, "  Throughput       %.1f frames/s\n",
+				m_rx_received / rxsec);
+
+		fprintf(fp, "\nTX: %u frames sent, %u captured, %u bad, %lu octets",
+			m_tx_sent, m_tx_captured, m_tx_bad,
+			(unsigned long)m_tx_octets);
+		if (txsec > 0)
+			fprintf(fp, " (%.1f frames/s, %.2f Mb/s)",
+				m_tx_captured / txsec,
+				8e-6 * m_tx_octets / txsec);
+		fprintf(fp, "\n");
+
+		fprintf(fp, "\nLatency                             min     mean      max\n");
+		m_lat_pre.report(fp,  "RX SOF -> preamble stripped", "rx clks");
+		m_lat_crc.report(fp,  "RX SOF -> CRC stage", "rx clks");
+		m_lat_mac.report(fp,  "RX SOF -> MAC stage", "rx clks");
+		m_lat_wr.report(fp,   "RX SOF -> memory write", "rx clks");
+		m_lat_eop.report(fp,  "RX EOF -> end of packet", "rx clks");
+		m_lat_int.report(fp,  "RX end of packet -> int", "ns");
+		m_lat_svc.report(fp,  "RX service (read+clear)", "ns");
+		m_lat_txstart.report(fp, "TX command -> TX enable", "ns");
+		m_lat_txwire.report(fp,  "TX time on the wire", "ns");
+		m_lat_txdone.report(fp,  "TX end -> !BUSY seen", "ns");
+
+		return (m_rx_corrupt == 0)&&(m_rx_unknown == 0)
+			&&(crc_rx == 0)&&(m_tx_bad == 0)
+			&&(m_tx_captured == m_ntx)&&(good_rx > 0);
+	}
+};
+
+void	usage(void) {
+	fprintf(stderr, "USAGE: enetpackets_tb [-h] [options]\n");
+	fprintf(stderr,
+"\t-n <nframes>\tNumber of frames to receive (default 1000)\n"
+"\t-x <nframes>\tNumber of frames to transmit (default 100)\n"
+"\t-l <min>[:<max>]\n"
+"\t\tFrame length in octets, excluding the CRC.  Given a range, lengths\n"
+"\t\tare uniformly distributed between min and max.  (Default: 60)\n"
+"\t-i\tUse an IMIX (7:4:1 of 64, 594, and 1518 octet frames)\n"
+"\t-g <nibbles>\tInterframe gap, in nibbles (default and minimum 24)\n"
+"\t-c <pct>\tPercentage of frames with a corrupted CRC\n"
+"\t-r <pct>\tPercentage of runt frames\n"
+"\t-q\tDon't read the received frames back out of memory\n"
+"\t-s <seed>\tSeed for the traffic generator\n"
+"\t-t <filename>\n"
+"\t\tTurns on tracing, sends the trace to <filename>--assumed to\n"
+"\t\tbe a vcd file\n");
+}
+
+int main(int  argc, char **argv) {
+	Verilated::commandArgs(argc, argv);
+	ENETPACKETS_TB	*tb = new ENETPACKETS_TB;
+	const char	*trace_file = NULL;
+	time_t		start_time;
+	bool		pass;
+
+	for(int argn=1; argn < argc; argn++) {
+		if (argv[argn][0] != '-') {
+			usage();
+			exit(EXIT_FAILURE);
+		} else if ((argv[argn][1])&&(strchr("nxlgcrst", argv[argn][1]))
+				&&(argn+1 >= argc)) {
+			fprintf(stderr, "ERR: -%c requires an argument\n",
+				argv[argn][1]);
+			exit(EXIT_FAILURE);
+		}
+
+		switch(argv[argn][1]) {
+		case 'n': tb->m_nframes = strtoul(argv[++argn], NULL, 0); break;
+		case 'x': tb->m_ntx = strtoul(argv[++argn], NULL, 0); break;
+		case 'l': {
+			char	*ptr;
+			tb->m_minlen = strtoul(argv[++argn], &ptr, 0);
+			tb->m_maxlen = (*ptr == ':')
+				? strtoul(ptr+1, NULL, 0) : tb->m_minlen;
+			} break;
+		case 'i': tb->m_imix = true; break;
+		case 'g': tb->m_ipg = strtoul(argv[++argn], NULL, 0); break;
+		case 'c': tb->m_crcpct = strtoul(argv[++argn], NULL, 0); break;
+		case 'r': tb->m_runtpct = strtoul(argv[++argn], NULL, 0); break;
+		case 'q': tb->m_readback = false; break;
+		case 's': tb->seed(strtoul(argv[++argn], NULL, 0)); break;
+		case 't': trace_file = argv[++argn]; break;
+		case 'h': usage(); exit(EXIT_SUCCESS); break;
+		default:
+			fprintf(stderr, "ERR: Unexpected flag, %s\n\n",
+				argv[argn]);
+			usage();
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (tb->m_minlen < 18)
+		tb->m_minlen = 18;
+	if (tb->m_ipg < 24)
+		tb->m_ipg = 24;
+	if (tb->m_maxlen > MAXFRAME)
+		tb->m_maxlen = MAXFRAME;
+	if (tb->m_maxlen < tb->m_minlen)
+		tb->m_maxlen = tb->m_minlen;
+	if (tb->m_crcpct + tb->m_runtpct > 100) {
+		fprintf(stderr, "ERR: More than 100%% of frames are in error\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (trace_file)
+		tb->trace(trace_file);
+
+	start_time = time(NULL);
+	pass = tb->run();
+	pass = tb->report(stdout) && pass;
+	printf("\nWall clock time: %ld s\n", (long)(time(NULL) - start_time));
+
+	delete	tb;
+	if (pass) {
+		printf("SUCCESS!!\n");
+		exit(EXIT_SUCCESS);
+	}
+
+	printf("TEST FAILED\n");
+	exit(EXIT_FAILURE);
+}
@@ -129,7 +129,7 @@ public:
 		// If you have any simulation components, create a
 		// SIM.DEFNS tag to have those components defined here
 		// as part of the main_tb.cpp function.
-	OLEDWIN		m_oledrgb;
+	OLEDSIM		m_oledrgb;
 #ifdef	SDRAM_ACCESS
 	MEMSIM	*m_sdram;
 #endif	// SDRAM_ACCESS
@@ -151,8 +151,6 @@ public:
 		// create a SIM.INIT tag.  That tag's value will be pasted
 		// here.
 		//
-		// From oledrgb
-		Glib::signal_idle().connect(sigc::mem_fun((*this),&MAINTB::on_tick));
 		// From sdram
 #ifdef	SDRAM_ACCESS
 		m_sdram = new MEMSIM(0x10000000);
@@ -170,7 +168,11 @@ public:
 #endif // FLASH_ACCESS
 		// From wbu
 		m_wbu = new DBLUARTSIM();
+#ifdef	FASTUART
+		m_wbu->setup(FASTUART);
+#else
 		m_wbu->setup(81);
+#endif
 		// From mdio
 #ifdef	NETCTRL_ACCESS
 		m_mdio = new ENETCTRLSIM;
@@ -481,34 +483,27 @@ public:
 	// define this tag by those functions (or other sim code), and
 	// it will be pasated here.
 	//
-	bool	on_tick(void) {
-		if (!m_done) {
-			tick();
-			return true;
-		 } else
-			return false;
-	}
 #ifdef	INCLUDE_ZIPCPU
-	void	loadelf(const char *elfname) {
-		ELFSECTION	**secpp, *secp;
-		uint32_t	entry;
-
-		elfread(elfname, entry, secpp);
+	// Loads the program's segments straight from the mapped ELF file,
+	// and returns its entry address
+	uint32_t	loadelf(const char *elfname) {
+		ELFFILE			elf(elfname);
+		const ELFSEGMENT	*segp;
 
-		for(int s=0; secpp[s]->m_len; s++) {
+		for(int s=0; elf.segments()[s].m_len; s++) {
 			bool	successful_load;
-			secp = secpp[s];
+			segp = &elf.segments()[s];
 
-			successful_load = load(secp->m_start,
-				secp->m_data, secp->m_len);
+			successful_load = load(segp->m_start,
+				segp->m_data, segp->m_len);
 
 			if (!successful_load) {
 				printf("Could not load section "
 					"from %08x to %08x--no such address\n",
-					secp->m_start,
-					secp->m_start+secp->m_len);
+					segp->m_start,
+					segp->m_start+segp->m_len);
 			}
-		} free(secpp);
+		} return elf.entry();
 	}
 
 
@@ -5,10 +5,11 @@
 // Project:	OpenArty, an entirely open SoC based upon the Arty platform
 //
 // Purpose:	The goal of this module is very specifically to simulate the 
-//		PModOLEDrgb using a GTKMM controlled window.  I'm doing this on
-//	an Linux computer with X-Windows, although one GTKMM selling point is
-//	that it should work in Windows as well.  I won't vouch for that, as I
-//	haven't tested under windows.
+//		PModOLEDrgb.  The display memory is kept in a plain frame
+//	buffer, so the simulation never waits on a GUI.  Whenever the display
+//	changes, at most once per (simulated) display refresh, the frame is
+//	published: it may be written to a PNG or raw file, and it may be picked
+//	up by the GTKMM viewer in oledview.cpp from another thread.
 //
 //	Either way, this controller only implements *some* of the OLED commands.
 //	There were just too many commands for me to be able to write them in the
@@ -55,9 +56,12 @@
 ////////////////////////////////////////////////////////////////////////////////
 //
 //
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "oledsim.h"
 
-const	int	OLEDSIM::OLED_HEIGHT = 64, OLEDSIM::OLED_WIDTH = 96;
+const	int	OLEDSIM::OLED_HEIGHT, OLEDSIM::OLED_WIDTH;
 
 const	int	MICROSECOND = 81,
 		tMINRESET = 3  * MICROSECOND, // 3 uS
@@ -67,57 +71,238 @@ const	int	MICROSECOND = 81,
 		tCSS   =  7, // 75 * NANOSECOND, chip select setup
 		tCSH   =  5, // 60 * NANOSECOND, chip select hold
 		tCLKL  =  7, // 75 * NANOSECOND, time the clock must be low
-		tCLKH  =  7; // 75 * NANOSECOND, time the clock must be high
+		tCLKH  =  7, // 75 * NANOSECOND, time the clock must be high
+		tFRAME = 16667 * MICROSECOND; // 60Hz display refresh
 
-void	OLEDSIM::on_realize() {
-	Gtk::DrawingArea::on_realize();
+OLEDSIM::OLEDSIM(void) {
+	m_state = OLED_OFF;
+	m_locked = true;
+	m_last_csn = 1;
+	m_last_sck = 1;
+	m_last_dcn = 1;
+	m_idx = 0;
+	m_bitpos = 0;
+	m_format = OLED_65kCLR;
+	m_display_start_row = 0;
+	m_vaddr_inc = false;
+	m_fill = false;
+	m_col = 0; m_row = 0;
+	m_col_start = 0; m_row_start = 0;
+	m_col_end = 95; m_row_end = 63;
 
-	// We'll be doing all of our drawing on an off-screen bit map.  Here,
-	// let's allocate that pixel map ...
-	m_pix = Cairo::ImageSurface::create(Cairo::FORMAT_RGB24,
-			OLED_WIDTH, OLED_HEIGHT);
+	m_frame_seq = 0;
+	m_dirty = false;
+	m_clocks = 0;
+	m_frame_clocks = tFRAME;
+	m_dump_fname = NULL;
 
-	// and a graphics context to be used when drawing to it.
-	m_gc = Cairo::Context::create(m_pix);
+	m_log_level   = OLED_LOG_CMD;
+	m_print_level = OLED_LOG_ERR;
+	m_total_clocks= 0;
+	m_log_head    = 0;
+	m_log_count   = 0;
 
-	// We'll start the pixel map filled with all black, as this is what
+	m_ncmds = m_npixels = m_nsame = m_nxfers = m_nignored = 0;
+	m_frame_cmds = m_frame_pixels = 0;
+	m_max_frame_cmds = m_max_frame_pixels = m_nframes = 0;
+	memset(m_ncmd_hist, 0, sizeof(m_ncmd_hist));
+
+	// We'll start the display filled with all black, as this is what
 	// my device looks like when I'm not doing anything with it.
-	m_gc->set_source_rgb(0.0,0.0,0.0); // Black
-	m_gc->rectangle(0, 0, OLED_WIDTH, OLED_HEIGHT);
-	m_gc->fill();
+	clear_to(0.0);
+	memset(m_frame, 0, sizeof(m_frame));
 }
 
-void	OLEDSIM::get_preferred_width_vfunc(int &min, int &nw) const {
-	// GTKMM wants to know how big we want our window to be.
-	// Let's request a window twice as big as we need, but insist that
-	// it never be smaller than one pixel output per one pixel input.
-	//
-	min = OLED_WIDTH;
-	nw = OLED_WIDTH * 2;
+OLEDSIM::~OLEDSIM(void) {
+	// Make certain the last frame makes it out
+	if (m_dirty)
+		publish();
+	free(m_dump_fname);
 }
 
-void	OLEDSIM::get_preferred_height_vfunc(int &min, int &nw) const {
-	//
-	// Same thing as above, but this time for height, not width.
-	//
-	min = OLED_HEIGHT;
-	nw = OLED_HEIGHT * 2;
+void	OLEDSIM::dump(const char *fname) {
+	free(m_dump_fname);
+	m_dump_fname = (fname) ? strdup(fname) : NULL;
 }
 
-void	OLEDSIM::get_preferred_width_for_height_vfunc(int h, int &min, int &nw) const {
-	min = OLED_WIDTH;
-	int k = (h+(OLED_HEIGHT/2))/OLED_HEIGHT;
-	if (k <= 0)
-		k = 1;
-	nw = OLED_WIDTH * k;
+unsigned	OLEDSIM::frame(uint32_t *buf) {
+	std::lock_guard<std::mutex>	guard(m_lock);
+
+	memcpy(buf, m_frame, sizeof(m_frame));
+	return m_frame_seq;
 }
 
-void	OLEDSIM::get_preferred_height_for_width_vfunc(int w, int &min, int &nw) const {
-	min = OLED_HEIGHT;
-	int k = (w+(OLED_WIDTH/2))/OLED_WIDTH;
-	if (k <= 0)
-		k = 1;
-	nw = OLED_HEIGHT * k;
+void	OLEDSIM::set_state(const int state) {
+	uint8_t	d = state;
+
+	m_state = state;
+	m_dirty = true;
+	log(OLED_LOG_INFO, OLEV_STATE, 1, &d);
+}
+
+/*
+ * publish()
+ *
+ * Copy the display, as it would appear given our current state, into the
+ * frame that viewers see, and dump it to a file if requested.
+ */
+void	OLEDSIM::publish(void) {
+	{
+		std::lock_guard<std::mutex>	guard(m_lock);
+
+		if (m_state == OLED_POWERED) {
+			// Scrolling will be implemented here
+			memcpy(m_frame, m_gddram, sizeof(m_frame));
+		} else {
+			uint32_t	v;
+
+			if ((m_state == OLED_VIO)||(m_state == OLED_RESET))
+				v = 0x1a1a1a;	// DARK gray
+			else
+				v = 0;		// Black
+			for(int r=0; r<OLED_HEIGHT; r++)
+				for(int c=0; c<OLED_WIDTH; c++)
+					m_frame[r][c] = v;
+		}
+		m_frame_seq++;
+	}
+
+	m_nframes++;
+	if (m_frame_cmds > m_max_frame_cmds)
+		m_max_frame_cmds = m_frame_cmds;
+	if (m_frame_pixels > m_max_frame_pixels)
+		m_max_frame_pixels = m_frame_pixels;
+	m_frame_cmds = 0;
+	m_frame_pixels = 0;
+
+	m_dirty = false;
+	if (m_dump_fname)
+		dump_frame();
+}
+
+static	uint32_t	pngcrc(uint32_t crc, const uint8_t *buf, unsigned len) {
+	static	uint32_t	table[256];
+	static	bool		built = false;
+
+	if (!built) {
+		for(unsigned k=0; k<256; k++) {
+			uint32_t	c = k;
+			for(int b=0; b<8; b++)
+				c = (c & 1) ? (c >> 1) ^ 0xedb88320 : (c >> 1);
+			table[k] = c;
+		} built = true;
+	}
+
+	crc = ~crc;
+	for(unsigned k=0; k<len; k++)
+		crc = table[(crc ^ buf[k]) & 0x0ff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static	void	pngchunk(FILE *fp, const char *id, const uint8_t *buf,
+			unsigned len) {
+	uint8_t		hdr[8];
+	uint32_t	crc;
+
+	hdr[0] = (len >> 24)&0x0ff; hdr[1] = (len >> 16)&0x0ff;
+	hdr[2] = (len >>  8)&0x0ff; hdr[3] =  len       &0x0ff;
+	memcpy(&hdr[4], id, 4);
+	fwrite(hdr, 1, 8, fp);
+	if (len > 0)
+		fwrite(buf, 1, len, fp);
+	crc = pngcrc(pngcrc(0, &hdr[4], 4), buf, len);
+	hdr[0] = (crc >> 24)&0x0ff; hdr[1] = (crc >> 16)&0x0ff;
+	hdr[2] = (crc >>  8)&0x0ff; hdr[3] =  crc       &0x0ff;
+	fwrite(hdr, 1, 4, fp);
+}
+
+/*
+ * dump_frame()
+ *
+ * Write the current frame to a file.  PNG files are written using stored
+ * (uncompressed) deflate blocks.  The frame is small enough to fit in one
+ * such block, and this keeps us from needing any image library.
+ */
+void	OLEDSIM::dump_frame(void) {
+	const	unsigned	ROWLEN = 1+3*OLED_WIDTH,
+				RAWLEN = ROWLEN * OLED_HEIGHT;
+	static_assert(RAWLEN < 65536, "OLED frame too big for one PNG block");
+	char		fname[512];
+	const char	*ext;
+	FILE		*fp;
+
+	if (strchr(m_dump_fname, '%'))
+		snprintf(fname, sizeof(fname), m_dump_fname, m_frame_seq);
+	else {
+		strncpy(fname, m_dump_fname, sizeof(fname)-1);
+		fname[sizeof(fname)-1] = '\0';
+	}
+
+	fp = fopen(fname, "wb");
+	if (!fp) {
+		fprintf(stderr, "OLEDSIM: Cannot open %s\n", fname);
+		return;
+	}
+
+	ext = strrchr(fname, '.');
+	if ((ext)&&(strcasecmp(ext, ".png")==0)) {
+		static const uint8_t	PNGSIG[8] = { 0x89, 'P', 'N', 'G',
+						'\r', '\n', 0x1a, '\n' };
+		uint8_t		ihdr[13], idat[2+5+RAWLEN+4], *raw;
+		uint32_t	s1 = 1, s2 = 0;
+
+		fwrite(PNGSIG, 1, sizeof(PNGSIG), fp);
+
+		ihdr[0] = ihdr[1] = ihdr[2] = 0; ihdr[3] = OLED_WIDTH;
+		ihdr[4] = ihdr[5] = ihdr[6] = 0; ihdr[7] = OLED_HEIGHT;
+		ihdr[8] = 8;	// Bits per sample
+		ihdr[9] = 2;	// Truecolor, RGB
+		ihdr[10] = ihdr[11] = ihdr[12] = 0;
+		pngchunk(fp, "IHDR", ihdr, sizeof(ihdr));
+
+		// ZLIB header, followed by one final stored block
+		idat[0] = 0x78; idat[1] = 0x01;
+		idat[2] = 1;
+		idat[3] =  RAWLEN     & 0x0ff; idat[4] = (RAWLEN>>8) & 0x0ff;
+		idat[5] = ~RAWLEN     & 0x0ff; idat[6] =(~RAWLEN>>8) & 0x0ff;
+		raw = &idat[7];
+		for(int r=0; r<OLED_HEIGHT; r++) {
+			uint8_t	*rp = &raw[r*ROWLEN];
+			*rp++ = 0;	// No filter
+			for(int c=0; c<OLED_WIDTH; c++) {
+				*rp++ = (m_frame[r][c] >> 16) & 0x0ff;
+				*rp++ = (m_frame[r][c] >>  8) & 0x0ff;
+				*rp++ =  m_frame[r][c]        & 0x0ff;
+			}
+		}
+
+		// Adler-32 of the uncompressed data
+		for(unsigned k=0; k<RAWLEN; k++) {
+			s1 = (s1 + raw[k]) % 65521;
+			s2 = (s2 + s1) % 65521;
+		}
+		s1 |= (s2 << 16);
+		idat[7+RAWLEN  ] = (s1 >> 24) & 0x0ff;
+		idat[7+RAWLEN+1] = (s1 >> 16) & 0x0ff;
+		idat[7+RAWLEN+2] = (s1 >>  8) & 0x0ff;
+		idat[7+RAWLEN+3] =  s1        & 0x0ff;
+		pngchunk(fp, "IDAT", idat, sizeof(idat));
+		pngchunk(fp, "IEND", NULL, 0);
+	} else {
+		uint8_t	pix[3*OLED_WIDTH];
+
+		if ((ext)&&(strcasecmp(ext, ".ppm")==0))
+			fprintf(fp, "P6\n%d %d\n255\n", OLED_WIDTH, OLED_HEIGHT);
+		for(int r=0; r<OLED_HEIGHT; r++) {
+			for(int c=0; c<OLED_WIDTH; c++) {
+				pix[3*c  ] = (m_frame[r][c] >> 16) & 0x0ff;
+				pix[3*c+1] = (m_frame[r][c] >>  8) & 0x0ff;
+				pix[3*c+2] =  m_frame[r][c]        & 0x0ff;
+			} fwrite(pix, 1, sizeof(pix), fp);
+		}
+	}
+
+	fclose(fp);
 }
 
 /*
@@ -125,38 +310,45 @@ void	OLEDSIM::get_preferred_height_for_width_vfunc(int w, int &min, int &nw) con
  * every tick of our controller within Verilator.  At each tick (and not twice
  * per tick), the outputs are gathered and sent our way.  Here, we just decode
  * the power and reset outputs, and send everything else to handle_io().
+ * Once per display refresh, if anything has changed, we also publish a new
+ * frame.
  */
 void	OLEDSIM::operator()(const int iopwr, const int rstn, const int dpwr,
 		const int csn, const int sck, const int dcn, const int mosi) {
+	m_total_clocks++;
+	if (++m_clocks >= m_frame_clocks) {
+		m_clocks = 0;
+		if (m_dirty)
+			publish();
+	}
+
 	if (!iopwr) {
 		if (m_state != OLED_OFF) {
-fprintf(stderr, "OLEDSIM::TURN-OFF\n");
-			m_state = OLED_OFF;
+			set_state(OLED_OFF);
 			clear_to(0.0);
-			queue_draw_area(0,0,get_width(), get_height());
 		}
 		assert(!dpwr);
 	} else if (!rstn) {
 		if (m_state != OLED_RESET) {
-fprintf(stderr, "OLEDSIM::ENTER-RESET\n");
-			m_state = OLED_RESET;
+			set_state(OLED_RESET);
 			m_locked = true;
 			clear_to(0.1);
 			m_reset_clocks = 0;
-			queue_draw_area(0,0,get_width(), get_height());
 		} if (m_reset_clocks < tMINRESET)
 			m_reset_clocks++;
 		assert(csn);
 		assert(sck);
 	} else if (dpwr) {
 		if (m_state != OLED_POWERED) {
-fprintf(stderr, "OLEDSIM::POWER-UP\n");
-			m_state = OLED_POWERED;
-			queue_draw_area(0,0,get_width(), get_height());
+			set_state(OLED_POWERED);
 			if (!csn) {
-				printf("OLED-ERR: CSN=%d, SCK=%d, DCN=%d, MOSI=%d, from %d,%d,%d\n",
-				csn, sck, dcn, mosi,
-				m_last_csn, m_last_sck, m_last_dcn);
+				uint8_t	d[8] = { OLERR_CSN_AT_POWERUP,
+					(uint8_t)csn, (uint8_t)sck,
+					(uint8_t)dcn, (uint8_t)mosi,
+					(uint8_t)m_last_csn,
+					(uint8_t)m_last_sck,
+					(uint8_t)m_last_dcn };
+				log(OLED_LOG_ERR, OLEV_ERROR, 8, d);
 			}
 			assert(csn); // Can't power up with SPI active.
 		}
@@ -164,9 +356,7 @@ fprintf(stderr, "OLEDSIM::POWER-UP\n");
 		handle_io(csn, sck, dcn, mosi);
 	} else {
 		if (m_state != OLED_VIO) {
-fprintf(stderr, "OLEDSIM::VIO\n");
-			m_state = OLED_VIO;
-			queue_draw_area(0,0,get_width(), get_height());
+			set_state(OLED_VIO);
 		}
 		handle_io(csn, sck, dcn, mosi);
 	}
@@ -182,15 +372,17 @@ fprintf(stderr, "OLEDSIM::VIO\n");
  *
  */
 void	OLEDSIM::handle_io(const int csn, const int sck, const int dcn, const int mosi) {
-	if ((csn != m_last_csn)||(sck != m_last_sck)||(dcn != m_last_dcn))
-		printf("OLED: HANDLE-IO(%d,%d,%d,%d) @[%d]%d\n",
-			csn, sck, dcn, mosi, m_idx, m_bitpos);
+	if ((csn != m_last_csn)||(sck != m_last_sck)||(dcn != m_last_dcn)) {
+		uint8_t	d[6] = { (uint8_t)csn, (uint8_t)sck, (uint8_t)dcn,
+				(uint8_t)mosi, (uint8_t)m_idx, (uint8_t)m_bitpos };
+		log(OLED_LOG_IO, OLEV_IO, 6, d);
+	}
+
 	if (csn) {
 		// CSN is high when the chip isn't selected.
 		if (!m_last_csn) {
 			// If the chip was just selected, it then means that our
 			// command just completed.  Let's process it here.
-			printf("OLED: Ending a command\n");
 			assert(m_idx > 0);
 			assert((m_bitpos&7)==0);
 			do_command(m_last_dcn, m_idx, m_data);
@@ -200,10 +392,14 @@ void	OLEDSIM::handle_io(const int csn, const int sck, const int dcn, const int m
 			for(int i=0; i<8; i++)
 				m_data[i] = 0;
 			assert(m_last_sck);
-		} if (!sck)
-			printf("OLED: CSN = %d, SCK = %d, DCN = %d, MOSI = %d, from %d, %d, %d\n",
-				csn, sck, dcn, mosi,
-				m_last_csn, m_last_sck, m_last_dcn);
+		} if (!sck) {
+			uint8_t	d[8] = { OLERR_SCK_IDLE,
+				(uint8_t)csn, (uint8_t)sck,
+				(uint8_t)dcn, (uint8_t)mosi,
+				(uint8_t)m_last_csn, (uint8_t)m_last_sck,
+				(uint8_t)m_last_dcn };
+			log(OLED_LOG_ERR, OLEV_ERROR, 8, d);
+		}
 		assert(sck);
 		m_bitpos = 0;
 		m_idx    = 0;
@@ -211,7 +407,6 @@ void	OLEDSIM::handle_io(const int csn, const int sck, const int dcn, const int m
 		if (m_last_csn) {
 			assert((sck)&&(m_last_sck));
 			assert(m_last_sck);
-			printf("OLED: Starting a command\n");
 		}
 
 		/*
@@ -223,8 +418,6 @@ void	OLEDSIM::handle_io(const int csn, const int sck, const int dcn, const int m
 		if ((sck)&&(!m_last_sck)) {
 			m_bitpos++;
 			m_data[m_idx] = (m_data[m_idx]<<1)|mosi;
-			printf("OLED: Accepted bit: m_data[%d] = %02x\n",
-				m_idx, m_data[m_idx]);
 			if (m_bitpos >= 8) {
 				m_idx++;
 				m_bitpos &= 7;
@@ -241,19 +434,10 @@ void	OLEDSIM::handle_io(const int csn, const int sck, const int dcn, const int m
 }
 
 void	OLEDSIM::do_command(const int dcn, const int len, char *data) {
-fprintf(stderr, "DO-COMMAND\n");
 	assert(len > 0);
 	assert(len <= 11);
 
-	printf("OLED: RECEIVED CMD(%02x) ", data[0]&0x0ff);
-	if (len > 1) {
-		printf(" - ");
-		for(int i=1; i<len-1; i++)
-			printf("%02x:", data[i]&0x0ff);
-		printf("%02x", data[len-1]&0x0ff);
-		printf("\n");
-	}
-	
+	m_nxfers++;
 	if (dcn) {
 		// Do something with the pixmap
 		double	dr, dg, db;
@@ -269,7 +453,8 @@ fprintf(stderr, "DO-COMMAND\n");
 			dg = g / 63.0;
 			db = b / 31.0;
 		} else {
-			printf("OLED: UNSUPPORTED COLOR FORMAT!\n");
+			uint8_t	d[2] = { OLERR_COLOR_FORMAT, (uint8_t)m_format };
+			log(OLED_LOG_ERR, OLEV_ERROR, 2, d);
 			dr = dg = db = 0.0;
 		} set_gddram(m_col, m_row, dr, dg, db);
 		if (!m_vaddr_inc) {
@@ -291,13 +476,20 @@ fprintf(stderr, "DO-COMMAND\n");
 		}
 	} else if (m_locked) {
 		if ((len == 2)&&((data[0]&0x0ff) == 0x0fd)&&(data[1] == 0x12)) {
+			uint8_t	d = 0;
 			m_locked = false;
-			printf("OLED: COMMANDS UNLOCKED\n");
+			log(OLED_LOG_INFO, OLEV_LOCK, 1, &d);
 		} else {
-			printf("OLED: COMMAND IGNORED, IC LOCKED\n");
+			m_nignored++;
+			log(OLED_LOG_INFO, OLEV_IGNORED, len, (uint8_t *)data);
 		}
 	} else {
 		// Command word
+		m_ncmds++;
+		m_frame_cmds++;
+		m_ncmd_hist[data[0]&0x0ff]++;
+		log(OLED_LOG_CMD, OLEV_CMD, len, (uint8_t *)data);
+
 		switch((data[0])&0x0ff) {
 		case 0x15: // Setup column start and end address
 			assert(len == 3);
@@ -312,9 +504,10 @@ fprintf(stderr, "DO-COMMAND\n");
 			assert(len == 3);
 			assert((data[1]&0x0ff) <= 63);
 			assert((data[2]&0x0ff) <= 63);
-			assert(m_row_end >= m_row_start);
 			m_row_start = data[1]&0x0ff;
 			m_row_end   = data[2]&0x0ff;
+			assert(m_row_end >= m_row_start);
+			m_row = m_row_start;
 			break;
 		case 0x81: // Set constrast for all color "A" segment
 			assert(len == 2);
@@ -406,8 +599,9 @@ fprintf(stderr, "DO-COMMAND\n");
 		case 0xfd: // Set command lock
 			assert(len == 2);
 			if (data[1] == 0x16) {
+				uint8_t	d = 1;
 				m_locked = true;
-				printf("OLED: COMMANDS NOW LOCKED\n");
+				log(OLED_LOG_INFO, OLEV_LOCK, 1, &d);
 			}
 			break;
 		case 0x21: // Draw Line
@@ -415,20 +609,30 @@ fprintf(stderr, "DO-COMMAND\n");
 			break;
 		case 0x22: // Draw Rectangle
 			assert(len == 11);
+			draw_rect(data);
 			break;
 		case 0x23: // Copy
 			assert(len == 7);
+			copy_rect(data);
 			break;
 		case 0x24: // Dim Window
 			assert(len == 5);
 			break;
 		case 0x25: // Clear Window
 			assert(len == 5);
+			{
+				char	black[11] = { 0x22,
+					data[1], data[2], data[3], data[4],
+					0, 0, 0, 0, 0, 0 };
+				bool	fill = m_fill;
+				m_fill = true;
+				draw_rect(black);
+				m_fill = fill;
+			}
 			break;
 		case 0x26: // Fill Enable/Disable
 			assert(len == 2);
-			// if (data[0]&1)
-			//	m_drect_fills = 1;
+			m_fill = (data[1]&1) ? true : false;
 			assert((data[1] & 0x10)==0);
 			break;
 		case 0x27: // Continuous horizontal and vertical scrolling setup
@@ -443,7 +647,11 @@ fprintf(stderr, "DO-COMMAND\n");
 			// m_scrolling = true;
 			break;
 		default:
-			printf("OLED: UNKNOWN COMMAND, data[0] = %02x\n", data[0] & 0x0ff);
+			{
+				uint8_t	d[2] = { OLERR_UNKNOWN_CMD,
+						(uint8_t)data[0] };
+				log(OLED_LOG_ERR, OLEV_ERROR, 2, d);
+			}
 			assert(0);
 			break;
 		}
@@ -459,8 +667,8 @@ fprintf(stderr, "DO-COMMAND\n");
  * The device allows other types of drawing, such as filling rectangles and
  * such.  Here, we just handle the setting of pixels.
  *
- * You'll note that updates to the drawing area are only queued if the device
- * is in powered mode.
+ * You'll note that the frame is only marked as changed if the device is in
+ * powered mode.
  *
  * At some point, I may wish to implement scrolling.  If/when that happens,
  * the GDDRAM will not be affected, but the area that needs to be redrawn will
@@ -468,29 +676,93 @@ fprintf(stderr, "DO-COMMAND\n");
  */
 void	OLEDSIM::set_gddram(const int col, const int row,
 		const double dr, const double dg, const double db) {
-	// Set our color to that given by the rgb (double) parameters.
-	m_gc->set_source_rgb(dr, dg, db);
-
-	printf("OLED: Setting pixel[%2d,%2d]\n", col, row);
 	int	drow; //  dcol;
+	uint32_t	rgb;
+
 	drow = row + m_display_start_row;
 	if (drow >= OLED_HEIGHT)
 		drow -= OLED_HEIGHT;
-	m_gc->rectangle(col, row, 1, 1);
-	m_gc->fill();
-
-	if (m_state == OLED_POWERED) {
-		// Need to adjust the invalidated area if scrolling is taking
-		// place.
-		double	kw, kh;
-		int	t, l;
-		kw = get_width()/(double)OLED_WIDTH;
-		kh = get_height()/(double)OLED_HEIGHT;
-
-		t = row * kh-1;
-		l = col * kw-1;
-		queue_draw_area(l, t, (int)(kw)+1, (int)(kh)+1);
+
+	rgb = (((unsigned)(dr * 255.0 + 0.5)) << 16)
+			| (((unsigned)(dg * 255.0 + 0.5)) << 8)
+			|  ((unsigned)(db * 255.0 + 0.5));
+
+	m_npixels++;
+	m_frame_pixels++;
+	if (m_gddram[row][col] == rgb)
+		m_nsame++;
+	m_gddram[row][col] = rgb;
+
+	if ((OLED_LOG_DATA <= m_log_level)||(OLED_LOG_DATA <= m_print_level)) {
+		uint8_t	d[5] = { (uint8_t)col, (uint8_t)row,
+				(uint8_t)(rgb>>16), (uint8_t)(rgb>>8),
+				(uint8_t)rgb };
+		log_event(OLED_LOG_DATA, OLEV_PIXEL, 5, d);
 	}
+
+	if (m_state == OLED_POWERED)
+		m_dirty = true;
+}
+
+/*
+ * draw_rect()
+ *
+ * The Draw Rectangle command: 0x22, the top left column and row, the bottom
+ * right column and row, then the outline's color and the fill color, each as
+ * three six bit values, red first.  The inside is only filled if fill has
+ * been enabled with the 0x26 command.  Like the other drawing commands, this
+ * changes the GDDRAM without counting any pixels as sent.
+ */
+void	OLEDSIM::draw_rect(const char *data) {
+	int	c0 = data[1]&0x07f, r0 = data[2]&0x03f,
+		c1 = data[3]&0x07f, r1 = data[4]&0x03f;
+	uint32_t	line, fill;
+
+	line = (((data[5]&0x03f)*255/63) << 16)
+		| (((data[6]&0x03f)*255/63) << 8)
+		|  ((data[7]&0x03f)*255/63);
+	fill = (((data[8]&0x03f)*255/63) << 16)
+		| (((data[9]&0x03f)*255/63) << 8)
+		|  ((data[10]&0x03f)*255/63);
+
+	if (c1 >= OLED_WIDTH)	c1 = OLED_WIDTH-1;
+	if (r1 >= OLED_HEIGHT)	r1 = OLED_HEIGHT-1;
+	for(int r=r0; r<=r1; r++)
+		for(int c=c0; c<=c1; c++) {
+			if ((r==r0)||(r==r1)||(c==c0)||(c==c1))
+				m_gddram[r][c] = line;
+			else if (m_fill)
+				m_gddram[r][c] = fill;
+		}
+
+	if (m_state == OLED_POWERED)
+		m_dirty = true;
+}
+
+/*
+ * copy_rect()
+ *
+ * The Copy command: 0x23, the source's top left column and row, its bottom
+ * right column and row, and then the top left column and row to copy it to.
+ */
+void	OLEDSIM::copy_rect(const char *data) {
+	int	c0 = data[1]&0x07f, r0 = data[2]&0x03f,
+		c1 = data[3]&0x07f, r1 = data[4]&0x03f,
+		dc = data[5]&0x07f, dr = data[6]&0x03f;
+	uint32_t	src[OLED_HEIGHT][OLED_WIDTH];
+
+	memcpy(src, m_gddram, sizeof(src));
+	for(int r=r0; r<=r1; r++)
+		for(int c=c0; c<=c1; c++) {
+			int	tr = dr + r - r0, tc = dc + c - c0;
+
+			if ((r < OLED_HEIGHT)&&(c < OLED_WIDTH)
+				&&(tr < OLED_HEIGHT)&&(tc < OLED_WIDTH))
+				m_gddram[tr][tc] = src[r][c];
+		}
+
+	if (m_state == OLED_POWERED)
+		m_dirty = true;
 }
 
 /*
@@ -498,46 +770,149 @@ void	OLEDSIM::set_gddram(const int col, const int row,
  *
  * Clears the simulated device to a known grayscale value.  Examples are 
  * 0.0 for black, or 0.1 for a gray that is nearly black.  Note that this
- * call does *not* invalidate our window.  Perhaps it should, but for now that
- * is the responsibility of whatever function calls this function.
+ * call does *not* mark the frame as changed.  Perhaps it should, but for now
+ * that is the responsibility of whatever function calls this function.
  */
 void	OLEDSIM::clear_to(double v) {
-	// How do we apply this to our pixmap?
-	m_gc->set_source_rgb(v, v, v);
-	m_gc->rectangle(0, 0, OLED_WIDTH, OLED_HEIGHT);
-	m_gc->fill();
+	unsigned	g = (unsigned)(v * 255.0 + 0.5);
+	uint32_t	rgb = (g << 16) | (g << 8) | g;
+
+	for(int r=0; r<OLED_HEIGHT; r++)
+		for(int c=0; c<OLED_WIDTH; c++)
+			m_gddram[r][c] = rgb;
 }
 
-bool	OLEDSIM::on_draw(CONTEXT &gc) {
-fprintf(stderr, "ON-DRAW\n");
-	gc->save();
-	if (m_state == OLED_POWERED) {
-		// Scrolling will be implemented here
-		gc->scale(get_width()/(double)OLED_WIDTH,
-				get_height()/(double)OLED_HEIGHT);
-		gc->set_source(m_pix, 0, 0);
-		gc->paint();
-	} else {
-		if ((m_state == OLED_VIO)||(m_state == OLED_RESET))
-			gc->set_source_rgb(0.1,0.1,0.1); // DARK gray
-		else
-			gc->set_source_rgb(0.0,0.0,0.0); // Black
-		// gc->rectangle(0, 0, OLED_WIDTH, OLED_HEIGHT);
-		gc->rectangle(0, 0, get_width(), get_height());
-		gc->fill();
-	} gc->restore();
-
-	return true;
+/*
+ * log_event()
+ *
+ * Record an event into the ring buffer, and print it if its level is at or
+ * below the print level.  Nothing is formatted unless it is to be printed.
+ */
+void	OLEDSIM::log_event(int level, int type, int len, const uint8_t *data) {
+	OLEDEVENT	*ev = &m_log[m_log_head];
+
+	if (len > (int)sizeof(ev->m_data))
+		len = sizeof(ev->m_data);
+	ev->m_clock = m_total_clocks;
+	ev->m_type  = type;
+	ev->m_len   = len;
+	memcpy(ev->m_data, data, len);
+
+	if (level <= m_print_level)
+		print_event(stderr, ev);
+
+	if (level <= m_log_level) {
+		m_log_head = (m_log_head + 1) & (OLED_LOGLEN-1);
+		m_log_count++;
+	}
+}
+
+void	OLEDSIM::print_event(FILE *fp, const OLEDEVENT *ev) {
+	static	const char *STATES[] = { "?", "OFF", "RESET", "VIO", "POWERED"};
+	const uint8_t	*d = ev->m_data;
+
+	fprintf(fp, "OLED %10lu: ", (unsigned long)ev->m_clock);
+	switch(ev->m_type) {
+	case OLEV_STATE:
+		fprintf(fp, "STATE %s\n", (d[0] <= OLED_POWERED)
+			? STATES[d[0]] : STATES[0]);
+		break;
+	case OLEV_ERROR:
+		switch(d[0]) {
+		case OLERR_CSN_AT_POWERUP:
+		case OLERR_SCK_IDLE:
+			fprintf(fp, "ERR: %s, CSN=%d, SCK=%d, DCN=%d, MOSI=%d, "
+				"from %d,%d,%d\n",
+				(d[0] == OLERR_SCK_IDLE) ? "SCK low while idle"
+					: "CSN active on power up",
+				d[1], d[2], d[3], d[4], d[5], d[6], d[7]);
+			break;
+		case OLERR_COLOR_FORMAT:
+			fprintf(fp, "ERR: Unsupported color format, %d\n",
+				d[1]);
+			break;
+		case OLERR_UNKNOWN_CMD:
+			fprintf(fp, "ERR: Unknown command, %02x\n", d[1]);
+			break;
+		default:
+			fprintf(fp, "ERR: %d\n", d[0]);
+			break;
+		} break;
+	case OLEV_LOCK:
+		fprintf(fp, "COMMANDS %s\n", (d[0]) ? "LOCKED" : "UNLOCKED");
+		break;
+	case OLEV_IGNORED:
+	case OLEV_CMD:
+		fprintf(fp, "%s(%02x)", (ev->m_type == OLEV_CMD)
+			? "CMD" : "IGNORED (LOCKED) CMD", d[0]);
+		for(int i=1; i<ev->m_len; i++)
+			fprintf(fp, "%s%02x", (i==1) ? " - " : ":", d[i]);
+		fprintf(fp, "\n");
+		break;
+	case OLEV_PIXEL:
+		fprintf(fp, "PIXEL[%2d,%2d] = %02x%02x%02x\n",
+			d[0], d[1], d[2], d[3], d[4]);
+		break;
+	case OLEV_IO:
+		fprintf(fp, "IO CSN=%d, SCK=%d, DCN=%d, MOSI=%d @[%d]%d\n",
+			d[0], d[1], d[2], d[3], d[4], d[5]);
+		break;
+	default:
+		fprintf(fp, "UNKNOWN EVENT %d\n", ev->m_type);
+		break;
+	}
 }
 
-OLEDWIN::OLEDWIN(void) {
-fprintf(stderr, "Setting up OLEDWIN\n");
-	m_sim = new OLEDSIM();
-	m_sim->set_size_request(OLEDSIM::OLED_WIDTH, OLEDSIM::OLED_HEIGHT);
-	set_border_width(0);
-	add(*m_sim);
-	show_all();
-	Gtk::Window::set_title(Glib::ustring("OLED Simulator"));
-	fprintf(stderr, "Window all set up\n");
+void	OLEDSIM::dump_log(FILE *fp) {
+	unsigned	n, pos;
+
+	n = (m_log_count < OLED_LOGLEN) ? (unsigned)m_log_count : OLED_LOGLEN;
+	pos = (m_log_head - n) & (OLED_LOGLEN-1);
+	for(unsigned k=0; k<n; k++) {
+		print_event(fp, &m_log[pos]);
+		pos = (pos + 1) & (OLED_LOGLEN-1);
+	}
+}
+
+void	OLEDSIM::write_log(FILE *fp) {
+	unsigned	n, pos;
+
+	n = (m_log_count < OLED_LOGLEN) ? (unsigned)m_log_count : OLED_LOGLEN;
+	pos = (m_log_head - n) & (OLED_LOGLEN-1);
+	for(unsigned k=0; k<n; k++) {
+		fwrite(&m_log[pos], sizeof(OLEDEVENT), 1, fp);
+		pos = (pos + 1) & (OLED_LOGLEN-1);
+	}
 }
 
+/*
+ * report()
+ *
+ * Summarize how the display was driven: how many commands and pixels it
+ * took, per frame, and how many of those pixel writes changed nothing.
+ */
+void	OLEDSIM::report(FILE *fp) {
+	unsigned long	nframes = (m_nframes > 0) ? m_nframes : 1;
+
+	fprintf(fp, "OLED STATISTICS\n");
+	fprintf(fp, "  Clocks:               %lu\n",
+		(unsigned long)m_total_clocks);
+	fprintf(fp, "  Frames published:     %lu\n", m_nframes);
+	fprintf(fp, "  SPI transactions:     %lu\n", m_nxfers);
+	fprintf(fp, "  Commands:             %lu (%lu ignored while locked)\n",
+		m_ncmds, m_nignored);
+	fprintf(fp, "  Pixels written:       %lu (%lu unchanged)\n",
+		m_npixels, m_nsame);
+	fprintf(fp, "  Commands per frame:   %.1f avg, %lu max\n",
+		m_ncmds / (double)nframes, m_max_frame_cmds);
+	fprintf(fp, "  Pixels per frame:     %.1f avg, %lu max\n",
+		m_npixels / (double)nframes, m_max_frame_pixels);
+	if (m_nxfers > 0)
+		fprintf(fp, "  Clocks per transaction: %.1f\n",
+			m_total_clocks / (double)m_nxfers);
+
+	fprintf(fp, "  Command histogram:\n");
+	for(int k=0; k<256; k++)
+		if (m_ncmd_hist[k])
+			fprintf(fp, "    %02x: %lu\n", k, m_ncmd_hist[k]);
+}
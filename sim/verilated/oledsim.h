@@ -7,8 +7,10 @@
 // Purpose:	To simulate the interaction between the OLED board and my
 //		logic.  This simulator tries to read from the SPI generated
 //	by the logic, verify that the SPI interaction is valid, and then
-//	draws the OLED memory to the screen so you can see how the OLED
-//	would work ... even without having an OLED connected.
+//	keeps the OLED memory in a plain frame buffer.  Nothing here depends
+//	upon a GUI, so the simulation can run headless.  Frames may be dumped
+//	to files as they change, or picked up by a viewer (see oledview.h)
+//	running in another thread.
 //
 // Creator:	Dan Gisselquist, Ph.D.
 //		Gisselquist Technology, LLC
@@ -42,8 +44,10 @@
 #ifndef	OLEDSIM_H
 #define	OLEDSIM_H
 
-#include <gtkmm.h>
+#include <stdio.h>
+#include <stdint.h>
 #include <assert.h>
+#include <mutex>
 
 #define	OLED_OFF	1
 #define	OLED_RESET	2
@@ -52,15 +56,70 @@
 #define	OLED_65kCLR	0
 #define	OLED_256CLR	1
 
-class	OLEDSIM : public Gtk::DrawingArea {
+//
+// Event log levels.  Events at or below the log level are recorded in a
+// (binary) ring buffer, those at or below the print level are also printed
+// as they happen.
+#define	OLED_LOG_NONE	0
+#define	OLED_LOG_ERR	1	// Protocol errors
+#define	OLED_LOG_INFO	2	// Power state changes, command lock/unlock
+#define	OLED_LOG_CMD	3	// Every command received
+#define	OLED_LOG_DATA	4	// Every pixel written
+#define	OLED_LOG_IO	5	// Every change on the SPI pins
+
+// Event types, as recorded in the log
+#define	OLEV_STATE	0	// data[0] = new state
+#define	OLEV_ERROR	1	// data[0] = error code, data[1..] = details
+#define	OLEV_LOCK	2	// data[0] = 1 if now locked, 0 if unlocked
+#define	OLEV_IGNORED	3	// data = command bytes ignored while locked
+#define	OLEV_CMD	4	// data = command bytes
+#define	OLEV_PIXEL	5	// data = col, row, r, g, b
+#define	OLEV_IO		6	// data = csn, sck, dcn, mosi, idx, bitpos
+
+#define	OLERR_CSN_AT_POWERUP	0
+#define	OLERR_COLOR_FORMAT	1
+#define	OLERR_UNKNOWN_CMD	2
+#define	OLERR_SCK_IDLE		3
+
+typedef	struct	{
+	uint64_t	m_clock;
+	uint8_t		m_type, m_len, m_data[14];
+} OLEDEVENT;
+
+#define	OLED_LOGLEN	4096	// Events in the ring, must be a power of two
+
+class	OLEDSIM {
 public:
-	typedef		Cairo::RefPtr<Cairo::Context>	CAIROGC;
-	typedef const	Cairo::RefPtr<Cairo::Context>	CONTEXT;
-	typedef 	Cairo::RefPtr<Cairo::ImageSurface>	CAIROIMG;
+	static const int	OLED_HEIGHT = 64, OLED_WIDTH = 96;
 
 private:
-	CAIROIMG	m_pix;
-	CAIROGC		m_gc;
+	// The GDDRAM, one 0x00rrggbb word per pixel
+	uint32_t	m_gddram[OLED_HEIGHT][OLED_WIDTH];
+
+	// The most recently published frame, as it would appear on the
+	// display, protected by m_lock so that a viewer may read it from
+	// another thread
+	std::mutex	m_lock;
+	uint32_t	m_frame[OLED_HEIGHT][OLED_WIDTH];
+	unsigned	m_frame_seq;
+
+	// Frames are published no more often than once every m_frame_clocks
+	bool		m_dirty;
+	unsigned long	m_clocks, m_frame_clocks;
+	char		*m_dump_fname;
+
+	// The event log
+	int		m_log_level, m_print_level;
+	uint64_t	m_total_clocks;
+	OLEDEVENT	m_log[OLED_LOGLEN];
+	unsigned	m_log_head;
+	uint64_t	m_log_count;
+
+	// Command decode statistics
+	unsigned long	m_ncmds, m_npixels, m_nsame, m_nxfers, m_nignored,
+			m_ncmd_hist[256];
+	unsigned long	m_frame_cmds, m_frame_pixels,
+			m_max_frame_cmds, m_max_frame_pixels, m_nframes;
 
 	int	m_state, m_reset_clocks; // , m_address_counts;
 
@@ -69,7 +128,7 @@ private:
 	int	m_idx, m_bitpos;
 	char	m_data[16];
 
-	bool	m_vaddr_inc, m_locked;
+	bool	m_vaddr_inc, m_locked, m_fill;
 	int	m_format;
 	int	m_col_start, m_col_end, m_col;
 	int	m_row_start, m_row_end, m_row, m_display_start_row;
@@ -79,50 +138,48 @@ private:
 	void	handle_io(const int, const int, const int, const int);
 	void	clear_to(const double v);
 	void	set_gddram(const int, const int, const double, const double, const double);
-public:
-	static const int	OLED_HEIGHT, OLED_WIDTH;
-
-	OLEDSIM(void) : Gtk::DrawingArea() {
-
-		set_has_window(true);
-		Widget::set_can_focus(false);
-		set_size_request(OLED_WIDTH, OLED_HEIGHT);
-
-		m_state = OLED_OFF;
-		m_locked = true;
-		m_last_csn = 1;
-		m_last_sck = 1;
-		m_last_dcn = 1;
-		m_format = OLED_65kCLR;
-		m_display_start_row = 0;
-		m_vaddr_inc = false;
-		m_col = 0; m_row = 0;
-		m_col_start = 0; m_row_start = 0;
-		m_col_end = 95; m_row_end = 63;
+	void	draw_rect(const char *data);
+	void	copy_rect(const char *data);
+	void	set_state(const int state);
+	void	publish(void);
+	void	dump_frame(void);
+	void	log_event(int level, int type, int len, const uint8_t *data);
+	void	log(int level, int type, int len, const uint8_t *data) {
+		if ((level <= m_log_level)||(level <= m_print_level))
+			log_event(level, type, len, data);
 	}
+	void	print_event(FILE *fp, const OLEDEVENT *ev);
+public:
+	OLEDSIM(void);
+	~OLEDSIM(void);
 
-	void	get_preferred_width_vfunc(int &min, int &nw) const;
-	void	get_preferred_height_vfunc(int &min, int &nw) const;
-	void	get_preferred_height_for_width_vfunc(int w, int &min, int &nw) const;
-	void	get_preferred_width_for_height_vfunc(int h, int &min, int &nw) const;
-
-	virtual	void	on_realize();
-	virtual	bool	on_draw(CONTEXT &gc);
 	void	operator()(const int iopwr, const int rstn, const int dpwr,
 			const int csn, const int sck, const int dcn, const int mosi);
-};
 
-class	OLEDWIN : public Gtk::Window {
-private:
-	OLEDSIM	*m_sim;
+	// Write every published frame to a file.  Names ending in .png
+	// produce PNG files, .ppm a PPM, and anything else raw RGB888.  If
+	// the name contains a printf style %d, each frame gets its own file.
+	// Otherwise the file holds only the latest frame.
+	void	dump(const char *fname);
 
-public:
-	OLEDWIN(void);
-	~OLEDWIN(void) { delete m_sim; }
-	void	operator()(int iopwr, int rstn, int dpwr,
-			int sck, int csn, int dcn, int mosi) {
-		(*m_sim)(iopwr, rstn, dpwr, sck, csn, dcn, mosi);
-	}
+	// Publish at most one frame every nclocks clocks
+	void	frame_rate(unsigned long nclocks) { m_frame_clocks = nclocks; }
+
+	// Copy the most recently published frame into buf, returning its
+	// sequence number.  Safe to call from any thread.
+	unsigned	frame(uint32_t *buf);
+
+	// Set the levels at which events are recorded and printed
+	void	log_level(int level) { m_log_level = level; }
+	void	print_level(int level) { m_print_level = level; }
+
+	// Decode the events remaining in the ring buffer, oldest first.
+	// write_log() writes the same events as raw OLEDEVENT records.
+	void	dump_log(FILE *fp);
+	void	write_log(FILE *fp);
+
+	// Report command decode statistics
+	void	report(FILE *fp);
 };
 
 #endif
@@ -0,0 +1,171 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	oledview.cpp
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	Displays the PModOLEDrgb simulation, as kept by OLEDSIM, using
+//		a GTKMM controlled window.  I'm doing this on an Linux computer
+//	with X-Windows, although one GTKMM selling point is that it should work
+//	in Windows as well.  I won't vouch for that, as I haven't tested under
+//	windows.
+//
+//	The viewer polls the simulator for new frames, rather than the
+//	simulator pushing them to the viewer.  All GTK calls therefore stay
+//	within the viewer's thread.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015-2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <string.h>
+#include <thread>
+#include "oledview.h"
+
+// How often, in milliseconds, to check for a new frame
+static	const	unsigned	POLL_MS = 20;
+
+OLEDVIEW::OLEDVIEW(OLEDSIM &sim) : Gtk::DrawingArea(), m_sim(sim) {
+	set_has_window(true);
+	Widget::set_can_focus(false);
+	set_size_request(OLEDSIM::OLED_WIDTH, OLEDSIM::OLED_HEIGHT);
+	// Anything other than the simulator's first frame number
+	m_seq = ~0u;
+
+	Glib::signal_timeout().connect(
+		sigc::mem_fun((*this),&OLEDVIEW::on_timeout), POLL_MS);
+}
+
+void	OLEDVIEW::on_realize() {
+	Gtk::DrawingArea::on_realize();
+
+	// We'll be doing all of our drawing from an off-screen bit map.  Here,
+	// let's allocate that pixel map ...
+	m_pix = Cairo::ImageSurface::create(Cairo::FORMAT_RGB24,
+			OLEDSIM::OLED_WIDTH, OLEDSIM::OLED_HEIGHT);
+
+	// ... and start it out with whatever the simulator has for us
+	on_timeout();
+}
+
+void	OLEDVIEW::get_preferred_width_vfunc(int &min, int &nw) const {
+	// GTKMM wants to know how big we want our window to be.
+	// Let's request a window twice as big as we need, but insist that
+	// it never be smaller than one pixel output per one pixel input.
+	//
+	min = OLEDSIM::OLED_WIDTH;
+	nw = OLEDSIM::OLED_WIDTH * 2;
+}
+
+void	OLEDVIEW::get_preferred_height_vfunc(int &min, int &nw) const {
+	//
+	// Same thing as above, but this time for height, not width.
+	//
+	min = OLEDSIM::OLED_HEIGHT;
+	nw = OLEDSIM::OLED_HEIGHT * 2;
+}
+
+void	OLEDVIEW::get_preferred_width_for_height_vfunc(int h, int &min, int &nw) const {
+	min = OLEDSIM::OLED_WIDTH;
+	int k = (h+(OLEDSIM::OLED_HEIGHT/2))/OLEDSIM::OLED_HEIGHT;
+	if (k <= 0)
+		k = 1;
+	nw = OLEDSIM::OLED_WIDTH * k;
+}
+
+void	OLEDVIEW::get_preferred_height_for_width_vfunc(int w, int &min, int &nw) const {
+	min = OLEDSIM::OLED_HEIGHT;
+	int k = (w+(OLEDSIM::OLED_WIDTH/2))/OLEDSIM::OLED_WIDTH;
+	if (k <= 0)
+		k = 1;
+	nw = OLEDSIM::OLED_HEIGHT * k;
+}
+
+/*
+ * on_timeout()
+ *
+ * Copy the latest frame from the simulator into our pixel map, and redraw
+ * the window if it has changed.
+ */
+bool	OLEDVIEW::on_timeout(void) {
+	uint32_t	frame[OLEDSIM::OLED_HEIGHT * OLEDSIM::OLED_WIDTH];
+	unsigned	seq;
+	unsigned char	*data;
+	int		stride;
+
+	if (!m_pix)
+		return true;
+
+	seq = m_sim.frame(frame);
+	if (seq == m_seq)
+		return true;
+	m_seq = seq;
+
+	m_pix->flush();
+	data   = m_pix->get_data();
+	stride = m_pix->get_stride();
+	for(int r=0; r<OLEDSIM::OLED_HEIGHT; r++)
+		memcpy(&data[r*stride], &frame[r*OLEDSIM::OLED_WIDTH],
+			OLEDSIM::OLED_WIDTH * sizeof(uint32_t));
+	m_pix->mark_dirty();
+
+	queue_draw();
+	return true;
+}
+
+bool	OLEDVIEW::on_draw(CONTEXT &gc) {
+	gc->save();
+	gc->scale(get_width()/(double)OLEDSIM::OLED_WIDTH,
+			get_height()/(double)OLEDSIM::OLED_HEIGHT);
+	gc->set_source(m_pix, 0, 0);
+	gc->paint();
+	gc->restore();
+
+	return true;
+}
+
+OLEDWIN::OLEDWIN(OLEDSIM &sim) {
+	m_view = new OLEDVIEW(sim);
+	set_border_width(0);
+	add(*m_view);
+	show_all();
+	Gtk::Window::set_title(Glib::ustring("OLED Simulator"));
+}
+
+void	oledview_start(OLEDSIM &sim) {
+	std::thread	viewer([&sim](void) {
+		int	argc = 0;
+		char	**argv = NULL;
+		Gtk::Main	main_instance(argc, argv);
+		OLEDWIN		win(sim);
+
+		Gtk::Main::run(win);
+	});
+
+	viewer.detach();
+}
@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	oledview.h
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	A GTKMM window that displays the frames published by an
+//		OLEDSIM.  The viewer runs its own GTK main loop in its own
+//	thread, and only ever reads the latest frame from the simulator, so the
+//	simulation itself never waits on the GUI.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015-2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	OLEDVIEW_H
+#define	OLEDVIEW_H
+
+#include <gtkmm.h>
+#include "oledsim.h"
+
+class	OLEDVIEW : public Gtk::DrawingArea {
+public:
+	typedef const	Cairo::RefPtr<Cairo::Context>	CONTEXT;
+	typedef 	Cairo::RefPtr<Cairo::ImageSurface>	CAIROIMG;
+
+private:
+	OLEDSIM		&m_sim;
+	CAIROIMG	m_pix;
+	unsigned	m_seq;
+
+	bool	on_timeout(void);
+public:
+	OLEDVIEW(OLEDSIM &sim);
+
+	void	get_preferred_width_vfunc(int &min, int &nw) const;
+	void	get_preferred_height_vfunc(int &min, int &nw) const;
+	void	get_preferred_height_for_width_vfunc(int w, int &min, int &nw) const;
+	void	get_preferred_width_for_height_vfunc(int h, int &min, int &nw) const;
+
+	virtual	void	on_realize();
+	virtual	bool	on_draw(CONTEXT &gc);
+};
+
+class	OLEDWIN : public Gtk::Window {
+private:
+	OLEDVIEW	*m_view;
+
+public:
+	OLEDWIN(OLEDSIM &sim);
+	~OLEDWIN(void) { delete m_view; }
+};
+
+// Start a viewer for sim in a (detached) thread of its own.  Closing the
+// window ends the viewer, but not the simulation.
+extern	void	oledview_start(OLEDSIM &sim);
+
+#endif
@@ -46,8 +46,26 @@
 #include <signal.h>
 #include <ctype.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "uartsim.h"
 
+// How long the I/O thread will wait in poll() before checking for characters
+// the design may have produced in the meantime, in milliseconds
+#define	UARTSIM_POLLMS	1
+
+// Every UARTSIM still in existence.  Simulations usually end with exit(),
+// from a SIM instruction, without ever deleting their UARTSIMs, so each is
+// killed here instead.  That gives its I/O thread the chance to pass on the
+// last of what the design sent.
+static std::vector<UARTSIM *>	uartsims;
+
+static void	uartsim_atexit(void) {
+	for(auto u : uartsims)
+		u->kill();
+}
+
 void	UARTSIM::setup_listener(const int port) {
 	struct	sockaddr_in	my_addr;
 
@@ -101,9 +119,57 @@ UARTSIM::UARTSIM(const int port) {
 	m_tx_baudcounter = 0;
 	m_rx_state = RXIDLE;
 	m_tx_state = TXIDLE;
+
+	m_done = false;
+	m_iothread = new std::thread(&UARTSIM::iothread, this);
+
+	static	bool	registered = false;
+	if (!registered) {
+		atexit(uartsim_atexit);
+		registered = true;
+	} uartsims.push_back(this);
+}
+
+UARTSIM::~UARTSIM(void) {
+	kill();
+	uartsims.erase(std::remove(uartsims.begin(), uartsims.end(), this),
+		uartsims.end());
 }
 
 void	UARTSIM::kill(void) {
+	// Stop the I/O thread first, so we are the only ones left touching
+	// the file descriptors below
+	m_done = true;
+	if (m_iothread) {
+		m_iothread->join();
+		delete m_iothread;
+		m_iothread = NULL;
+	}
+
+	// Write out anything the design sent that the I/O thread never got
+	// to, so that the last of a program's output isn't lost on exit
+	if (m_conwr >= 0) {
+		char		buf[512];
+		unsigned	nw;
+
+		while((nw = m_outq.pop(buf, sizeof(buf))) > 0) {
+			unsigned	pos = 0;
+
+			while(pos < nw) {
+				int	snt;
+
+				if (m_skt >= 0)
+					snt = send(m_conwr, &buf[pos], nw-pos, 0);
+				else
+					snt = write(m_conwr, &buf[pos], nw-pos);
+				if (snt <= 0)
+					break;
+				pos += snt;
+			} if (pos < nw)
+				break;
+		}
+	}
+
 	fflush(stdout);
 
 	// Quickly double check that we aren't about to close stdin/stdout
@@ -131,14 +197,15 @@ void	UARTSIM::setup(unsigned isetup) {
 	}
 }
 
-void	UARTSIM::check_for_new_connections(void) {
+void	UARTSIM::check_for_new_connections(const int timeout_ms) {
 	if ((m_conrd < 0)&&(m_conwr<0)&&(m_skt>=0)) {
 		// Can we accept a connection?
 		struct	pollfd	pb;
 
 		pb.fd = m_skt;
 		pb.events = POLLIN;
-		poll(&pb, 1, 0);
+		pb.revents = 0;
+		poll(&pb, 1, timeout_ms);
 
 		if (pb.revents & POLLIN) {
 			m_conrd = accept(m_skt, 0, 0);
@@ -152,11 +219,115 @@ void	UARTSIM::check_for_new_connections(void) {
 
 }
 
-int	UARTSIM::rawtick(const int i_tx, const bool network) {
-	int	o_rx = 1, nr = 0;
+void	UARTSIM::close_connection(void) {
+	if (m_skt >= 0) {
+		if (m_conrd >= 0)
+			close(m_conrd);
+		m_conrd = m_conwr = -1;
+	}
+}
+
+void	UARTSIM::iothread(void) {
+	const bool	network = (m_skt >= 0);
+	char		buf[512];
+
+	while(!m_done) {
+		unsigned	nw;
+
+		if ((network)&&(m_conrd < 0)) {
+			check_for_new_connections(UARTSIM_POLLMS);
+
+			// With no one listening, anything the design sends
+			// is lost--just as it would be on a real serial port
+			// with nothing attached.
+			while(m_outq.pop(buf, sizeof(buf)) > 0)
+				;
+			continue;
+		}
+
+		//
+		// Write out everything the design has given us, in one go
+		//
+		nw = m_outq.pop(buf, sizeof(buf));
+		if ((nw > 0)&&(m_conwr >= 0)) {
+			unsigned	pos = 0;
+
+			while(pos < nw) {
+				int	snt;
+
+				if (network)
+					snt = send(m_conwr, &buf[pos], nw-pos, 0);
+				else
+					snt = write(m_conwr, &buf[pos], nw-pos);
+				if (snt > 0) {
+					pos += snt;
+				} else if (network) {
+					fprintf(stderr, "Failed write, connection closed\n");
+					close_connection();
+					break;
+				} else {
+					fprintf(stderr, "ERR while attempting to write out--closing output port\n");
+					perror("UARTSIM::write() ");
+					m_conrd = m_conwr = -1;
+					break;
+				}
+			}
+		}
+
+		//
+		// Then read anything the host has for us, but only as much as
+		// we have room for.  If we just wrote something, don't wait
+		// around--the design is busy, and may have more for us.
+		//
+		struct	pollfd	pb;
+		unsigned	space = m_inq.space();
+		int		npb = 0;
+
+		pb.fd = m_conrd;
+		pb.events = POLLIN;
+		pb.revents = 0;
+		if ((m_conrd >= 0)&&(space > 0))
+			npb = 1;
+
+		if (poll(&pb, npb, (nw > 0) ? 0 : UARTSIM_POLLMS) < 0) {
+			perror("Polling error:");
+			continue;
+		}
+
+		if ((npb > 0)&&(pb.revents & (POLLIN|POLLHUP|POLLERR))) {
+			int	nr;
+
+			if (space > sizeof(buf))
+				space = sizeof(buf);
+			if (network)
+				nr = recv(m_conrd, buf, space, MSG_DONTWAIT);
+			else
+				nr = read(m_conrd, buf, space);
+			if (nr > 0) {
+				m_inq.push(buf, nr);
+			} else if ((network)&&(nr == 0)) {
+				close_connection();
+				// printf("Closing network connection\n");
+			} else if (nr == 0) {
+				// End of file on our input.  Stop reading, lest
+				// poll() keep telling us there's more to read.
+				m_conrd = -1;
+			} else if (nr < 0) {
+				if (!network) {
+					fprintf(stderr, "ERR while attempting to read in--closing input port\n");
+					perror("UARTSIM::read() ");
+					m_conrd = -1;
+				} else {
+					perror("O/S Read err:");
+					close_connection();
+				}
+			}
+		}
+	}
+}
 
-	if (network)
-		check_for_new_connections();
+int	UARTSIM::tick(const int i_tx) {
+	int	o_rx = 1;
 
 	if ((!i_tx)&&(m_last_tx))
 		m_rx_changectr = 0;
@@ -173,20 +344,15 @@ int	UARTSIM::rawtick(const int i_tx, const bool network) {
 		}
 	} else if (m_rx_baudcounter <= 0) {
 		if (m_rx_busy >= (1<<(m_nbits+m_nparity+m_nstop-1))) {
+			char	ch;
+
 			m_rx_state = RXIDLE;
-			if (m_conwr >= 0) {
-				char	buf[1];
-				buf[0] = (m_rx_data >> (32-m_nbits-m_nstop-m_nparity))&0x0ff;
-				if ((network)&&(1 != send(m_conwr, buf, 1, 0))) {
-					close(m_conwr);
-					m_conrd = m_conwr = -1;
-					fprintf(stderr, "Failed write, connection closed\n");
-				} else if ((!network)&&(1 != write(m_conwr, buf, 1))) {
-					fprintf(stderr, "ERR while attempting to write out--closing output port\n");
-					perror("UARTSIM::write() ");
-					m_conrd = m_conwr = -1;
-				}
-			}
+			ch = (m_rx_data >> (32-m_nbits-m_nstop-m_nparity))&0x0ff;
+			// The I/O thread is always draining this queue, so
+			// it should only ever be full if the host stops
+			// reading.  Wait for it rather than drop a character.
+			while((!m_outq.push(ch))&&(!m_done))
+				std::this_thread::yield();
 		} else {
 			m_rx_busy = (m_rx_busy << 1)|1;
 			// Low order bit is transmitted first, in this
@@ -205,60 +371,34 @@ int	UARTSIM::rawtick(const int i_tx, const bool network) {
 	} else
 		m_rx_baudcounter--;
 
-	if ((m_tx_state == TXIDLE)&&((network)||(m_conrd >= 0))) {
-		struct	pollfd	pb;
-		pb.fd = m_conrd;
-		pb.events = POLLIN;
-		if (poll(&pb, 1, 0) < 0)
-			perror("Polling error:");
+	if (m_tx_state == TXIDLE) {
+		int	ch = m_inq.pop();
 
-		if (pb.revents & POLLIN) {
-			char	buf[1];
+		if (ch >= 0) {
+			m_tx_data = (-1<<(m_nbits+m_nparity+1))
+				// << nstart_bits
+				|((ch<<1)&0x01fe);
+			if (m_nparity) {
+				int	p;
 
-			if (network)
-				nr = recv(m_conrd, buf, 1, MSG_DONTWAIT);
-			else
-				nr = read(m_conrd, buf, 1);
-			if (1 == nr) {
-				m_tx_data = (-1<<(m_nbits+m_nparity+1))
-					// << nstart_bits
-					|((buf[0]<<1)&0x01fe);
-				if (m_nparity) {
-					int	p;
-
-					// If m_nparity is set, we need to then
-					// create the parity bit.
-					if (m_fixdp)
-						p = m_evenp;
-					else {
-						p = (m_tx_data >> 1)&0x0ff;
-						p = p ^ (p>>4);
-						p = p ^ (p>>2);
-						p = p ^ (p>>1);
-						p &= 1;
-						p ^= m_evenp;
-					}
-					m_tx_data |= (p<<(m_nbits+m_nparity));
-				}
-				m_tx_busy = (1<<(m_nbits+m_nparity+m_nstop+1))-1;
-				m_tx_state = TXDATA;
-				o_rx = 0;
-				m_tx_baudcounter = m_baud_counts-1;
-			} else if ((network)&&(nr == 0)) {
-				close(m_conrd);
-				m_conrd = m_conwr = -1;
-				// printf("Closing network connection\n");
-			} else if (nr < 0) {
-				if (!network) {
-					fprintf(stderr, "ERR while attempting to read in--closing input port\n");
-					perror("UARTSIM::read() ");
-					m_conrd = -1;
-				} else {
-					perror("O/S Read err:");
-					close(m_conrd);
-					m_conrd = m_conwr = -1;
+				// If m_nparity is set, we need to then
+				// create the parity bit.
+				if (m_fixdp)
+					p = m_evenp;
+				else {
+					p = (m_tx_data >> 1)&0x0ff;
+					p = p ^ (p>>4);
+					p = p ^ (p>>2);
+					p = p ^ (p>>1);
+					p &= 1;
+					p ^= m_evenp;
 				}
+				m_tx_data |= (p<<(m_nbits+m_nparity));
 			}
+			m_tx_busy = (1<<(m_nbits+m_nparity+m_nstop+1))-1;
+			m_tx_state = TXDATA;
+			o_rx = 0;
+			m_tx_baudcounter = m_baud_counts-1;
 		}
 	} else if (m_tx_baudcounter <= 0) {
 		m_tx_data >>= 1;
@@ -275,11 +415,3 @@ int	UARTSIM::rawtick(const int i_tx, const bool network) {
 
 	return o_rx;
 }
-
-int	UARTSIM::nettick(const int i_tx) {
-	return rawtick(i_tx, true);
-}
-
-int	UARTSIM::fdtick(const int i_tx) {
-	return rawtick(i_tx, false);
-}
@@ -50,17 +50,26 @@
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <signal.h>
+#include <atomic>
+#include <thread>
+
+#include "bytequeue.h"
 
 #define	TXIDLE	0
 #define	TXDATA	1
 #define	RXIDLE	0
 #define	RXDATA	1
 
+// Number of characters (log based two) that may be queued in either direction
+// between the simulation and the I/O thread
+#define	UARTSIM_LGQUEUE	12
+
 class	UARTSIM	{
 	// The file descriptors:
 	//	m_skt   is the socket/port we are listening on
 	//	m_conrd is the file descriptor to read from
 	//	m_conwr is the file descriptor to write to
+	// Once the I/O thread has started, only that thread touches these.
 	int	m_skt, m_conrd, m_conwr;
 	//
 	// The m_setup register is the 29'bit control register used within
@@ -75,26 +84,33 @@ class	UARTSIM	{
 	int	m_tx_baudcounter, m_tx_state, m_tx_busy;
 	unsigned	m_rx_data, m_tx_data;
 
+	// The simulation side talks to the outside world only through these
+	// two queues.  m_inq holds characters read from the host, waiting to
+	// be sent into the design, m_outq holds characters received from the
+	// design, waiting to be written to the host.
+	BYTEQUEUE<UARTSIM_LGQUEUE>	m_inq, m_outq;
+	std::thread		*m_iothread;
+	std::atomic<bool>	m_done;
+
 	// setup_listener is an attempt to encapsulate all of the network
 	// related setup stuff.
 	void	setup_listener(const int port);
 
 	// Call check_for_new_connections() to see if we can accept a new
-	// network socket connection to our device
-	void	check_for_new_connections(void);
-
-	// nettick() gets called if we are connected to a network, and
-	int	nettick(const int i_tx);
-	int	fdtick(const int i_tx);
-	int	rawtick(const int i_tx, const bool network);
-
-	// We'll use the file descriptor for the listener socket to determine
-	// whether we are connected to the network or not.  If not connected
-	// to the network, then we assume m_conrd and m_conwr refer to 
-	// your more traditional file descriptors, and use them as such.
-	int	tick(const int i_tx) {
-		return rawtick(i_tx, (m_skt >= 0));
-	}
+	// network socket connection to our device.  Waits up to timeout_ms
+	// for one to show up.
+	void	check_for_new_connections(const int timeout_ms);
+
+	// Close the current connection (if any), and go back to listening
+	void	close_connection(void);
+
+	// The I/O thread: accepts connections, reads from and writes to the
+	// host in blocks, and moves characters to and from the queues.
+	void	iothread(void);
+
+	// tick() handles the per bit timing of the UART.  It never makes a
+	// system call, only ever looking at the two queues above.
+	int	tick(const int i_tx);
 
 public:
 	//
@@ -102,9 +118,11 @@ public:
 	// localhost to listen in on.  Once started, connections may be made
 	// to this port to get the output from the port.
 	UARTSIM(const int port);
+	~UARTSIM(void);
 
-	// kill() closes any active connection and the socket.  Once killed,
-	// no further output will be sent to the port.
+	// kill() stops the I/O thread, and then closes any active connection
+	// and the socket.  Once killed, no further output will be sent to the
+	// port.
 	void	kill(void);
 
 	// setup() busts out the bits from isetup to the various internal
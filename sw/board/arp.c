@@ -54,37 +54,95 @@
 ///////////
 unsigned	arp_requests_sent = 0;
 
+// The table is a pool of entries, chained from a small hash of the IP address.
+// Entries are aged in seconds, by arp_tick(), rather than by how often they
+// are looked up.
+#define	NUM_ARP_ENTRIES	32
+#define	NUM_ARP_HASH	16	// Must be a power of two
+
+#define	ARP_FREE	0
+#define	ARP_VALID	1
+#define	ARP_PENDING	2	// Requested, but not yet answered
+
+// Re-request an address still in use once it's this old (in seconds), and
+// forget it if there's still no answer by ARP_TIMEOUT
+#define	ARP_REFRESH	240
+#define	ARP_TIMEOUT	300
+// How many requests, one per second, to send before giving up on an address
+#define	ARP_RETRIES	3
+
 typedef	struct	{
-	int		valid;
-	unsigned	age, ipaddr;
+	int		valid, next;
+	unsigned	age, ipaddr, tries;
 	unsigned long	mac;
 } ARP_TABLE_ENTRY;
 
-#define	NUM_ARP_ENTRIES	8
 ARP_TABLE_ENTRY	arp_table[NUM_ARP_ENTRIES];
+int		arp_hash[NUM_ARP_HASH];
+
+static	int	arp_hashof(unsigned ipaddr) {
+	// Hosts on the local network differ in the low octets
+	return (ipaddr ^ (ipaddr >> 8)) & (NUM_ARP_HASH-1);
+}
 
 void	init_arp_table(void) {
 	for(int k=0; k<NUM_ARP_ENTRIES; k++)
-		arp_table[k].valid = 0;
+		arp_table[k].valid = ARP_FREE;
+	for(int k=0; k<NUM_ARP_HASH; k++)
+		arp_hash[k] = -1;
+}
+
+// Returns the index of the entry for ipaddr, or -1 if there isn't one
+static	int	arp_find(unsigned ipaddr) {
+	int	eid = arp_hash[arp_hashof(ipaddr)];
+
+	while((eid >= 0)&&(arp_table[eid].ipaddr != ipaddr))
+		eid = arp_table[eid].next;
+	return eid;
+}
+
+static	void	arp_remove(int eid) {
+	int	*pp = &arp_hash[arp_hashof(arp_table[eid].ipaddr)];
+
+	while(*pp != eid)
+		pp = &arp_table[*pp].next;
+	*pp = arp_table[eid].next;
+	arp_table[eid].valid = ARP_FREE;
 }
 
 int	get_next_arp_index(void) {
-	int	eid, eldest = 0, unused_id = -1, oldage = 0, found=-1;
+	int	eid, eldest = 0;
+	unsigned	oldage = 0;
+
 	for(eid=0; eid<NUM_ARP_ENTRIES; eid++) {
-		if (!arp_table[eid].valid) {
-			unused_id = eid;
-			break;
-		} else if (arp_table[eid].age > oldage) {
+		if (arp_table[eid].valid == ARP_FREE)
+			return eid;
+		else if (arp_table[eid].age >= oldage) {
 			oldage = arp_table[eid].age;
 			eldest = eid;
 		}
 	}
 
-	if (unused_id >= 0)
-		return unused_id;
+	// The table is full, so make room by dropping the oldest entry
+	arp_remove(eldest);
 	return eldest;
 }
 
+// Creates a new entry for ipaddr, and returns its index
+static	int	arp_insert(unsigned ipaddr, int valid) {
+	int	eid = get_next_arp_index(), hash = arp_hashof(ipaddr);
+
+	arp_table[eid].valid  = valid;
+	arp_table[eid].age    = 0;
+	arp_table[eid].tries  = 0;
+	arp_table[eid].ipaddr = ipaddr;
+	arp_table[eid].mac    = 0;
+	arp_table[eid].next   = arp_hash[hash];
+	arp_hash[hash] = eid;
+
+	return eid;
+}
+
 void	send_arp_request(int ipaddr) {
 	unsigned	pkt[9];
 
@@ -98,17 +156,22 @@ void	send_arp_request(int ipaddr) {
 	pkt[7] = 0;
 	pkt[8] = ipaddr;
 
-arp_requests_sent++;
+	arp_requests_sent++;
 
-	// Send our packet
+	// Send our packet.  There's no need to wait on the answer, arp_tick()
+	// will send the request again if it doesn't come.
 	syscall(KTRAPID_SENDPKT,0,(unsigned)pkt, 9*4);
-
-for(volatile int k=0; k<2000; k++);
-	;
 }
 
+/*
+ * arp_lookup()
+ *
+ * Returns 0, and the MAC address for ipaddr in *mac, if the address is known.
+ * Otherwise, a request for it is queued and sent, and 1 is returned.  The
+ * caller should try again later--there's no waiting for the answer here.
+ */
 int	arp_lookup(unsigned ipaddr, unsigned long *mac) {
-	int	eid, eldest = 0, unused_id = -1, oldage = 0, found=-1;
+	int	eid;
 
 	if (((((ipaddr ^ my_ip_addr) & my_ip_mask) != 0)
 		|| (ipaddr == my_ip_router))
@@ -117,24 +180,52 @@ int	arp_lookup(unsigned ipaddr, unsigned long *mac) {
 		return 0;
 	}
 
-	for(eid=0; eid<NUM_ARP_ENTRIES; eid++) {
-		if (arp_table[eid].valid) {
-			if (arp_table[eid].ipaddr == ipaddr) {
-				arp_table[eid].age = 0;
-				*mac = arp_table[eid].mac;
-				return 0;
-			} else if (arp_table[eid].age > oldage) {
-				oldage = arp_table[eid].age++;
-				eldest = eid;
-				if (oldage >= 0x010000)
-					arp_table[eid].valid = 0;
-			} else
-				arp_table[eid].age++;
-		}
+	eid = arp_find(ipaddr);
+	if (eid < 0) {
+		// Queue a request for this address
+		eid = arp_insert(ipaddr, ARP_PENDING);
+		arp_table[eid].tries = 1;
+		send_arp_request(ipaddr);
+		return 1;
+	} else if (arp_table[eid].valid != ARP_VALID)
+		// Already asked, arp_tick() will ask again if need be
+		return 1;
+
+	if ((arp_table[eid].age >= ARP_REFRESH)&&(arp_table[eid].tries == 0)) {
+		// Still in use, so ask again before it expires.  The old
+		// address is good until then.
+		arp_table[eid].tries = 1;
+		send_arp_request(ipaddr);
 	}
 
-	send_arp_request(ipaddr);
-	return 1;
+	*mac = arp_table[eid].mac;
+	return 0;
+}
+
+/*
+ * arp_tick()
+ *
+ * To be called once a second.  Ages the table, expires old entries, and
+ * resends any requests that haven't yet been answered.
+ */
+void	arp_tick(void) {
+	for(int eid=0; eid<NUM_ARP_ENTRIES; eid++) {
+		ARP_TABLE_ENTRY	*e = &arp_table[eid];
+
+		if (e->valid == ARP_FREE)
+			continue;
+
+		e->age++;
+		if (e->valid == ARP_PENDING) {
+			if (e->tries >= ARP_RETRIES)
+				arp_remove(eid);
+			else {
+				e->tries++;
+				send_arp_request(e->ipaddr);
+			}
+		} else if (e->age >= ARP_TIMEOUT)
+			arp_remove(eid);
+	}
 }
 
 typedef struct	{
@@ -146,48 +237,26 @@ int	arp_logid = 0;
 ARP_TABLE_LOG_ENTRY	arp_table_log[32];
 
 void	arp_table_add(unsigned ipaddr, unsigned long mac) {
-	unsigned long	lclmac;
 	int		eid;
 
 	arp_table_log[arp_logid].ipaddr = ipaddr;
 	arp_table_log[arp_logid].mac = mac;
 	arp_logid++;
 	arp_logid&= 31;
-	
 
 	if (ipaddr == my_ip_addr)
 		return;
-	// Missing the 'if'??
-	else if (ipaddr == my_ip_router) {
+	else if (ipaddr == my_ip_router)
 		router_mac_addr = mac;
-	} else if (arp_lookup(ipaddr, &lclmac)==0) {
-		if (mac != lclmac) {
-			for(eid=0; eid<NUM_ARP_ENTRIES; eid++) {
-				if ((arp_table[eid].valid)&&
-					(arp_table[eid].ipaddr == ipaddr)) {
-					volatile int *ev = &arp_table[eid].valid;
-					// Prevent anyone from using an invalid
-					// entry while we are updating it
-					*ev = 0;
-					arp_table[eid].age = 0;
-					arp_table[eid].mac = mac;
-					*ev = 1;
-					break;
-				}
-			}
-		}
-	} else {
-		volatile int *ev = &arp_table[eid].valid;
-		eid = get_next_arp_index();
-
-		// Prevent anyone from using an invalid entry while we are
-		// updating it
-		*ev = 0;
-		arp_table[eid].age = 0;
-		arp_table[eid].ipaddr = ipaddr;
-		arp_table[eid].mac = mac;
-		*ev = 1;
-	}
+
+	// Answer any request that's pending, or refresh what we know
+	eid = arp_find(ipaddr);
+	if (eid < 0)
+		eid = arp_insert(ipaddr, ARP_VALID);
+	arp_table[eid].valid = ARP_VALID;
+	arp_table[eid].age   = 0;
+	arp_table[eid].tries = 0;
+	arp_table[eid].mac   = mac;
 }
 
 void	send_arp_reply(unsigned machi, unsigned maclo, unsigned ipaddr) {
@@ -43,6 +43,7 @@
 extern void	init_arp_table(void);
 extern	int	arp_lookup(unsigned ipaddr, unsigned long *mac);
 extern	void	arp_table_add(unsigned ipaddr, unsigned long mac);
+extern	void	arp_tick(void);
 extern	void	send_arp_reply(unsigned machi, unsigned maclo, unsigned ipaddr);
 
 #endif
@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	bench.c
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	Reports benchmark results, in the form sw/host/benchcmp.pl
+//		reads.  See bench.h.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include "bench.h"
+
+BENCHPERF	bench_perf, bench_overhead;
+int		bench_fails = 0;
+
+void	bench_begin(const char *suite) {
+	printf("%s counters=%s clkfreq=%d\n", suite, BENCH_COUNTERS,
+		CLKFREQHZ);
+}
+
+static unsigned	less(unsigned v, unsigned overhead) {
+	return (v > overhead) ? v - overhead : 0;
+}
+
+void	bench_net(BENCHPERF *p) {
+	p->p_clocks  = less(bench_perf.p_clocks,  bench_overhead.p_clocks);
+	p->p_insns   = less(bench_perf.p_insns,   bench_overhead.p_insns);
+	p->p_mstalls = less(bench_perf.p_mstalls, bench_overhead.p_mstalls);
+	p->p_pstalls = less(bench_perf.p_pstalls, bench_overhead.p_pstalls);
+}
+
+void	bench_print(const char *name, int iters, const BENCHPERF *p,
+		const char *extra, int pass) {
+	printf("BENCH name=%s iters=%d clocks=%u insns=%u mstalls=%u "
+		"pstalls=%u%s%s result=%s\n", name, iters,
+		p->p_clocks, p->p_insns, p->p_mstalls, p->p_pstalls,
+		(extra) ? " " : "", (extra) ? extra : "",
+		(pass) ? "pass" : "FAIL");
+	if (!pass)
+		bench_fails++;
+}
+
+void	bench_report(const char *name, int iters, int pass) {
+	BENCHPERF	p;
+
+	bench_net(&p);
+	bench_print(name, iters, &p, NULL, pass);
+}
+
+int	bench_end(const char *suite) {
+	printf("%s fails=%d\n", suite, bench_fails);
+	return (bench_fails) ? 1 : 0;
+}
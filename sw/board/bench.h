@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	bench.h
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	What the benchmark programs (zipbench, cksumbench, divbench,
+//		membench, and oledbench) have in common: starting and stopping
+//	the counters, and reporting the results.  Each runs from start to
+//	finish without any help and exits when done, so that
+//
+//		main_tb zipbench > bench.txt
+//
+//	from the sim/verilated directory is all it takes to run one.
+//
+//	Counts come from the ZipSystem's accounting counters, less the cost of
+//	starting and stopping them (or of whatever else BENCH_CALIBRATE() was
+//	given), and are printed one benchmark per line:
+//
+//		BENCH name=dhry iters=100 clocks=N insns=N mstalls=N pstalls=N
+//			result=pass
+//
+//	(on one line).  mstalls are clocks stalled on memory operands, and
+//	pstalls clocks spent waiting on the prefetch.  A benchmark may add
+//	fields of its own before the result.  Without the accounting
+//	counters, clocks come from timer C and the other counts are zero.
+//	sw/host/benchcmp.pl compares two such runs.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	BENCH_H
+#define	BENCH_H
+
+// board.h first, since it decides which parts of the ZipSystem zipsys.h
+// describes
+#include "board.h"
+#include "zipsys.h"
+
+// Timer C counts down, once per clock, from wherever it is set.  It's not
+// used for anything else by the benchmarks.
+#define	TMSTART		0x7fffffff
+#define	START_TIMER()	(_zip->z_tmc = TMSTART)
+#define	TICKS()		(TMSTART - (unsigned)_zip->z_tmc)
+
+typedef	struct	{
+	unsigned	p_clocks, p_insns, p_mstalls, p_pstalls;
+} BENCHPERF;
+
+// The last measurement, and the overhead to be taken from each
+extern	BENCHPERF	bench_perf, bench_overhead;
+extern	int		bench_fails;
+
+#ifdef	_HAVE_ZIPSYS_PERFORMANCE_COUNTERS
+#define	BENCH_COUNTERS	"zipsys"
+// The z_m counters count in both supervisor and user mode
+static inline void	bench_start(void) {
+	_zip->z_m.ac_icnt = 0;
+	_zip->z_m.ac_pf   = 0;
+	_zip->z_m.ac_mem  = 0;
+	_zip->z_m.ac_ck   = 0;
+}
+
+static inline void	bench_stop(BENCHPERF *p) {
+	p->p_clocks  = _zip->z_m.ac_ck;
+	p->p_insns   = _zip->z_m.ac_icnt;
+	p->p_mstalls = _zip->z_m.ac_mem;
+	p->p_pstalls = _zip->z_m.ac_pf;
+}
+#else
+#define	BENCH_COUNTERS	"timer"
+static inline void	bench_start(void) {
+	START_TIMER();
+}
+
+static inline void	bench_stop(BENCHPERF *p) {
+	p->p_clocks  = TICKS();
+	p->p_insns   = 0;
+	p->p_mstalls = 0;
+	p->p_pstalls = 0;
+}
+#endif
+
+// Measure STMT into bench_perf
+#define	BENCH_TIME(STMT)	do {					\
+		bench_start();						\
+		STMT;							\
+		bench_stop(&bench_perf);				\
+	} while(0)
+
+// Measure STMT as the overhead.  The first pass loads the cache, so only the
+// second is kept.
+#define	BENCH_CALIBRATE(STMT)	do {					\
+		BENCH_TIME(STMT);					\
+		BENCH_TIME(STMT);					\
+		bench_overhead = bench_perf;				\
+	} while(0)
+
+// Print the suite's name and the counters in use
+extern	void	bench_begin(const char *suite);
+// bench_perf, less the overhead
+extern	void	bench_net(BENCHPERF *p);
+// Print one BENCH line.  extra, if not NULL, holds further name=value fields.
+extern	void	bench_print(const char *name, int iters, const BENCHPERF *p,
+			const char *extra, int pass);
+// Print bench_perf, less the overhead
+extern	void	bench_report(const char *name, int iters, int pass);
+// Print the number of failures, and return main()'s exit code
+extern	int	bench_end(const char *suite);
+
+#endif
@@ -0,0 +1,148 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	cksumbench.c
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	Measures how many clocks ipcksum() takes over packets of
+//		several sizes, next to the original word at a time loop, and
+//	how long ipcksum_update() takes to patch a checksum.  Each result is
+//	also checked against the original.  Results are reported, and the
+//	program run, as bench.h describes.  Each line is named for the kernel
+//	and the number of words summed, as in cksum375_unrolled.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include "bench.h"
+#include "zipcpu.h"
+#include "ipcksum.h"
+
+#define	NTRIALS		16
+#define	MAXLEN		376	// Words, a bit more than a full 1500 byte packet
+
+// The checksum kernel as it was: one word, and one branch, per pass
+unsigned	ipcksum_simple(int len, unsigned *ptr);
+asm(ASMFNSTR("ipcksum_simple")		// R1 = length (W), R2 = packet pointer
+	"\tMOV	R1,R3\n"
+	"\tCLR	R1\n"
+".Lsloop:\n"
+	"\tLW	(R2),R4\n"
+	"\tADD	R4,R1\n"
+	"\tADD.C	1,R1\n"
+	"\tADD	4,R2\n"
+	"\tSUB	1,R3\n"
+	"\tBZ	.Lsexit\n"
+	"\tBRA	.Lsloop\n"
+".Lsexit:\n"
+	"\tMOV	R1,R3\n"
+	"\tAND	0x0ffff,R1\n"
+	"\tLSR	16,R3\n"
+	"\tADD	R3,R1\n"
+	"\tTEST	0xffff0000,R1\n"
+	"\tADD.NZ 1,R1\n"
+	"\tAND	0x0ffff,R1\n"
+	"\tXOR	0x0ffff,R1\n"
+	"\tRETN");
+
+// In one's complement, 0xffff and 0x0000 are both zero, and an incremental
+// update may legitimately return either one where the full sum returns the
+// other.  Fold them together before comparing.
+int	same_cksum(unsigned a, unsigned b) {
+	if (a == 0x0ffff)
+		a = 0;
+	if (b == 0x0ffff)
+		b = 0;
+	return (a == b);
+}
+
+unsigned	pkt[MAXLEN];
+const int	lengths[] = { 2, 5, 7, 16, 64, 256, 375, 0 };
+
+// Measures NTRIALS calls of fn over len words into bench_perf
+void	timeit(unsigned (*fn)(int, unsigned *), int len, unsigned *result) {
+	BENCH_TIME(for(int k=0; k<NTRIALS; k++) *result = fn(len, pkt));
+}
+
+int main(int argc, char **argv) {
+	unsigned	seed = 0x5a5a5a5a, result, expected;
+	char		name[32];
+
+	bench_begin("CKSUMBENCH");
+
+	// Fill the packet with something that isn't all zeros
+	for(int k=0; k<MAXLEN; k++) {
+		seed = seed * 1103515245 + 12345;
+		pkt[k] = seed;
+	}
+
+	// The cost of the counters and the call itself, with no data
+	BENCH_CALIBRATE(timeit(ipcksum, 0, &result));
+
+	for(int i=0; lengths[i]; i++) {
+		int		len = lengths[i];
+
+		timeit(ipcksum_simple, len, &expected);
+		sprintf(name, "cksum%d_original", len);
+		bench_report(name, NTRIALS, 1);
+
+		timeit(ipcksum, len, &result);
+		sprintf(name, "cksum%d_unrolled", len);
+		bench_report(name, NTRIALS, result == expected);
+		if (result != expected)
+			printf("FAIL: %d words, checksum %04x should be %04x\n",
+				len, result, expected);
+	}
+
+	// Patch one word of a full sized packet, and check against the sum
+	{
+		unsigned	cksum, oldw, neww;
+
+		cksum = ipcksum(375, pkt);
+		oldw = pkt[100];
+		neww = oldw ^ 0x08000800;
+
+		BENCH_TIME(for(int k=0; k<NTRIALS; k++)
+			result = ipcksum_update(cksum, oldw, neww));
+
+		pkt[100] = neww;
+		expected = ipcksum(375, pkt);
+		pkt[100] = oldw;
+
+		bench_report("cksum_update", NTRIALS,
+			same_cksum(result, expected));
+		if (!same_cksum(result, expected))
+			printf("FAIL: updated checksum %04x should be %04x\n",
+				result, expected);
+	}
+
+	return bench_end("CKSUMBENCH");
+}
@@ -0,0 +1,207 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	divbench.c
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+// Purpose:	Measures how many clocks a 64-bit divide takes, for each of
+//		32-bit by 32-bit, 64-bit by 32-bit, and 64-bit by 64-bit
+//	operands, using the library's __udivdi3() next to the original bit at
+//	a time routine.  Division by a constant, via udivconst(), is timed on
+//	the 64-bit by 32-bit cases as well.  Every quotient is also checked
+//	against the original.  Results are reported, and the program run, as
+//	bench.h describes, one line per case and routine, as in
+//	div64/32_library.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <stdint.h>
+#include "bench.h"
+#include "zipcpu.h"
+#include "udiv.h"
+
+#define	NTRIALS		16
+#define	NPAIRS		8
+
+// The divide as it was: a bit at a time, once the operands no longer fit
+// the hardware's 32-bit divide
+int	cltz_simple(unsigned long);
+asm(ASMFNSTR("cltz_simple")
+	"\tMOV	R1,R3\n"
+	"\tCLR	R1\n"
+	"\tCMP	0,R3\n"
+	"\tMOV.Z R2,R3\n"
+	"\tADD.Z 32,R1\n"
+	"\tBREV	R3\n"
+	"\tTEST	0x0ffff,R3\n"
+	"\tADD.Z 16,R1\n"
+	"\tLSR.Z 16,R3\n"
+	"\tTEST	0x0ff,R3\n"
+	"\tADD.Z 8,R1\n"
+	"\tLSR.Z 8,R3\n"
+	"\tTEST	0x0f,R3\n"
+	"\tADD.Z 4,R1\n"
+	"\tLSR.Z 4,R3\n"
+	"\tTEST	0x03,R3\n"
+	"\tADD.Z 2,R1\n"
+	"\tLSR.Z 2,R3\n"
+	"\tTEST	0x01,R3\n"
+	"\tADD.Z 1,R1\n"
+	"\tRETN\n");
+
+unsigned long
+udivdi3_simple(unsigned long a, unsigned long b) {
+	unsigned long	r;
+
+	if (a < b)
+		return 0;
+	if (((b>>32)==0)&&((a>>32)==0)) {
+		uint32_t	ia, ib, ir;
+
+		ia = (uint32_t) a;
+		ib = (uint32_t) b;
+		ir = ia / ib;
+		r = (unsigned long)ir;
+		return r;
+	}
+
+	int	la = cltz_simple(a), lb = cltz_simple(b);
+	a <<= la;
+	unsigned long	m;
+	if ((lb - la < 32)&&(((b<<la)&0x0ffffffff)==0)) {
+		uint32_t	ia, ib, ir;
+		b <<= la;
+		ia = (uint32_t)(a>>32);
+		ib = (uint32_t)(b>>32);
+		ir = ia / ib;
+		r = ir;
+		return r;
+	} else {
+		r = 0;
+		b <<= lb;
+		m = (1ul<<(lb-la));
+		while(m > 0) {
+			if (a >= b) {
+				r |= m;
+				a -= b;
+			}
+			m>>= 1;
+			b >>= 1;
+		} return r;
+	}
+}
+
+typedef	struct	{
+	const char	*name;
+	unsigned long	a[NPAIRS], b[NPAIRS];
+} DIVCASE;
+
+DIVCASE	cases[3] = {
+	{ "32/32",
+	  { 1000000000ul, 0xfffffffful, 123456789ul, 86399ul,
+	    0x80000000ul, 65535ul, 3600000ul, 0xdeadbeeful },
+	  { 7ul, 10ul, 1000ul, 3600ul, 0x10000ul, 255ul, 60ul, 0x1234ul } },
+	// Microseconds, such as since 1970, converted to seconds
+	{ "64/32",
+	  { 1593561600000000ul, 1600000000123456ul, 0x0123456789abcdeful,
+	    0xfffffffffffffffful, 0x100000000ul, 131999999999999ul,
+	    0x7fffffff00000000ul, 86400000000ul },
+	  { 1000000ul, 1000000ul, 1000000ul, 1000000ul, 1000000ul, 1000000ul,
+	    1000000ul, 1000000ul } },
+	{ "64/64",
+	  { 0xfffffffffffffffful, 0x0123456789abcdeful, 1593561600000000ul,
+	    0x8000000000000000ul, 0x7ffffffffffffffful, 0x100000000ul,
+	    0xfedcba9876543210ul, 0x5555555555555555ul },
+	  { 0x100000001ul, 0x12345678aul, 86400000000ul, 0xfffffffffful,
+	    0x100000000ul, 0x100000000ul, 0x8000000000000001ul,
+	    0x3333333333ul } }
+};
+
+unsigned long	results[NPAIRS], expected[NPAIRS];
+
+// Measures NTRIALS passes of fn over all of the pairs in one case, into
+// bench_perf
+void	timeit(unsigned long (*fn)(unsigned long, unsigned long),
+			const DIVCASE *c, unsigned long *r) {
+	BENCH_TIME(for(int k=0; k<NTRIALS; k++)
+			for(int i=0; i<NPAIRS; i++)
+				r[i] = fn(c->a[i], c->b[i]));
+}
+
+// Does nothing, for measuring the cost of the loop and the call
+unsigned long	divnull(unsigned long a, unsigned long b) {
+	return a;
+}
+
+// Reports the last measurement, checking r against expected
+void	check(const DIVCASE *c, const char *routine, const unsigned long *r) {
+	char	name[32];
+	int	pass = 1;
+
+	for(int i=0; i<NPAIRS; i++) {
+		if (r[i] != expected[i]) {
+			printf("FAIL: %s %s, pair %d\n", c->name, routine, i);
+			pass = 0;
+		}
+	}
+
+	sprintf(name, "div%s_%s", c->name, routine);
+	bench_report(name, NTRIALS * NPAIRS, pass);
+}
+
+int main(int argc, char **argv) {
+	bench_begin("DIVBENCH");
+
+	BENCH_CALIBRATE(timeit(divnull, &cases[0], results));
+
+	for(int c=0; c<3; c++) {
+		timeit(udivdi3_simple, &cases[c], expected);
+		check(&cases[c], "original", expected);
+		timeit(__udivdi3, &cases[c], results);
+		check(&cases[c], "library", results);
+
+		if (c == 1) {
+			// All of these divide by the same thing, so time the
+			// reciprocal instead of the divide
+			UDIVCONST	kdiv;
+			uint32_t	rem;
+
+			udivconst_init(&kdiv, (uint32_t)cases[c].b[0]);
+			BENCH_TIME(for(int k=0; k<NTRIALS; k++)
+				for(int i=0; i<NPAIRS; i++)
+					results[i] = udivconst(&kdiv,
+						cases[c].a[i], &rem));
+			check(&cases[c], "constant", results);
+		}
+	}
+
+	return bench_end("DIVBENCH");
+}
@@ -0,0 +1,134 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	enetrx.c
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	Moves received network packets from the network port's one
+//		receive buffer into a ring of packets, so that the port may
+//	receive the next packet while this one is being processed.  See
+//	enetrx.h for how the ring is to be used.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <string.h>
+#include "zipcpu.h"
+#include "zipsys.h"
+#include "board.h"
+#include "enetrx.h"
+
+#ifdef	_BOARD_HAS_ENETP
+// Packets received into the ring, packets dropped for errors, and the number
+// of times a packet had to wait in the hardware for a free slot
+unsigned	enetrx_pkts = 0, enetrx_errs = 0, enetrx_full = 0;
+
+static	RXPKT	rxring[NRXPKTS];
+// m_head is only ever written by the supervisor, m_tail by the user task.
+// Both count packets, and are only reduced modulo NRXPKTS when indexing.
+static	volatile unsigned	m_head = 0, m_tail = 0;
+// Set when the receive interrupt has been turned off for want of a free slot
+static	volatile int		m_stalled = 0;
+
+void	enetrx_init(void) {
+	m_head = m_tail = 0;
+	m_stalled = 0;
+	_netp->n_rxcmd = ENET_RXCLRERR|ENET_RXCLR;
+}
+
+/*
+ * enetrx_isr()
+ *
+ * To be called by the supervisor on a receive interrupt.  Copies the packet
+ * waiting in the hardware into the next free slot, and clears the hardware to
+ * receive another.  Returns 0 if the hardware is free to receive again, or -1
+ * if the ring is full.  In that case the packet is left in the hardware, and
+ * the receive interrupt is turned off until enetrx_release() frees a slot.
+ */
+int	enetrx_isr(void) {
+	unsigned	rxcmd = _netp->n_rxcmd;
+
+	if ((rxcmd & ENET_RXAVAIL)==0)
+		return 0;
+
+	if (rxcmd & (ENET_RXERR|ENET_RXCRC)) {
+		enetrx_errs++;
+		_netp->n_rxcmd = ENET_RXCLRERR|ENET_RXCLR;
+		return 0;
+	}
+
+	if (m_head - m_tail >= NRXPKTS) {
+		enetrx_full++;
+		m_stalled = 1;
+		_zip->z_pic = DINT(SYSINT_ENETRX);
+		return -1;
+	}
+
+	RXPKT	*pkt = &rxring[m_head & (NRXPKTS-1)];
+	int		nw = ((rxcmd & 0x07ff)+3)>>2;
+
+	// Both buffers are word aligned, so memcpy() moves the packet in
+	// bursts of eight words
+	memcpy(pkt->p_data, (const void *)_netbrx, nw * sizeof(unsigned));
+
+	pkt->p_rxcmd = rxcmd;
+	_netp->n_rxcmd = ENET_RXCLRERR|ENET_RXCLR;
+	m_head = m_head + 1;
+	enetrx_pkts++;
+
+	return 0;
+}
+
+/*
+ * enetrx_get()
+ *
+ * Returns the oldest packet in the ring, or NULL if there are none.  The
+ * packet remains valid until it is released.
+ */
+RXPKT	*enetrx_get(void) {
+	if (m_head == m_tail)
+		return NULL;
+	return &rxring[m_tail & (NRXPKTS-1)];
+}
+
+/*
+ * enetrx_release()
+ *
+ * Returns the oldest packet's slot, as returned by enetrx_get(), to the ring.
+ */
+void	enetrx_release(RXPKT *pkt) {
+	m_tail = m_tail + 1;
+	if (m_stalled) {
+		// The supervisor ran out of room, so turn the receive
+		// interrupt back on to let it pick up the waiting packet
+		m_stalled = 0;
+		_zip->z_pic = EINT(SYSINT_ENETRX);
+	}
+}
+#endif	// _BOARD_HAS_ENETP
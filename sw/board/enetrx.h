@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	enetrx.h
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	A ring of received network packets.  The network port has
+//		only the one receive buffer, and it can't accept a new packet
+//	until that buffer has been cleared.  Hence, the supervisor moves
+//	each packet into the next slot of a ring the moment it arrives (on the
+//	receive interrupt), and releases the hardware to receive the next.
+//	Protocol handlers then parse each packet in place, within its slot,
+//	and release the slot when done.
+//
+//	There's only one writer (the supervisor) and one reader (the user task)
+//	of the ring, so no locks are needed.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	ENETRX_H
+#define	ENETRX_H
+
+// The number of slots in the ring.  Must be a power of two.
+#define	NRXPKTS		8
+// Words in each slot, enough for the largest packet the port can receive
+#define	RXPKTW		512
+
+typedef	struct	RXPKT_S {
+	// A copy of the n_rxcmd register, as it was when the packet arrived,
+	// for the length and the broadcast flag
+	unsigned	p_rxcmd;
+	// The packet itself, starting with the destination MAC
+	unsigned	p_data[RXPKTW];
+} RXPKT;
+
+#define	RXPKT_LEN(P)	((P)->p_rxcmd & 0x07ff)
+
+extern	unsigned	enetrx_pkts, enetrx_errs, enetrx_full;
+
+extern	void	enetrx_init(void);
+extern	int	enetrx_isr(void);
+extern	RXPKT	*enetrx_get(void);
+extern	void	enetrx_release(RXPKT *pkt);
+
+#endif
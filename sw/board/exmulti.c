@@ -42,6 +42,8 @@
 #include "zipsys.h"
 #include <stdio.h>
 #include <string.h>
+#include "gpsrx.h"
+#include "nmea.h"
 
 void	idle_task(void) {
 	while(1)
@@ -94,94 +96,37 @@ void	user_task(void) {
 	}
 }
 
-int	mpyuhi(int a, int b) {
-	// err_in_ns = mpyuhi(err_in_ns, err);
-	// __asm__("MPYUHI %1,%0" :"+r"(a):"r"(b));
-	unsigned alo, blo, ahi, bhi, f, o, i, l, rhi;
-
-	alo = (a & 0x0ffff);
-	ahi = (a >> 16)&0x0ffff;
-	blo = (b & 0x0ffff);
-	bhi = (b >> 16)&0x0ffff;
-
-	l = alo * blo;
-	o = ahi * blo;
-	i = alo * bhi;
-	f = ahi * bhi;
-
-	rhi = o + i + (l >> 16);
-	return (rhi >> 16) + f;
-	// return f;
-	// return ahi;
-}
+// Report each RMC fix as it comes in, once a second
+void	gps_report(void) {
+	const GPSFIX	*f = &gps_fix;
+	int		lat = f->f_lat, lon = f->f_lon;
 
-#ifdef	GPSUART_ACCESS
-int	gps_lock = 0;
-void	gps_process_line(const char *line) {
-	if ((line[0] != '$')||(line[1] != 'G')
-			||(line[2] != 'P'))
+	if (!f->f_valid) {
+		printf("No GPS lock\r\n");
 		return;
+	}
 
-	// GGA, GSV(x3), RMC, VTG
-	if (line[3] == 'G') {
-		/*
-		if ((line[4] == 'G')&&(line[5] == 'A')) {
-		} // else if ((line[5] == 'S')&&(line[6] == 'V')) {
-		}
-		*/
-		// printf("GPS Line: %s\r\n", line);
-	} else if (line[3] == 'R') {
-		// if ((line[4] == 'M')&&(line[5] == 'C')&&(line[6] == ','))
-		{
-			// char	outbuf[256], *outptr = outbuf;
-			// const char *here = &line[8], *there;
-			// there = strchr(here, ',');
-			fputs("RMC-Line\r\n", stdout);
-#ifdef	PROCLINE
-			if ((there)&&(there - here > 6)) {
-				outptr += sprintf(outptr,
-					"TIME: %c%c:%c%c:%c%c\r\n", 
-						here[0], here[1],
-						here[2], here[3],
-						here[4], here[5]);
-				here = there + 1;
-				there = strchr(here, ',');
-			} if (there) {
-				if (*here == 'A')
-					gps_lock = 1;
-				else
-					gps_lock = 0;
-				here = there + 1;
-				there = strchr(there+1, ',');
-			} if (there) {
-				there = strchr(there+1, ',');
-			} if (there) {
-				char	tmp[32];
-				strncpy(tmp, here, there-here);
-				outptr += sprintf(outptr, "LATITUDE: %s\r\n");
-				here = there + 1;
-				there = strchr(there+1, ',');
-			} if (there) {
-				there = strchr(there+1, ',');
-			} if (there) {
-				char	tmp[32];
-				strncpy(tmp, here, there-here);
-				outptr += sprintf(outptr, "LONGITUDE: %s\r\n");
-			} if (gps_lock)
-				fputs(outbuf, stdout);
-			else	puts("No GPS lock\r\n");
-#endif
-		}
-		printf("GPS RMC Line: %s\r\n", line);
-	} else if (line[3] == 'V') {
-		/*
-		if ((line[4] == 'T')&&(line[5] == 'G')) {
-		}
-		*/
-		// printf("GPS Line: %s\r\n", line);
-	} else printf("Other GPS Line: %s\r\n", line);
+	printf("TIME: %02x:%02x:%02x.%03u, DATE: %08x\r\n",
+		(f->f_time >> 16) & 0x0ff, (f->f_time >> 8) & 0x0ff,
+		f->f_time & 0x0ff, zip_mpyuhi(f->f_subsec, 1000),
+		f->f_date);
+	printf("LATITUDE: %c%d.%07d, LONGITUDE: %c%d.%07d\r\n",
+		(lat < 0) ? 'S':'N',
+		((lat < 0) ? -lat : lat) / 10000000,
+		((lat < 0) ? -lat : lat) % 10000000,
+		(lon < 0) ? 'W':'E',
+		((lon < 0) ? -lon : lon) / 10000000,
+		((lon < 0) ? -lon : lon) % 10000000);
+}
+
+// Run whatever has arrived from the GPS through the NMEA parser
+void	gps_parse(void) {
+	int	ch;
+
+	while((ch = gpsrx_getc()) >= 0)
+		if (nmea_putc(ch) == NMEA_RMC)
+			gps_report();
 }
-#endif
 
 char	errstring[128];
 
@@ -285,9 +230,7 @@ void	main(int argc, char **argv) {
 
 	_zip->z_tma = TMR_INTERVAL | (second/1000);
 	wait_on_interrupt(SYSINT_TMA);
-#ifdef	GPSUART_ACCESS
-	_gpsu->u_rx = 0x01000;
-#endif
+	gpsrx_init();
 	while(1) {
 		char	*s = errstring;
 
@@ -303,7 +246,7 @@ void	main(int argc, char **argv) {
 		int	err_sgn = (err < 0)?1:0, err_in_ns_rem;
 
 		err_in_ns = (err<0)?-err:err;
-		err_in_ns = mpyuhi(err_in_ns, 1000000000);
+		err_in_ns = zip_mpyuhi(err_in_ns, 1000000000);
 
 		err_in_us = err_in_ns / 1000;
 		err_in_ns_rem = err_in_ns - err_in_us * 1000;
@@ -321,33 +264,14 @@ void	main(int argc, char **argv) {
 #ifdef	GPSTRK_ACCESS
 		_zip->z_pic  = SYSINT_GPSRXF | SYSINT_PPS | SYSINT_TMA;
 
-		{
-			const int	LINEBUFSZ = 80;
-			char	line[LINEBUFSZ], *linep = line;
-			do {
-				int	v;
-
-#ifdef	GPSUART_ACCESS
-				wait_on_interrupt(SYSINT_PPS|SYSINT_GPSRXF|SYSINT_TMA);
-
-				while(((v = _gpsu->u_rx)&0x100)==0) {
-					v &= 0x0ff;
-					// putchar(v);
-					// sys->io_uart.u_tx = v;
-					*linep++ = v;
-					if(linep-line > LINEBUFSZ)
-						linep = line;
-					if ((v == '\r')||(v == '\n')) {
-						*linep = '\0';
-						if (line[0] == '$')
-							gps_process_line(line);
-						linep = line;
-					}
-				}
-#endif
-				wait_on_interrupt(SYSINT_PPS|SYSINT_TMA);
-			} while((_zip->z_pic & SYSINT_PPS)==0);
-		}
+		do {
+			wait_on_interrupt(SYSINT_PPS|SYSINT_GPSRXF|SYSINT_TMA);
+			// Once a millisecond, and whenever the GPS FIFO is
+			// half full, empty the FIFO into the ring.  Unless a
+			// sentence has ended, this is all it costs.
+			if (gpsrx_isr())
+				gps_parse();
+		} while((_zip->z_pic & SYSINT_PPS)==0);
 #endif
 	}
 
@@ -0,0 +1,126 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	exsched.c
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+// Purpose:	Demonstrates the task scheduler in sw/zlib/sched.c.  Four
+//		tasks share the CPU: one blinks an LED, one follows the
+//	switches with the color LEDs, one reports once a second (and on every
+//	GPS PPS), and one at the lowest priority does nothing but count.  The
+//	last never waits, so everything else only runs because the scheduler
+//	takes the CPU away from it.  The console's output is sent from its
+//	FIFO interrupt, by way of a supervisor handler.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include "board.h"
+#include "zipcpu.h"
+#include "zipsys.h"
+#include "txbuf.h"
+#include "sched.h"
+#include "ledcolors.h"
+
+#define	QUANTUM		(CLKFREQHZ/1000)	// One millisecond
+#define	STACKW		256
+
+int	blink_stack[STACKW], switch_stack[STACKW], report_stack[STACKW],
+	count_stack[STACKW];
+volatile unsigned	counts = 0;
+
+void	blink_task(void *arg) {
+	while(1) {
+#ifdef	_BOARD_HAS_SPIO
+		*_spio = 0x0101;
+		task_sleep(250);
+		*_spio = 0x0100;
+		task_sleep(750);
+#else
+		task_exit();
+#endif
+	}
+}
+
+void	switch_task(void *arg) {
+	while(1) {
+#if	defined(_BOARD_HAS_SPIO) && defined(_BOARD_HAS_CLRLED)
+		unsigned	sw = (*_spio >> 16) & 0x0f;
+
+		for(int i=0; i<4; i++)
+			_clrled[i] = (sw & (1<<i)) ? LEDC_GREEN : 0;
+		task_sleep(20);
+#else
+		task_exit();
+#endif
+	}
+}
+
+void	report_task(void *arg) {
+	unsigned	seconds = 0, last = 0, now;
+
+	while(1) {
+#ifdef	GPSTRK_ACCESS
+		// Wake on the PPS, or after a second if there isn't one
+		if (task_wait(SYSINT_PPS, 1000) & SYSINT_PPS)
+			txbuf_printf("PPS ");
+#else
+		task_sleep(1000);
+#endif
+		now = counts;
+		txbuf_printf("%4u: %u counts, %u faults\n", ++seconds,
+			now - last, sched_faults);
+		last = now;
+	}
+}
+
+void	count_task(void *arg) {
+	while(1)
+		counts++;
+}
+
+int main(int argc, char **argv) {
+	_zip->z_pic = CLEARPIC;
+
+	printf("Scheduler demonstration\n");
+	txbuf_useint(1);
+	sched_isr(SYSPIC_UARTTXF, txbuf_isr);
+
+	sched_task(blink_task,  NULL, blink_stack,  STACKW, 3);
+	sched_task(switch_task, NULL, switch_stack, STACKW, 2);
+	sched_task(report_task, NULL, report_stack, STACKW, 1);
+	sched_task(count_task,  NULL, count_stack,  STACKW, 0);
+
+	sched_run(QUANTUM);
+
+	// Only gets here if every task exits
+	txbuf_flush();
+	zip_halt();
+}
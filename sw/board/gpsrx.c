@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	gpsrx.c
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	The interrupt fed receive ring for the GPS UART.  See gpsrx.h.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include "zipcpu.h"
+#include "zipsys.h"
+#include "board.h"
+#include "gpsrx.h"
+
+unsigned	gpsrx_dropped = 0, gpsrx_errs = 0;
+
+#ifdef	_BOARD_HAS_GPS_UART
+static	volatile char	m_ring[GPSRXLN];
+// m_head is only ever written by the supervisor, m_tail by the reader.  Both
+// count characters, and are only reduced modulo GPSRXLN when indexing.
+static	volatile unsigned	m_head = 0, m_tail = 0;
+
+void	gpsrx_init(void) {
+	m_head = m_tail = 0;
+	// Clear any errors, and anything left in the FIFO
+	_gpsu->u_rx = 0x01000;
+}
+
+/*
+ * gpsrx_isr()
+ *
+ * To be called by the supervisor on the GPS UART's SYSINT_GPSRXF interrupt,
+ * and on a regular timer tick.  Moves everything in the FIFO into the ring.
+ * Returns non-zero if a sentence ended (a newline arrived), so that the
+ * caller knows there's something worth parsing.
+ */
+int	gpsrx_isr(void) {
+	unsigned	head = m_head;
+	int		v, eol = 0;
+
+	while(((v = _gpsu->u_rx) & UART_RX_NOTREADY)==0) {
+		if (v & (UART_RX_BREAK|UART_RX_FRAMEERR|UART_RX_PARITYERR)) {
+			// The parity error, at least, is sticky, and would
+			// otherwise throw away every character from here on
+			_gpsu->u_rx = UART_RX_PARITYERR|UART_RX_FRAMEERR;
+			gpsrx_errs++;
+			continue;
+		}
+
+		if (head - m_tail >= GPSRXLN) {
+			gpsrx_dropped++;
+			continue;
+		}
+
+		v &= 0x0ff;
+		m_ring[head & (GPSRXLN-1)] = (char)v;
+		head++;
+		if (v == '\n')
+			eol = 1;
+	} m_head = head;
+
+	return eol;
+}
+
+/*
+ * gpsrx_getc()
+ *
+ * Returns the next character from the ring, or -1 if it's empty.
+ */
+int	gpsrx_getc(void) {
+	unsigned	tail = m_tail;
+	int		ch;
+
+	if (tail == m_head)
+		return -1;
+	ch = (unsigned char)m_ring[tail & (GPSRXLN-1)];
+	m_tail = tail + 1;
+	return ch;
+}
+#else
+void	gpsrx_init(void) {}
+int	gpsrx_isr(void) { return 0; }
+int	gpsrx_getc(void) { return -1; }
+#endif
@@ -0,0 +1,66 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	gpsrx.h
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	A ring of characters received from the GPS.  The supervisor
+//		empties the GPS UART's receive FIFO into the ring whenever
+//	the FIFO is half full (SYSINT_GPSRXF), so nothing is lost while the
+//	rest of the program is busy, and the NMEA parser is only run once a
+//	whole sentence has arrived.
+//
+//	The half-full interrupt alone would leave the end of each burst of
+//	sentences sitting in the FIFO until the next burst, so gpsrx_isr()
+//	should also be called on a regular timer tick.  When the FIFO is empty,
+//	this costs a single read.
+//
+//	As with enetrx, there's one writer (the supervisor) and one reader of
+//	the ring, so no locks are needed.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	GPSRX_H
+#define	GPSRX_H
+
+// The size of the ring, in characters.  Must be a power of two.  A second's
+// worth of sentences at 9600 baud fits, with room to spare.
+#define	GPSRXLN		1024
+
+// Characters dropped for want of room, and characters received with framing,
+// parity, or break errors
+extern	unsigned	gpsrx_dropped, gpsrx_errs;
+
+extern	void	gpsrx_init(void);
+extern	int	gpsrx_isr(void);
+extern	int	gpsrx_getc(void);
+
+#endif
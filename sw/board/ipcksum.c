@@ -9,6 +9,9 @@
 //	(which is usually a part of it) must be blank when calling this
 //	function.
 //
+//	ipcksum_update() adjusts an existing checksum for a change to one word
+//	of the data it covers, per RFC 1624, without touching the rest.
+//
 // Creator:	Dan Gisselquist, Ph.D.
 //		Gisselquist Technology, LLC
 //
@@ -42,8 +45,8 @@
 #include "ipcksum.h"
 
 #define ASM
-unsigned	ipcksum(int len, unsigned *ptr) {
 #ifndef	ASM
+unsigned	ipcksum(int len, unsigned *ptr) {
 	unsigned	checksum = 0;
 
 	for(int i=0; i<len; i++)
@@ -51,19 +54,56 @@ unsigned	ipcksum(int len, unsigned *ptr) {
 	while(checksum & ~0x0ffff)
 		checksum = (checksum & 0x0ffff) + (checksum >> 16);
 	return checksum ^ 0x0ffff;
+}
 #else
+//
+// Words are added 32-bits at a time, with the carry wrapped around, and only
+// folded to 16-bits at the end.  The main loop reads four words at a time, so
+// that the loads can go out as a single pipelined burst and the loop branch
+// is only taken once every four words.  Any words left over (len % 4) are
+// handled first.  R5-R7 belong to our caller, and so are saved on the stack.
+//
 asm(ASMFNSTR("ipcksum")			// R1 = length (W), R2 = packet pointer
+	"\tSUB	12,SP\n"
+	"\tSW	R5,(SP)\n"
+	"\tSW	R6,4(SP)\n"
+	"\tSW	R7,8(SP)\n"
 	"\tMOV	R1,R3\n"		// R3 is now the remaining length
 	"\tCLR	R1\n"			// R1 will be our checksum accumulator
+	"\tTEST	3,R3\n"
+	"\tBZ	.Lquad\n"
+".Lsingle:\n"				// One word at a time, until a multiple
+	"\tLW	(R2),R4\n"		// of four remain
+	"\tADD	4,R2\n"
+	"\tADD	R4,R1\n"
+	"\tADD.C	1,R1\n"
+	"\tSUB	1,R3\n"
+	"\tTEST	3,R3\n"
+	"\tBNZ	.Lsingle\n"
+".Lquad:\n"
+	"\tLSR	2,R3\n"			// R3 is now the number of bursts
+	"\tBZ	.Lexit\n"
 ".Lloop:\n"
 	"\tLW	(R2),R4\n"
+	"\tLW	4(R2),R5\n"
+	"\tLW	8(R2),R6\n"
+	"\tLW	12(R2),R7\n"
 	"\tADD	R4,R1\n"
 	"\tADD.C	1,R1\n"
-	"\tADD	4,R2\n"
+	"\tADD	R5,R1\n"
+	"\tADD.C	1,R1\n"
+	"\tADD	R6,R1\n"
+	"\tADD.C	1,R1\n"
+	"\tADD	R7,R1\n"
+	"\tADD.C	1,R1\n"
+	"\tADD	16,R2\n"
 	"\tSUB	1,R3\n"
-	"\tBZ	.Lexit\n"
-	"\tBRA	.Lloop\n"
+	"\tBNZ	.Lloop\n"
 ".Lexit:\n"
+	"\tLW	(SP),R5\n"
+	"\tLW	4(SP),R6\n"
+	"\tLW	8(SP),R7\n"
+	"\tADD	12,SP\n"
 	"\tMOV	R1,R3\n"
 	"\tAND	0x0ffff,R1\n"
 	"\tLSR	16,R3\n"
@@ -74,5 +114,23 @@ asm(ASMFNSTR("ipcksum")			// R1 = length (W), R2 = packet pointer
 	"\tXOR	0x0ffff,R1\n"
 	"\tRETN");
 #endif
-}
 
+/*
+ * ipcksum_update()
+ *
+ * Given the checksum, cksum, over some data, returns what it becomes when one
+ * 32-bit word of that data changes from oldw to neww.  This is equation 3 of
+ * RFC 1624, HC' = ~(~HC + ~m + m'), applied to both halves of the word.  Any
+ * part of the word that holds the checksum itself should be zero in both
+ * oldw and neww.
+ */
+unsigned	ipcksum_update(unsigned cksum, unsigned oldw, unsigned neww) {
+	unsigned	sum;
+
+	sum = (~cksum & 0x0ffff)
+		+ (~oldw & 0x0ffff) + ((~oldw >> 16) & 0x0ffff)
+		+ ( neww & 0x0ffff) + ( neww >> 16);
+	sum = (sum & 0x0ffff) + (sum >> 16);
+	sum = (sum & 0x0ffff) + (sum >> 16);
+	return (~sum) & 0x0ffff;
+}
@@ -42,6 +42,7 @@
 #define	IPCKSUM_H
 
 extern unsigned	ipcksum(int len, unsigned *ptr);
+extern unsigned	ipcksum_update(unsigned cksum, unsigned oldw, unsigned neww);
 
 #endif
 
@@ -0,0 +1,132 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	membench.c
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+// Purpose:	Measures how many bytes per clock memcpy(), memmove() and
+//		memset() move, both within block RAM and within the SDRAM,
+//	next to a simple word at a time loop.  Copies are timed with the
+//	source and destination aligned alike, and with the source one byte off.
+//	Each result is also checked.  Results are reported, and the program
+//	run, as bench.h describes, with the bytes moved per call and per clock
+//	added to each line.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <string.h>
+#include "bench.h"
+#include "zipcpu.h"
+
+#define	NTRIALS		4
+#define	BUFLN		4096
+#define	COPYLN		(BUFLN-8)	// Leaves room to offset either end
+
+// Two buffers in block RAM, next to the program
+unsigned	bkbuf[2][BUFLN/sizeof(unsigned)];
+
+// The baseline, as the board programs used to copy: one word per pass.  GCC
+// would otherwise turn this into a call to memcpy().
+__attribute__((noinline,optimize("no-tree-loop-distribute-patterns")))
+void	wordcopy(unsigned *dst, const unsigned *src, int nw) {
+	for(int k=0; k<nw; k++)
+		dst[k] = src[k];
+}
+
+// Report the last measurement, adding bytes per clock with two decimal places
+void	report(const char *mem, const char *op, int iters, int pass) {
+	BENCHPERF	p;
+	char		name[32], extra[48];
+	unsigned	bpc;
+
+	bench_net(&p);
+	bpc = (p.p_clocks) ? (100u * COPYLN * iters) / p.p_clocks : 0;
+	sprintf(name, "%s_%s", mem, op);
+	sprintf(extra, "bytes=%d bpc=%u.%02u", COPYLN, bpc / 100, bpc % 100);
+	bench_print(name, iters, &p, extra, pass);
+}
+
+int	check(const char *mem, const char *op, const char *got,
+		const char *want) {
+	for(int k=0; k<COPYLN; k++) {
+		if (got[k] != ((want) ? want[k] : 0x5a)) {
+			printf("FAIL: %s %s, byte %d\n", mem, op, k);
+			return 0;
+		}
+	} return 1;
+}
+
+void	bench(const char *mem, char *src, char *dst) {
+	for(int k=0; k<BUFLN; k++)
+		src[k] = (char)(k * 7 + 3);
+
+#define	TIMEIT(STMT)	\
+	BENCH_TIME(for(int trial=0; trial<NTRIALS; trial++) STMT)
+
+	TIMEIT(wordcopy((unsigned *)dst, (const unsigned *)src, COPYLN/4));
+	report(mem, "wordloop", NTRIALS, check(mem, "wordloop", dst, src));
+
+	TIMEIT(memcpy(dst, src, COPYLN));
+	report(mem, "memcpy", NTRIALS, check(mem, "memcpy", dst, src));
+
+	TIMEIT(memcpy(dst, src+1, COPYLN));
+	report(mem, "memcpy_unaligned", NTRIALS,
+		check(mem, "memcpy_unaligned", dst, src+1));
+
+	// Overlapping, so memmove() has to copy from the top down.  Each
+	// trial would shift the buffer up by four more bytes, so only one is
+	// run, and checked.
+	memcpy(dst, src, COPYLN);
+	BENCH_TIME(memmove(dst+4, dst, COPYLN));
+	report(mem, "memmove_overlap", 1,
+		check(mem, "memmove_overlap", dst+4, src));
+
+	TIMEIT(memset(dst, 0x5a, COPYLN));
+	report(mem, "memset", NTRIALS, check(mem, "memset", dst, NULL));
+#undef	TIMEIT
+}
+
+int main(int argc, char **argv) {
+	bench_begin("MEMBENCH");
+
+	// The cost of the counters and an empty loop
+	BENCH_CALIBRATE(for(int trial=0; trial<NTRIALS; trial++) ;);
+
+	bench("BKRAM", (char *)bkbuf[0], (char *)bkbuf[1]);
+#ifdef	_BOARD_HAS_SDRAM
+	// At the top of the SDRAM, out of the way of any program that might
+	// have been loaded there
+	bench("SDRAM", &_sdram[sizeof(_sdram) - 2*BUFLN],
+			&_sdram[sizeof(_sdram) - BUFLN]);
+#endif
+
+	return bench_end("MEMBENCH");
+}
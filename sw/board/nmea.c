@@ -0,0 +1,263 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	nmea.c
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	The single pass NMEA parser.  See nmea.h.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include "zipcpu.h"
+#include "nmea.h"
+
+GPSFIX		gps_fix;
+unsigned	nmea_sentences = 0, nmea_errors = 0;
+
+// Parser states
+#define	NS_IDLE		0	// Waiting for a '$'
+#define	NS_BODY		1	// Within the sentence
+#define	NS_CKSUM	2	// Within the checksum, following the '*'
+
+// What each field of a sentence holds, of those fields that are kept
+#define	F_NONE		0
+#define	F_TIME		1
+#define	F_STATUS	2
+#define	F_LAT		3
+#define	F_NS		4
+#define	F_LON		5
+#define	F_EW		6
+#define	F_DATE		7
+#define	F_QUALITY	8
+#define	F_SATS		9
+#define	F_ALT		10
+
+#define	NFIELDS		10
+static	const char	gga_fields[NFIELDS] = { F_NONE, F_TIME, F_LAT, F_NS,
+			F_LON, F_EW, F_QUALITY, F_SATS, F_NONE, F_ALT },
+			rmc_fields[NFIELDS] = { F_NONE, F_TIME, F_STATUS, F_LAT,
+			F_NS, F_LON, F_EW, F_NONE, F_NONE, F_DATE };
+
+// Digits kept following a decimal point.  Any more are ignored.
+#define	MAXFRAC		5
+
+static	int		m_state = NS_IDLE, m_field, m_ncksum;
+static	unsigned	m_id, m_sum, m_cksum;
+static	const char	*m_fields;	// gga_fields, rmc_fields, or NULL
+static	GPSFIX		m_fix;		// The fix, as this sentence changes it
+
+// The field being converted
+static	unsigned	m_int,	// The digits before any decimal point
+			m_bcd,	// Those same digits, packed as BCD
+			m_frac;	// The (first MAXFRAC) digits after it
+static	int		m_nint, m_nfrac, m_dot, m_ch;
+
+// 2^32 / 10^n, as a 32.32 fixed point number rounded up, for converting n
+// decimal digits of a second into the GPS clock's binary fraction.  The
+// result is then exact, rounded down.
+static	const unsigned	subsec_scale[5][2] = {
+	{ 0, 0 },
+	{ 429496729u, 2576980378u },
+	{  42949672u, 4123168605u },
+	{   4294967u, 1271310320u },
+	{    429496u, 3133608140u } };
+static	const unsigned	decpow[MAXFRAC+1] = {
+	1, 10, 100, 1000, 10000, 100000 };
+
+static	void	clear_field(void) {
+	m_int = m_bcd = m_frac = 0;
+	m_nint = m_nfrac = m_dot = m_ch = 0;
+}
+
+// The digits following the decimal point, in units of 10^-MAXFRAC
+static	unsigned	frac5(void) {
+	return m_frac * decpow[MAXFRAC - m_nfrac];
+}
+
+// Convert ddmm.mmmmm, or dddmm.mmmmm, to degrees times 10^7.  Minutes are
+// first put in units of 10^-5, of which there are 6,000,000 in a degree,
+// hence each is worth 5/3 of a 10^-7 degree.
+static	int	degrees(void) {
+	unsigned	deg = m_int / 100, min = m_int - deg * 100;
+
+	return (int)(deg * 10000000u + ((min * 100000u + frac5()) * 5u) / 3u);
+}
+
+// Store the field just finished into m_fix, if it's one that's kept
+static	void	end_field(void) {
+	unsigned	sub;
+	int		nsub;
+
+	if ((!m_fields)||(m_field >= NFIELDS))
+		return;
+
+	// Leave the fix as it was for any field left empty
+	if ((m_nint == 0)&&(m_nfrac == 0)&&(m_ch == 0))
+		return;
+
+	switch(m_fields[m_field]) {
+	case F_TIME:
+		m_fix.f_time = m_bcd & 0x0ffffff;
+		// Only the first four digits of the second are kept
+		sub = m_frac;
+		if (m_nfrac > 4)
+			sub /= decpow[m_nfrac-4];
+		nsub = (m_nfrac > 4) ? 4 : m_nfrac;
+		m_fix.f_subsec = sub * subsec_scale[nsub][0]
+				+ zip_mpyuhi(sub, subsec_scale[nsub][1]);
+		break;
+	case F_STATUS:	m_fix.f_valid = (m_ch == 'A'); break;
+	case F_LAT:	m_fix.f_lat = degrees(); break;
+	case F_NS:	if (m_ch == 'S') m_fix.f_lat = -m_fix.f_lat; break;
+	case F_LON:	m_fix.f_lon = degrees(); break;
+	case F_EW:	if (m_ch == 'W') m_fix.f_lon = -m_fix.f_lon; break;
+	case F_DATE:
+		// ddmmyy, to 0x20YYMMDD
+		m_fix.f_date = 0x20000000 | ((m_bcd & 0x0ff) << 16)
+			| (m_bcd & 0x0ff00) | ((m_bcd >> 16) & 0x0ff);
+		break;
+	case F_QUALITY:	m_fix.f_quality = m_int; break;
+	case F_SATS:	m_fix.f_sats = m_int; break;
+	case F_ALT:
+		// Meters, to centimeters
+		m_fix.f_alt = m_int * 100 + frac5() / 1000;
+		if (m_ch == '-')
+			m_fix.f_alt = -m_fix.f_alt;
+		break;
+	default:
+		break;
+	}
+}
+
+static	int	hexval(int ch) {
+	if ((ch >= '0')&&(ch <= '9'))
+		return ch - '0';
+	if ((ch >= 'A')&&(ch <= 'F'))
+		return ch - 'A' + 10;
+	if ((ch >= 'a')&&(ch <= 'f'))
+		return ch - 'a' + 10;
+	return -1;
+}
+
+/*
+ * nmea_putc()
+ *
+ * Hands the parser the next character received from the GPS.  If this
+ * character completed a GGA or RMC sentence, and so updated gps_fix, returns
+ * NMEA_GGA or NMEA_RMC.  Otherwise returns NMEA_OTHER.
+ */
+int	nmea_putc(int ch) {
+	int	d;
+
+	if (ch == '$') {
+		// Start over, no matter what came before
+		m_state = NS_BODY;
+		m_field = 0;
+		m_id = m_sum = 0;
+		m_fields = 0;
+		m_fix = gps_fix;
+		clear_field();
+		return NMEA_OTHER;
+	}
+
+	switch(m_state) {
+	case NS_BODY:
+		if ((ch == '\r')||(ch == '\n')) {
+			// A sentence without a checksum isn't trusted
+			nmea_errors++;
+			m_state = NS_IDLE;
+		} else if (ch == '*') {
+			end_field();
+			m_state = NS_CKSUM;
+			m_cksum = 0;
+			m_ncksum = 0;
+		} else {
+			m_sum ^= ch;
+			if (ch == ',') {
+				if (m_field == 0) {
+					// The talker and sentence ID, as
+					// in GPGGA or GNRMC.  Only the last
+					// three letters matter.
+					m_id &= 0x0ffffff;
+					if (m_id == (('G'<<16)|('G'<<8)|'A'))
+						m_fields = gga_fields;
+					else if (m_id == (('R'<<16)|('M'<<8)|'C'))
+						m_fields = rmc_fields;
+				} else
+					end_field();
+				m_field++;
+				clear_field();
+			} else if (m_field == 0) {
+				m_id = (m_id << 8) | (ch & 0x0ff);
+			} else if ((ch >= '0')&&(ch <= '9')) {
+				d = ch - '0';
+				if (m_dot) {
+					if (m_nfrac < MAXFRAC) {
+						m_frac = m_frac * 10 + d;
+						m_nfrac++;
+					}
+				} else if (m_nint < 8) {
+					m_int = m_int * 10 + d;
+					m_bcd = (m_bcd << 4) | d;
+					m_nint++;
+				}
+			} else if (ch == '.')
+				m_dot = 1;
+			else
+				m_ch = ch;
+		} break;
+	case NS_CKSUM:
+		if ((ch == '\r')||(ch == '\n')) {
+			m_state = NS_IDLE;
+			if ((m_ncksum != 2)||(m_cksum != (m_sum & 0x0ff))) {
+				nmea_errors++;
+				return NMEA_OTHER;
+			}
+
+			nmea_sentences++;
+			if (!m_fields)
+				return NMEA_OTHER;
+			m_fix.f_updates = gps_fix.f_updates + 1;
+			gps_fix = m_fix;
+			return (m_fields == gga_fields) ? NMEA_GGA : NMEA_RMC;
+		} else if (((d = hexval(ch)) >= 0)&&(m_ncksum < 2)) {
+			m_cksum = (m_cksum << 4) | d;
+			m_ncksum++;
+		} else
+			// Too many digits, or not a digit at all
+			m_ncksum = 3;
+		break;
+	default:
+		break;
+	}
+
+	return NMEA_OTHER;
+}
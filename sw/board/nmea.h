@@ -0,0 +1,79 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	nmea.h
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	A single pass NMEA sentence parser.  Characters are handed to
+//		nmea_putc() one at a time, as they arrive, and are never
+//	buffered: each field is converted as it goes by, into a copy of the
+//	fix.  When a GGA or RMC sentence ends with a good checksum, the copy
+//	becomes gps_fix.  Other sentences are checked, and counted, but
+//	otherwise ignored.
+//
+//	Times and dates are kept in the same form as the real time clock keeps
+//	them, so they can be compared against (or written to) the RTC directly,
+//	and the fraction of a second in the same form as the top half of the
+//	GPS clock's count.  Positions are kept in integer units, so no floating
+//	point is needed anywhere.
+//
+//	gps_fix is only ever written by whoever calls nmea_putc(), so there's
+//	nothing to lock so long as it's read from that same task.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	NMEA_H
+#define	NMEA_H
+
+typedef	struct	GPSFIX_S {
+	unsigned	f_time;		// UTC time of day, BCD 0x00HHMMSS as in RTC
+	unsigned	f_subsec;	// Fraction of a second, in units of 2^-32
+	unsigned	f_date;		// BCD 0xCCYYMMDD, as in the RTC date
+	int		f_lat, f_lon;	// Degrees times 10^7, north and east > 0
+	int		f_alt;		// Altitude above mean sea level, in cm
+	int		f_quality;	// GGA fix quality: 0 = none, 1 = GPS, ...
+	int		f_sats;		// Satellites used in the fix
+	int		f_valid;	// RMC status: 1 if 'A', 0 if 'V'
+	unsigned	f_updates;	// Counts the sentences accepted
+} GPSFIX;
+
+// Sentence types, as returned by nmea_putc()
+#define	NMEA_OTHER	0
+#define	NMEA_GGA	1
+#define	NMEA_RMC	2
+
+extern	GPSFIX		gps_fix;
+// Sentences seen with good and bad checksums
+extern	unsigned	nmea_sentences, nmea_errors;
+
+extern	int	nmea_putc(int ch);
+
+#endif
@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	oledbench.c
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	Measures how many frames per second the graphics layer in
+//		oledgfx.c can send to the PMod OLEDrgb: whole frames streamed
+//	by the CPU and by the DMA, whole screen hardware fills, a line of
+//	text, and a text scroll using the controller's copy command.  Each
+//	frame is timed from the start of drawing until the last pixel has been
+//	handed to the controller.  Results are reported, and the program run,
+//	as bench.h describes, with the pixels sent per frame and the frames
+//	per second added to each line.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include "bench.h"
+#include "zipcpu.h"
+#include "oledgfx.h"
+
+#ifdef	_BOARD_HAS_OLEDRGB
+
+#define	NFRAMES		4
+
+// A gradient that moves with each frame, drawn straight into the framebuffer
+void	gradient(int frame) {
+	for(int r=0; r<GFX_HEIGHT; r++)
+		for(int c=0; c<GFX_WIDTH; c++)
+			gfx_fb[r][c] = GFX_RGB((c+frame)*8/3, r*4, (r+c)*2);
+	gfx_dirty(0, 0, GFX_WIDTH, GFX_HEIGHT);
+}
+
+// Report the last measurement, adding the pixels each frame took, and frames
+// per second with one decimal place
+void	report(const char *name, unsigned pixels) {
+	BENCHPERF	p;
+	char		extra[48];
+	unsigned	fps;
+
+	bench_net(&p);
+	pixels /= NFRAMES;
+	fps = (p.p_clocks) ? (unsigned)(10ul * NFRAMES * CLKFREQHZ
+				/ p.p_clocks) : 0;
+	sprintf(extra, "pixels=%u fps=%u.%u", pixels, fps / 10, fps % 10);
+	bench_print(name, NFRAMES, &p, extra, 1);
+}
+
+int main(int argc, char **argv) {
+	unsigned	pixels;
+	char		str[16];
+
+	bench_begin("OLEDBENCH");
+	printf("Initializing the OLED\n");
+	gfx_init();
+
+	BENCH_CALIBRATE(;);
+
+#define	TIMEIT(NAME, STMT)	do {					\
+		pixels = gfx_pixels;					\
+		BENCH_TIME(for(int frame=0; frame<NFRAMES; frame++) {	\
+				STMT;					\
+				gfx_flush();				\
+			});						\
+		report(NAME, gfx_pixels - pixels);			\
+	} while(0)
+
+	gfx_usedma(0);
+	TIMEIT("frame_cpu", gradient(frame));
+
+	gfx_usedma(1);
+	TIMEIT("frame_dma", gradient(frame));
+
+	// The controller's fill, which sends only 11 bytes over the port
+	TIMEIT("fill_hw", gfx_fill(0, 0, GFX_WIDTH, GFX_HEIGHT,
+			GFX_RGB(frame*64, 0, 255-frame*64)));
+
+	// A clock's worth of text, as a status display might update
+	TIMEIT("text", sprintf(str, "12:34:%02d", frame);
+			gfx_text(0, 0, str, 0xffff, 0));
+
+	// Scroll the screen up a line, and write a new one at the bottom
+	TIMEIT("scroll", gfx_copy(0, GFX_CHARH, GFX_WIDTH,
+				GFX_HEIGHT-GFX_CHARH, 0, 0);
+			sprintf(str, "Line %d", frame);
+			gfx_fill(0, GFX_HEIGHT-GFX_CHARH, GFX_WIDTH,
+				GFX_CHARH, 0);
+			gfx_text(0, GFX_HEIGHT-GFX_CHARH, str, 0xffff, 0));
+#undef	TIMEIT
+
+	return bench_end("OLEDBENCH");
+}
+
+#else
+int main(int argc, char **argv) {
+	printf("This design requires the OLEDrgb to be installed\n");
+	return 1;
+}
+#endif
@@ -0,0 +1,589 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	oledgfx.c
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	Implements the framebuffer, dirty rectangle, and drawing
+//		routines described in oledgfx.h, together with the power up
+//	sequence for the PMod OLEDrgb that used to live in oledtest.c.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <string.h>
+#include "board.h"
+#include "zipcpu.h"
+#include "zipsys.h"
+#include "oledgfx.h"
+
+#ifdef	_BOARD_HAS_OLEDRGB
+
+#define	MICROSECOND	(CLKFREQHZ/1000000)
+
+// Fills smaller than this many pixels are cheaper to stream than to send
+// as an eleven byte rectangle command
+#define	GFX_HWFILL	8
+
+// Have the DMA wait on the OLED's ready interrupt before each word
+#define	DMA_ONOLED	DMA_ONINT(__builtin_ctz(SYSINT_OLED))
+
+unsigned	gfx_fb[GFX_HEIGHT][GFX_WIDTH];
+unsigned	gfx_pixels = 0;
+
+// Rectangles are kept with inclusive corners, as the controller wants them
+typedef	struct	{
+	int	x0, y0, x1, y1;
+} GFXRECT;
+
+static	GFXRECT	m_dirty[GFX_NDIRTY];
+static	int	m_ndirty = 0;
+#ifdef	_HAVE_ZIPSYS_DMA
+static	int	m_dma = 1;
+#endif
+
+/*
+ * The 5x7 font, for the printable characters from ' ' to '~'.  Each glyph
+ * is five columns, left to right, one byte per column with the top row in
+ * bit zero.
+ */
+static const unsigned char	gfx_font[95*5] = {
+	0x00,0x00,0x00,0x00,0x00, 0x00,0x00,0x5f,0x00,0x00, // ' ' !
+	0x00,0x07,0x00,0x07,0x00, 0x14,0x7f,0x14,0x7f,0x14, // " #
+	0x24,0x2a,0x7f,0x2a,0x12, 0x23,0x13,0x08,0x64,0x62, // $ %
+	0x36,0x49,0x55,0x22,0x50, 0x00,0x05,0x03,0x00,0x00, // & '
+	0x00,0x1c,0x22,0x41,0x00, 0x00,0x41,0x22,0x1c,0x00, // ( )
+	0x14,0x08,0x3e,0x08,0x14, 0x08,0x08,0x3e,0x08,0x08, // * +
+	0x00,0x50,0x30,0x00,0x00, 0x08,0x08,0x08,0x08,0x08, // , -
+	0x00,0x60,0x60,0x00,0x00, 0x20,0x10,0x08,0x04,0x02, // . /
+	0x3e,0x51,0x49,0x45,0x3e, 0x00,0x42,0x7f,0x40,0x00, // 0 1
+	0x42,0x61,0x51,0x49,0x46, 0x21,0x41,0x45,0x4b,0x31, // 2 3
+	0x18,0x14,0x12,0x7f,0x10, 0x27,0x45,0x45,0x45,0x39, // 4 5
+	0x3c,0x4a,0x49,0x49,0x30, 0x01,0x71,0x09,0x05,0x03, // 6 7
+	0x36,0x49,0x49,0x49,0x36, 0x06,0x49,0x49,0x29,0x1e, // 8 9
+	0x00,0x36,0x36,0x00,0x00, 0x00,0x56,0x36,0x00,0x00, // : ;
+	0x08,0x14,0x22,0x41,0x00, 0x14,0x14,0x14,0x14,0x14, // < =
+	0x00,0x41,0x22,0x14,0x08, 0x02,0x01,0x51,0x09,0x06, // > ?
+	0x32,0x49,0x79,0x41,0x3e, 0x7e,0x11,0x11,0x11,0x7e, // @ A
+	0x7f,0x49,0x49,0x49,0x36, 0x3e,0x41,0x41,0x41,0x22, // B C
+	0x7f,0x41,0x41,0x22,0x1c, 0x7f,0x49,0x49,0x49,0x41, // D E
+	0x7f,0x09,0x09,0x01,0x01, 0x3e,0x41,0x41,0x51,0x32, // F G
+	0x7f,0x08,0x08,0x08,0x7f, 0x00,0x41,0x7f,0x41,0x00, // H I
+	0x20,0x40,0x41,0x3f,0x01, 0x7f,0x08,0x14,0x22,0x41, // J K
+	0x7f,0x40,0x40,0x40,0x40, 0x7f,0x02,0x04,0x02,0x7f, // L M
+	0x7f,0x04,0x08,0x10,0x7f, 0x3e,0x41,0x41,0x41,0x3e, // N O
+	0x7f,0x09,0x09,0x09,0x06, 0x3e,0x41,0x51,0x21,0x5e, // P Q
+	0x7f,0x09,0x19,0x29,0x46, 0x46,0x49,0x49,0x49,0x31, // R S
+	0x01,0x01,0x7f,0x01,0x01, 0x3f,0x40,0x40,0x40,0x3f, // T U
+	0x1f,0x20,0x40,0x20,0x1f, 0x7f,0x20,0x18,0x20,0x7f, // V W
+	0x63,0x14,0x08,0x14,0x63, 0x03,0x04,0x78,0x04,0x03, // X Y
+	0x61,0x51,0x49,0x45,0x43, 0x00,0x7f,0x41,0x41,0x00, // Z [
+	0x02,0x04,0x08,0x10,0x20, 0x00,0x41,0x41,0x7f,0x00, // \ ]
+	0x04,0x02,0x01,0x02,0x04, 0x40,0x40,0x40,0x40,0x40, // ^ _
+	0x00,0x01,0x02,0x04,0x00, 0x20,0x54,0x54,0x54,0x78, // ` a
+	0x7f,0x48,0x44,0x44,0x38, 0x38,0x44,0x44,0x44,0x20, // b c
+	0x38,0x44,0x44,0x48,0x7f, 0x38,0x54,0x54,0x54,0x18, // d e
+	0x08,0x7e,0x09,0x01,0x02, 0x08,0x14,0x54,0x54,0x3c, // f g
+	0x7f,0x08,0x04,0x04,0x78, 0x00,0x44,0x7d,0x40,0x00, // h i
+	0x20,0x40,0x44,0x3d,0x00, 0x00,0x7f,0x10,0x28,0x44, // j k
+	0x00,0x41,0x7f,0x40,0x00, 0x7c,0x04,0x18,0x04,0x78, // l m
+	0x7c,0x08,0x04,0x04,0x78, 0x38,0x44,0x44,0x44,0x38, // n o
+	0x7c,0x14,0x14,0x14,0x08, 0x08,0x14,0x14,0x18,0x7c, // p q
+	0x7c,0x08,0x04,0x04,0x08, 0x48,0x54,0x54,0x54,0x20, // r s
+	0x04,0x3f,0x44,0x40,0x20, 0x3c,0x40,0x40,0x20,0x7c, // t u
+	0x1c,0x20,0x40,0x20,0x1c, 0x3c,0x40,0x30,0x40,0x3c, // v w
+	0x44,0x28,0x10,0x28,0x44, 0x0c,0x50,0x50,0x50,0x3c, // x y
+	0x44,0x64,0x54,0x4c,0x44, 0x00,0x08,0x36,0x41,0x00, // z {
+	0x00,0x00,0x7f,0x00,0x00, 0x00,0x41,0x36,0x08,0x00, // | }
+	0x02,0x01,0x02,0x04,0x02				    // ~
+};
+
+/*
+ * The following outlines a series of commands to send to the OLEDrgb as part
+ * of an initialization sequence.  The sequence itself was taken from the
+ * MPIDE demo.  Single byte numbers in the sequence are just that: commands
+ * to send 8-bit values across the port.  17-bit values with the 16th bit
+ * set send two bytes (bits 15-0) to the port.  The OLEDrgb treats these as
+ * commands (first byte) with an argument (the second byte).
+ */
+static const int	init_sequence[] = {
+	//  Unlock commands
+	0x01fd12,
+	//  Display off
+	0x0ae,
+	//  Set remap and data format
+	0x01a072,
+	//  Set the start line
+	0x01a100,
+	//  Set the display offset
+	0x01a200,
+	//  Normal display mode
+	0x0000a4,
+	//  Set multiplex ratio
+	0x01a83f,
+	//  Set master configuration:
+	//	Use External VCC
+	0x01ad8e,
+	//  Disable power save mode
+	0x01b00b,
+	//  Set phase length
+	0x01b131,
+	//  Set clock divide
+	0x01b3f0,
+	//  Set Second Pre-change Speed For ColorA
+	0x018a64,
+	//  5l) Set Set Second Pre-charge Speed of Color B
+	0x018b78,
+	//  5m) Set Second Pre-charge Speed of Color C
+	0x018c64,
+	//  5n) Set Pre-Charge Voltage
+	0x01bb3a,
+	//  50) Set VCOMH Deselect Level
+	0x01be3e,
+	//  5p) Set Master Current
+	0x018706,
+	//  5q) Set Contrast for Color A
+	0x018191,
+	//  5r) Set Contrast for Color B
+	0x018250,
+	//  5s) Set Contrast for Color C
+	0x01837D,
+	//  disable scrolling
+	0x02e,
+	//  Fill the rectangles we draw, rather than just outlining them
+	0x012601
+};
+
+static const int num_init_items = sizeof(init_sequence)/sizeof(init_sequence[0]);
+
+static void	oled_wait(void) {
+	while(OLEDRGB_BUSY(_oledrgb))
+		;
+}
+
+static void	oled_cmd(unsigned ctrl) {
+	oled_wait();
+	_oledrgb->o_ctrl = ctrl;
+}
+
+/*
+ * gfx_delay()
+ *
+ * Waits for the given number of clocks on timer A.  This polls, rather than
+ * sleeping, so that it doesn't depend upon there being a user task to switch
+ * to, and is only used while powering up.
+ */
+static void	gfx_delay(int counts) {
+	if (counts <= 10)
+		return;
+	_zip->z_tma = 0;
+	_zip->z_pic = SYSINT_TMA;
+	_zip->z_tma = counts;
+	while((_zip->z_pic & SYSINT_TMA)==0)
+		;
+	_zip->z_pic = SYSINT_TMA;
+}
+
+/*
+ * gfx_init()
+ *
+ * Powers up the OLED, following the PMod's power up sequence, sends it the
+ * init_sequence[] above, clears it, and turns it on.  The framebuffer is
+ * cleared to match, and nothing is left dirty.  Uses timer A.
+ */
+void	gfx_init(void) {
+	int	pwrcount;
+
+	// Wait 'til we've had power for at least a quarter second
+	pwrcount = *_pwrcount;
+	if ((pwrcount > 0)&&(pwrcount < CLKFREQHZ/4))
+		gfx_delay(CLKFREQHZ/4 - pwrcount);
+
+	// If the OLED is already powered, such as might be the case if
+	// we rebooted but the board was still hot, shut it down
+	if (_oledrgb->o_data & 0x07) {
+		_oledrgb->o_data = OLEDRGB_VCC_DISABLE;
+		gfx_delay(CLKFREQHZ/10);
+		_oledrgb->o_data = OLEDRGB_POWER_DOWN;
+		gfx_delay(CLKFREQHZ/10);
+	}
+
+	// Apply power, with the device held in reset.  Reset must be held
+	// low for at least 3us, and we may need to wait another 2us after
+	// that.
+	_oledrgb->o_data = OLEDRGB_PMODEN|OLEDRGB_RESET_CLR;
+	gfx_delay(4*MICROSECOND);
+	_oledrgb->o_data = OLEDRGB_RESET;
+	gfx_delay(8*MICROSECOND);
+	_oledrgb->o_data = OLEDRGB_RESET_CLR;
+	gfx_delay(4*MICROSECOND);
+
+	for(int i=0; i<num_init_items; i++)
+		oled_cmd(init_sequence[i]);
+
+	// Clear the whole screen.  This is a five byte command, 0x25 followed
+	// by the top left and bottom right corners, so the last two bytes
+	// go in o_a ahead of the command itself.
+	oled_wait();
+	_oledrgb->o_a = ((GFX_WIDTH-1)<<24)|((GFX_HEIGHT-1)<<16);
+	_oledrgb->o_ctrl = 0x40250000;
+	memset(gfx_fb, 0, sizeof(gfx_fb));
+	m_ndirty = 0;
+
+	// Wait 5ms, turn on VCC, and wait another 100ms
+	gfx_delay(CLKFREQHZ/200);
+	_oledrgb->o_data = OLEDRGB_VCCEN;
+	gfx_delay(CLKFREQHZ/10);
+
+	oled_cmd(OLEDRGB_DISPLAYON);
+
+#ifdef	_HAVE_ZIPSYS_DMA
+	_zip->z_dma.d_ctrl = DMACLEAR;
+#endif
+}
+
+/*
+ * gfx_usedma()
+ *
+ * Selects whether gfx_flush() streams pixels with the DMA (the default, when
+ * there is one), or with the CPU.  Without a DMA, this does nothing.
+ */
+void	gfx_usedma(int on) {
+#ifdef	_HAVE_ZIPSYS_DMA
+	m_dma = on;
+#endif
+}
+
+// Clip a rectangle to the screen, returning zero if nothing is left
+static int	clip(int *x, int *y, int *w, int *h) {
+	if (*x < 0) { *w += *x; *x = 0; }
+	if (*y < 0) { *h += *y; *y = 0; }
+	if (*x + *w > GFX_WIDTH)
+		*w = GFX_WIDTH  - *x;
+	if (*y + *h > GFX_HEIGHT)
+		*h = GFX_HEIGHT - *y;
+	return (*w > 0)&&(*h > 0);
+}
+
+static int	area(int x0, int y0, int x1, int y1) {
+	return (x1-x0+1)*(y1-y0+1);
+}
+
+// How many pixels merging d with the given rectangle would send that
+// neither needs.  Overlapping rectangles come out negative.
+static int	waste(const GFXRECT *d, int x0, int y0, int x1, int y1) {
+	int	ux0 = (d->x0 < x0) ? d->x0 : x0,
+		uy0 = (d->y0 < y0) ? d->y0 : y0,
+		ux1 = (d->x1 > x1) ? d->x1 : x1,
+		uy1 = (d->y1 > y1) ? d->y1 : y1;
+
+	return area(ux0, uy0, ux1, uy1) - area(d->x0, d->y0, d->x1, d->y1)
+			- area(x0, y0, x1, y1);
+}
+
+/*
+ * add_dirty()
+ *
+ * Adds a rectangle to the dirty list.  Any rectangle it overlaps, or can be
+ * merged with for free, is merged into it first.  If the list is still full,
+ * the rectangle is merged with whichever wastes the least.
+ */
+static void	add_dirty(int x0, int y0, int x1, int y1) {
+	int	k, best;
+	GFXRECT	*d;
+
+	for(k=0; k<m_ndirty; ) {
+		d = &m_dirty[k];
+		if (((d->x0 <= x1)&&(x0 <= d->x1)&&(d->y0 <= y1)&&(y0 <= d->y1))
+				||(waste(d, x0, y0, x1, y1) <= 0)) {
+			if (d->x0 < x0) x0 = d->x0;
+			if (d->y0 < y0) y0 = d->y0;
+			if (d->x1 > x1) x1 = d->x1;
+			if (d->y1 > y1) y1 = d->y1;
+			// Remove this one, and start over, since the result
+			// may now overlap something it didn't before
+			m_dirty[k] = m_dirty[--m_ndirty];
+			k = 0;
+		} else
+			k++;
+	}
+
+	if (m_ndirty >= GFX_NDIRTY) {
+		best = 0;
+		for(k=1; k<m_ndirty; k++)
+			if (waste(&m_dirty[k], x0, y0, x1, y1)
+					< waste(&m_dirty[best], x0, y0, x1, y1))
+				best = k;
+		d = &m_dirty[best];
+		if (d->x0 < x0) x0 = d->x0;
+		if (d->y0 < y0) y0 = d->y0;
+		if (d->x1 > x1) x1 = d->x1;
+		if (d->y1 > y1) y1 = d->y1;
+		m_dirty[best] = m_dirty[--m_ndirty];
+		add_dirty(x0, y0, x1, y1);
+		return;
+	}
+
+	d = &m_dirty[m_ndirty++];
+	d->x0 = x0; d->y0 = y0;
+	d->x1 = x1; d->y1 = y1;
+}
+
+// Forget any dirty rectangles that lie entirely within the given one, since
+// the controller has just been told to draw all of it
+static void	drop_dirty(int x0, int y0, int x1, int y1) {
+	for(int k=0; k<m_ndirty; ) {
+		GFXRECT	*d = &m_dirty[k];
+
+		if ((d->x0 >= x0)&&(d->x1 <= x1)&&(d->y0 >= y0)&&(d->y1 <= y1))
+			m_dirty[k] = m_dirty[--m_ndirty];
+		else
+			k++;
+	}
+}
+
+/*
+ * gfx_dirty()
+ *
+ * Marks a region of gfx_fb[] as changed, for anything that draws into the
+ * framebuffer directly.  Pixels so drawn must keep the bits above the low
+ * sixteen clear, or the controller will take them for power commands.
+ */
+void	gfx_dirty(int x, int y, int w, int h) {
+	if (clip(&x, &y, &w, &h))
+		add_dirty(x, y, x+w-1, y+h-1);
+}
+
+/*
+ * gfx_fill()
+ *
+ * Fills a rectangle with the given pixel value, using the controller's
+ * rectangle command.  This is an 11 byte command, consisting of the 0x22,
+ * followed by the top left column and row of our rectangle, and then the
+ * bottom right column and row.  That's the first five bytes.  The next six
+ * bytes are the color of the border and the color of the fill, six bits
+ * each of red, green, and blue.  Here, both colors are the same.
+ */
+void	gfx_fill(int x, int y, int w, int h, unsigned pix) {
+	unsigned	r, g, b;
+
+	if (!clip(&x, &y, &w, &h))
+		return;
+
+	pix &= 0x0ffff;
+	for(int row=y; row<y+h; row++)
+		for(int col=x; col<x+w; col++)
+			gfx_fb[row][col] = pix;
+
+	if (w*h < GFX_HWFILL) {
+		add_dirty(x, y, x+w-1, y+h-1);
+		return;
+	}
+
+	drop_dirty(x, y, x+w-1, y+h-1);
+
+	r = (pix >> 10) & 0x03e;
+	g = (pix >>  5) & 0x03f;
+	b = (pix <<  1) & 0x03e;
+
+	oled_wait();
+	_oledrgb->o_a = ((x+w-1)<<24) | ((y+h-1)<<16) | (r<<8) | g;
+	_oledrgb->o_b = (b<<24) | (r<<16) | (g<<8) | b;
+	_oledrgb->o_ctrl = 0xa0220000 | (x<<8) | y;
+}
+
+/*
+ * gfx_copy()
+ *
+ * Copies a w x h rectangle from (sx,sy) to (dx,dy), using the controller's
+ * seven byte copy command: 0x23, the source's top left and bottom right
+ * corners, and then the destination's top left corner.  The controller can
+ * only copy what it already has, so anything dirty within the source is
+ * flushed first.
+ */
+void	gfx_copy(int sx, int sy, int w, int h, int dx, int dy) {
+	int	ox = sx, oy = sy;
+
+	if (!clip(&sx, &sy, &w, &h))
+		return;
+	dx += sx - ox;
+	dy += sy - oy;
+	if (dx < 0) { sx -= dx; w += dx; dx = 0; }
+	if (dy < 0) { sy -= dy; h += dy; dy = 0; }
+	if (dx + w > GFX_WIDTH)
+		w = GFX_WIDTH - dx;
+	if (dy + h > GFX_HEIGHT)
+		h = GFX_HEIGHT - dy;
+	if ((w <= 0)||(h <= 0))
+		return;
+
+	for(int k=0; k<m_ndirty; k++) {
+		GFXRECT	*d = &m_dirty[k];
+
+		if ((d->x0 < sx+w)&&(sx <= d->x1)&&(d->y0 < sy+h)&&(sy <= d->y1)) {
+			gfx_flush();
+			break;
+		}
+	}
+
+	drop_dirty(dx, dy, dx+w-1, dy+h-1);
+
+	// Rows are copied in whichever order keeps from overwriting source
+	// rows before they've been copied
+	if (dy > sy) {
+		for(int row=h-1; row>=0; row--)
+			memmove(&gfx_fb[dy+row][dx], &gfx_fb[sy+row][sx],
+				w * sizeof(unsigned));
+	} else {
+		for(int row=0; row<h; row++)
+			memmove(&gfx_fb[dy+row][dx], &gfx_fb[sy+row][sx],
+				w * sizeof(unsigned));
+	}
+
+	oled_wait();
+	_oledrgb->o_a = ((sx+w-1)<<24) | ((sy+h-1)<<16) | (dx<<8) | dy;
+	_oledrgb->o_ctrl = 0x60230000 | (sx<<8) | sy;
+}
+
+/*
+ * gfx_image()
+ *
+ * Copies a w x h image, one 16-bit pixel per halfword, into the framebuffer
+ * with its top left corner at (x,y).
+ */
+void	gfx_image(int x, int y, int w, int h, const unsigned short *img) {
+	int	ox = x, oy = y, stride = w;
+
+	if (!clip(&x, &y, &w, &h))
+		return;
+	img += (y - oy) * stride + (x - ox);
+	for(int row=0; row<h; row++, img += stride) {
+		unsigned	*fb = &gfx_fb[y+row][x];
+
+		for(int col=0; col<w; col++)
+			fb[col] = img[col];
+	}
+
+	add_dirty(x, y, x+w-1, y+h-1);
+}
+
+/*
+ * gfx_text()
+ *
+ * Draws a string with its top left corner at (x,y), in fg on a background
+ * of bg, and returns the column just past its end.  Characters outside of
+ * the font are drawn as '?'.
+ */
+int	gfx_text(int x, int y, const char *str, unsigned fg, unsigned bg) {
+	int	x0 = x;
+
+	fg &= 0x0ffff;
+	bg &= 0x0ffff;
+	for(; *str; str++, x += GFX_CHARW) {
+		const unsigned char	*glyph;
+		int	ch = *str;
+
+		if ((ch < ' ')||(ch > '~'))
+			ch = '?';
+		glyph = &gfx_font[(ch - ' ') * 5];
+
+		for(int row=0; row<GFX_CHARH; row++) {
+			if ((unsigned)(y+row) >= GFX_HEIGHT)
+				continue;
+			for(int col=0; col<GFX_CHARW; col++) {
+				unsigned	on;
+
+				if ((unsigned)(x+col) >= GFX_WIDTH)
+					continue;
+				on = (col < 5) ? (glyph[col] >> row) & 1 : 0;
+				gfx_fb[y+row][x+col] = (on) ? fg : bg;
+			}
+		}
+	}
+
+	gfx_dirty(x0, y, x - x0, GFX_CHARH);
+	return x;
+}
+
+#ifdef	_HAVE_ZIPSYS_DMA
+// Have the DMA send n pixels to the controller, starting at src, one each
+// time the controller is ready for another, and wait for it to finish
+static void	dma_push(const unsigned *src, int n) {
+	_zip->z_dma.d_len = n;
+	_zip->z_dma.d_rd  = (int *)src;
+	_zip->z_dma.d_wr  = (int *)&_oledrgb->o_data;
+	_zip->z_dma.d_ctrl= DMAONEATATIME|DMA_CONSTDST|DMA_ONOLED;
+	while(_zip->z_dma.d_ctrl & DMA_BUSY)
+		;
+}
+#endif
+
+/*
+ * gfx_flush()
+ *
+ * Sends every dirty rectangle to the panel.  Each is set up as the
+ * controller's drawing window, so that its pixels can follow one after
+ * another without any addresses.  Rectangles spanning the full width are
+ * contiguous in the framebuffer, and go out in one piece.  Others go out a
+ * row at a time.
+ */
+void	gfx_flush(void) {
+	for(int k=0; k<m_ndirty; k++) {
+		GFXRECT	*d = &m_dirty[k];
+		int	w = d->x1 - d->x0 + 1, h = d->y1 - d->y0 + 1;
+
+		oled_cmd(0x20150000 | (d->x0<<8) | d->x1);
+		oled_cmd(0x20750000 | (d->y0<<8) | d->y1);
+		gfx_pixels += w * h;
+
+#ifdef	_HAVE_ZIPSYS_DMA
+		if (m_dma) {
+			oled_wait();
+			if (w == GFX_WIDTH)
+				dma_push(&gfx_fb[d->y0][0], w * h);
+			else for(int row=d->y0; row<=d->y1; row++)
+				dma_push(&gfx_fb[row][d->x0], w);
+			continue;
+		}
+#endif
+		for(int row=d->y0; row<=d->y1; row++) {
+			const unsigned	*fb = &gfx_fb[row][d->x0];
+
+			for(int col=0; col<w; col++) {
+				oled_wait();
+				_oledrgb->o_data = fb[col];
+			}
+		}
+	}
+
+	m_ndirty = 0;
+}
+
+#endif	// _BOARD_HAS_OLEDRGB
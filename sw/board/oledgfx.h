@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	oledgfx.h
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	A small graphics layer for the PMod OLEDrgb.  Everything is
+//		drawn into a framebuffer in memory, gfx_fb[], and the regions
+//	that have changed are remembered as a short list of dirty rectangles.
+//	gfx_flush() then sends only those rectangles to the panel, each as a
+//	single window followed by a stream of pixels.  Where the ZipSystem
+//	DMA is present, it does the streaming, one pixel every time the
+//	controller is ready for another.
+//
+//	Fills and copies are also handed to the controller's own rectangle
+//	fill and copy commands, which take a dozen bytes or less over the SPI
+//	port rather than two bytes per pixel.  The framebuffer is kept up to
+//	date either way, so that anything drawn on top of it later is right.
+//
+//	Pixels are 16-bit 5:6:5 RGB, one per word of gfx_fb[], since that's
+//	what the DMA needs to write them to the controller's data register.
+//
+//	All of this is for the supervisor, and assumes nothing else is using
+//	the OLED or the DMA.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	OLEDGFX_H
+#define	OLEDGFX_H
+
+#define	GFX_WIDTH	96
+#define	GFX_HEIGHT	64
+
+// Text is drawn in cells of this size, holding a 5x7 glyph
+#define	GFX_CHARW	6
+#define	GFX_CHARH	8
+
+// The most dirty rectangles remembered at once.  Beyond this, the two that
+// can be merged with the least wasted area are merged.
+#define	GFX_NDIRTY	4
+
+// Build a 5:6:5 pixel from 8-bit red, green, and blue
+#define	GFX_RGB(R,G,B)	((((R)&0x0f8)<<8)|(((G)&0x0fc)<<3)|(((B)&0x0f8)>>3))
+
+extern	unsigned	gfx_fb[GFX_HEIGHT][GFX_WIDTH];
+
+// Pixels sent to the panel by gfx_flush() so far
+extern	unsigned	gfx_pixels;
+
+extern	void	gfx_init(void);
+extern	void	gfx_usedma(int on);
+
+extern	void	gfx_dirty(int x, int y, int w, int h);
+extern	void	gfx_fill(int x, int y, int w, int h, unsigned pix);
+extern	void	gfx_copy(int sx, int sy, int w, int h, int dx, int dy);
+extern	void	gfx_image(int x, int y, int w, int h, const unsigned short *img);
+extern	int	gfx_text(int x, int y, const char *str, unsigned fg, unsigned bg);
+extern	void	gfx_flush(void);
+
+#endif
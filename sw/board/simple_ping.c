@@ -78,12 +78,15 @@
 #include "zipcpu.h"
 #include "zipsys.h"
 #include <stdio.h>
+#include <string.h>
 #define	KTRAPID_SENDPKT	0
 #include "etcnet.h"
 #include "protoconst.h"
 #include "ledcolors.h"
 #include "ipcksum.h"
 #include "arp.h"
+#include "enetrx.h"
+#include "txbuf.h"
 
 unsigned	pkts_received = 0, replies_received=0, arp_requests_received=0,
 		arp_pkt_count =0, arp_pkt_invalid =0,
@@ -182,18 +185,23 @@ void	uping_reply(unsigned ipaddr, unsigned *icmp_request) {
 		pkt[4] = 0xff010000;//No flags,frag offset=0,ttl=0,proto=1(ICMP)
 		pkt[5] = icmp_request[4];	// Swap sender and receiver
 		pkt[6] = icmp_request[3];
-		for(int k=7; k<pktlnw; k++)
-			pkt[k] = icmp_request[k-2];
+		if (pktlnw > 7)
+			memcpy(&pkt[7], &icmp_request[5],
+				(pktlnw-7) * sizeof(unsigned));
 		pkt[7] = 0;
 
 		if ((pktln & 3)!=0)
 			pkt[pktlnw-1] &= ~((1<<((4-(pktln&3))<<3))-1);
 
-		// Now, let's go fill in the IP and ICMP checksums
+		// Now, let's go fill in the IP and ICMP checksums.  The IP
+		// header is all new, and only five words, so sum it.  The
+		// ICMP reply, though, differs from the request only in its
+		// type, so patch the request's checksum rather than summing
+		// the entire payload again.
 		pkt[4] |= ipcksum(5, &pkt[2]);
 
-		pkt[7] &= 0xffff0000;
-		pkt[7] |= ipcksum(pktlnw-7, &pkt[7]);
+		pkt[7] = ipcksum_update(icmp_request[5] & 0x0ffff,
+				icmp_request[5] & 0xffff0000, pkt[7]);
 
 		ping_replies_sent++;
 
@@ -202,37 +210,39 @@ void	uping_reply(unsigned ipaddr, unsigned *icmp_request) {
 		ping_reply_err ++;
 }
 
-unsigned	rxpkt[2048];
 void	user_task(void) {
-	unsigned	rtc = _rtc->r_clock;
+	unsigned	rtc = ~_rtc->r_clock;
 
 	while(1) {
-		do {
-			unsigned long	mac;
+		RXPKT	*rxp;
 
+		// Rate limit our ARP searching, and age the ARP table, at one
+		// Hz.  This is checked on every packet, lest a steady stream
+		// of packets keep us from ever getting to it.
+		if (_rtc->r_clock != rtc) {
+			unsigned long	mac;
 
-			// Rate limit our ARP searching to one Hz
 			rtc = _rtc->r_clock;
 
+			arp_tick();
 			if (arp_lookup(ping_ip_addr, &ping_mac_addr) == 0)
 				arp_lookup(my_ip_router, &mac);
+		}
 
-			while(((_netp->n_rxcmd & ENET_RXAVAIL)==0)
-					&&(_rtc->r_clock == rtc))
-				user_heartbeats++;
-		} while((_netp->n_rxcmd & ENET_RXAVAIL)==0);
+		// The supervisor fills the receive ring from its interrupt,
+		// so we need only wait for something to show up
+		if (NULL == (rxp = enetrx_get())) {
+			user_heartbeats++;
+			continue;
+		}
 
-		// Okay, now we have a receive packet ... let's process it
-		int	etype = _netbrx[1] & 0x0ffff;
-		unsigned *epayload; //  = (unsigned *)&sys->io_enet_rx[2];
+		// Okay, now we have a receive packet ... let's process it,
+		// in place, within the ring
+		int	etype = rxp->p_data[1] & 0x0ffff;
+		unsigned *epayload = &rxp->p_data[2];
 		int	invalid = 0;
-		int	ln, rxcmd = _netp->n_rxcmd;
+		int	rxcmd = rxp->p_rxcmd;
 
-		ln = _netp->n_rxcmd & 0x07ff;
-		for(int k=0; k<(ln+3)>>2; k++)
-			rxpkt[k] = _netbrx[k];
-		epayload = &rxpkt[2];
-		_netp->n_rxcmd = ENET_RXCLR|ENET_RXCLRERR;
 		*_spio = LED_RXCLEAR;
 
 		pkts_received++;
@@ -301,6 +311,8 @@ void	user_task(void) {
 				arp_table_add(sip, sha);
 			}
 		}
+
+		enetrx_release(rxp);
 	}
 }
 
@@ -383,6 +395,10 @@ int main(int argc, char **argv) {
 	restore_context(user_context);
 	printf("Ethernet Test\n");
 
+	// From here on, console output is sent from the UART's interrupt, so
+	// that printing doesn't hold up the network
+	txbuf_useint(1);
+
 	init_arp_table();
 
 	for(int i=0; i<4; i++)
@@ -407,7 +423,8 @@ int main(int argc, char **argv) {
 	// Set our timer to have us send a ping 1/sec
 	_zip->z_tma = CLKFREQHZ | TMR_INTERVAL;
 
-	_netp->n_rxcmd = ENET_RXCLRERR|ENET_RXCLR;
+	// Empty the receive ring, and clear the port to receive
+	enetrx_init();
 
 	*_spio = LED_GIEMODE;
 	while(1) {
@@ -437,6 +454,9 @@ int main(int argc, char **argv) {
 #else
 		_zip->z_pic = EINT(SYSINT_TMA|SYSINT_ENETRX);
 #endif
+		// Turns the console's interrupt back on, if it has anything
+		// left to send
+		txbuf_isr();
 		do {
 			if ((_zip->z_pic & INTNOW)==0) {
 				// Run the user process if no
@@ -461,6 +481,7 @@ int main(int argc, char **argv) {
 				_clrled[2] = LEDC_BRIGHTRED;
 				_clrled[3] = LEDC_BRIGHTRED;
 				printf("Sub-process fault\n");
+				txbuf_flush();
 				zip_halt();
 			} else if (zip_ucc() & CC_TRAP) {
 				save_context((int *)user_context);
@@ -475,8 +496,8 @@ int main(int argc, char **argv) {
 				while(_netp->n_txcmd & ENET_TXBUSY)
 					;
 				if (ln < 1400) {
-					for(int i=0; i<(ln+3)>>2; i++)
-						_netbtx[i] = *sptr++;
+					memcpy((void *)_netbtx, sptr,
+						((ln+3)>>2)*sizeof(unsigned));
 					*_spio = LED_TXACTIVE;
 					_netp->n_txcmd = ENET_TXCMD(ln);
 
@@ -498,6 +519,7 @@ int main(int argc, char **argv) {
 				_clrled[2] = LEDC_BRIGHTRED;
 				_clrled[3] = LEDC_BRIGHTRED;
 				printf("Too many interrupts! ??\n");
+				txbuf_flush();
 				zip_halt();
 			} else if ((picv & DINT(SYSINT_TMA))==0) {
 				*_spio = 0x0f0f;
@@ -506,6 +528,7 @@ int main(int argc, char **argv) {
 				_clrled[2] = LEDC_WHITE;
 				_clrled[3] = LEDC_BRIGHTRED;
 				printf("Timer-A interrupt (FAULT)\n");
+				txbuf_flush();
 				zip_halt();
 #ifdef	GPSTRK_ACCESS
 			} else if ((picv & DINT(SYSINT_PPS))==0) {
@@ -515,18 +538,19 @@ int main(int argc, char **argv) {
 				_clrled[2] = LEDC_BRIGHTRED;
 				_clrled[3] = LEDC_WHITE;
 				printf("PPS Interrupt (FAULT)\n");
+				txbuf_flush();
 				zip_halt();
 #endif
 			} if (picv & SYSINT_ENETRX) {
-				// This will not clear until the packet has
-				// been removed and the interface reset.  For
-				// now, just double check that the interrupt
-				// has been disabled.
-				if (picv&(DINT(SYSINT_ENETRX))) {
-					_zip->z_pic = DINT(SYSINT_ENETRX);
-					*_spio = LED_RXACTIVE;
-					_clrled[2] = LEDC_GREEN;
-				}
+				// Move the packet into the receive ring, and
+				// free the hardware to receive the next.  If
+				// the ring is full, enetrx_isr() turns this
+				// interrupt off until the user task frees a
+				// slot.
+				if (enetrx_isr() == 0)
+					_zip->z_pic = EINT(SYSINT_ENETRX);
+				*_spio = LED_RXACTIVE;
+				_clrled[2] = LEDC_GREEN;
 			} else
 				_zip->z_pic = EINT(SYSINT_ENETRX);
 			if (picv & SYSINT_ENETTX) {
@@ -538,6 +562,9 @@ int main(int argc, char **argv) {
 				*_spio = LED_TXCLEAR;
 			} else
 				_zip->z_pic = EINT(SYSINT_ENETTX);
+			if (picv & SYSPIC_UARTTXF)
+				// Refill the console's FIFO
+				txbuf_isr();
 			// Make certain interrupts remain enabled
 #ifdef	GPSTRK_ACCESS
 			_zip->z_pic = EINT(SYSINT_TMA|SYSINT_PPS);
@@ -41,6 +41,7 @@
 //
 #include <stdint.h>
 #include "board.h"
+#include "txbuf.h"
 #include "txfns.h"
 
 void	txchr(char ch);
@@ -50,41 +51,28 @@ void	txstr(const char *str);
 /*
  * txchr()
  *
- * This is the fundamental routine within here.  It transmits one character
- * out of the UART, polling the UART device to determine when/if it is idle
- * to send the next character.
+ * This is the fundamental routine within here.  It places one character into
+ * the transmit ring (see txbuf.h), from where it is moved into the UART's
+ * FIFO.  It only waits for the UART if the ring is full, or if the ring isn't
+ * being emptied by the UART's interrupt.
  *
  */
-#define	UARTTX_READY	(_uart->u_fifo & 0x010000)
 void	txchr(char val) {
-	unsigned v = (unsigned char)val;
-	static	int last_was_cr = 0;
-	uint8_t	c;
-
-	if ((0 == last_was_cr)&&(val == '\n')) {
-		while(!UARTTX_READY)
-			;
-		c = '\r';
-		_uart->u_tx = (unsigned)c;
-	}
-
-	while(!UARTTX_READY)
-		;
-	c = v;
-	_uart->u_tx = (unsigned)c;
-	last_was_cr = (c == '\r')?1:0;
+	txbuf_send(&val, 1);
 }
 
 /*
  * txstr()
  *
- * Called to send a string to the UART port.  This works by calling txchr to
- * do its real work.
+ * Called to send a string to the UART port.  The string is handed to the
+ * ring all at once, rather than one character at a time.
  */
 void    txstr(const char *str) {
-	const	char *ptr = str;
-	while(*ptr)
-		txchr(*ptr++);
+	int	ln = 0;
+
+	while(str[ln])
+		ln++;
+	txbuf_send(str, ln);
 }
 
 /*
@@ -93,12 +81,15 @@ void    txstr(const char *str) {
  * Send a hexadecimal value to the output port
  */
 void	txhex(unsigned val) {
-	for(int i=28; i>=0; i-=4) {
-		int ch = ((val>>i)&0x0f)+'0';
+	char	tmp[8];
+
+	for(int i=0; i<8; i++) {
+		int ch = ((val>>(28-4*i))&0x0f)+'0';
 		if (ch > '9')
 			ch = ch - '0'+'A'-10;
-		txchr(ch);
+		tmp[i] = ch;
 	}
+	txbuf_send(tmp, 8);
 }
 
 /*
@@ -112,10 +103,8 @@ void	txdecimal(int val) {
 
 	if (val < 0) {
 		uval = -val;
-		txchr('-');
 	} else {
 		uval = val;
-		txchr(' ');
 	}
 
 	if (uval == 0) {
@@ -127,8 +116,13 @@ void	txdecimal(int val) {
 		tmp[nc++] = (digit + '0');
 		uval = dval;
 	}
+	tmp[nc++] = (val < 0) ? '-' : ' ';
 
-	for(unsigned i=nc; i>0; i--)
-		txchr(tmp[i-1]);
+	// The digits were found in reverse order
+	for(int i=0; i<nc/2; i++) {
+		char	t = tmp[i];
+		tmp[i] = tmp[nc-1-i];
+		tmp[nc-1-i] = t;
+	}
+	txbuf_send(tmp, nc);
 }
-
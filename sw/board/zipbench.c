@@ -0,0 +1,584 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	zipbench.c
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	A suite of small benchmarks, meant to be run in simulation
+//		after any change to the CPU's configuration or to the libraries
+//	in sw/zlib, to see whether anything got slower.
+//
+//	The kernels are in the style of Dhrystone and CoreMark (records and
+//	strings, list sorting, a matrix multiply, a state machine, and a CRC),
+//	followed by memcpy(), memset(), ipcksum(), 32 and 64-bit division, the
+//	time from a timer interrupt to the supervisor, and the time to go from
+//	the supervisor to a user task and back with a trap.  Each kernel's
+//	result is checked, so a benchmark that's fast because it's broken
+//	fails instead.
+//
+//	Each result is reported as bench.h describes.  The latency test adds
+//	min= and max= fields, in clocks.  The last line is "ZIPBENCH fails=N".
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory, run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <string.h>
+#include "bench.h"
+#include "zipcpu.h"
+#include "udiv.h"
+#include "ipcksum.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Dhrystone style: records, strings, and small procedure calls
+//
+typedef	struct	{
+	int	r_comp, r_int;
+	char	r_str[32];
+} DHREC;
+
+static	DHREC	dh_glob, dh_next;
+static	int	dh_arr1[50], dh_arr2[50][50];
+static	char	dh_str1[32], dh_str2[32];
+
+__attribute__((noinline))
+static int	dh_func1(char a, char b) {
+	return (a == b) ? 1 : 0;
+}
+
+__attribute__((noinline))
+static int	dh_func2(const char *s1, const char *s2) {
+	return (strcmp(s1, s2) > 0) ? 1 : 0;
+}
+
+__attribute__((noinline))
+static void	dh_proc1(DHREC *r) {
+	DHREC	*n = &dh_next;
+
+	*n = *r;
+	n->r_int = r->r_int + 1;
+	if (n->r_comp) {
+		r->r_comp = 0;
+		r->r_int -= 3;
+	} else {
+		r->r_comp = 1;
+		r->r_int += 2;
+	}
+}
+
+__attribute__((noinline))
+static void	dh_proc8(int *a1, int (*a2)[50], int i1, int i2) {
+	int	loc = i1 + 5;
+
+	a1[loc]    = i2;
+	a1[loc+1]  = a1[loc];
+	a1[loc+30] = loc;
+	for(int k=loc; k<=loc+1; k++)
+		a2[loc][k] = loc;
+	a2[loc][loc-1] += 1;
+	a2[loc+20][loc] = a1[loc];
+}
+
+#define	DHRY_ITERS	100
+#define	DHRY_CHECK	0x00023575
+
+static unsigned	dhry(int iters) {
+	unsigned	sum = 0;
+
+	strcpy(dh_glob.r_str, "DHRYSTONE PROGRAM, SOME STRING");
+	strcpy(dh_str1, "DHRYSTONE PROGRAM, 1'ST STRING");
+	dh_glob.r_comp = 0;
+	dh_glob.r_int  = 40;
+	for(int run=0; run<iters; run++) {
+		int	i1 = 2, i2 = 3, i3 = 0, b;
+
+		strcpy(dh_str2, "DHRYSTONE PROGRAM, 2'ND STRING");
+		b = !dh_func2(dh_str1, dh_str2);
+		while(i1 < i2) {
+			i3 = 5 * i1 - i2;
+			i1++;
+		}
+		dh_proc8(dh_arr1, dh_arr2, i1, i3);
+		dh_proc1(&dh_glob);
+		for(char ch='A'; ch<='C'; ch++)
+			if (dh_func1(ch, 'C'))
+				i2 += ch;
+		i2 = i2 * i1;
+		i1 = i2 / i3;
+		i2 = 7 * (i2 - i3) - i1;
+		sum += i1 + i2 + i3 + b + dh_next.r_int;
+	}
+
+	return sum + dh_arr2[8][7] + dh_arr1[8];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// CoreMark style: a linked list, sorted by key and then back again
+//
+typedef	struct	LNODE_S {
+	struct LNODE_S	*l_next;
+	unsigned	l_key, l_idx;
+} LNODE;
+
+#define	NLIST		64
+#define	LIST_ITERS	8
+#define	LIST_CHECK	0x1175c872
+
+static	LNODE	l_nodes[NLIST];
+
+static unsigned	lval(const LNODE *n, int bykey) {
+	return (bykey) ? n->l_key : n->l_idx;
+}
+
+// A bottom up merge sort, as CoreMark's
+static LNODE	*l_sort(LNODE *list, int bykey) {
+	for(int insize=1; ; insize *= 2) {
+		LNODE	*p = list, *q, *e, *tail = NULL;
+		int	nmerges = 0, psize, qsize;
+
+		list = NULL;
+		while(p) {
+			nmerges++;
+			q = p;
+			psize = 0;
+			for(int k=0; (k<insize)&&(q); k++) {
+				psize++;
+				q = q->l_next;
+			}
+			qsize = insize;
+
+			while((psize > 0)||((qsize > 0)&&(q))) {
+				if (psize == 0) {
+					e = q; q = q->l_next; qsize--;
+				} else if ((qsize == 0)||(!q)) {
+					e = p; p = p->l_next; psize--;
+				} else if (lval(p, bykey) <= lval(q, bykey)) {
+					e = p; p = p->l_next; psize--;
+				} else {
+					e = q; q = q->l_next; qsize--;
+				}
+
+				if (tail)
+					tail->l_next = e;
+				else
+					list = e;
+				tail = e;
+			}
+			p = q;
+		}
+		tail->l_next = NULL;
+
+		if (nmerges <= 1)
+			return list;
+	}
+}
+
+static unsigned	listk(int iters) {
+	LNODE		*list;
+	unsigned	seed = 1, sum = 0;
+
+	for(int k=0; k<NLIST; k++) {
+		seed = seed * 1103515245u + 12345u;
+		l_nodes[k].l_idx  = k;
+		l_nodes[k].l_key  = seed >> 16;
+		l_nodes[k].l_next = (k+1 < NLIST) ? &l_nodes[k+1] : NULL;
+	}
+	list = &l_nodes[0];
+
+	for(int run=0; run<iters; run++) {
+		list = l_sort(list, 1);
+		for(LNODE *n=list; n; n=n->l_next) {
+			sum = (sum << 5) + (sum >> 27) + n->l_idx;
+			n->l_key ^= (run + n->l_idx) * 0x9e3779b9u;
+		}
+		list = l_sort(list, 0);
+	}
+
+	return sum;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// CoreMark style: a 16x16 matrix multiply, fed back into itself
+//
+#define	NMAT		16
+#define	MAT_ITERS	2
+#define	MAT_CHECK	0xb8e0fc69
+
+static	short	m_a[NMAT][NMAT], m_b[NMAT][NMAT];
+static	int	m_c[NMAT][NMAT];
+
+static unsigned	matrix(int iters) {
+	unsigned	sum = 0;
+
+	for(int i=0; i<NMAT; i++)
+		for(int j=0; j<NMAT; j++) {
+			m_a[i][j] = (i*NMAT + j) * 7 % 113 - 56;
+			m_b[i][j] = (j*NMAT + i) * 5 % 97  - 48;
+		}
+
+	for(int run=0; run<iters; run++) {
+		for(int i=0; i<NMAT; i++)
+			for(int j=0; j<NMAT; j++) {
+				int	acc = 0;
+
+				for(int k=0; k<NMAT; k++)
+					acc += m_a[i][k] * m_b[k][j];
+				m_c[i][j] = acc;
+			}
+
+		for(int i=0; i<NMAT; i++)
+			for(int j=0; j<NMAT; j++) {
+				sum = (sum << 3) + (sum >> 29) + (unsigned)m_c[i][j];
+				m_a[i][j] = (short)(((unsigned)m_c[i][j] & 0x0ff) - 128);
+			}
+	}
+
+	return sum;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// CoreMark style: a state machine, sorting numbers from non-numbers
+//
+enum	{ ST_START, ST_INT, ST_SIGN, ST_FLOAT, ST_EXP, ST_EXPSIGN, ST_SCI,
+		ST_INVALID };
+
+#define	STATE_ITERS	16
+#define	STATE_CHECK	0x000006e0
+
+static const char	st_input[] =
+	"5012 1.23e4 -0.5 x1 +42 7e 3.14 -1e-3 0x1f 99 . 6E+2 --1 "
+	"1024 -7 .25 2.5.1 8e8 +.5e-1 ab3 314159 0.0 -+2 12e";
+
+static unsigned	statek(int iters) {
+	unsigned	counts[ST_INVALID+1];
+
+	for(int k=0; k<=ST_INVALID; k++)
+		counts[k] = 0;
+
+	for(int run=0; run<iters; run++) {
+		int	st = ST_START;
+
+		for(const char *s = st_input; ; s++) {
+			char	ch = *s;
+			int	digit = ((unsigned)(ch - '0') < 10);
+
+			if ((ch == ' ')||(ch == '\0')) {
+				if (st != ST_START)
+					counts[st]++;
+				st = ST_START;
+				if (!ch)
+					break;
+				continue;
+			}
+
+			switch(st) {
+			case ST_START:
+				if (digit)
+					st = ST_INT;
+				else if ((ch == '+')||(ch == '-'))
+					st = ST_SIGN;
+				else if (ch == '.')
+					st = ST_FLOAT;
+				else
+					st = ST_INVALID;
+				break;
+			case ST_SIGN:
+				if (digit)
+					st = ST_INT;
+				else if (ch == '.')
+					st = ST_FLOAT;
+				else
+					st = ST_INVALID;
+				break;
+			case ST_INT:
+				if (ch == '.')
+					st = ST_FLOAT;
+				else if ((ch == 'e')||(ch == 'E'))
+					st = ST_EXP;
+				else if (!digit)
+					st = ST_INVALID;
+				break;
+			case ST_FLOAT:
+				if ((ch == 'e')||(ch == 'E'))
+					st = ST_EXP;
+				else if (!digit)
+					st = ST_INVALID;
+				break;
+			case ST_EXP:
+				if ((ch == '+')||(ch == '-'))
+					st = ST_EXPSIGN;
+				else if (digit)
+					st = ST_SCI;
+				else
+					st = ST_INVALID;
+				break;
+			case ST_EXPSIGN:
+				st = (digit) ? ST_SCI : ST_INVALID;
+				break;
+			case ST_SCI:
+				if (!digit)
+					st = ST_INVALID;
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	return counts[ST_INT] + 3*counts[ST_FLOAT] + 5*counts[ST_SCI]
+		+ 7*counts[ST_INVALID]
+		+ 11*(counts[ST_SIGN]+counts[ST_EXP]+counts[ST_EXPSIGN]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// CoreMark style: a bit at a time CRC-16
+//
+#define	CRCLN		256
+#define	CRC_ITERS	4
+#define	CRC_CHECK	0x00008640
+
+static	unsigned char	crc_buf[CRCLN];
+
+static unsigned	crc16(int iters) {
+	unsigned	crc = 0;
+
+	for(int k=0; k<CRCLN; k++)
+		crc_buf[k] = (unsigned char)(k * 13 + 7);
+
+	for(int run=0; run<iters; run++)
+		for(int k=0; k<CRCLN; k++) {
+			crc ^= crc_buf[k];
+			for(int b=0; b<8; b++)
+				crc = (crc & 1) ? (crc >> 1) ^ 0xa001 : (crc >> 1);
+		}
+
+	return crc;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Division, both by the hardware's 32-bit divide and by the library's 64-bit
+// routines
+//
+#define	DIV_ITERS	64
+#define	DIV32_CHECK	0x1e732a8c
+#define	DIV64_CHECK	0xffffbf4e
+#define	DIVK_CHECK	0xca1e5d0c
+
+static unsigned	div32(int iters) {
+	unsigned	x = 1, sum = 0;
+
+	for(int run=0; run<iters; run++) {
+		unsigned	d;
+
+		x = x * 1103515245u + 12345u;
+		d = (x >> (run & 15)) | 1;
+		sum += (x / d) + (x % d);
+	}
+	return sum;
+}
+
+static unsigned	div64(int iters) {
+	unsigned long	a = 1;
+	unsigned	sum = 0;
+
+	for(int run=0; run<iters; run++) {
+		unsigned long	q;
+
+		a = a * 6364136223846793005ul + 1442695040888963407ul;
+		q = a / ((a >> (8 + (run & 31))) | 1);
+		sum += (unsigned)q ^ (unsigned)(q >> 32);
+	}
+	return sum;
+}
+
+// Dividing by a constant, such as converting microseconds to seconds
+static unsigned	divk(int iters) {
+	UDIVCONST	k;
+	unsigned long	a = 1;
+	unsigned	sum = 0;
+
+	udivconst_init(&k, 1000000);
+	for(int run=0; run<iters; run++) {
+		unsigned long	q;
+		uint32_t	rem;
+
+		a = a * 6364136223846793005ul + 1442695040888963407ul;
+		q = udivconst(&k, a, &rem);
+		sum += (unsigned)q ^ (unsigned)(q >> 32) ^ rem;
+	}
+	return sum;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Memory, and the IP checksum
+//
+#define	MEMLN		4096
+#define	COPYLN		(MEMLN-8)	// Leaves room to offset the source
+#define	MEM_ITERS	4
+#define	CKSUMLN		375		// Words, a full 1500 byte packet
+#define	CKSUM_ITERS	16
+#define	CKSUM_CHECK	0x000063d6
+
+static	unsigned	mem_buf[2][MEMLN/sizeof(unsigned)];
+
+static int	memcheck(const char *got, const char *want) {
+	for(int k=0; k<COPYLN; k++)
+		if (got[k] != ((want) ? want[k] : 0x5a))
+			return 0;
+	return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// The time from a timer interrupt to the supervisor, and from the supervisor
+// to a user task and back via a trap
+//
+#define	LAT_DELAY	200
+#define	LAT_TRIALS	16
+#define	TRAP_ITERS	32
+
+static	int		user_regs[16];
+static	unsigned	user_stack[256];
+
+// Something for the timer to interrupt, with a divide in the loop so that
+// interrupts don't always land on the same instruction
+static void	busy_task(void) {
+	volatile unsigned	v = 1;
+
+	while(1)
+		v = v + v / 3 + 1;
+}
+
+static void	trap_task(void) {
+	while(1)
+		syscall(0, 0, 0, 0);
+}
+
+static void	user_task(void (*task)(void)) {
+	for(int k=0; k<16; k++)
+		user_regs[k] = 0;
+	user_regs[13] = (int)&user_stack[sizeof(user_stack)/sizeof(unsigned)];
+	user_regs[15] = (int)task;
+	zip_restore_context(user_regs);
+}
+
+static void	irqlat(void) {
+	unsigned	mn = ~0u, mx = 0, total = 0;
+	int		pass = 1;
+
+	user_task(busy_task);
+	for(int trial=0; trial<LAT_TRIALS; trial++) {
+		unsigned	ticks;
+
+		_zip->z_pic = DALLPIC|SYSINT_TMA;
+		_zip->z_pic = EINT(SYSINT_TMA);
+		START_TIMER();
+		_zip->z_tma = LAT_DELAY + trial;
+		zip_rtu();
+		ticks = TICKS() - (LAT_DELAY + trial);
+
+		if ((_zip->z_pic & SYSINT_TMA)==0)
+			pass = 0;
+		total += ticks;
+		if (ticks < mn) mn = ticks;
+		if (ticks > mx) mx = ticks;
+	}
+	_zip->z_pic = DALLPIC|SYSINT_TMA;
+
+	{
+		BENCHPERF	p = { total, 0, 0, 0 };
+		char		extra[32];
+
+		sprintf(extra, "min=%u max=%u", mn, mx);
+		bench_print("irqlat", LAT_TRIALS, &p, extra, pass);
+	}
+}
+
+static void	trap(void) {
+	user_task(trap_task);
+	_zip->z_pic = DALLPIC;
+	BENCH_TIME(for(int k=0; k<TRAP_ITERS; k++) zip_rtu());
+	bench_report("trap", TRAP_ITERS, (zip_ucc() & CC_TRAP) != 0);
+}
+
+int main(int argc, char **argv) {
+	char		*src = (char *)mem_buf[0], *dst = (char *)mem_buf[1];
+	unsigned	v;
+
+	bench_begin("ZIPBENCH");
+
+	// What it costs to start and stop the counters, with nothing between
+	BENCH_CALIBRATE(;);
+
+	BENCH_TIME(v = dhry(DHRY_ITERS));
+	bench_report("dhry", DHRY_ITERS, v == DHRY_CHECK);
+	BENCH_TIME(v = listk(LIST_ITERS));
+	bench_report("list", LIST_ITERS, v == LIST_CHECK);
+	BENCH_TIME(v = matrix(MAT_ITERS));
+	bench_report("matrix", MAT_ITERS, v == MAT_CHECK);
+	BENCH_TIME(v = statek(STATE_ITERS));
+	bench_report("state", STATE_ITERS, v == STATE_CHECK);
+	BENCH_TIME(v = crc16(CRC_ITERS));
+	bench_report("crc16", CRC_ITERS, v == CRC_CHECK);
+
+	for(int k=0; k<MEMLN; k++)
+		src[k] = (char)(k * 7 + 3);
+	BENCH_TIME(for(int k=0; k<MEM_ITERS; k++) memcpy(dst, src, COPYLN));
+	bench_report("memcpy", MEM_ITERS, memcheck(dst, src));
+	BENCH_TIME(for(int k=0; k<MEM_ITERS; k++) memcpy(dst, src+1, COPYLN));
+	bench_report("memcpy_unaligned", MEM_ITERS, memcheck(dst, src+1));
+	BENCH_TIME(for(int k=0; k<MEM_ITERS; k++) memset(dst, 0x5a, COPYLN));
+	bench_report("memset", MEM_ITERS, memcheck(dst, NULL));
+
+	for(int k=0; k<CKSUMLN; k++)
+		mem_buf[0][k] = k * 0x9e3779b9u;
+	BENCH_TIME(for(int k=0; k<CKSUM_ITERS; k++)
+			v = ipcksum(CKSUMLN, mem_buf[0]));
+	bench_report("ipcksum", CKSUM_ITERS, v == CKSUM_CHECK);
+
+	BENCH_TIME(v = div32(DIV_ITERS));
+	bench_report("div32", DIV_ITERS, v == DIV32_CHECK);
+	BENCH_TIME(v = div64(DIV_ITERS));
+	bench_report("div64", DIV_ITERS, v == DIV64_CHECK);
+	BENCH_TIME(v = divk(DIV_ITERS));
+	bench_report("udivconst", DIV_ITERS, v == DIVK_CHECK);
+
+	irqlat();
+	trap();
+
+	return bench_end("ZIPBENCH");
+}
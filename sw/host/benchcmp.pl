@@ -0,0 +1,124 @@
+#!/usr/bin/perl
+################################################################################
+##
+## Filename: 	benchcmp.pl
+##
+## Project:	OpenArty, an entirely open SoC based upon the Arty platform
+##
+## Purpose:	Compares two runs of the zipbench program (sw/board/zipbench.c),
+##		such as one from before and one from after a change to the
+##	CPU's configuration or to the libraries.  Usage:
+##
+##		benchcmp.pl [-t percent] baseline.txt new.txt
+##
+##	Prints the clocks each benchmark took in each run, and the change.
+##	Exits with a non-zero status if any benchmark failed its check in the
+##	new run, is missing from it, or got slower by more than the threshold
+##	percentage (one percent by default).  Since the simulation is cycle
+##	accurate, any change at all is a real one.
+##
+##
+## Creator:	Dan Gisselquist, Ph.D.
+##		Gisselquist Technology, LLC
+##
+################################################################################
+##
+## Copyright (C) 2020, Gisselquist Technology, LLC
+##
+## This program is free software (firmware): you can redistribute it and/or
+## modify it under the terms of  the GNU General Public License as published
+## by the Free Software Foundation, either version 3 of the License, or (at
+## your option) any later version.
+##
+## This program is distributed in the hope that it will be useful, but WITHOUT
+## ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+## FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+## for more details.
+##
+## You should have received a copy of the GNU General Public License along
+## with this program.  (It's in the $(ROOT)/doc directory, run make with no
+## target there if the PDF file isn't present.)  If not, see
+## <http://www.gnu.org/licenses/> for a copy.
+##
+## License:	GPL, v3, as defined and found on www.gnu.org,
+##		http://www.gnu.org/licenses/gpl.html
+##
+##
+################################################################################
+##
+##
+
+$threshold = 1.0;
+if ($#ARGV >= 0 && $ARGV[0] eq "-t") {
+	shift @ARGV;
+	$threshold = shift @ARGV;
+}
+
+if ($#ARGV != 1) {
+	print STDERR "Usage: benchcmp.pl [-t percent] baseline.txt new.txt\n";
+	exit(2);
+}
+
+## Read every BENCH line of a run into a hash of hashes, by benchmark name,
+## and return the names in the order they were run
+sub	readrun {
+	my ($fname, $run) = @_;
+	my @names = ();
+
+	open(RUN, "< $fname") or die "Cannot open $fname";
+	while($line = <RUN>) {
+		next unless ($line =~ /^BENCH\s/);
+		my %fields = ();
+		foreach $kv (split(/\s+/, $line)) {
+			if ($kv =~ /^(\w+)=(\S+)$/) {
+				$fields{$1} = $2;
+			}
+		}
+		next unless defined($fields{"name"});
+		$run->{$fields{"name"}} = { %fields };
+		push @names, $fields{"name"};
+	}
+	close(RUN);
+	return @names;
+}
+
+%base = ();
+%new  = ();
+readrun($ARGV[0], \%base);
+@names = readrun($ARGV[1], \%new);
+
+$errors = 0;
+printf("%-18s %10s %10s %8s\n", "Benchmark", "Baseline", "New", "Change");
+foreach $name (@names) {
+	$nclk = $new{$name}{"clocks"};
+	$flag = "";
+
+	if ($new{$name}{"result"} ne "pass") {
+		$flag = "FAILED";
+		$errors++;
+	}
+
+	if (!defined($base{$name})) {
+		printf("%-18s %10s %10d %8s%s\n", $name, "-", $nclk, "",
+			($flag ne "") ? " $flag" : "");
+		next;
+	}
+
+	$bclk = $base{$name}{"clocks"};
+	$change = ($bclk > 0) ? 100.0 * ($nclk - $bclk) / $bclk : 0.0;
+	if ($change > $threshold) {
+		$flag = ($flag eq "") ? "SLOWER" : "$flag, SLOWER";
+		$errors++;
+	}
+	printf("%-18s %10d %10d %+7.2f%%%s\n", $name, $bclk, $nclk,
+		$change, ($flag ne "") ? " $flag" : "");
+}
+
+foreach $name (keys %base) {
+	next if (defined($new{$name}));
+	printf("%-18s %10d %10s %8s MISSING\n", $name, $base{$name}{"clocks"},
+		"-", "");
+	$errors++;
+}
+
+exit(($errors > 0) ? 1 : 0);
@@ -60,6 +60,14 @@ public:
 	BUSERR(const uint32 a) : addr(a) {};
 };
 
+// One access within a sequence of single word accesses.  For a write,
+// m_data is the value to be written.  For a read, it's where the value read
+// is returned.
+typedef	struct {
+	uint32	m_addr, m_data;
+	bool	m_write;
+} BUSOP;
+
 class	DEVBUS {
 public:
 	typedef	uint32	BUSW;
@@ -120,6 +128,48 @@ public:
 	//
 	virtual	void	writez(const BUSW a, const int len, const BUSW *buf) = 0;
 
+	// Write a value to one address, and then read a value back from
+	// another, len times over.  This is the access pattern of an indirect
+	// (address, data) register pair.  It is equivalent to:
+	//	for(int i=0; i<len; i++) {
+	//		writeio(wa, wv[i]);
+	//		buf[i] = readio(ra);
+	//	}
+	// which is also what it does by default.  Implementations that can
+	// pipeline the accesses, rather than waiting on each, should.
+	virtual	void	writeread(const BUSW wa, const BUSW *wv, const BUSW ra,
+			const int len, BUSW *buf) {
+		for(int i=0; i<len; i++) {
+			writeio(wa, wv[i]);
+			buf[i] = readio(ra);
+		}
+	}
+
+	// Perform a sequence of unrelated single word reads and writes, in
+	// order.  Returns the number of accesses that completed, so a return
+	// value of less than len means ops[return value] failed with a bus
+	// error, and none of those following it can be trusted.  Where the
+	// accesses are pipelined, an error from a write may only be noticed,
+	// and charged, at some later access.  This is equivalent to:
+	//	for(int i=0; i<len; i++)
+	//		if (ops[i].m_write)
+	//			writeio(ops[i].m_addr, ops[i].m_data);
+	//		else
+	//			ops[i].m_data = readio(ops[i].m_addr);
+	// which, again, is what it does by default.
+	virtual	int	ioseq(const int len, BUSOP *ops) {
+		for(int i=0; i<len; i++) {
+			try {
+				if (ops[i].m_write)
+					writeio(ops[i].m_addr, ops[i].m_data);
+				else
+					ops[i].m_data = readio(ops[i].m_addr);
+			} catch(BUSERR b) {
+				return i;
+			}
+		} return len;
+	}
+
 	// Query whether or not an interrupt has taken place
 	virtual	bool	poll(void) = 0;
 
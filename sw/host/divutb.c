@@ -49,6 +49,7 @@
 #endif
 
 #define	__udivdi3	udivdi3
+#define	__udivmoddi4	udivmoddi4
 #include "../zlib/udiv.c"
 
 
@@ -60,6 +61,19 @@ void	divtest(unsigned long a, unsigned long b) {
 	printf("\t%lx -> %lx\n", h, h-r);
 	fflush(stdout);
 	assert(h-r == 0);
+
+	udivmoddi4(a, b, &r);
+	assert(r == a % b);
+
+	if ((b >> 32)==0) {
+		UDIVCONST	k;
+		uint32_t	kr;
+
+		udivconst_init(&k, (uint32_t)b);
+		r = udivconst(&k, a, &kr);
+		assert(r == h);
+		assert(kr == a % b);
+	}
 }
 
 int main(int argc, char **argv) {
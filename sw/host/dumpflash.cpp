@@ -7,6 +7,15 @@
 // Purpose:	Read/Empty the entire contents of the flash memory to a file.
 //		The flash is unchanged by this process.
 //
+//	The flash is read in chunks.  While one chunk is being read over the
+//	bus, a second thread writes the previous one to eqspidump.bin.part,
+//	and records its CRC in eqspidump.bin.crc.  Should the link fail part
+//	way through, running dumpflash again checks the chunks already on
+//	disk against their CRCs, and picks up from the first one that's
+//	missing or bad.  Once the dump is complete, trailing 0xff's (erased
+//	flash) are trimmed and the file is renamed to eqspidump.bin.  The
+//	.crc file is kept, so the image can later be checked against it.
+//
 // Creator:	Dan Gisselquist, Ph.D.
 //		Gisselquist Technology, LLC
 //
@@ -44,6 +53,11 @@
 #include <string.h>
 #include <signal.h>
 #include <assert.h>
+#include <time.h>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "port.h"
 #include "regdefs.h"
@@ -59,64 +73,288 @@ void	closeup(int v) {
 #define	DUMPMEM		FLASHBASE
 #define	DUMPWORDS	(FLASHLEN>>2)
 
-int main(int argc, char **argv) {
 #ifdef	FLASH_ACCESS
-	FILE	*fp;
-	const int	BUFLN = FLASHLEN;
-	char	*buf = new char[FLASHLEN];
+#define	FLASHFILE	"eqspidump.bin"
+#define	PARTFILE	FLASHFILE ".part"
+#define	CRCFILE		FLASHFILE ".crc"
 
-	FPGAOPEN(m_fpga);
-	fprintf(stderr, "Before starting, nread = %ld\n", 
-		m_fpga->m_total_nread);
+// The unit of reading, checking, and resuming, in words
+const	unsigned	CHUNKW = 4096;
+const	unsigned	CHUNKLN = CHUNKW * 4;
+const	unsigned	NCHUNKS = (DUMPWORDS + CHUNKW-1) / CHUNKW;
+// How many chunks may be read ahead of the one being written
+const	unsigned	NBUFS = 4;
 
-	// Start with testing the version:
-	printf("VERSION: %08x\n", m_fpga->readio(R_VERSION));
+//
+// The standard (reflected) CRC-32, the same as Ethernet's and crctest's, only
+// by table rather than bit at a time.  This is also what zlib's crc32() and
+// the crc32 command line utility produce, so a chunk can be checked by other
+// tools.
+//
+static	uint32_t	m_crctbl[256];
 
-	// SPI flash testing
-	// Enable the faster (vector) reads
-	bool	vector_read = true;
-	unsigned	sz;
+void	crcinit(void) {
+	const unsigned int	taps = 0xedb88320u;
 
-	if (vector_read) {
-		m_fpga->readi(DUMPMEM, BUFLN>>2, (DEVBUS::BUSW *)&buf[0]);
-		byteswapbuf(BUFLN>>2, (DEVBUS::BUSW *)&buf[0]);
-	} else {
-		for(int i=0; i<BUFLN; i+=4) {
-			DEVBUS::BUSW	word;
-
-			word = m_fpga->readio(DUMPMEM+i);
-			
-			buf[i  ] = (word>>24) & 0x0ff;
-			buf[i+1] = (word>>16) & 0x0ff;
-			buf[i+2] = (word>> 8) & 0x0ff;
-			buf[i+3] = (word    ) & 0x0ff;
-		}
+	for(unsigned k=0; k<256; k++) {
+		uint32_t	c = k;
+		for(int bit=0; bit<8; bit++)
+			c = (c & 1) ? (c >> 1) ^ taps : (c >> 1);
+		m_crctbl[k] = c;
 	}
-	printf("\nREAD-COMPLETE\n");
+}
+
+uint32_t	calccrc(const unsigned len, const unsigned char *buf) {
+	uint32_t	crc = 0xffffffff;
+
+	for(unsigned k=0; k<len; k++)
+		crc = m_crctbl[(crc ^ buf[k]) & 0x0ff] ^ (crc >> 8);
+	return crc ^ 0xffffffff;
+}
 
-	// Now, let's find the end
-	sz = BUFLN-1;
-	while((sz>0)&&((unsigned char)buf[sz] == 0xff))
+// The number of bytes in chunk k.  Only the last may be short.
+unsigned	chunklen(const unsigned k) {
+	if ((k+1)*CHUNKLN > FLASHLEN)
+		return FLASHLEN - k*CHUNKLN;
+	return CHUNKLN;
+}
+
+// Chunks are read into a ring of buffers by the main thread, and written out
+// by a second thread.  m_nread and m_nwritten count chunks from the start of
+// the flash; m_stopped is set once the main thread will read no more.
+static	std::mutex		m_mtx;
+static	std::condition_variable	m_cv;
+static	unsigned		m_nread = 0, m_nwritten = 0;
+static	bool			m_stopped = false;
+static	char			*m_bufs[NBUFS];
+// Offset of one past the last byte that isn't 0xff
+static	unsigned		m_used = 0;
+
+// Track the end of the programmed area
+void	findused(const unsigned k, const unsigned len, const unsigned char *buf) {
+	unsigned	sz = len;
+
+	while((sz>0)&&(buf[sz-1] == 0xff))
 		sz--;
-	sz+=1;
+	if (sz > 0)
+		m_used = k * CHUNKLN + sz;
+}
 
-#define	FLASHFILE	"eqspidump.bin"
+//
+// writer
+//
+// Byte swaps, checksums, and writes chunks to the file as they arrive.  The
+// data is flushed before its CRC is recorded, so that any chunk listed in the
+// CRC file is (barring an error) also on disk.
+//
+void	writer(unsigned k, FILE *dfp, FILE *cfp) {
+	for(; ; k++) {
+		{
+			std::unique_lock<std::mutex>	lock(m_mtx);
+			m_cv.wait(lock, [k]{ return (m_nread > k)||(m_stopped); });
+			if (m_nread <= k)
+				break;
+		}
+
+		char		*buf = m_bufs[k % NBUFS];
+		unsigned	ln = chunklen(k);
+		uint32_t	crc;
+
+		byteswapbuf(ln>>2, (uint32_t *)buf);
+		crc = calccrc(ln, (const unsigned char *)buf);
+		findused(k, ln, (const unsigned char *)buf);
+
+		if ((fwrite(buf, 1, ln, dfp) != ln)||(fflush(dfp) != 0)) {
+			fprintf(stderr, "ERR: Could not write to %s\n", PARTFILE);
+			exit(EXIT_FAILURE);
+		}
+		fprintf(cfp, "%08x %08x\n", DUMPMEM + k*CHUNKLN, crc);
+		fflush(cfp);
+
+		std::lock_guard<std::mutex>	lock(m_mtx);
+		m_nwritten = k+1;
+		m_cv.notify_one();
+	}
+}
+
+//
+// resume
+//
+// Checks the chunks of a previous, interrupted, dump against the CRCs recorded
+// for them, and returns the number of chunks that can be kept.  Both files
+// are left positioned and truncated to just after the last good chunk.
+//
+unsigned	resume(FILE *dfp, FILE *cfp) {
+	char		line[80];
+	unsigned	base, len, chunk, k = 0;
+	long		cpos;
+	char		*buf = m_bufs[0];
+
+	if ((!fgets(line, sizeof(line), cfp))
+			||(sscanf(line, "# dumpflash %x %x %x", &base, &len,
+				&chunk) != 3)) {
+		fprintf(stderr, "ERR: %s is not a dumpflash CRC file\n",
+			CRCFILE);
+		exit(EXIT_FAILURE);
+	} else if ((base != DUMPMEM)||(len != FLASHLEN)||(chunk != CHUNKLN)) {
+		fprintf(stderr, "ERR: %s was made from a different flash, or by a different dumpflash\n", CRCFILE);
+		fprintf(stderr, "\tRemove %s and %s to start over\n",
+			PARTFILE, CRCFILE);
+		exit(EXIT_FAILURE);
+	}
+
+	cpos = ftell(cfp);
+	while(k < NCHUNKS) {
+		unsigned	addr, crc, ln = chunklen(k);
+
+		if ((!fgets(line, sizeof(line), cfp))
+			||(sscanf(line, "%x %x", &addr, &crc) != 2)
+			||(addr != DUMPMEM + k*CHUNKLN)
+			||(fread(buf, 1, ln, dfp) != ln)
+			||(calccrc(ln, (const unsigned char *)buf) != crc))
+			break;
+		findused(k, ln, (const unsigned char *)buf);
+		cpos = ftell(cfp);
+		k++;
+	}
+
+	fflush(dfp);
+	fflush(cfp);
+	if ((ftruncate(fileno(dfp), (off_t)k * CHUNKLN) != 0)
+			||(ftruncate(fileno(cfp), cpos) != 0)) {
+		fprintf(stderr, "ERR: Could not truncate %s\n", PARTFILE);
+		exit(EXIT_FAILURE);
+	}
+	fseek(dfp, (long)k * CHUNKLN, SEEK_SET);
+	fseek(cfp, cpos, SEEK_SET);
+
+	return k;
+}
+
+double	now(void) {
+	struct	timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+#endif // FLASH_ACCESS
+
+int main(int argc, char **argv) {
+#ifdef	FLASH_ACCESS
+	FILE		*dfp, *cfp;
+	unsigned	start, k;
+	double		tstart, tdone;
 
 	if (access(FLASHFILE, F_OK)==0) {
 		fprintf(stderr, "Cowardly refusing to overwrite %s\n", FLASHFILE);
 		exit(EXIT_FAILURE);
 	}
 
-	fp = fopen(FLASHFILE,"w");
-	fwrite(buf, sizeof(buf[0]), sz, fp);
-	fclose(fp);
+	crcinit();
+	for(unsigned i=0; i<NBUFS; i++)
+		m_bufs[i] = new char[CHUNKLN];
 
+	// Pick up where any earlier dump left off
+	if ((access(PARTFILE, F_OK)==0)&&(access(CRCFILE, F_OK)==0)) {
+		dfp = fopen(PARTFILE, "r+");
+		cfp = fopen(CRCFILE, "r+");
+		if ((!dfp)||(!cfp)) {
+			fprintf(stderr, "ERR: Could not open %s to resume\n",
+				(dfp) ? CRCFILE : PARTFILE);
+			exit(EXIT_FAILURE);
+		}
+		start = resume(dfp, cfp);
+		printf("Resuming from %08x, %u of %u chunks already read\n",
+			DUMPMEM + start * CHUNKLN, start, NCHUNKS);
+	} else {
+		dfp = fopen(PARTFILE, "w");
+		cfp = fopen(CRCFILE, "w");
+		if ((!dfp)||(!cfp)) {
+			fprintf(stderr, "ERR: Could not create %s\n",
+				(dfp) ? CRCFILE : PARTFILE);
+			exit(EXIT_FAILURE);
+		}
+		fprintf(cfp, "# dumpflash %08x %08x %08x\n", DUMPMEM, FLASHLEN,
+			CHUNKLN);
+		fflush(cfp);
+		start = 0;
+	}
+
+	FPGAOPEN(m_fpga);
+
+	// Start with testing the version:
+	printf("VERSION: %08x\n", m_fpga->readio(R_VERSION));
+
+	m_nread = m_nwritten = start;
+	tstart = now();
+
+	std::thread	wr(writer, start, dfp, cfp);
+
+	for(k=start; k<NCHUNKS; k++) {
+		{
+			// Wait for a free buffer
+			std::unique_lock<std::mutex>	lock(m_mtx);
+			m_cv.wait(lock, [k]{ return m_nwritten + NBUFS > k; });
+		}
+
+		try {
+			m_fpga->readi(DUMPMEM + k*CHUNKLN, chunklen(k)>>2,
+				(DEVBUS::BUSW *)m_bufs[k % NBUFS]);
+		} catch(BUSERR b) {
+			fprintf(stderr, "BUS-ERR while reading from %08x\n",
+				b.addr);
+			break;
+		}
+
+		std::lock_guard<std::mutex>	lock(m_mtx);
+		m_nread = k+1;
+		m_cv.notify_one();
+	}
+
+	{
+		std::lock_guard<std::mutex>	lock(m_mtx);
+		m_stopped = true;
+		m_cv.notify_one();
+	} wr.join();
+	tdone = now();
+
+	if ((k > start)&&(tdone > tstart))
+		printf("Read %u bytes in %.2f s: %.1f kB/s\n",
+			(k - start) * CHUNKLN, tdone - tstart,
+			(k - start) * CHUNKLN / (tdone - tstart) / 1e3);
 	printf("The read was accomplished in %ld bytes over the UART\n",
 		m_fpga->m_total_nread);
 
 	if (m_fpga->poll())
 		printf("FPGA was interrupted\n");
 	delete	m_fpga;
+
+	if (k < NCHUNKS) {
+		fclose(dfp);
+		fclose(cfp);
+		fprintf(stderr, "Dump incomplete.  Run dumpflash again to resume\n");
+		exit(EXIT_FAILURE);
+	}
+	printf("\nREAD-COMPLETE\n");
+
+	// Trim the erased flash from the end, and record how much was kept
+	fflush(dfp);
+	if (ftruncate(fileno(dfp), m_used) != 0) {
+		fprintf(stderr, "ERR: Could not truncate %s\n", PARTFILE);
+		exit(EXIT_FAILURE);
+	}
+	fclose(dfp);
+	fprintf(cfp, "# %u bytes kept, the rest of the flash is erased (0xff)\n",
+		m_used);
+	fclose(cfp);
+
+	if (rename(PARTFILE, FLASHFILE) != 0) {
+		fprintf(stderr, "ERR: Could not rename %s to %s\n",
+			PARTFILE, FLASHFILE);
+		exit(EXIT_FAILURE);
+	}
+	printf("%u bytes written to %s, chunk CRCs in %s\n", m_used,
+		FLASHFILE, CRCFILE);
 #else // FLASH_ACCESS
 	printf(
 "This design requires some kind of flash be available within your design.\n"
@@ -128,4 +366,3 @@ int main(int argc, char **argv) {
 #endif // FLASH_ACCESS
 }
 
-
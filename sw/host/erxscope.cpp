@@ -114,6 +114,14 @@ int main(int argc, char **argv) {
 #ifndef	R_NETSCOPE
 	printf("This design was not built with a NET scope within it.\n");
 #else
+	// -s	streams captures until killed
+	// -sN	streams N captures
+	int	nstream = -1;
+	for(int argn=1; argn<argc; argn++) {
+		if ((argv[argn][0] == '-')&&(argv[argn][1] == 's'))
+			nstream = atoi(&argv[argn][2]);
+	}
+
 	FPGAOPEN(m_fpga);
 
 	signal(SIGSTOP, closeup);
@@ -121,7 +129,13 @@ int main(int argc, char **argv) {
 
 	ERXSCOPE *scope = new ERXSCOPE(m_fpga, WBSCOPE);
 	scope->set_clkfreq_hz(ENETCLKFREQHZ);
-	if (!scope->ready()) {
+	if (nstream >= 0) {
+		// Stream captures into one file, rather than reading just one
+#ifdef	R_PWRCOUNT
+		scope->set_timestamp(R_PWRCOUNT, CLKFREQHZ);
+#endif
+		scope->stream("erxscope.vcd", nstream);
+	} else if (!scope->ready()) {
 		printf("Scope is not yet ready:\n");
 		scope->decode_control();
 	} else {
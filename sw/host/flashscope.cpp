@@ -158,6 +158,14 @@ int main(int argc, char **argv) {
 "used by AutoFPGA found in the auto-data/ directory, and then include it\n"
 "within the Makefile of the same directory.\n");
 #else
+	// -s	streams captures until killed
+	// -sN	streams N captures
+	int	nstream = -1;
+	for(int argn=1; argn<argc; argn++) {
+		if ((argv[argn][0] == '-')&&(argv[argn][1] == 's'))
+			nstream = atoi(&argv[argn][2]);
+	}
+
 	FPGAOPEN(m_fpga);
 
 	signal(SIGSTOP, closeup);
@@ -165,7 +173,13 @@ int main(int argc, char **argv) {
 
 	QFLEXPRESSCOPE *scope = new QFLEXPRESSCOPE(m_fpga, WBSCOPE, true);
 	scope->set_clkfreq_hz(CLKFREQHZ);
-	if (!scope->ready()) {
+	if (nstream >= 0) {
+		// Stream captures into one file, rather than reading just one
+#ifdef	R_PWRCOUNT
+		scope->set_timestamp(R_PWRCOUNT, CLKFREQHZ);
+#endif
+		scope->stream("qflexpress.vcd", nstream);
+	} else if (!scope->ready()) {
 		printf("Scope is not yet ready:\n");
 		scope->decode_control();
 	} else {
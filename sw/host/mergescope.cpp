@@ -0,0 +1,158 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	mergescope.cpp
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	Reads several scopes within one session, and writes their
+//		captures onto one timeline in a single VCD (or FST) file, with
+//	all of their triggers at time zero.  Usage:
+//
+//		mergescope [-o <file>] [-c] [-f <hz>] <scope> [[-c] [-f <hz>] <scope> ...]
+//
+//	Each scope is given by the name (or address) of its control register,
+//	such as ZIPSCOPE or NETSCOPE.  The -c and -f options apply to the scope
+//	that follows them: -c marks a compressed (wbscopc) scope, and -f gives
+//	the frequency of the clock it samples on (CLKFREQHZ by default).
+//
+//	Since the individual scope tools keep their wire definitions to
+//	themselves, each scope's capture appears here as its raw data word.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <strings.h>
+#include <ctype.h>
+#include <string.h>
+#include <signal.h>
+#include <vector>
+
+#include "port.h"
+#include "regdefs.h"
+#include "scopecls.h"
+#include "ttybus.h"
+
+FPGA	*m_fpga;
+void	closeup(int v) {
+	m_fpga->kill();
+	exit(0);
+}
+
+// A scope known only by its address, with no wires beyond its raw data
+class	RAWSCOPE : public SCOPE {
+public:
+	RAWSCOPE(FPGA *fpga, unsigned addr, bool compressed)
+		: SCOPE(fpga, addr, compressed, true) {};
+	~RAWSCOPE(void) {}
+	virtual	void	decode(DEVBUS::BUSW val) const {}
+};
+
+void	usage(void) {
+	printf("USAGE: mergescope [-o <file>] [-c] [-f <hz>] <scope> [[-c] [-f <hz>] <scope> ...]\n"
+"\n"
+"\tReads each of the given scopes, and merges their captures into one\n"
+"\tfile, triggers aligned at time zero.\n"
+"\n"
+"\t-o <file>\tThe VCD file to write, or an FST file if it ends in\n"
+"\t\t.fst.  Defaults to mergescope.vcd\n"
+"\t-c\tThe next scope is a compressed (wbscopc) scope\n"
+"\t-f <hz>\tThe next scope samples on a clock of this frequency\n"
+"\n"
+"\tEach scope is the name or address of its control register\n");
+}
+
+int main(int argc, char **argv) {
+	const char	*fname = "mergescope.vcd";
+	std::vector<unsigned>	addrs, freqs;
+	std::vector<bool>	compressed;
+	std::vector<SCOPE *>	scopes;
+	bool		cmprs = false, ready = true;
+	unsigned	hz = CLKFREQHZ;
+
+	for(int argn=1; argn<argc; argn++) {
+		if (argv[argn][0] == '-') {
+			switch(argv[argn][1]) {
+			case 'c': cmprs = true; break;
+			case 'f':
+				if (++argn >= argc) {
+					usage(); exit(EXIT_FAILURE);
+				} hz = strtoul(argv[argn], NULL, 0);
+				break;
+			case 'o':
+				if (++argn >= argc) {
+					usage(); exit(EXIT_FAILURE);
+				} fname = argv[argn];
+				break;
+			case 'h':
+				usage(); exit(EXIT_SUCCESS);
+			default:
+				fprintf(stderr, "ERR: Unknown option, %s\n",
+					argv[argn]);
+				usage(); exit(EXIT_FAILURE);
+			}
+		} else {
+			addrs.push_back(addrdecode(argv[argn]));
+			freqs.push_back(hz);
+			compressed.push_back(cmprs);
+			cmprs = false;
+			hz = CLKFREQHZ;
+		}
+	}
+
+	if (addrs.size() == 0) {
+		usage();
+		exit(EXIT_FAILURE);
+	}
+
+	FPGAOPEN(m_fpga);
+
+	signal(SIGSTOP, closeup);
+	signal(SIGHUP, closeup);
+
+	for(unsigned k=0; k<addrs.size(); k++) {
+		SCOPE	*sc = new RAWSCOPE(m_fpga, addrs[k], compressed[k]);
+
+		sc->set_clkfreq_hz(freqs[k]);
+		if (!sc->ready()) {
+			printf("Scope at %08x is not yet ready:\n", addrs[k]);
+			sc->decode_control();
+			ready = false;
+		} scopes.push_back(sc);
+	}
+
+	if (ready)
+		SCOPE::writevcd(fname, scopes.size(), &scopes[0]);
+
+	delete	m_fpga;
+	return (ready) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
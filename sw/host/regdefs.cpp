@@ -161,11 +161,87 @@ const	REGNAME	raw_bregs[] = {
 const	REGNAME		*bregs = raw_bregs;
 const	int	NREGS = RAW_NREGS;
 
+//
+// REGINDEX
+//
+// bregs[] is in bus order.  Rather than searching it from top to bottom on
+// every lookup, we sort it (once, on first use) both by name and by address,
+// and then use a binary search.  Where several names share one address, the
+// first one listed in bregs[] is the one returned by address.
+//
+class	REGINDEX {
+	static	int	namecmp(const void *a, const void *b) {
+		return strcasecmp((*(const REGNAME **)a)->m_name,
+				(*(const REGNAME **)b)->m_name);
+	}
+
+	static	int	addrcmp(const void *a, const void *b) {
+		const REGNAME	*ra = *(const REGNAME **)a,
+				*rb = *(const REGNAME **)b;
+		if (ra->m_addr != rb->m_addr)
+			return (ra->m_addr < rb->m_addr) ? -1 : 1;
+		// Keep the original order among registers at the same address
+		return (ra < rb) ? -1 : ((ra > rb) ? 1 : 0);
+	}
+public:
+	const	REGNAME	*m_byname[RAW_NREGS], *m_byaddr[RAW_NREGS];
+
+	REGINDEX(void) {
+		for(int i=0; i<NREGS; i++)
+			m_byname[i] = m_byaddr[i] = &bregs[i];
+		qsort(m_byname, NREGS, sizeof(REGNAME *), namecmp);
+		qsort(m_byaddr, NREGS, sizeof(REGNAME *), addrcmp);
+	}
+
+	const	REGNAME	*byname(const char *name) const {
+		int	lo = 0, hi = NREGS;
+
+		while(lo < hi) {
+			int	mid = (lo+hi)/2,
+				c = strcasecmp(name, m_byname[mid]->m_name);
+			if (c == 0)
+				return m_byname[mid];
+			else if (c < 0)
+				hi = mid;
+			else
+				lo = mid+1;
+		} return NULL;
+	}
+
+	const	REGNAME	*byaddr(const unsigned addr) const {
+		int	lo = 0, hi = NREGS;
+
+		// Find the first entry at or above addr
+		while(lo < hi) {
+			int	mid = (lo+hi)/2;
+			if (m_byaddr[mid]->m_addr < addr)
+				lo = mid+1;
+			else
+				hi = mid;
+		} if ((lo < NREGS)&&(m_byaddr[lo]->m_addr == addr))
+			return m_byaddr[lo];
+		return NULL;
+	}
+};
+
+static	const	REGINDEX	&regindex(void) {
+	static	const	REGINDEX	index;
+	return index;
+}
+
+const	REGNAME	*regbyname(const char *name) {
+	return regindex().byname(name);
+}
+
+const	REGNAME	*regbyaddr(const unsigned addr) {
+	return regindex().byaddr(addr);
+}
+
 unsigned	addrdecode(const char *v) {
 	if (isalpha(v[0])) {
-		for(int i=0; i<NREGS; i++)
-			if (strcasecmp(v, bregs[i].m_name)==0)
-				return bregs[i].m_addr;
+		const	REGNAME	*r = regbyname(v);
+		if (r)
+			return r->m_addr;
 #ifdef	R_ZIPCTRL
 		if (strcasecmp(v, "CPU")==0)
 			return R_ZIPCTRL;
@@ -181,9 +257,7 @@ unsigned	addrdecode(const char *v) {
 }
 
 const	char *addrname(const unsigned v) {
-	for(int i=0; i<NREGS; i++)
-		if (bregs[i].m_addr == v)
-			return bregs[i].m_name;
-	return NULL;
+	const	REGNAME	*r = regbyaddr(v);
+	return (r) ? r->m_name : NULL;
 }
 
@@ -242,6 +242,11 @@ extern	const	int	NREGS;
 
 extern	unsigned	addrdecode(const char *v);
 extern	const	char *addrname(const unsigned v);
+// Look up a register by (case insensitive) name, or by address.  Both return
+// NULL if there's no such register.  Neither exits on failure, unlike
+// addrdecode().
+extern	const	REGNAME	*regbyname(const char *name);
+extern	const	REGNAME	*regbyaddr(const unsigned addr);
 // End of definitions from REGDEFS.H.INSERT
 
 
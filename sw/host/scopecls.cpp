@@ -47,6 +47,9 @@
 #include <signal.h>
 #include <assert.h>
 #include <time.h>
+#include <errno.h>
+
+#include <string>
 
 #include "devbus.h"
 #include "scopecls.h"
@@ -127,6 +130,14 @@ void	SCOPE::rawread(void) {
 	// buffer to hold all this data
 	m_data = new DEVBUS::BUSW[m_scoplen];
 
+	readbuf();
+}
+
+//
+// readbuf
+//
+// (Re)read the scope's memory into our (already allocated) m_data buffer
+void	SCOPE::readbuf(void) {
 	// There are two means of reading from a DEVBUS interface: The first
 	// is a vector read, optimized so that the address and read command
 	// only needs to be sent once.  This is the optimal means.  However,
@@ -213,33 +224,47 @@ void	SCOPE::write_trace_header(FILE *fp, int offset) {
 		write_trace_timezero(fp, offset);
 
 	fprintf(fp, " $scope module WBSCOPE $end\n");
+	write_trace_vars(fp, "");
+	fprintf(fp, " $upscope $end\n");
+	fprintf(fp, "$enddefinitions $end\n");
+}
+
+/*
+ * write_trace_vars
+ *
+ * Declares all of this scope's wires within a VCD header.  Every identifier
+ * key is preceded by prefix, so that several scopes may share one file.
+ */
+void	SCOPE::write_trace_vars(FILE *fp, const char *prefix) {
 	// Print out all of the various values
 	if (m_compressed) {
-		fprintf(fp, "  $var wire %2d \'R _raw_data [%d:0] $end\n", 31,
-			30);
+		fprintf(fp, "  $var wire %2d %s\'R _raw_data [%d:0] $end\n", 31,
+			prefix, 30);
 	} else {
-		fprintf(fp, "  $var wire %2d \'C clk $end\n", 1);
-		fprintf(fp, "  $var wire %2d \'R _raw_data [%d:0] $end\n", 32,
-			31);
+		fprintf(fp, "  $var wire %2d %s\'C clk $end\n", 1, prefix);
+		fprintf(fp, "  $var wire %2d %s\'R _raw_data [%d:0] $end\n", 32,
+			prefix, 31);
 	}
 
 	// Add in a fake _trigger variable to the VCD file we are producing,
 	// so we can see when our trigger took place (assuming the holdoff is
 	// such that it is within the collect)
-	fprintf(fp, "  $var wire %2d \'T _trigger $end\n", 1);
+	fprintf(fp, "  $var wire %2d %s\'T _trigger $end\n", 1, prefix);
+
+	// When streaming, mark which times were actually captured, and which
+	// fall in the gaps between captures
+	if (m_streaming)
+		fprintf(fp, "  $var wire %2d %s\'S _capture $end\n", 1, prefix);
 
 	for(unsigned i=0; i<m_traces.size(); i++) {
 		TRACEINFO *info = m_traces[i];
-		fprintf(fp, "  $var wire %2d %s %s",
-			info->m_nbits, info->m_key, info->m_name);
+		fprintf(fp, "  $var wire %2d %s%s %s",
+			info->m_nbits, prefix, info->m_key, info->m_name);
 		if ((info->m_nbits != 1)&&(NULL != strchr(info->m_name, '[')))
 			fprintf(fp, "[%d:0] $end\n", info->m_nbits-1);
 		else
 			fprintf(fp, " $end\n");
 	}
-
-	fprintf(fp, " $upscope $end\n");
-	fprintf(fp, "$enddefinitions $end\n");
 }
 
 void	SCOPE::write_binary_trace(FILE *fp, const int nbits, unsigned val,
@@ -338,123 +363,358 @@ void	SCOPE::writevcd(FILE *fp) {
 	// Write the file header.
 	write_trace_header(fp, offset);
 
-	// And split into two paths--one for compressed scopes (wbscopc), and
-	// the other for the more normal scopes (wbscope).
-	if(m_compressed) {
-		// With compressed scopes, you need to track the address
-		// relative to the beginning.
-		unsigned long	addrv = 0;
-		unsigned long	now_ns;
-		double		dnow;
-		bool		last_trigger = true;
-
-		// Loop over each data word read from the scope
-		for(int i=0; i<(int)m_scoplen; i++) {
-			// If the high bit is set, the address jumps by more
-			// than an increment
-			if ((m_data[i]>>31)&1) {
-				if (i!=0) {
-					if (last_trigger) {
-						// If the trigger was valid
-						// on the last clock, then we
-						// need to include the change
-						// to drop it.
-						//
-						dnow   = 1.0/((double)m_clkfreq_hz) * (addrv+1);
-						now_ns = (unsigned long)(dnow * 1e9);
-						fprintf(fp, "#%ld\n", now_ns);
-						fprintf(fp, "0\'T\n");
-					}
-					// But ... with nothing to write out.
-					addrv += (m_data[i]&0x7fffffff) + 1;
-				} continue;
-			}
+	write_vcd_data(fp, 0, offset);
+}
 
-			// Produce a line identifying the time associated with
-			// this piece of data.
-			//
-			// dnow is the current time represented as a double
-			dnow = 1.0/((double)m_clkfreq_hz) * addrv;
-			// Convert to nanoseconds, and to integers.
-			now_ns = (unsigned long)(dnow * 1e9);
-
-			fprintf(fp, "#%ld\n", now_ns);
-
-			if ((int)(addrv-alen) == offset) {
-				fprintf(fp, "1\'T\n");
-				last_trigger = true;
-			} else if (last_trigger)
-				fprintf(fp, "0\'T\n");
-
-			// For compressed data, only the lower 31 bits are
-			// valid.  Write those bits to the VCD file as a raw
-			// value.
-			write_binary_trace(fp, 31, m_data[i], "\'R\n");
-
-			// Finally, walk through all of the user defined traces,
-			// writing each to the VCD file.
-			for(unsigned k=0; k<m_traces.size(); k++) {
-				TRACEINFO *info = m_traces[k];
-				write_binary_trace(fp, info, m_data[i]);
-			}
+/*
+ * VCDBUF
+ *
+ * A buffered VCD writer.  Rather than calling fprintf() for every bit of every
+ * value, values are formatted into a large buffer using a table lookup, one
+ * byte of bits at a time, and the buffer is written out only when it fills.
+ */
+class	VCDBUF {
+	FILE		*m_fp;
+	unsigned	m_len;
+	char		m_buf[65536];
+	// The time stamp is only written once something changes at that time
+	bool		m_tpending;
+	unsigned long	m_time;
+	static	char	m_bits[256][8];
+	static	bool	m_bits_ready;
+
+	void	need(unsigned n) {
+		if (m_len + n > sizeof(m_buf))
+			flush();
+	}
+public:
+	VCDBUF(FILE *fp) : m_fp(fp), m_len(0), m_tpending(false) {
+		if (!m_bits_ready) {
+			for(int v=0; v<256; v++)
+			for(int b=0; b<8; b++)
+				m_bits[v][b] = '0' + ((v>>(7-b))&1);
+			m_bits_ready = true;
+		}
+	}
+	~VCDBUF(void) { flush(); }
+
+	void	flush(void) {
+		if (m_len > 0)
+			fwrite(m_buf, 1, m_len, m_fp);
+		m_len = 0;
+	}
+
+	void	str(const char *s) {
+		unsigned	ln = strlen(s);
+		need(ln);
+		memcpy(&m_buf[m_len], s, ln);
+		m_len += ln;
+	}
+
+	// Set the time for the next values written
+	void	time(unsigned long t) {
+		m_time = t;
+		m_tpending = true;
+	}
+
+	// A time stamp line, #<t>
+	void	write_time(void) {
+		char		tmp[24];
+		int		n = 0;
+		unsigned long	t = m_time;
+
+		m_tpending = false;
+		need(24);
+		m_buf[m_len++] = '#';
+		do {
+			tmp[n++] = '0' + (t % 10);
+			t /= 10;
+		} while(t != 0);
+		while(n > 0)
+			m_buf[m_len++] = tmp[--n];
+		m_buf[m_len++] = '\n';
+	}
+
+	// A single bit value, <v><key>
+	void	bit(unsigned v, const char *key) {
+		if (m_tpending)
+			write_time();
+		need(2);
+		m_buf[m_len++] = '0' + (v&1);
+		str(key);
+		need(1);
+		m_buf[m_len++] = '\n';
+	}
 
-			addrv++;
+	// A vector value, b<bits> <key>
+	void	vec(int nbits, unsigned v, const char *key) {
+		char	*ptr;
+		int	lead = nbits & 7;
+
+		if (m_tpending)
+			write_time();
+		need(nbits + 2);
+		ptr = &m_buf[m_len];
+		*ptr++ = 'b';
+		if (lead) {
+			memcpy(ptr, &m_bits[(v>>(nbits-lead))&((1<<lead)-1)][8-lead], lead);
+			ptr += lead;
 		}
-	} else {
-		//
-		// Uncompressed scope.
-		//
-		unsigned now_ns;
-		double	dnow;
+		for(int b=nbits-lead-8; b>=0; b-=8) {
+			memcpy(ptr, m_bits[(v>>b)&0x0ff], 8);
+			ptr += 8;
+		}
+		*ptr++ = ' ';
+		m_len = ptr - m_buf;
+		str(key);
+		need(1);
+		m_buf[m_len++] = '\n';
+	}
+};
 
-		// We assume a clock signal, and set it to one and zero.
-		// We also assume everything changes on the positive edge of
-		// that clock within here.
+char	VCDBUF::m_bits[256][8];
+bool	VCDBUF::m_bits_ready = false;
 
-		// Loop over all data words
-		for(int i=0; i<(int)m_scoplen; i++) {
-			// Positive edge of the clock (everything is assumed to
-			// be on the positive edge)
+/*
+ * SCOPETRACK
+ *
+ * Walks through the data from one scope, producing the VCD events it
+ * requires in time order, so that any number of scopes may be merged into a
+ * single file.  Only those values that change are ever written.  Compressed
+ * (wbscopc) run lengths are handled by simply skipping over them, since
+ * nothing changes during a run.
+ */
+class	SCOPETRACK {
+public:
+	const	DEVBUS::BUSW	*m_data;
+	unsigned	m_len, m_idx;	// Words in m_data, next word to use
+	unsigned long	m_clk;		// Clock number of m_data[m_idx]
+	bool		m_compressed;
+	double		m_period_ns;
+	unsigned long	m_base_ns;
+	// The falling edge of the clock, pending after each sample of an
+	// uncompressed scope
+	bool		m_fall;
+	unsigned long	m_fallclk;
+	// The _trigger wire rises at the trigger's clock, and falls one clock
+	// later, whether or not there's a sample at either clock.
+	bool		m_trigpend, m_tknown;
+	unsigned	m_trigval;
+	unsigned long	m_trigclk;
+	// Keys, and the last values written to each trace, and to the raw
+	// word.  m_known is false until the first sample has been written.
+	std::vector<std::string>	m_keys;
+	std::vector<unsigned>		m_last;
+	std::string	m_rkey, m_tkey, m_ckey;
+	unsigned	m_lastraw;
+	bool		m_known;
+
+	SCOPETRACK(const std::vector<TRACEINFO *> &traces,
+			const DEVBUS::BUSW *data, unsigned len, bool compressed,
+			unsigned clkfreq_hz, unsigned long base_ns,
+			long trigger, const char *prefix)
+		: m_data(data), m_len(len), m_idx(0), m_clk(0),
+		m_compressed(compressed), m_base_ns(base_ns), m_fall(false),
+		m_trigpend(trigger >= 0), m_tknown(false), m_trigval(1),
+		m_trigclk(trigger), m_lastraw(0), m_known(false) {
+
+		m_period_ns = 1e9 / (double)clkfreq_hz;
+		m_rkey = std::string(prefix) + "'R";
+		m_tkey = std::string(prefix) + "'T";
+		m_ckey = std::string(prefix) + "'C";
+		for(unsigned k=0; k<traces.size(); k++)
+			m_keys.push_back(std::string(prefix) + traces[k]->m_key);
+		m_last.resize(traces.size());
+		skip_runs();
+	}
 
+	// In the compressed format, a word with the high bit set is a run
+	// length: the previous value lasted that many clocks (plus one)
+	// longer.  A run at the very start carries no information.
+	void	skip_runs(void) {
+		while((m_compressed)&&(m_idx < m_len)
+				&&((m_data[m_idx]>>31)&1)) {
+			if (m_idx != 0)
+				m_clk += (m_data[m_idx]&0x7fffffff) + 1;
+			m_idx++;
+		}
+	}
 
-			//
-			// Clock goes high
-			//
+	// We're done once the last sample has been written.  Any trigger
+	// change beyond that falls outside of the capture.
+	bool	done(void) const {
+		return (!m_fall)&&(m_idx >= m_len);
+	}
 
-			// Write the current (relative) time of this data word
-			dnow = 1.0/((double)m_clkfreq_hz) * i;
-			now_ns = (unsigned)(dnow * 1e9 + 0.5);
-			fprintf(fp, "#%d\n", now_ns);
+	unsigned long	when(unsigned long clk, bool half=false) const {
+		double	t = m_period_ns * clk;
+		if (half)
+			t += m_period_ns / 2.;
+		return m_base_ns + (unsigned long)(t + 0.5);
+	}
 
-			fprintf(fp, "1\'C\n");
-			write_binary_trace(fp, (m_compressed)?31:32,
-				m_data[i], "\'R\n");
+	unsigned long	next_time(void) const {
+		unsigned long	t;
 
-			if (i == offset)
-				fprintf(fp, "1\'T\n");
-			else // if (addrv == offset+1)
-				fprintf(fp, "0\'T\n");
+		if (m_fall)
+			t = when(m_fallclk, true);
+		else
+			t = when(m_clk);
+		if ((m_trigpend)&&(when(m_trigclk) < t))
+			t = when(m_trigclk);
+		return t;
+	}
 
-			for(unsigned k=0; k<m_traces.size(); k++) {
-				TRACEINFO *info = m_traces[k];
-				write_binary_trace(fp, info, m_data[i]);
-			}
+	// Write whatever changes take place at next_time(), and then advance
+	void	emit(VCDBUF &vcd, const std::vector<TRACEINFO *> &traces) {
+		if ((m_trigpend)&&(when(m_trigclk) == next_time())) {
+			vcd.bit(m_trigval, m_tkey.c_str());
+			m_tknown = true;
+			if (m_trigval) {
+				m_trigval = 0;
+				m_trigclk++;
+			} else
+				m_trigpend = false;
+			return;
+		} else if (m_fall) {
+			vcd.bit(0, m_ckey.c_str());
+			m_fall = false;
+			return;
+		}
+
+		DEVBUS::BUSW	v = m_data[m_idx];
+
+		if (!m_compressed)
+			vcd.bit(1, m_ckey.c_str());
+		else
+			v &= 0x7fffffff;
+		if ((!m_known)||(v != m_lastraw))
+			vcd.vec((m_compressed)?31:32, v, m_rkey.c_str());
+		if (!m_tknown) {
+			vcd.bit(0, m_tkey.c_str());
+			m_tknown = true;
+		}
+		for(unsigned k=0; k<traces.size(); k++) {
+			TRACEINFO	*info = traces[k];
+			unsigned	tv = v >> info->m_nshift;
+
+			if (info->m_nbits < 32)
+				tv &= (1u<<info->m_nbits)-1;
+			if ((m_known)&&(tv == m_last[k]))
+				continue;
+			m_last[k] = tv;
+			if (info->m_nbits <= 1)
+				vcd.bit(tv, m_keys[k].c_str());
+			else
+				vcd.vec(info->m_nbits, tv, m_keys[k].c_str());
+		}
+		m_lastraw  = v;
+		m_known = true;
+
+		if (!m_compressed) {
+			m_fall = true;
+			m_fallclk = m_clk;
+		}
+		m_idx++; m_clk++;
+		skip_runs();
+	}
+};
 
-			//
-			// Clock goes to zero
-			//
+/*
+ * write_tracks
+ *
+ * Merge the events from all of the given tracks, in time order, into one
+ * VCD file.
+ */
+static	void	write_tracks(FILE *fp, std::vector<SCOPETRACK *> &tracks,
+		std::vector<const std::vector<TRACEINFO *> *> &traces) {
+	VCDBUF	vcd(fp);
 
-			// Add half a clock period to our time
-			dnow += 1.0/((double)m_clkfreq_hz)/2.;
-			now_ns = (unsigned)(dnow * 1e9 + 0.5);
-			fprintf(fp, "#%d\n", now_ns);
+	while(1) {
+		unsigned long	t = 0;
+		bool		any = false;
 
-			// Now finally write the clock as zero.
-			fprintf(fp, "0\'C\n");
+		for(unsigned k=0; k<tracks.size(); k++) {
+			if (tracks[k]->done())
+				continue;
+			if ((!any)||(tracks[k]->next_time() < t))
+				t = tracks[k]->next_time();
+			any = true;
+		} if (!any)
+			break;
+
+		vcd.time(t);
+		for(unsigned k=0; k<tracks.size(); k++) {
+			while((!tracks[k]->done())&&(tracks[k]->next_time() == t))
+				tracks[k]->emit(vcd, *traces[k]);
 		}
 	}
 }
 
+/*
+ * write_vcd_data
+ *
+ * Writes the samples in m_data to the VCD file, with the first sample placed
+ * base_ns nanoseconds into the file.  The trigger is marked at sample offset.
+ */
+void	SCOPE::write_vcd_data(FILE *fp, unsigned long base_ns, int offset) {
+	std::vector<SCOPETRACK *>	tracks;
+	std::vector<const std::vector<TRACEINFO *> *>	traces;
+
+	tracks.push_back(new SCOPETRACK(m_traces, m_data, m_scoplen,
+		m_compressed, m_clkfreq_hz, base_ns, offset, ""));
+	traces.push_back(&m_traces);
+	write_tracks(fp, tracks, traces);
+	delete tracks[0];
+}
+
+/*
+ * open_trace, close_trace
+ *
+ * Open a trace file for writing.  VCD files are written directly.  For an FST
+ * file, we write a VCD to a temporary file, and then have GTKWave's vcd2fst
+ * convert it once we are done.
+ */
+static	bool	is_fst(const char *fname) {
+	const char	*ext = strrchr(fname, '.');
+	return (ext)&&(strcasecmp(ext, ".fst")==0);
+}
+
+static	FILE	*open_trace(const char *fname, char *tmpname) {
+	FILE	*fp;
+
+	tmpname[0] = '\0';
+	if (is_fst(fname)) {
+		int	fd;
+
+		strcpy(tmpname, "/tmp/wbscope-XXXXXX");
+		if ((fd = mkstemp(tmpname)) < 0)
+			fp = NULL;
+		else
+			fp = fdopen(fd, "w");
+	} else
+		fp = fopen(fname, "w");
+
+	if (fp == NULL) {
+		fprintf(stderr, "ERR: Cannot open %s for writing!\n", fname);
+		fprintf(stderr, "ERR: Trace file not written\n");
+	} return fp;
+}
+
+static	void	close_trace(FILE *fp, const char *fname, const char *tmpname) {
+	fclose(fp);
+	if (tmpname[0]) {
+		char	*cmd = new char[strlen(fname)+strlen(tmpname)+32];
+
+		sprintf(cmd, "vcd2fst \"%s\" \"%s\"", tmpname, fname);
+		if (system(cmd) != 0)
+			fprintf(stderr, "ERR: vcd2fst failed, %s not written\n",
+				fname);
+		unlink(tmpname);
+		delete[] cmd;
+	}
+}
+
 /*
  * writevcd
  *
@@ -463,16 +723,201 @@ void	SCOPE::writevcd(FILE *fp) {
  * an error is written to the standard error stream, and the routine returns.
  */
 void	SCOPE::writevcd(const char *trace_file_name) {
-	FILE	*fp = fopen(trace_file_name, "w");
+	char	tmpname[64];
+	FILE	*fp = open_trace(trace_file_name, tmpname);
+
+	if (fp == NULL)
+		return;
+
+	writevcd(fp);
+
+	close_trace(fp, trace_file_name, tmpname);
+}
+
+/*
+ * writevcd (multiple scopes)
+ *
+ * Merge the captures of several scopes onto one timeline.  Since each scope
+ * only knows where its samples lie relative to its own trigger, the triggers
+ * are all placed at time zero.  Each scope may run from its own clock.
+ */
+void	SCOPE::writevcd(const char *trace_file_name, int nscopes,
+		SCOPE **scopes) {
+	std::vector<SCOPETRACK *>	tracks;
+	std::vector<const std::vector<TRACEINFO *> *>	traces;
+	std::vector<double>	pre_ns;
+	double		maxpre = 0.0;
+	char		tmpname[64], prefix[16];
+	FILE		*fp;
+	time_t		now;
+
+	for(int k=0; k<nscopes; k++) {
+		SCOPE	*sc = scopes[k];
+		long	trig;
+
+		if (!sc->m_data)
+			sc->rawread();
+		if (!sc->m_data)
+			return;
+		if (sc->m_traces.size()==0)
+			sc->define_traces();
+		trig = (long)sc->getaddresslen() - sc->m_holdoff - 1;
+		pre_ns.push_back(trig * 1e9 / (double)sc->m_clkfreq_hz);
+		if (pre_ns[k] > maxpre)
+			maxpre = pre_ns[k];
+	}
+
+	if (NULL == (fp = open_trace(trace_file_name, tmpname)))
+		return;
+
+	time(&now);
+	fprintf(fp, "$version Generated by WBScope $end\n");
+	fprintf(fp, "$date %s\n $end\n", ctime(&now));
+	scopes[0]->write_trace_timescale(fp);
+	fprintf(fp, "$timezero %ld $end\n\n", -(long)(maxpre + 0.5));
+	for(int k=0; k<nscopes; k++) {
+		sprintf(prefix, "%d", k);
+		fprintf(fp, " $scope module WBSCOPE%d $end\n", k);
+		scopes[k]->write_trace_vars(fp, prefix);
+		fprintf(fp, " $upscope $end\n");
+	}
+	fprintf(fp, "$enddefinitions $end\n");
+
+	for(int k=0; k<nscopes; k++) {
+		SCOPE	*sc = scopes[k];
+
+		sprintf(prefix, "%d", k);
+		tracks.push_back(new SCOPETRACK(sc->m_traces, sc->m_data,
+			sc->m_scoplen, sc->m_compressed, sc->m_clkfreq_hz,
+			(unsigned long)(maxpre - pre_ns[k] + 0.5),
+			(long)sc->getaddresslen() - sc->m_holdoff - 1,
+			prefix));
+		traces.push_back(&sc->m_traces);
+	}
+
+	write_tracks(fp, tracks, traces);
+	for(unsigned k=0; k<tracks.size(); k++)
+		delete tracks[k];
 
+	close_trace(fp, trace_file_name, tmpname);
+}
+
+/*
+ * rearm
+ *
+ * Reset the scope, so that it starts recording again, while keeping the
+ * holdoff it was using.
+ */
+void	SCOPE::rearm(void) {
+	scoplen();
+	m_fpga->writeio(m_addr, m_holdoff & ((1<<20)-1));
+}
+
+/*
+ * now_ns
+ *
+ * Returns the current time in nanoseconds, for placing streamed captures on
+ * a common timeline.  If a free running counter within the design has been
+ * given via set_timestamp(), that counter is used.  Otherwise, we fall back
+ * to the host's clock--which includes the delays across the link.
+ */
+unsigned long	SCOPE::now_ns(void) {
+	if (m_tshz != 0) {
+		// The counter's top bit is sticky, once it has wrapped, so
+		// only the bottom 31 bits tell us anything.  Extend those
+		// into 64-bits ourselves.
+		unsigned	v = m_fpga->readio(m_tsaddr) & 0x7fffffff;
+
+		if (v < (unsigned)(m_tscount & 0x7fffffff))
+			m_tscount += 0x80000000ul;
+		m_tscount = (m_tscount & ~0x7ffffffful) | v;
+		return (unsigned long)((double)m_tscount * 1e9 / m_tshz);
+	} else {
+		struct	timespec	ts;
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec * 1000000000ul + ts.tv_nsec;
+	}
+}
+
+/*
+ * stream
+ *
+ * Capture continuously, appending every capture to one VCD file.  After each
+ * capture is read, the scope is immediately re-armed, and the capture is
+ * placed on the file's timeline at the time the scope stopped.  That time is
+ * only known to within one poll of the scope's control register.  Since the
+ * scope can't record while it is being read, there will be gaps between
+ * captures.  These are marked in the file by the _capture wire being low.
+ *
+ * If ncaptures is zero, this continues until the program is killed.
+ */
+void	SCOPE::stream(const char *trace_file_name, unsigned ncaptures) {
+	FILE	*fp;
+	unsigned long	t0 = 0, tnext = 0;
+	double		clk_ns = 1e9 / (double)m_clkfreq_hz;
+
+	if (scoplen() <= 4) {
+		printf("ERR: Scope has less than a minimum length.  Is it truly a scope?\n");
+		return;
+	}
+
+	fp = fopen(trace_file_name, "w");
 	if (fp == NULL) {
 		fprintf(stderr, "ERR: Cannot open %s for writing!\n", trace_file_name);
-		fprintf(stderr, "ERR: Trace file not written\n");
+		fprintf(stderr, "ERR: %s\n", strerror(errno));
 		return;
 	}
 
-	writevcd(fp);
+	if (m_traces.size()==0)
+		define_traces();
+	if (!m_data)
+		m_data = new DEVBUS::BUSW[m_scoplen];
+
+	m_streaming = true;
+	write_trace_header(fp, 0);
+	fprintf(fp, "#0\n0\'S\n");
+
+	for(unsigned n=0; (ncaptures == 0)||(n < ncaptures); n++) {
+		unsigned long	tlo, thi, tstop, tstart;
+		unsigned	alen;
+		int		offset;
+
+		// Wait for the scope to stop.  It stopped somewhere between
+		// our last look at it and now.
+		tlo = now_ns();
+		while(!ready())
+			tlo = now_ns();
+		thi = now_ns();
+		tstop = tlo + (thi - tlo)/2;
+
+		readbuf();
+		// Start the next capture as soon as we have this one
+		rearm();
+
+		alen   = getaddresslen();
+		offset = alen - m_holdoff - 1;
+
+		// The last sample was taken when the scope stopped
+		tstart = tstop - (unsigned long)((alen-1) * clk_ns);
+		if (n == 0)
+			t0 = tstart;
+		else if (tstart < tnext)
+			// Our estimate is off by more than the gap.  Captures
+			// can't overlap, so just butt this one up against the
+			// last.
+			tstart = tnext;
+
+		fprintf(fp, "#%ld\n1\'S\n", tstart - t0);
+		write_vcd_data(fp, tstart - t0, offset);
+		tnext = tstart + (unsigned long)(alen * clk_ns);
+		fprintf(fp, "#%ld\n0\'S\n", tnext - t0);
+		fflush(fp);
+
+		printf("Capture %4d: %6d samples at %12.6f s\n", n, alen,
+			(tstart - t0) * 1e-9);
+	}
 
+	m_streaming = false;
 	fclose(fp);
 }
-
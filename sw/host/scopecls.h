@@ -90,6 +90,14 @@ class	SCOPE {
 	unsigned	*m_data;	// Data read from the scope
 	unsigned	m_clkfreq_hz;
 
+	// Streaming support.  m_tsaddr is the address of a free running
+	// counter, ticking at m_tshz, used to timestamp captures.  If m_tshz
+	// is zero, the host's clock is used instead.
+	bool		m_streaming;
+	DEVBUS::BUSW	m_tsaddr;
+	unsigned	m_tshz;
+	unsigned long	m_tscount;
+
 	// The m_traces variable holds a list of all of the various wire
 	// definitions within the scope data word.
 	std::vector<TRACEINFO *> m_traces;
@@ -99,7 +107,9 @@ public:
 			bool compressed=false, bool vecread=true)
 		: m_fpga(fpga), m_addr(addr),
 			m_compressed(compressed), m_vector_read(vecread),
-			m_scoplen(0), m_data(NULL) {
+			m_scoplen(0), m_data(NULL),
+			m_streaming(false), m_tsaddr(0), m_tshz(0),
+			m_tscount(0) {
 		//
 		// First thing we want to do upon allocating a scope, is to
 		// define the traces for that scope.  Sad thing is ... we can't
@@ -143,6 +153,28 @@ public:
 	// Nothing more is done with it beyond that.
 	virtual	void	rawread(void);
 
+	// Read the scope's memory into m_data, whether or not it's been read
+	// before.
+		void	readbuf(void);
+
+	// Reset the scope, starting a new capture with the same holdoff
+		void	rearm(void);
+
+	// Name a free running counter within the design, counting at
+	// counter_hz, to be used to timestamp streamed captures.
+		void	set_timestamp(DEVBUS::BUSW addr, unsigned counter_hz) {
+		m_tsaddr = addr; m_tshz = counter_hz; }
+
+	// The current time, in nanoseconds, according to the timestamp
+	// counter (if given), or the host otherwise.
+		unsigned long	now_ns(void);
+
+	// Streaming mode: wait for the scope to stop, read it, re-arm it, and
+	// append the capture to trace_file_name--over and over again, for
+	// ncaptures captures (or forever, if ncaptures is zero).
+		void	stream(const char *trace_file_name,
+				unsigned ncaptures = 0);
+
 	// Walk through the data, and print out to the standard output, what is
 	// in it.  If multiple lines have the same data, print() will avoid
 	// printing those lines for the purpose of keeping the output from
@@ -177,6 +209,10 @@ public:
 	// Write the VCD file's header
 	virtual void	write_trace_header(FILE *fp, int offset = 0);
 
+	// Declare this scope's wires within a VCD header, with every
+	// identifier prefixed by prefix
+		void	write_trace_vars(FILE *fp, const char *prefix);
+
 	// Given a value, and the number of bits required to define that value,
 	// write a single line to our VCD file.
 	//
@@ -194,13 +230,25 @@ public:
 				unsigned value);
 
 	// This is the user entry point.  When you know the scope is ready,
-	// you may call writevcd to start the VCD generation process.
+	// you may call writevcd to start the VCD generation process.  If the
+	// file name ends in .fst, an FST file is produced instead (this
+	// requires GTKWave's vcd2fst).
 		void	writevcd(const char *trace_file_name);
+
+	// Write the captures from several scopes into one file, each within
+	// its own module, with all of their triggers lined up at time zero.
+	static	void	writevcd(const char *trace_file_name,
+				int nscopes, SCOPE **scopes);
 	// This is an alternate entry point, useful if you already have a
 	// FILE *.  This will write the data to the file, but not close the
 	// file.
 		void	writevcd(FILE *fp);
 
+	// Write our data, but not the header, to a VCD file.  The first sample
+	// is placed at base_ns, and the trigger at sample offset.
+		void	write_vcd_data(FILE *fp, unsigned long base_ns,
+				int offset);
+
 	// Calculate the number of points the scope covers.  Nominally, this
 	// will be m_scopelen, the length of the scope.  However, if the
 	// scope is compressed, this could be greater.
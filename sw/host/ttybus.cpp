@@ -207,6 +207,59 @@ void	TTYBUS::writeio(const BUSW a, const BUSW v) {
 	m_lastaddr = a; m_addr_set = true;
 }
 
+/*
+ * encode_write
+ *
+ * Encodes a single write command, of the value val, into buf.  If the value
+ * has been written recently, it is sent as an index into the table of recent
+ * writes, rather than as a full word.  Returns a pointer to the end of the
+ * encoded command.
+ */
+char	*TTYBUS::encode_write(const BUSW val, const int p, char *buf) {
+	char	*ptr = buf;
+	int	caddr = 0;
+	// Let's try compression
+	for(int i=1; i<256; i++) {
+		unsigned	tstaddr;
+		tstaddr = (m_wraddr - i) & 0x0ff;
+		if ((!m_wrloaded)&&(tstaddr > (unsigned)m_wraddr))
+			break;
+		if (m_writetbl[tstaddr] == val) {
+			caddr = ( m_wraddr- tstaddr ) & 0x0ff;
+			break;
+		}
+	}
+
+	/*
+	if (caddr != 0)
+		DBGPRINTF("WR[%08x] = %08x (= TBL[%4x] <= %4x)\n", m_lastaddr, val, caddr, m_wraddr);
+	else
+		DBGPRINTF("WR[%08x] = %08x\n", m_lastaddr, val);
+	*/
+
+	if (caddr != 0) {
+		*ptr++ = charenc( (((caddr>>6)&0x03)<<1) + (p?1:0) + 0x010);
+		*ptr++ = charenc(    caddr    &0x3f    );
+
+	} else {
+		// For testing, let's start just doing this the hard way
+		*ptr++ = charenc( (((val>>30)&0x03)<<1) + (p?1:0) + 0x018);
+		*ptr++ = charenc( (val>>24)&0x3f);
+		*ptr++ = charenc( (val>>18)&0x3f);
+		*ptr++ = charenc( (val>>12)&0x3f);
+		*ptr++ = charenc( (val>> 6)&0x3f);
+		*ptr++ = charenc( (val    )&0x3f);
+
+		m_writetbl[m_wraddr++] = val;
+		m_wraddr &= 0x0ff;
+		if (m_wraddr == 0) {
+			m_wrloaded = true;
+		}
+	}
+
+	return ptr;
+}
+
 /*
  * writev
  *
@@ -242,7 +295,7 @@ void	TTYBUS::writev(const BUSW a, const int p, const int len, const BUSW *buf) {
 
 	DBGPRINTF("WRITEV(%08x,%d,#%d,0x%08x ...)\n", a, p, len, buf[0]);
 	// Encode the address
-	ptr = encode_address(a);
+	ptr = encode_address(a, m_buf);
 	m_lastaddr = a; m_addr_set = true;
 
 	while(nw < len) {
@@ -252,48 +305,7 @@ void	TTYBUS::writev(const BUSW a, const int p, const int len, const BUSW *buf) {
 
 		DBGPRINTF("WRITEV-SUB(%08x%s,#%d,&buf[%d])\n", a+nw, (p)?"++":"", ln, nw);
 		for(int i=0; i<ln; i++) {
-			BUSW	val = buf[nw+i];
-
-			int	caddr = 0;
-			// Let's try compression
-			for(int i=1; i<256; i++) {
-				unsigned	tstaddr;
-				tstaddr = (m_wraddr - i) & 0x0ff;
-				if ((!m_wrloaded)&&(tstaddr > (unsigned)m_wraddr))
-					break;
-				if (m_writetbl[tstaddr] == val) {
-					caddr = ( m_wraddr- tstaddr ) & 0x0ff;
-					break;
-				}
-			}
-
-		/*
-		if (caddr != 0)
-			DBGPRINTF("WR[%08x] = %08x (= TBL[%4x] <= %4x)\n", m_lastaddr, val, caddr, m_wraddr);
-		else
-			DBGPRINTF("WR[%08x] = %08x\n", m_lastaddr, val);
-		*/
-
-			if (caddr != 0) {
-				*ptr++ = charenc( (((caddr>>6)&0x03)<<1) + (p?1:0) + 0x010);
-				*ptr++ = charenc(    caddr    &0x3f    );
-			
-			} else {
-				// For testing, let's start just doing this the hard way
-				*ptr++ = charenc( (((val>>30)&0x03)<<1) + (p?1:0) + 0x018);
-				*ptr++ = charenc( (val>>24)&0x3f);
-				*ptr++ = charenc( (val>>18)&0x3f);
-				*ptr++ = charenc( (val>>12)&0x3f);
-				*ptr++ = charenc( (val>> 6)&0x3f);
-				*ptr++ = charenc( (val    )&0x3f);
-
-				m_writetbl[m_wraddr++] = val;
-				m_wraddr &= 0x0ff;
-				if (m_wraddr == 0) {
-					m_wrloaded = true;
-				}
-			}
-
+			ptr = encode_write(buf[nw+i], p, ptr);
 			if (p == 1) m_lastaddr+=4;
 		}
 		// *ptr++ = charenc(0x2e);
@@ -382,12 +394,13 @@ TTYBUS::BUSW	TTYBUS::readio(const TTYBUS::BUSW a) {
  * encode_address
  *
  * Creates a message to be sent across the bus with a new address value
- * in it.
+ * in it.  The message is placed into buf, and a pointer to the end of the
+ * message is returned.
  *
  */
-char	*TTYBUS::encode_address(const TTYBUS::BUSW a) {
+char	*TTYBUS::encode_address(const TTYBUS::BUSW a, char *buf) {
 	TTYBUS::BUSW	addr = a>>2;
-	char	*ptr = m_buf;
+	char	*ptr = buf;
 
 	// Double check that we are aligned
 	if ((a&3)!=0) {
@@ -400,7 +413,7 @@ char	*TTYBUS::encode_address(const TTYBUS::BUSW a) {
 	if (m_addr_set) {
 		// Encode a difference address
 		int	diffaddr = (a - m_lastaddr)>>2;
-		ptr = m_buf;
+		ptr = buf;
 		if ((diffaddr >= -32)&&(diffaddr < 32)) {
 			*ptr++ = charenc(0x09);
 			*ptr++ = charenc(diffaddr & 0x03f);
@@ -422,7 +435,7 @@ char	*TTYBUS::encode_address(const TTYBUS::BUSW a) {
 		}
 		*ptr = '\0';
 		DBGPRINTF("DIF-ADDR: (%ld) \'%s\' encodes last_addr(0x%08x) %c %d(0x%08x)\n",
-			ptr-m_buf, m_buf,
+			ptr-buf, buf,
 			m_lastaddr, (diffaddr<0)?'-':'+',
 			diffaddr, diffaddr&0x0ffffffff);
 	}
@@ -432,40 +445,40 @@ char	*TTYBUS::encode_address(const TTYBUS::BUSW a) {
 		// Prefer absolute address encoding over differential encoding,
 		// when both encodings encode the same address, and when both
 		// encode the address in the same number of words
-		if ((addr <= 0x03f)&&((ptr == m_buf)||(ptr >= &m_buf[2]))) {
-			ptr = m_buf;
+		if ((addr <= 0x03f)&&((ptr == buf)||(ptr >= &buf[2]))) {
+			ptr = buf;
 			*ptr++ = charenc(0x08);
 			*ptr++ = charenc(addr);
-		} else if((addr <= 0x0fff)&&((ptr == m_buf)||(ptr >= &m_buf[3]))) {
+		} else if((addr <= 0x0fff)&&((ptr == buf)||(ptr >= &buf[3]))) {
 			DBGPRINTF("Setting ADDR.3 to %08x\n", addr);
-			ptr = m_buf;
+			ptr = buf;
 			*ptr++ = charenc(0x0a);
 			*ptr++ = charenc((addr>> 6) & 0x03f);
 			*ptr++ = charenc( addr      & 0x03f);
-		} else if((addr <= 0x03ffff)&&((ptr == m_buf)||(ptr >= &m_buf[4]))) {
+		} else if((addr <= 0x03ffff)&&((ptr == buf)||(ptr >= &buf[4]))) {
 			DBGPRINTF("Setting ADDR.4 to %08x\n", addr);
-			ptr = m_buf;
+			ptr = buf;
 			*ptr++ = charenc(0x0c);
 			*ptr++ = charenc((addr>>12) & 0x03f);
 			*ptr++ = charenc((addr>> 6) & 0x03f);
 			*ptr++ = charenc( addr      & 0x03f);
-		} else if((addr <= 0x0ffffff)&&((ptr == m_buf)||(ptr >= &m_buf[5]))) {
+		} else if((addr <= 0x0ffffff)&&((ptr == buf)||(ptr >= &buf[5]))) {
 			DBGPRINTF("Setting ADDR.5 to %08x\n", addr);
-			ptr = m_buf;
+			ptr = buf;
 			*ptr++ = charenc(0x0e);
 			*ptr++ = charenc((addr>>18) & 0x03f);
 			*ptr++ = charenc((addr>>12) & 0x03f);
 			*ptr++ = charenc((addr>> 6) & 0x03f);
 			*ptr++ = charenc( addr      & 0x03f);
-		} else if (ptr == m_buf) { // Send our address prior to any read
-			// ptr = m_buf;
+		} else if (ptr == buf) { // Send our address prior to any read
+			// ptr = buf;
 			encode(0, addr, ptr);
 			ptr+=6;
 		}
 	}
 
 	*ptr = '\0';
-	DBGPRINTF("ADDR-CMD: (%ld) \'%s\'\n", ptr-m_buf, m_buf);
+	DBGPRINTF("ADDR-CMD: (%ld) \'%s\'\n", ptr-buf, buf);
 	m_rdaddr = 0;
 
 	return ptr;
@@ -516,7 +529,7 @@ void	TTYBUS::readv(const TTYBUS::BUSW a, const int inc, const int len, TTYBUS::B
 		return;
 	DBGPRINTF("READV(%08x,%d,#%4d)\n", a, inc, len);
 
-	ptr = encode_address(a);
+	ptr = encode_address(a, m_buf);
 	try {
 	    while(cmdrd < len) {
 		// ptr = m_buf;
@@ -583,6 +596,124 @@ void	TTYBUS::readz(const TTYBUS::BUSW a, const int len, TTYBUS::BUSW *buf) {
 	readv(a, 0, len, buf);
 }
 
+/*
+ * writeread
+ *
+ * Write wv[k] to address wa, and then read the value at address ra back into
+ * buf[k], for each of len (write, read) pairs.  This is the access pattern of
+ * an indirect register port, such as the ZipCPU's debug control/data pair.
+ * Rather than waiting for a round trip on every access, the pairs are all
+ * encoded into a single command stream, up to MAXWRLEN pairs at a time, and
+ * only then are the results read back.
+ */
+void	TTYBUS::writeread(const BUSW wa, const BUSW *wv, const BUSW ra,
+		const int len, BUSW *buf) {
+	int	nw = 0;
+
+	if (len <= 0)
+		return;
+	DBGPRINTF("WRITEREAD(%08x,%08x,#%d)\n", wa, ra, len);
+
+	// Each pair takes at most six characters for each of its two
+	// addresses, six for the write, and one for the read
+	bufalloc(MAXWRLEN*19+2);
+
+	try {
+		while(nw < len) {
+			char	*ptr = m_buf;
+			int	ln = len-nw;
+			if ((unsigned)ln > MAXWRLEN)
+				ln = MAXWRLEN;
+
+			for(int i=0; i<ln; i++) {
+				ptr = encode_address(wa, ptr);
+				m_lastaddr = wa; m_addr_set = true;
+				ptr = encode_write(wv[nw+i], 0, ptr);
+
+				ptr = encode_address(ra, ptr);
+				m_lastaddr = ra;
+				ptr = readcmd(0, 1, ptr);
+			}
+			*ptr++ = '\n'; *ptr = '\0';
+			m_dev->write(m_buf, ptr-m_buf);
+			DBGPRINTF(">> %s\n", m_buf);
+
+			// Write acknowledgments are skipped by readword(), so
+			// all that's left is to collect the values
+			for(int i=0; i<ln; i++)
+				buf[nw+i] = readword();
+			nw += ln;
+		}
+	} catch(BUSERR b) {
+		DBGPRINTF("WRITEREAD::BUSERR, pair %d\n", nw);
+		throw BUSERR(ra);
+	}
+
+	if (m_lastaddr != ra) {
+		printf("TTYBUS::WRITEREAD(wa=%08x,ra=%08x,len=%d) ERR: (Last) %08x != %08x (Expected)\n", wa, ra, len, m_lastaddr, ra);
+		exit(-3);
+	}
+}
+
+/*
+ * ioseq
+ *
+ * Perform a sequence of single word reads and writes to unrelated addresses.
+ * As with writeread(), the accesses are encoded into one command stream, up
+ * to MAXWRLEN of them at a time, before collecting the values read.  Returns
+ * the number of accesses that completed.  Since write acknowledgements are
+ * skipped, a bus error is attributed to the next read that has yet to
+ * return.  Following the last read, ioseq() only checks for errors that have
+ * already arrived, charging any to the last access.  An error from a write
+ * after the last read may therefore not be seen until some later read.
+ */
+int	TTYBUS::ioseq(const int len, BUSOP *ops) {
+	int	nw = 0;
+
+	if (len <= 0)
+		return 0;
+	DBGPRINTF("IOSEQ(#%d)\n", len);
+
+	// At most six characters for each address, and six for a write
+	bufalloc(MAXWRLEN*12+2);
+
+	while(nw < len) {
+		char	*ptr = m_buf;
+		int	ln = len-nw, k = nw;
+		if ((unsigned)ln > MAXWRLEN)
+			ln = MAXWRLEN;
+
+		for(int i=nw; i<nw+ln; i++) {
+			ptr = encode_address(ops[i].m_addr, ptr);
+			m_lastaddr = ops[i].m_addr; m_addr_set = true;
+			if (ops[i].m_write)
+				ptr = encode_write(ops[i].m_data, 0, ptr);
+			else
+				ptr = readcmd(0, 1, ptr);
+		}
+		*ptr++ = '\n'; *ptr = '\0';
+		m_dev->write(m_buf, ptr-m_buf);
+		DBGPRINTF(">> %s\n", m_buf);
+
+		try {
+			for(k=nw; k<nw+ln; k++)
+				if (!ops[k].m_write)
+					ops[k].m_data = readword();
+			readidle();
+		} catch(BUSERR b) {
+			DBGPRINTF("IOSEQ::BUSERR, access %d\n", k);
+			// Whatever state the address was left in, it's no
+			// longer known
+			m_addr_set = false;
+			return (k < nw+ln) ? k : nw+ln-1;
+		}
+
+		nw += ln;
+	}
+
+	return len;
+}
+
 /*
  * readword()
  *
@@ -744,7 +875,6 @@ void	TTYBUS::readidle(void) {
 
 	while((!found_start)&&(m_dev->available())
 			&&((nr=lclreadcode(&m_buf[0], 1))>0)) {
-		nr = lclreadcode(&m_buf[0], 1);
 		sixbits = chardec(m_buf[0]);
 
 		if (sixbits&(~0x03f)) {
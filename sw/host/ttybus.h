@@ -101,7 +101,8 @@ private:
 
 	int	lclread(char *buf, int len);
 	int	lclreadcode(char *buf, int len);
-	char	*encode_address(const BUSW a);
+	char	*encode_address(const BUSW a, char *buf);
+	char	*encode_write(const BUSW val, const int p, char *buf);
 	char	*readcmd(const int inc, const int len, char *buf);
 public:
 	TTYBUS(LLCOMMSI *comms) : m_dev(comms) { init(); }
@@ -120,6 +121,9 @@ public:
 	void	readz( const BUSW a, const int len, BUSW *buf);
 	void	writei(const BUSW a, const int len, const BUSW *buf);
 	void	writez(const BUSW a, const int len, const BUSW *buf);
+	void	writeread(const BUSW wa, const BUSW *wv, const BUSW ra,
+			const int len, BUSW *buf);
+	int	ioseq(const int len, BUSOP *ops);
 	bool	poll(void) { return m_interrupt_flag; };
 	void	usleep(unsigned msec); // Sleep until interrupt
 	void	wait(void); // Sleep until interrupt
@@ -8,6 +8,11 @@
 //		and write wishbone registers one at a time.  Thus this program
 //	implements readio() and writeio() but nothing more.
 //
+//	In script mode (-s), a whole series of reads, writes, polls, sleeps,
+//	and dumps are read from a file (or stdin) and executed within one
+//	session.  Runs of reads and writes are pipelined together (ioseq()),
+//	rather than waiting on a round trip for each.
+//
 //
 // Creator:	Dan Gisselquist, Ph.D.
 //		Gisselquist Technology, LLC
@@ -46,6 +51,9 @@
 #include <string.h>
 #include <signal.h>
 #include <assert.h>
+#include <time.h>
+
+#include <vector>
 
 #include "port.h"
 #include "regdefs.h"
@@ -70,7 +78,9 @@ bool	isvalue(const char *v) {
 	if (*ptr == '0') {
 		ptr++;
 		if (tolower(*ptr) == 'x')
-			ptr++;
+			return isxdigit(ptr[1]);
+		// A lone zero is still a value
+		return true;
 	}
 
 	return (isdigit(*ptr));
@@ -99,8 +109,10 @@ unsigned getmap_address(const char *map_fname, const char *name) {
 			continue;
 		if (!isvalue(astr))
 			continue;
-		if (0 == strcasecmp(nstr, name))
+		if (0 == strcasecmp(nstr, name)) {
+			fclose(fmp);
 			return strtoul(astr, NULL, 0);
+		}
 	}
 	
 	fclose(fmp);
@@ -131,16 +143,312 @@ char	*getmap_name(const char *map_fname, const unsigned val) {
 			continue;
 		if (!isvalue(astr))
 			continue;
-		if (strtoul(astr, NULL, 0) == val)
+		if (strtoul(astr, NULL, 0) == val) {
+			fclose(fmp);
 			return strdup(nstr);
+		}
 	}
 	
 	fclose(fmp);
 	return NULL;
 }
 
+// Resolve an address, given either as a number or as a register name--from
+// either the map file, if given, or regdefs.  Returns false if there's no
+// such register.
+bool	lookup_address(const char *map_file, const char *named_address,
+		unsigned &address, const char *&nm) {
+	const	REGNAME	*r;
+
+	nm = NULL;
+	if (isvalue(named_address)) {
+		address = strtoul(named_address, NULL, 0);
+		if (map_file)
+			nm = getmap_name(map_file, address);
+	} else if ((map_file)&&((address = getmap_address(map_file,
+				named_address)) != 0)
+			&&((nm = getmap_name(map_file, address)) != NULL)) {
+		;
+	} else if ((r = regbyname(named_address)) != NULL) {
+		address = r->m_addr;
+#ifdef	R_ZIPCTRL
+	} else if (strcasecmp(named_address, "CPU")==0) {
+		address = R_ZIPCTRL;
+#endif	// R_ZIPCTRL
+#ifdef	R_ZIPDATA
+	} else if (strcasecmp(named_address, "CPUD")==0) {
+		address = R_ZIPDATA;
+#endif	// R_ZIPDATA
+	} else
+		return false;
+
+	if (nm == NULL)
+		nm = addrname(address);
+	if (nm == NULL)
+		nm = "";
+	return true;
+}
+
+//
+// Reporting results
+//
+typedef	enum { OUT_TEXT, OUT_CSV, OUT_JSON } OUTFMT;
+
+OUTFMT	out_format = OUT_TEXT;
+bool	use_decimal = false;
+int	nreports = 0;
+
+void	report_start(void) {
+	if (out_format == OUT_CSV)
+		printf("op,address,name,value,status\n");
+	else if (out_format == OUT_JSON)
+		printf("[");
+}
+
+void	report_end(void) {
+	if (out_format == OUT_JSON)
+		printf("%s]\n", (nreports > 0) ? "\n" : "");
+	fflush(stdout);
+}
+
+// Report one access.  status is NULL if the access succeeded.
+void	report(const char *op, unsigned address, const char *nm,
+		FPGA::BUSW v, const char *status) {
+	bool	wr = (op[0] == 'w');
+
+	nreports++;
+	if (out_format == OUT_CSV) {
+		printf("%s,0x%08x,%s,", op, address, nm);
+		if (use_decimal)
+			printf("%d", v);
+		else
+			printf("0x%08x", v);
+		printf(",%s\n", (status) ? status : "ok");
+	} else if (out_format == OUT_JSON) {
+		printf("%s\n  { \"op\": \"%s\", \"address\": %u, \"name\": \"",
+			(nreports > 1) ? ",":"", op, address);
+		for(const char *p = nm; *p; p++) {
+			if ((*p == '\"')||(*p == '\\'))
+				putchar('\\');
+			putchar(*p);
+		}
+		printf("\", \"value\": %u, \"status\": \"%s\" }",
+			v, (status) ? status : "ok");
+	} else if ((status)&&(strcmp(status, "timeout") != 0)) {
+		printf("%08x (%8s) : %s\n", address, nm, status);
+	} else if (wr) {
+		printf("%08x (%8s)-> %08x\n", address, nm, v);
+	} else if (use_decimal) {
+		printf("%d%s\n", v, (status) ? " (timeout)" : "");
+	} else {
+		unsigned char a, b, c, d;
+		a = (v>>24)&0x0ff;
+		b = (v>>16)&0x0ff;
+		c = (v>> 8)&0x0ff;
+		d = (v    )&0x0ff;
+		printf("%08x (%8s) : [%c%c%c%c] %08x%s\n", address, nm, 
+			isgraph(a)?a:'.', isgraph(b)?b:'.',
+			isgraph(c)?c:'.', isgraph(d)?d:'.', v,
+			(status) ? " (timeout)" : "");
+	}
+}
+
+//
+// Script mode
+//
+// Reads and writes are queued, together with the names they were given, and
+// only issued once something other than a read or write comes along, once
+// the queue fills, or at the end of the script.
+//
+std::vector<BUSOP>		pending;
+std::vector<const char *>	pending_names;
+bool	script_failed = false;
+
+void	flush_pending(void) {
+	int	ndone;
+
+	if (pending.size() == 0)
+		return;
+	try {
+		ndone = m_fpga->ioseq(pending.size(), &pending[0]);
+	} catch(const char *er) {
+		printf("Caught bug: %s\n", er);
+		exit(EXIT_FAILURE);
+	}
+
+	for(int k=0; k<(int)pending.size(); k++) {
+		if (k > ndone)
+			break;
+		report((pending[k].m_write) ? "write" : "read",
+			pending[k].m_addr, pending_names[k],
+			pending[k].m_data, (k == ndone) ? "BUS-ERROR" : NULL);
+	} if (ndone < (int)pending.size())
+		script_failed = true;
+
+	pending.clear();
+	pending_names.clear();
+}
+
+void	queue_op(bool wr, unsigned address, const char *nm, FPGA::BUSW v) {
+	const	unsigned	MAXPENDING = 1024;
+	BUSOP	op;
+
+	op.m_addr  = address;
+	op.m_data  = v;
+	op.m_write = wr;
+	pending.push_back(op);
+	pending_names.push_back(nm);
+	if (pending.size() >= MAXPENDING)
+		flush_pending();
+}
+
+double	now_ms(void) {
+	struct	timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+void	script_error(const char *fname, int lineno, const char *msg,
+		const char *arg) {
+	flush_pending();
+	report_end();
+	fprintf(stderr, "%s:%d: %s%s%s\n", fname, lineno, msg,
+		(arg) ? ", " : "", (arg) ? arg : "");
+	exit(EXIT_FAILURE);
+}
+
+void	run_script(const char *fname, const char *map_file) {
+	FILE	*fp;
+	char	line[512];
+	int	lineno = 0;
+	bool	interactive;
+
+	if (strcmp(fname, "-")==0) {
+		fp = stdin;
+		fname = "(stdin)";
+	} else if (NULL == (fp = fopen(fname, "r"))) {
+		fprintf(stderr, "ERR: Could not open script file, %s\n", fname);
+		perror("O/S Err:");
+		exit(EXIT_FAILURE);
+	} interactive = isatty(fileno(fp));
+
+	report_start();
+	while((!script_failed)&&(fgets(line, sizeof(line), fp))) {
+		char		*tok[6], *cmd;
+		int		ntok = 0;
+		unsigned	address;
+		const char	*nm;
+
+		lineno++;
+		if (NULL != (cmd = strchr(line, '#')))
+			*cmd = '\0';
+		for(cmd = strtok(line, " \t\n,"); (cmd)&&(ntok < 6);
+				cmd = strtok(NULL, " \t\n,"))
+			tok[ntok++] = cmd;
+		if (ntok == 0)
+			continue;
+		cmd = tok[0];
+
+		if ((strcasecmp(cmd, "read")==0)||(strcasecmp(cmd, "r")==0)) {
+			if (ntok != 2)
+				script_error(fname, lineno, "Usage: read <address>", NULL);
+			if (!lookup_address(map_file, tok[1], address, nm))
+				script_error(fname, lineno, "Unknown register", tok[1]);
+			queue_op(false, address, nm, 0);
+		} else if ((strcasecmp(cmd, "write")==0)
+				||(strcasecmp(cmd, "w")==0)) {
+			if ((ntok != 3)||(!isvalue(tok[2])))
+				script_error(fname, lineno, "Usage: write <address> <value>", NULL);
+			if (!lookup_address(map_file, tok[1], address, nm))
+				script_error(fname, lineno, "Unknown register", tok[1]);
+			queue_op(true, address, nm, strtoul(tok[2], NULL, 0));
+		} else if (strcasecmp(cmd, "poll")==0) {
+			FPGA::BUSW	value, mask = -1, v = 0;
+			double		timeout_ms = 1000, start;
+			bool		matched = false;
+
+			if ((ntok < 3)||(ntok > 5))
+				script_error(fname, lineno, "Usage: poll <address> <value> [<mask> [<timeout-ms>]]", NULL);
+			if (!lookup_address(map_file, tok[1], address, nm))
+				script_error(fname, lineno, "Unknown register", tok[1]);
+			value = strtoul(tok[2], NULL, 0);
+			if (ntok > 3)
+				mask = strtoul(tok[3], NULL, 0);
+			if (ntok > 4)
+				timeout_ms = atof(tok[4]);
+
+			flush_pending();
+			start = now_ms();
+			try {
+				do {
+					v = m_fpga->readio(address);
+					matched = ((v & mask) == (value & mask));
+				} while((!matched)&&(now_ms()-start < timeout_ms));
+				report("poll", address, nm, v,
+					(matched) ? NULL : "timeout");
+			} catch(BUSERR b) {
+				report("poll", address, nm, 0, "BUS-ERROR");
+				matched = false;
+			} script_failed = !matched;
+		} else if (strcasecmp(cmd, "sleep")==0) {
+			if (ntok != 2)
+				script_error(fname, lineno, "Usage: sleep <ms>", NULL);
+			flush_pending();
+			fflush(stdout);
+			usleep((useconds_t)(atof(tok[1]) * 1000));
+		} else if (strcasecmp(cmd, "dump")==0) {
+			int	len;
+
+			if ((ntok != 3)||(!isvalue(tok[2])))
+				script_error(fname, lineno, "Usage: dump <address> <nwords>", NULL);
+			if (!lookup_address(map_file, tok[1], address, nm))
+				script_error(fname, lineno, "Unknown register", tok[1]);
+			len = strtoul(tok[2], NULL, 0);
+			if (len <= 0)
+				continue;
+			flush_pending();
+
+			FPGA::BUSW	*buf = new FPGA::BUSW[len];
+			try {
+				m_fpga->readi(address, len, buf);
+				for(int k=0; k<len; k++) {
+					const char *wnm = addrname(address+4*k);
+					report("read", address+4*k,
+						(wnm) ? wnm : "", buf[k], NULL);
+				}
+			} catch(BUSERR b) {
+				report("dump", b.addr, "", 0, "BUS-ERROR");
+				script_failed = true;
+			} delete[] buf;
+		} else if (lookup_address(map_file, cmd, address, nm)) {
+			// The same "address [value]" as on the command line
+			if (ntok == 1)
+				queue_op(false, address, nm, 0);
+			else if ((ntok == 2)&&(isvalue(tok[1])))
+				queue_op(true, address, nm,
+					strtoul(tok[1], NULL, 0));
+			else
+				script_error(fname, lineno, "Usage: <address> [<value>]", NULL);
+		} else
+			script_error(fname, lineno, "Unknown command", cmd);
+
+		// Don't leave someone typing at us waiting on their answer
+		if (interactive) {
+			flush_pending();
+			fflush(stdout);
+		}
+	}
+
+	flush_pending();
+	report_end();
+	if (fp != stdin)
+		fclose(fp);
+}
+
 void	usage(void) {
-	printf("USAGE: wbregs [-d] address [value]\n"
+	printf("USAGE: wbregs [-d] [-m <map-file>] [-o <text|csv|json>] address [value]\n"
+"       wbregs [-d] [-m <map-file>] [-o <text|csv|json>] -s <script>\n"
 "\n"
 "\tWBREGS stands for Wishbone registers.  It is designed to allow a\n"
 "\tuser to peek and poke at registers within a given FPGA design, so\n"
@@ -151,6 +459,25 @@ void	usage(void) {
 "\t-d\tIf given, specifies the value returned should be in decimal,\n"
 "\t\trather than hexadecimal.\n"
 "\n"
+"\t-m <map-file>\tLook up names in the given map file, before\n"
+"\t\tlooking in regdefs.cpp\n"
+"\n"
+"\t-o <format>\tReport results as text (the default), CSV, or as a\n"
+"\t\tJSON array of objects\n"
+"\n"
+"\t-s <script>\tRead a series of commands, one per line, from the\n"
+"\t\tgiven file, or from stdin if the file is -.  Commands are:\n"
+"\t\t  read <address>\n"
+"\t\t  write <address> <value>\n"
+"\t\t  poll <address> <value> [<mask> [<timeout-ms>]]\n"
+"\t\t  sleep <ms>\n"
+"\t\t  dump <address> <nwords>\n"
+"\t\t  <address> [<value>]\n"
+"\t\tAnything following a # is a comment.  Runs of reads and\n"
+"\t\twrites are pipelined together.  The script stops at the\n"
+"\t\tfirst bus error or poll timeout.  Writes aren't waited on,\n"
+"\t\tso a failed write may only be reported at a later read.\n"
+"\n"
 "\tAddress is either a 32-bit value with the syntax of strtoul, or a\n"
 "\tregister name.  Register names can be found in regdefs.cpp\n"
 "\n"
@@ -161,8 +488,7 @@ void	usage(void) {
 
 int main(int argc, char **argv) {
 	int	skp=0;
-	bool	use_decimal = false;
-	char	*map_file = NULL;
+	char	*map_file = NULL, *script_file = NULL;
 
 	skp=1;
 	for(int argn=0; argn<argc-skp; argn++) {
@@ -175,7 +501,31 @@ int main(int argc, char **argv) {
 					exit(EXIT_SUCCESS);
 				}
 				map_file = argv[argn+skp+1];
-				skp++; argn--;
+				skp++;
+			} else if (argv[argn+skp][1] == 'o') {
+				if (argn+skp+1 >= argc) {
+					fprintf(stderr, "ERR: No output format given\n");
+					exit(EXIT_FAILURE);
+				}
+				const char *fmt = argv[argn+skp+1];
+				if (strcasecmp(fmt, "csv")==0)
+					out_format = OUT_CSV;
+				else if (strcasecmp(fmt, "json")==0)
+					out_format = OUT_JSON;
+				else if (strcasecmp(fmt, "text")==0)
+					out_format = OUT_TEXT;
+				else {
+					fprintf(stderr, "ERR: Unknown output format, %s\n", fmt);
+					exit(EXIT_FAILURE);
+				}
+				skp++;
+			} else if (argv[argn+skp][1] == 's') {
+				if (argn+skp+1 >= argc) {
+					fprintf(stderr, "ERR: No script file given\n");
+					exit(EXIT_FAILURE);
+				}
+				script_file = argv[argn+skp+1];
+				skp++;
 			} else {
 				usage();
 				exit(EXIT_SUCCESS);
@@ -185,12 +535,10 @@ int main(int argc, char **argv) {
 			argv[argn] = argv[argn+skp];
 	} argc -= skp;
 
-	FPGAOPEN(m_fpga);
-
-	signal(SIGSTOP, closeup);
-	signal(SIGHUP, closeup);
-
-	if ((argc < 1)||(argc > 2)) {
+	if ((script_file)&&(argc != 0)) {
+		printf("USAGE: wbregs -s script\n");
+		exit(-1);
+	} else if ((!script_file)&&((argc < 1)||(argc > 2))) {
 		// usage();
 		printf("USAGE: wbregs address [value]\n");
 		exit(-1);
@@ -202,48 +550,35 @@ int main(int argc, char **argv) {
 		exit(EXIT_FAILURE);
 	}
 
+	FPGAOPEN(m_fpga);
+
+	signal(SIGSTOP, closeup);
+	signal(SIGHUP, closeup);
+
+	if (script_file) {
+		run_script(script_file, map_file);
+		if (m_fpga->poll())
+			fprintf(stderr, "FPGA was interrupted\n");
+		delete	m_fpga;
+		exit((script_failed) ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+
 	const char *nm = NULL, *named_address = argv[0];
 	unsigned address, value;
 
-	if (isvalue(named_address)) {
-		// printf("Named address = %s\n", named_address);
-		address = strtoul(named_address, NULL, 0);
-		if (map_file)
-			nm = getmap_name(map_file, address);
-		if (nm == NULL)
-			nm = addrname(address);
-	} else if (map_file) {
-		address = getmap_address(map_file, named_address);
-		nm = getmap_name(map_file, address);
-		if (!nm) {
-			address = addrdecode(named_address);
-			nm = addrname(address);
-		}
-	} else {
-		address = addrdecode(named_address);
-		nm = addrname(address);
+	if (!lookup_address(map_file, named_address, address, nm)) {
+		fprintf(stderr, "Unknown register: %s\n", named_address);
+		exit(-2);
 	}
 
-	if (NULL == nm)
-		nm = "";
-
+	report_start();
 	if (argc < 2) {
 		FPGA::BUSW	v;
 		try {
-			unsigned char a, b, c, d;
 			v = m_fpga->readio(address);
-			a = (v>>24)&0x0ff;
-			b = (v>>16)&0x0ff;
-			c = (v>> 8)&0x0ff;
-			d = (v    )&0x0ff;
-			if (use_decimal)
-				printf("%d\n", v);
-			else
-			printf("%08x (%8s) : [%c%c%c%c] %08x\n", address, nm, 
-				isgraph(a)?a:'.', isgraph(b)?b:'.',
-				isgraph(c)?c:'.', isgraph(d)?d:'.', v);
+			report("read", address, nm, v, NULL);
 		} catch(BUSERR b) {
-			printf("%08x (%8s) : BUS-ERROR\n", address, nm);
+			report("read", address, nm, 0, "BUS-ERROR");
 		} catch(const char *er) {
 			printf("Caught bug: %s\n", er);
 			exit(EXIT_FAILURE);
@@ -252,18 +587,18 @@ int main(int argc, char **argv) {
 		try {
 			value = strtoul(argv[1], NULL, 0);
 			m_fpga->writeio(address, value);
-			printf("%08x (%8s)-> %08x\n", address, nm, value);
+			report("write", address, nm, value, NULL);
 		} catch(BUSERR b) {
-			printf("%08x (%8s) : BUS-ERR)R\n", address, nm);
+			report("write", address, nm, value, "BUS-ERROR");
+			report_end();
 			exit(EXIT_FAILURE);
 		} catch(const char *er) {
 			printf("Caught bug on write: %s\n", er);
 			exit(EXIT_FAILURE);
 		}
-	}
+	} report_end();
 
 	if (m_fpga->poll())
 		printf("FPGA was interrupted\n");
 	delete	m_fpga;
 }
-
@@ -106,14 +106,40 @@ public:
 	ZIPPY(DEVBUS *fpga) : m_fpga(fpga), m_cursor(0), m_user_break(false),
 		m_show_users_timers(false), m_show_cc(false) {}
 
+	// Read n consecutive words starting at a, as a single burst.  Should
+	// the burst fail, fall back to reading the words one at a time so
+	// that only the words that actually fault are marked as invalid.
+	void	read_burst(const BUSW a, const int n, BUSW *buf, bool *valid) {
+		try {
+			readi(a, n, buf);
+			for(int i=0; i<n; i++)
+				valid[i] = true;
+		} catch(BUSERR be) {
+			for(int i=0; i<n; i++) {
+				try {
+					buf[i] = readio(a+(i<<2));
+					valid[i] = true;
+				} catch(BUSERR be) {
+					valid[i] = false;
+				}
+			}
+		}
+	}
+
 	void	read_raw_state(void) {
+		const	int	NIBURST = 8;
+		BUSW	regs[52], ibuf[NIBURST], sbuf[5], ibase;
+		bool	ivalid[NIBURST], svalid[5];
+		int	nib;
+
 		m_state.m_valid = false;
+		cmd_readv(0, 52, regs);
 		for(int i=0; i<16; i++)
-			m_state.m_sR[i] = cmd_read(i);
+			m_state.m_sR[i] = regs[i];
 		for(int i=0; i<16; i++)
-			m_state.m_uR[i] = cmd_read(i+16);
+			m_state.m_uR[i] = regs[i+16];
 		for(int i=0; i<20; i++)
-			m_state.m_p[i]  = cmd_read(i+32);
+			m_state.m_p[i]  = regs[i+32];
 
 		m_state.m_gie = (m_state.m_sR[14] & 0x020);
 		m_state.m_pc  = (m_state.m_gie) ? (m_state.m_uR[15]):(m_state.m_sR[15]);
@@ -123,49 +149,51 @@ public:
 			m_state.m_imem[0].m_a = m_state.m_last_pc;
 		else
 			m_state.m_imem[0].m_a = m_state.m_pc - 4;
-		try {
-			m_state.m_imem[0].m_d = readio(m_state.m_imem[0].m_a);
-			m_state.m_imem[0].m_valid = true;
-		} catch(BUSERR be) {
-			m_state.m_imem[0].m_valid = false;
-		}
-		m_state.m_imem[1].m_a = m_state.m_pc;
-		try {
-			m_state.m_imem[1].m_d = readio(m_state.m_imem[1].m_a);
-			m_state.m_imem[1].m_valid = true;
-		} catch(BUSERR be) {
-			m_state.m_imem[1].m_valid = false;
-		}
 
-		for(int i=1; i<4; i++) {
-			if (!m_state.m_imem[i].m_valid) {
-				m_state.m_imem[i+1].m_valid = false;
-				m_state.m_imem[i+1].m_a = m_state.m_imem[i].m_a+4;
-				continue;
+		// Most of the time, the instructions we want to show are all
+		// in a row, from just before the PC onwards.  Grab them all
+		// in one burst, and only go back to the bus for those (branch
+		// targets) that fall outside of it.
+		ibase = m_state.m_imem[0].m_a;
+		if ((ibase <= m_state.m_pc)&&(m_state.m_pc-ibase <= 12)) {
+			nib = ((m_state.m_pc - ibase)>>2) + 4;
+		} else {
+			ibase = m_state.m_pc;
+			nib = 4;
+		} read_burst(ibase, nib, ibuf, ivalid);
+
+		m_state.m_imem[1].m_a = m_state.m_pc;
+		for(int i=0; i<5; i++) {
+			SPARSEMEM	*im = &m_state.m_imem[i];
+
+			if (i >= 2) {
+				if (!m_state.m_imem[i-1].m_valid) {
+					im->m_valid = false;
+					im->m_a = m_state.m_imem[i-1].m_a+4;
+					continue;
+				}
+				im->m_a = zop_early_branch(
+					m_state.m_imem[i-1].m_a,
+					m_state.m_imem[i-1].m_d);
 			}
-			m_state.m_imem[i+1].m_a = zop_early_branch(
-					m_state.m_imem[i].m_a,
-					m_state.m_imem[i].m_d);
-			try {
-				m_state.m_imem[i+1].m_d = readio(m_state.m_imem[i+1].m_a);
-				m_state.m_imem[i+1].m_valid = true;
+
+			if ((im->m_a >= ibase)&&(im->m_a - ibase < (BUSW)(nib<<2))
+					&&((im->m_a & 3)==0)) {
+				im->m_d     = ibuf[(im->m_a - ibase)>>2];
+				im->m_valid = ivalid[(im->m_a - ibase)>>2];
+			} else try {
+				im->m_d = readio(im->m_a);
+				im->m_valid = true;
 			} catch(BUSERR be) {
-				m_state.m_imem[i+1].m_valid = false;
+				im->m_valid = false;
 			}
 		}
 
-		m_state.m_smem[0].m_a = m_state.m_sp;
-		for(int i=1; i<5; i++)
-			m_state.m_smem[i].m_a = m_state.m_smem[i-1].m_a+4;
+		read_burst(m_state.m_sp, 5, sbuf, svalid);
 		for(int i=0; i<5; i++) {
-			m_state.m_smem[i].m_valid = true;
-			if (m_state.m_smem[i].m_valid)
-			try {
-				m_state.m_smem[i].m_d = readio(m_state.m_smem[i].m_a);
-				m_state.m_smem[i].m_valid = true;
-			} catch(BUSERR be) {
-				m_state.m_smem[i].m_valid = false;
-			}
+			m_state.m_smem[i].m_a = m_state.m_sp + (i<<2);
+			m_state.m_smem[i].m_d = sbuf[i];
+			m_state.m_smem[i].m_valid = svalid[i];
 		}
 		m_state.m_valid = true;
 	}
@@ -182,6 +210,9 @@ public:
 		return m_fpga->writei(a, len, buf); }
 	void	writez(const BUSW a, const int len, const BUSW *buf) {
 		return m_fpga->writez(a, len, buf); }
+	void	writeread(const BUSW wa, const BUSW *wv, const BUSW ra,
+			const int len, BUSW *buf) {
+		return m_fpga->writeread(wa, wv, ra, len, buf); }
 	bool	poll(void) { return m_fpga->poll(); }
 	void	usleep(unsigned ms) { m_fpga->usleep(ms); }
 	void	wait(void) { m_fpga->wait(); }
@@ -291,6 +322,19 @@ public:
 		return readio(R_ZIPDATA);
 	}
 
+	// Read n consecutive debug registers, starting at a.  The first read
+	// waits for the CPU to halt, just like cmd_read().  Once halted, the
+	// CPU answers register reads without stalling, so the rest can be
+	// sent as one pipelined stream of (select, read) pairs.
+	void	cmd_readv(unsigned int a, int n, BUSW *buf) {
+		BUSW	sel[64];
+
+		buf[0] = cmd_read(a);
+		for(int i=1; i<n; i++)
+			sel[i] = CMD_HALT|((a+i)&0x3f);
+		writeread(R_ZIPCTRL, &sel[1], R_ZIPDATA, n-1, &buf[1]);
+	}
+
 	void	cmd_write(unsigned int a, int v) {
 		int errcount = 0;
 		unsigned int	s;
@@ -4,7 +4,11 @@
 //
 // Project:	OpenArty, an entirely open SoC based upon the Arty platform
 //
-// Purpose:	
+// Purpose:	To read ZipCPU ELF files, for both the host tools and the
+//		simulator.  The file is memory mapped and parsed in place,
+//	so loading a program costs little more than the page faults needed to
+//	touch it.  The symbol table and the DWARF line table (.debug_line,
+//	versions 2-4) are only parsed when first asked for.
 //
 //
 // Creator:	Dan Gisselquist, Ph.D.
@@ -40,17 +44,34 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
-#include <libelf.h>
-#include <assert.h>
-#include <gelf.h>
+#include <elf.h>
 #include <string.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "zipelf.h"
 
+// The address of field FLD, of a structure of type TYP, found at P
+#define	ELFFLD(P, TYP, FLD)	((const char *)(P) + offsetof(TYP, FLD))
+
+// DWARF line number program opcodes
+enum {
+	DW_LNS_copy = 1, DW_LNS_advance_pc, DW_LNS_advance_line,
+	DW_LNS_set_file, DW_LNS_set_column, DW_LNS_negate_stmt,
+	DW_LNS_set_basic_block, DW_LNS_const_add_pc, DW_LNS_fixed_advance_pc
+};
+
+enum {
+	DW_LNE_end_sequence = 1, DW_LNE_set_address, DW_LNE_define_file
+};
+
 bool
 iself(const char *fname)
 {
@@ -67,195 +88,492 @@ iself(const char *fname)
 	return 	ret;
 }
 
-void	elfread(const char *fname, unsigned &entry, ELFSECTION **&sections)
-{
-	Elf	*e;
-	int	fd, i;
-	size_t	n;
-	char	*id;
-	Elf_Kind	ek;
-	GElf_Ehdr	ehdr;
-	GElf_Phdr	phdr;
-	const	bool	dbg = false;
-
-	if (elf_version(EV_CURRENT) == EV_NONE) {
-		fprintf(stderr, "ELF library initialization err, %s\n", elf_errmsg(-1));
+uint16_t	ELFFILE::get16(const void *vp) const {
+	const unsigned char	*p = (const unsigned char *)vp;
+
+	if (m_big)
+		return (p[0]<<8) | p[1];
+	return (p[1]<<8) | p[0];
+}
+
+uint32_t	ELFFILE::get32(const void *vp) const {
+	const unsigned char	*p = (const unsigned char *)vp;
+
+	if (m_big)
+		return ((uint32_t)p[0]<<24) | (p[1]<<16) | (p[2]<<8) | p[3];
+	return ((uint32_t)p[3]<<24) | (p[2]<<16) | (p[1]<<8) | p[0];
+}
+
+static	uint32_t	uleb(const unsigned char *&p, const unsigned char *end) {
+	uint32_t	v = 0;
+	unsigned	shift = 0;
+
+	while(p < end) {
+		unsigned char	b = *p++;
+		if (shift < 32)
+			v |= (uint32_t)(b & 0x7f) << shift;
+		shift += 7;
+		if ((b & 0x80) == 0)
+			break;
+	} return v;
+}
+
+static	int32_t	sleb(const unsigned char *&p, const unsigned char *end) {
+	uint32_t	v = 0;
+	unsigned	shift = 0;
+	unsigned char	b = 0;
+
+	while(p < end) {
+		b = *p++;
+		if (shift < 32)
+			v |= (uint32_t)(b & 0x7f) << shift;
+		shift += 7;
+		if ((b & 0x80) == 0)
+			break;
+	} if ((shift < 32)&&(b & 0x40))
+		v |= -(1u << shift);
+	return (int32_t)v;
+}
+
+ELFFILE::ELFFILE(const char *fname) : m_map(NULL), m_size(0), m_big(true),
+		m_entry(0), m_nsegs(0), m_nsyms(-1), m_nlines(-1),
+		m_segs(NULL), m_syms(NULL), m_lines(NULL) {
+	int		fd;
+	struct stat	sb;
+	uint32_t	phoff;
+	unsigned	phentsize, phnum;
+
+	if ((fd = open(fname, O_RDONLY, 0)) < 0) {
+		fprintf(stderr, "Could not open %s\n", fname);
 		perror("O/S Err:");
 		exit(EXIT_FAILURE);
-	} if ((fd = open(fname, O_RDONLY, 0)) < 0) {
-		fprintf(stderr, "Could not open %s\n", fname);
+	} if (fstat(fd, &sb) != 0) {
+		fprintf(stderr, "Could not stat %s\n", fname);
 		perror("O/S Err:");
 		exit(EXIT_FAILURE);
-	} if ((e = elf_begin(fd, ELF_C_READ, NULL))==NULL) {
-		fprintf(stderr, "Could not run elf_begin, %s\n", elf_errmsg(-1));
+	} if ((size_t)sb.st_size < sizeof(Elf32_Ehdr)) {
+		fprintf(stderr, "%s is too short to be an ELF file\n", fname);
 		exit(EXIT_FAILURE);
 	}
 
-	ek = elf_kind(e);
-	if (ek == ELF_K_ELF) {
-		; // This is the kind of file we should expect
-	} else if (ek == ELF_K_AR) {
-		fprintf(stderr, "Cannot run an archive!\n");
-		exit(EXIT_FAILURE);
-	} else if (ek == ELF_K_NONE) {
-		;
-	} else {
-		fprintf(stderr, "Unexpected ELF file kind!\n");
+	m_size = sb.st_size;
+	m_map = (char *)mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (m_map == MAP_FAILED) {
+		fprintf(stderr, "Could not map %s\n", fname);
+		perror("O/S Err:");
 		exit(EXIT_FAILURE);
-	}
+	} close(fd);
 
-	if (gelf_getehdr(e, &ehdr) == NULL) {
-		fprintf(stderr, "getehdr() failed: %s\n", elf_errmsg(-1));
-		exit(EXIT_FAILURE);
-	} if ((i=gelf_getclass(e)) == ELFCLASSNONE) {
-		fprintf(stderr, "getclass() failed: %s\n", elf_errmsg(-1));
+	if (memcmp(m_map, ELFMAG, SELFMAG) != 0) {
+		fprintf(stderr, "%s is not an ELF file\n", fname);
 		exit(EXIT_FAILURE);
-	} if ((id = elf_getident(e, NULL)) == NULL) {
-		fprintf(stderr, "getident() failed: %s\n", elf_errmsg(-1));
-		exit(EXIT_FAILURE);
-	} if (i != ELFCLASS32) {
+	} if (m_map[EI_CLASS] != ELFCLASS32) {
 		fprintf(stderr, "This is a 64-bit ELF file, ZipCPU ELF files are all 32-bit\n");
 		exit(EXIT_FAILURE);
 	}
 
-	if (dbg) {
-	printf("ELF File header\n");
-	printf("    %-20s 0x%jx\n", "e_type", (uintmax_t)ehdr.e_type);
-	printf("    %-20s 0x%jx\n", "e_machine", (uintmax_t)ehdr.e_machine);
-	printf("    %-20s 0x%jx\n", "e_version", (uintmax_t)ehdr.e_version);
-	printf("    %-20s 0x%jx\n", "e_entry", (uintmax_t)ehdr.e_entry);
-	printf("    %-20s 0x%jx\n", "e_phoff", (uintmax_t)ehdr.e_phoff);
-	printf("    %-20s 0x%jx\n", "e_shoff", (uintmax_t)ehdr.e_shoff);
-	printf("    %-20s 0x%jx\n", "e_flags", (uintmax_t)ehdr.e_flags);
-	printf("    %-20s 0x%jx\n", "e_ehsize", (uintmax_t)ehdr.e_ehsize);
-	printf("    %-20s 0x%jx\n", "e_phentsize", (uintmax_t)ehdr.e_phentsize);
-	printf("    %-20s 0x%jx\n", "e_shentsize", (uintmax_t)ehdr.e_shentsize);
-	printf("\n");
-	}
-
+	m_big = (m_map[EI_DATA] == ELFDATA2MSB);
 
 	// Check whether or not this is an ELF file for the ZipCPU ...
-	if (ehdr.e_machine != 0x0dad1) {
+	if (get16(ELFFLD(m_map, Elf32_Ehdr, e_machine)) != 0x0dad1) {
 		fprintf(stderr, "This is not a ZipCPU/8 ELF file\n");
 		exit(EXIT_FAILURE);
 	}
 
-	// Get our entry address
-	entry = ehdr.e_entry;
-
+	m_entry   = get32(ELFFLD(m_map, Elf32_Ehdr, e_entry));
+	phoff     = get32(ELFFLD(m_map, Elf32_Ehdr, e_phoff));
+	phentsize = get16(ELFFLD(m_map, Elf32_Ehdr, e_phentsize));
+	phnum     = get16(ELFFLD(m_map, Elf32_Ehdr, e_phnum));
 
-	// Now, let's go look at the program header
-	if (elf_getphdrnum(e, &n) != 0) {
-		fprintf(stderr, "elf_getphdrnum() failed: %s\n", elf_errmsg(-1));
+	if ((phnum > 0)&&((phentsize < sizeof(Elf32_Phdr))
+			||(phoff + (size_t)phnum * phentsize > m_size))) {
+		fprintf(stderr, "%s has an invalid program header table\n", fname);
 		exit(EXIT_FAILURE);
 	}
 
-assert(n != 0);
+	m_segs = new ELFSEGMENT[phnum+1];
+	for(unsigned i=0; i<phnum; i++) {
+		const char	*ph = &m_map[phoff + i * phentsize];
+		ELFSEGMENT	*seg = &m_segs[m_nsegs];
+		uint32_t	offset, filesz, memsz;
 
-	unsigned total_octets = 0, current_offset=0, current_section=0;
-	for(i=0; i<(int)n; i++) {
-		total_octets += sizeof(ELFSECTION *)+sizeof(ELFSECTION);
+		if (get32(ELFFLD(ph, Elf32_Phdr, p_type)) != PT_LOAD)
+			continue;
+		offset = get32(ELFFLD(ph, Elf32_Phdr, p_offset));
+		filesz = get32(ELFFLD(ph, Elf32_Phdr, p_filesz));
+		memsz  = get32(ELFFLD(ph, Elf32_Phdr, p_memsz));
 
-		if (gelf_getphdr(e, i, &phdr) != &phdr) {
-			fprintf(stderr, "getphdr() failed: %s\n", elf_errmsg(-1));
+		// Only keep segments with something to load.  A zero length
+		// segment marks the end of the list.
+		if (filesz == 0)
+			continue;
+		if (filesz > memsz)
+			filesz = memsz;
+		if ((size_t)offset + filesz > m_size) {
+			fprintf(stderr, "Segment %d extends past the end of %s\n",
+				i, fname);
 			exit(EXIT_FAILURE);
 		}
 
-		if (dbg) {
-		printf("  Section %d:\n", i);
-		printf("    %-20s 0x%x\n", "p_type",   phdr.p_type);
-		printf("    %-20s 0x%jx\n", "p_offset", phdr.p_offset);
-		printf("    %-20s 0x%jx\n", "p_vaddr",  phdr.p_vaddr);
-		printf("    %-20s 0x%jx\n", "p_paddr",  phdr.p_paddr);
-		printf("    %-20s 0x%jx\n", "p_filesz", phdr.p_filesz);
-		printf("    %-20s 0x%jx\n", "p_memsz",  phdr.p_memsz);
-		printf("    %-20s 0x%x [", "p_flags",  phdr.p_flags);
-
-		if (phdr.p_flags & PF_X)	printf(" Execute");
-		if (phdr.p_flags & PF_R)	printf(" Read");
-		if (phdr.p_flags & PF_W)	printf(" Write");
-		printf("]\n");
-		printf("    %-20s 0x%jx\n", "p_align", phdr.p_align);
-		}
-
-		total_octets += phdr.p_memsz;
+		seg->m_start = get32(ELFFLD(ph, Elf32_Phdr, p_paddr));
+		seg->m_len   = filesz;
+		seg->m_memsz = memsz;
+		seg->m_data  = &m_map[offset];
+		m_nsegs++;
 	}
 
-	char	*d = (char *)malloc(total_octets + sizeof(ELFSECTION)+sizeof(ELFSECTION *));
-	memset(d, 0, total_octets);
+	m_segs[m_nsegs].m_start = 0;
+	m_segs[m_nsegs].m_len   = 0;
+	m_segs[m_nsegs].m_memsz = 0;
+	m_segs[m_nsegs].m_data  = NULL;
+}
+
+ELFFILE::~ELFFILE(void) {
+	delete[] m_segs;
+	delete[] m_syms;
+	delete[] m_lines;
+	munmap(m_map, m_size);
+}
+
+//
+// section
+//
+// Returns a pointer to the contents of the named section, or NULL if there's
+// no such section in the file.
+//
+const char	*ELFFILE::section(const char *name, uint32_t &len) const {
+	uint32_t	shoff = get32(ELFFLD(m_map, Elf32_Ehdr, e_shoff));
+	unsigned	shentsize= get16(ELFFLD(m_map,Elf32_Ehdr,e_shentsize)),
+			shnum    = get16(ELFFLD(m_map, Elf32_Ehdr, e_shnum)),
+			shstrndx = get16(ELFFLD(m_map, Elf32_Ehdr, e_shstrndx));
+	const char	*sh, *names;
+	uint32_t	nameoff, namelen;
+
+	len = 0;
+	if ((shnum == 0)||(shstrndx >= shnum)
+			||(shentsize < sizeof(Elf32_Shdr))
+			||(shoff + (size_t)shnum * shentsize > m_size))
+		return NULL;
+
+	sh = &m_map[shoff + shstrndx * shentsize];
+	nameoff = get32(ELFFLD(sh, Elf32_Shdr, sh_offset));
+	namelen = get32(ELFFLD(sh, Elf32_Shdr, sh_size));
+	if ((size_t)nameoff + namelen > m_size)
+		return NULL;
+	names = &m_map[nameoff];
+
+	for(unsigned i=0; i<shnum; i++) {
+		uint32_t	nm, offset, size;
+
+		sh = &m_map[shoff + i * shentsize];
+		nm = get32(ELFFLD(sh, Elf32_Shdr, sh_name));
+		if ((nm >= namelen)||(strncmp(&names[nm], name, namelen-nm)!=0))
+			continue;
+		if (get32(ELFFLD(sh, Elf32_Shdr, sh_type)) == SHT_NOBITS)
+			return NULL;
+		offset = get32(ELFFLD(sh, Elf32_Shdr, sh_offset));
+		size   = get32(ELFFLD(sh, Elf32_Shdr, sh_size));
+		if ((size_t)offset + size > m_size)
+			return NULL;
+		len = size;
+		return &m_map[offset];
+	} return NULL;
+}
 
-	ELFSECTION **r = sections = (ELFSECTION **)d;
-	current_offset = (n+1)*sizeof(ELFSECTION *);
-	current_section = 0;
+void	ELFFILE::readsymbols(void) {
+	uint32_t	shoff = get32(ELFFLD(m_map, Elf32_Ehdr, e_shoff));
+	unsigned	shentsize= get16(ELFFLD(m_map,Elf32_Ehdr,e_shentsize)),
+			shnum    = get16(ELFFLD(m_map, Elf32_Ehdr, e_shnum));
+	std::vector<ELFSYMBOL>	syms;
 
-	for(i=0; i<(int)n; i++) {
-		r[i] = (ELFSECTION *)(&d[current_offset]);
+	m_nsyms = 0;
+	if ((shnum == 0)||(shentsize < sizeof(Elf32_Shdr))
+			||(shoff + (size_t)shnum * shentsize > m_size))
+		return;
 
-		if (gelf_getphdr(e, i, &phdr) != &phdr) {
-			fprintf(stderr, "getphdr() failed: %s\n", elf_errmsg(-1));
-			exit(EXIT_FAILURE);
-		}
+	for(unsigned i=0; i<shnum; i++) {
+		const char	*sh = &m_map[shoff + i * shentsize], *strsh;
+		uint32_t	offset, size, entsize, link, stroff, strsz;
 
-		if (dbg) {
-		printf("  Section %d:\n", i);
-		printf("    %-20s 0x%jx\n", "p_offset", phdr.p_offset);
-		printf("    %-20s 0x%jx\n", "p_vaddr",  phdr.p_vaddr);
-		printf("    %-20s 0x%jx\n", "p_paddr",  phdr.p_paddr);
-		printf("    %-20s 0x%jx\n", "p_filesz", phdr.p_filesz);
-		printf("    %-20s 0x%jx\n", "p_memsz",  phdr.p_memsz);
-		printf("    %-20s 0x%x [", "p_flags",  phdr.p_flags);
-
-		if (phdr.p_flags & PF_X)	printf(" Execute");
-		if (phdr.p_flags & PF_R)	printf(" Read");
-		if (phdr.p_flags & PF_W)	printf(" Write");
-		printf("]\n");
-
-		printf("    %-20s 0x%jx\n", "p_align", phdr.p_align);
-		}
+		if (get32(ELFFLD(sh, Elf32_Shdr, sh_type)) != SHT_SYMTAB)
+			continue;
+		offset  = get32(ELFFLD(sh, Elf32_Shdr, sh_offset));
+		size    = get32(ELFFLD(sh, Elf32_Shdr, sh_size));
+		entsize = get32(ELFFLD(sh, Elf32_Shdr, sh_entsize));
+		link    = get32(ELFFLD(sh, Elf32_Shdr, sh_link));
+		if ((entsize < sizeof(Elf32_Sym))||(link >= shnum)
+				||((size_t)offset + size > m_size))
+			continue;
 
-		if (phdr.p_filesz == 0)
+		// The string table holding this table's names
+		strsh  = &m_map[shoff + link * shentsize];
+		stroff = get32(ELFFLD(strsh, Elf32_Shdr, sh_offset));
+		strsz  = get32(ELFFLD(strsh, Elf32_Shdr, sh_size));
+		if ((size_t)stroff + strsz > m_size)
 			continue;
 
-		// Only create non-zero sized sections
-		// A zero sized section is the mark of the end of the file.
-		current_section++;
+		for(uint32_t k=0; k+entsize <= size; k+=entsize) {
+			const char	*sym = &m_map[offset + k];
+			unsigned char	info = sym[offsetof(Elf32_Sym, st_info)];
+			unsigned	typ  = ELF32_ST_TYPE(info),
+					shndx= get16(ELFFLD(sym, Elf32_Sym, st_shndx));
+			uint32_t	nm   = get32(ELFFLD(sym, Elf32_Sym, st_name));
+			ELFSYMBOL	s;
+
+			// Keep functions, as well as any global labels--such
+			// as _start--from assembly files
+			if ((typ != STT_FUNC)&&((typ != STT_NOTYPE)
+					||(ELF32_ST_BIND(info) != STB_GLOBAL)))
+				continue;
+			if ((shndx == SHN_UNDEF)||(shndx >= SHN_LORESERVE))
+				continue;
+			if ((nm >= strsz)||(memchr(&m_map[stroff+nm], 0,
+					strsz-nm) == NULL))
+				continue;
+
+			s.m_addr = get32(ELFFLD(sym, Elf32_Sym, st_value));
+			s.m_size = get32(ELFFLD(sym, Elf32_Sym, st_size));
+			s.m_name = &m_map[stroff + nm];
+			syms.push_back(s);
+		}
+	}
+
+	std::stable_sort(syms.begin(), syms.end(),
+		[](const ELFSYMBOL &a, const ELFSYMBOL &b) {
+			return a.m_addr < b.m_addr; });
 
-		r[i]->m_start = phdr.p_paddr;
-		r[i]->m_len   = phdr.p_filesz;
+	m_nsyms = syms.size();
+	m_syms  = new ELFSYMBOL[m_nsyms];
+	std::copy(syms.begin(), syms.end(), m_syms);
+}
 
-		current_offset += phdr.p_memsz + sizeof(ELFSECTION);
+int	ELFFILE::nsymbols(void) {
+	if (m_nsyms < 0)
+		readsymbols();
+	return m_nsyms;
+}
 
-		// Now, let's read in our section ...
-		if (lseek(fd, phdr.p_offset, SEEK_SET) < 0) {
-			fprintf(stderr, "Could not seek to file position %08lx\n", phdr.p_offset);
-			perror("O/S Err:");
-			exit(EXIT_FAILURE);
-		} if (phdr.p_filesz > phdr.p_memsz)
-			phdr.p_filesz = 0;
-		if (read(fd, r[i]->m_data, phdr.p_filesz) != (int)phdr.p_filesz) {
-			fprintf(stderr, "Didnt read entire section\n");
-			perror("O/S Err:");
-			exit(EXIT_FAILURE);
+const ELFSYMBOL	*ELFFILE::symbols(void) {
+	if (m_nsyms < 0)
+		readsymbols();
+	return m_syms;
+}
+
+const ELFSYMBOL	*ELFFILE::symbol(const uint32_t addr) {
+	int	lo = 0, hi = nsymbols();
+
+	// Find the last symbol at or below addr
+	while(lo < hi) {
+		int	mid = (lo + hi)/2;
+		if (m_syms[mid].m_addr <= addr)
+			lo = mid+1;
+		else
+			hi = mid;
+	} if (lo == 0)
+		return NULL;
+
+	const ELFSYMBOL	*sym = &m_syms[lo-1];
+	if ((sym->m_size != 0)&&(addr >= sym->m_addr + sym->m_size))
+		return NULL;
+	return sym;
+}
+
+//
+// readlines
+//
+// Runs the DWARF line number program of every unit in .debug_line, keeping
+// every row it produces.  Only versions 2-4, and the 32-bit DWARF format, are
+// understood.  Units in any other format are skipped.
+//
+void	ELFFILE::readlines(void) {
+	std::vector<ELFLINE>	rows;
+	const unsigned char	*p, *end;
+	uint32_t		len;
+
+	m_nlines = 0;
+	p = (const unsigned char *)section(".debug_line", len);
+	if (!p)
+		return;
+	end = p + len;
+
+	while(p + 4 <= end) {
+		const unsigned char	*q, *uend, *prog, *oplens;
+		uint32_t	ulen = get32(p), hlen, addr;
+		unsigned	version, minlen, linerange, opbase, file;
+		int		linebase, line;
+		std::vector<const char *>	dirs, files, filedirs;
+
+		// A length of 0xfffffff0 or more marks 64-bit DWARF
+		if ((ulen >= 0xfffffff0)||(ulen > (size_t)(end - p) - 4))
+			break;
+		q    = p + 4;
+		uend = q + ulen;
+		p    = uend;
+
+		if (q + 2 + 4 > uend)
+			continue;
+		version = get16(q);	q += 2;
+		hlen    = get32(q);	q += 4;
+		if ((version < 2)||(version > 4)||(hlen > (size_t)(uend - q)))
+			continue;
+		prog = q + hlen;
+
+		if (q + ((version >= 4) ? 5 : 4) > prog)
+			continue;
+		minlen    = *q++;
+		if (version >= 4)
+			q++;	// Maximum operations per instruction
+		q++;		// The default is_stmt
+		linebase  = (signed char)*q++;
+		linerange = *q++;
+		opbase    = *q++;
+		oplens    = q;
+		if ((linerange == 0)||(opbase == 0)||(q + opbase-1 > prog))
+			continue;
+		q += opbase-1;
+
+		// Directory zero is the compilation directory
+		dirs.push_back(NULL);
+		while((q < prog)&&(*q)) {
+			dirs.push_back((const char *)q);
+			q += strnlen((const char *)q, prog-q)+1;
+		} q++;
+
+		// Files are numbered from one
+		files.push_back(NULL);
+		filedirs.push_back(NULL);
+		while((q < prog)&&(*q)) {
+			const char	*nm = (const char *)q;
+			unsigned	dir;
+
+			q += strnlen(nm, prog-q)+1;
+			dir = uleb(q, prog);
+			uleb(q, prog);	// Modification time
+			uleb(q, prog);	// File length
+			files.push_back(nm);
+			filedirs.push_back((dir < dirs.size()) ? dirs[dir] : NULL);
 		}
 
-		/*
-		// Next, we need to byte swap it from big to little endian
-		for(unsigned j=0; j<r[i]->m_len; j++)
-			r[i]->m_data[j] = byteswap(r[i]->m_data[j]);
-		*/
-
-/*
-		if (dbg) for(unsigned j=0; j<r[i]->m_len; j++)
-			fprintf(stderr, "ADR[%04x] = %02x\n", r[i]->m_start+j,
-				r[i]->m_data[j] & 0x0ff);
-*/
+		// Run the line number program
+		addr = 0; file = 1; line = 1;
+		q = prog;
+		while(q < uend) {
+			unsigned	op = *q++;
+			bool		emit = false, endseq = false;
+
+			if (op >= opbase) {
+				// A special opcode
+				unsigned	adj = op - opbase;
+				addr += (adj / linerange) * minlen;
+				line += linebase + (int)(adj % linerange);
+				emit = true;
+			} else if (op == 0) {
+				// An extended opcode
+				uint32_t		n = uleb(q, uend);
+				const unsigned char	*next = q + n;
+
+				if ((n == 0)||(n > (size_t)(uend - q)))
+					break;
+				switch(*q) {
+				case DW_LNE_end_sequence:
+					emit = endseq = true;
+					break;
+				case DW_LNE_set_address:
+					if (n == 5)
+						addr = get32(q+1);
+					break;
+				case DW_LNE_define_file: {
+					const unsigned char *f = q+1;
+					const char	*nm = (const char *)f;
+					unsigned	dir;
+
+					f += strnlen(nm, next-f)+1;
+					dir = uleb(f, next);
+					files.push_back(nm);
+					filedirs.push_back((dir < dirs.size())
+						? dirs[dir] : NULL);
+					} break;
+				default:
+					break;
+				} q = next;
+			} else switch(op) {
+				case DW_LNS_copy:
+					emit = true;
+					break;
+				case DW_LNS_advance_pc:
+					addr += uleb(q, uend) * minlen;
+					break;
+				case DW_LNS_advance_line:
+					line += sleb(q, uend);
+					break;
+				case DW_LNS_set_file:
+					file = uleb(q, uend);
+					break;
+				case DW_LNS_const_add_pc:
+					addr += ((255 - opbase) / linerange) * minlen;
+					break;
+				case DW_LNS_fixed_advance_pc:
+					if (q + 2 <= uend)
+						addr += get16(q);
+					q += 2;
+					break;
+				default:
+					// Skip the arguments of anything else
+					for(unsigned k=0; k<oplens[op-1]; k++)
+						uleb(q, uend);
+					break;
+			}
+
+			if (emit) {
+				ELFLINE	ln;
+
+				ln.m_addr = addr;
+				ln.m_line = (endseq) ? 0 : line;
+				ln.m_file = (file < files.size()) ? files[file] : NULL;
+				ln.m_dir  = (file < files.size()) ? filedirs[file]:NULL;
+				rows.push_back(ln);
+			} if (endseq) {
+				addr = 0; file = 1; line = 1;
+			}
+		}
 	}
 
-	r[i] = (ELFSECTION *)(&d[current_offset]);
-	r[current_section]->m_start = 0;
-	r[current_section]->m_len   = 0;
+	// Where one sequence ends at the address the next begins, place the
+	// end of the first ahead of the start of the second
+	std::stable_sort(rows.begin(), rows.end(),
+		[](const ELFLINE &a, const ELFLINE &b) {
+			if (a.m_addr != b.m_addr)
+				return a.m_addr < b.m_addr;
+			return (a.m_line == 0)&&(b.m_line != 0); });
+
+	m_nlines = rows.size();
+	m_lines  = new ELFLINE[m_nlines];
+	std::copy(rows.begin(), rows.end(), m_lines);
+}
+
+int	ELFFILE::nlines(void) {
+	if (m_nlines < 0)
+		readlines();
+	return m_nlines;
+}
 
-	elf_end(e);
-	close(fd);
+const ELFLINE	*ELFFILE::lines(void) {
+	if (m_nlines < 0)
+		readlines();
+	return m_lines;
 }
 
+const ELFLINE	*ELFFILE::line(const uint32_t addr) {
+	int	lo = 0, hi = nlines();
+
+	// Find the last row at or below addr
+	while(lo < hi) {
+		int	mid = (lo + hi)/2;
+		if (m_lines[mid].m_addr <= addr)
+			lo = mid+1;
+		else
+			hi = mid;
+	} if ((lo == 0)||(m_lines[lo-1].m_line == 0))
+		return NULL;
+	return &m_lines[lo-1];
+}
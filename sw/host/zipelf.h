@@ -4,7 +4,11 @@
 //
 // Project:	OpenArty, an entirely open SoC based upon the Arty platform
 //
-// Purpose:	
+// Purpose:	To read ZipCPU ELF files, for both the host tools and the
+//		simulator.  The file is memory mapped, and everything
+//	returned--segment contents, symbol names, and line table file names--
+//	points into that mapping rather than being copied.  Symbols and the
+//	line table are only parsed when first asked for.
 //
 //
 // Creator:	Dan Gisselquist, Ph.D.
@@ -40,14 +44,74 @@
 #define	ZIPELF_H
 
 #include <stdint.h>
+#include <stddef.h>
 
-class	ELFSECTION {
+// A loadable (PT_LOAD) segment.  m_data is in the file's (big-endian) byte
+// order.  Only the m_len bytes found in the file are given: the rest of the
+// segment, out to m_memsz, is BSS and left for the startup code to clear.
+// The list of segments is followed by one with m_len == 0.
+class	ELFSEGMENT {
 public:
-	uint32_t	m_start, m_len;
-	char		m_data[4];
+	uint32_t	m_start, m_len, m_memsz;
+	const char	*m_data;
+};
+
+class	ELFSYMBOL {
+public:
+	uint32_t	m_addr, m_size;
+	const char	*m_name;
+};
+
+// One row of the DWARF line table: the code from m_addr up to the next row
+// came from line m_line of m_file, found in directory m_dir (NULL if the
+// compilation directory).  A row with m_line == 0 marks the end of a
+// sequence.
+class	ELFLINE {
+public:
+	uint32_t	m_addr;
+	unsigned	m_line;
+	const char	*m_file, *m_dir;
+};
+
+class	ELFFILE {
+	char		*m_map;
+	size_t		m_size;
+	bool		m_big;
+	uint32_t	m_entry;
+
+	int		m_nsegs, m_nsyms, m_nlines;
+	ELFSEGMENT	*m_segs;
+	ELFSYMBOL	*m_syms;
+	ELFLINE		*m_lines;
+
+	uint16_t	get16(const void *p) const;
+	uint32_t	get32(const void *p) const;
+	const char	*section(const char *name, uint32_t &len) const;
+	void		readsymbols(void);
+	void		readlines(void);
+public:
+	// Maps the file, and reads its segments.  Exits on any error.
+	ELFFILE(const char *fname);
+	~ELFFILE(void);
+
+	uint32_t	entry(void) const { return m_entry; }
+
+	int		nsegments(void) const { return m_nsegs; }
+	const ELFSEGMENT *segments(void) const { return m_segs; }
+
+	// Function symbols, together with any global labels, sorted by address
+	int		nsymbols(void);
+	const ELFSYMBOL	*symbols(void);
+	// The function containing addr, or NULL if there isn't one
+	const ELFSYMBOL	*symbol(const uint32_t addr);
+
+	// The line table, sorted by address
+	int		nlines(void);
+	const ELFLINE	*lines(void);
+	// The line containing addr, or NULL if it isn't known
+	const ELFLINE	*line(const uint32_t addr);
 };
 
 bool	iself(const char *fname);
-void	elfread(const char *fname, uint32_t &entry, ELFSECTION **&sections);
 
 #endif
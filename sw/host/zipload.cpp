@@ -8,6 +8,13 @@
 //		or SDRAM.  This requires a working/running configuration
 //	in order to successfully load.
 //
+//	RAM is loaded in blocks.  With -s, the CPU first checksums each block
+//	on board, and those blocks that already hold the right values are
+//	skipped.  With -V, the blocks are checksummed again once loaded, to
+//	verify them.  Either way, only the checksums cross the link, so
+//	reloading a program that has barely changed costs little more than
+//	sending the changes.
+//
 //
 // Creator:	Dan Gisselquist, Ph.D.
 //		Gisselquist Technology, LLC
@@ -49,6 +56,11 @@
 #include <string.h>
 #include <signal.h>
 #include <assert.h>
+#include <time.h>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "port.h"
 #include "llcomms.h"
@@ -64,11 +76,221 @@
 
 FPGA	*m_fpga;
 
+// RAM is loaded, checksummed, and verified in blocks of this many words
+#define	LDBLKW	1024
+
+// How long to wait, in seconds, for the checksum stub to finish a block
+#define	STUB_TIMEOUT	1.0
+
+typedef	struct {
+	uint32_t	m_addr, m_len;	// Bus address, and length in words
+	const char	*m_src;		// Section data, as found in the ELF file
+	unsigned	m_srclen;	// Bytes available at m_src
+	uint32_t	*m_data;	// The words to write, in bus order
+	uint32_t	m_suma, m_sumb;	// Checksums of m_data
+} LOADBLK;
+
+//
+// Rather than reading a block back across the link to see if it has changed,
+// we have the CPU checksum it on board.  This stub expects R1 to point to the
+// block, R2 to point just past it, and R3 and R5 to be zero.  It leaves a
+// Fletcher style pair of sums in R3 and R5, and halts on the BREAK with
+// R1 == R2.
+//
+static const uint32_t	HASHSTUB[] = {
+	0x24844000,	// loop:	LW	(R1),R4
+	0x08800004,	//		ADD	4,R1
+	0x18850000,	//		ADD	R4,R3
+	0x2884c000,	//		ADD	R3,R5
+	0x0c048000,	//		CMP	R2,R1
+	0x78abffe8,	//		BNZ	loop
+	0x77000000	//		BREAK
+};
+#define	HASHSTUBLEN	(sizeof(HASHSTUB)/sizeof(HASHSTUB[0]))
+
+// Blocks are byte swapped and checksummed by a second thread, so that this
+// work takes place while earlier blocks are being sent.
+static	std::mutex		m_prepmtx;
+static	std::condition_variable	m_prepcv;
+static	unsigned		m_nprepped = 0;
+
 void	usage(void) {
-	printf("USAGE: zipload [-hr] <zip-program-file>\n");
+	printf("USAGE: zipload [-hrsvV] <zip-program-file>\n");
 	printf("\n"
 "\t-h\tDisplay this usage statement\n"
-"\t-r\tStart the ZipCPU running from the address in the program file\n");
+"\t-r\tStart the ZipCPU running from the address in the program file\n"
+"\t-s\tSkip any RAM blocks whose on-board checksum shows that they\n"
+"\t\talready hold the values to be loaded\n"
+"\t-v\tVerbose\n"
+"\t-V\tVerify the RAM blocks, by checksum, once loaded\n");
+}
+
+double	now(void) {
+	struct	timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+bool	inram(const unsigned start, const unsigned len) {
+#ifdef	BKRAM_ACCESS
+	if ((start >= BKRAMBASE)&&(start+len <= BKRAMBASE+BKRAMLEN))
+		return true;
+#endif
+#ifdef	SDRAM_ACCESS
+	if ((start >= SDRAMBASE)&&(start+len <= SDRAMBASE+SDRAMLEN))
+		return true;
+#endif
+	return false;
+}
+
+//
+// prepare
+//
+// Converts each block from the ELF file's byte order into bus words, and
+// checksums it the same way the stub will.
+//
+void	prepare(const unsigned nblk, LOADBLK *blk) {
+	for(unsigned k=0; k<nblk; k++) {
+		LOADBLK	*bp = &blk[k];
+		const unsigned char *sp = (const unsigned char *)bp->m_src;
+		uint32_t	a = 0, b = 0;
+
+		for(unsigned i=0; i<bp->m_len; i++) {
+			uint32_t	v;
+
+			if (4*i+4 <= bp->m_srclen)
+				v = buildword(&sp[4*i]);
+			else {
+				// Zero pad any partial word at the end
+				unsigned char	tail[4] = { 0, 0, 0, 0 };
+				memcpy(tail, &sp[4*i], bp->m_srclen-4*i);
+				v = buildword(tail);
+			}
+
+			bp->m_data[i] = v;
+			a += v;
+			b += a;
+		}
+
+		bp->m_suma = a;
+		bp->m_sumb = b;
+
+		std::lock_guard<std::mutex>	lock(m_prepmtx);
+		m_nprepped = k+1;
+		m_prepcv.notify_one();
+	}
+}
+
+// Wait for the preparation thread to be done with block k
+LOADBLK	*ready(LOADBLK *blk, const unsigned k) {
+	std::unique_lock<std::mutex>	lock(m_prepmtx);
+
+	m_prepcv.wait(lock, [k]{ return m_nprepped > k; });
+	return &blk[k];
+}
+
+// Find a place for the checksum stub, outside of anything we'll be loading.
+// Since it's placed at the top of memory, the program's stack will later
+// overwrite it.
+unsigned	stubaddr(const ELFSEGMENT *segs) {
+	const unsigned	ln = sizeof(HASHSTUB);
+	unsigned	cand[2], nc = 0;
+
+#ifdef	BKRAM_ACCESS
+	cand[nc++] = BKRAMBASE+BKRAMLEN-ln;
+#endif
+#ifdef	SDRAM_ACCESS
+	cand[nc++] = SDRAMBASE+SDRAMLEN-ln;
+#endif
+	for(unsigned c=0; c<nc; c++) {
+		bool	clear = true;
+
+		for(int i=0; segs[i].m_len; i++)
+			if ((segs[i].m_start < cand[c]+ln)
+				&&(segs[i].m_start+segs[i].m_len > cand[c]))
+				clear = false;
+		if (clear)
+			return cand[c];
+	} return 0;
+}
+
+static void	setop(BUSOP &op, const unsigned a, const unsigned v) {
+	op.m_addr = a; op.m_data = v; op.m_write = true;
+}
+
+static void	getop(BUSOP &op, const unsigned a) {
+	op.m_addr = a; op.m_data = 0; op.m_write = false;
+}
+
+// Wait for the checksum stub to halt.  Returns false if it never does, in
+// which case it's left halted anyway.
+static bool	wait_halt(void) {
+	double	tstart = now();
+
+	while(0 == (m_fpga->readio(R_ZIPCTRL) & CPU_HALT)) {
+		if (now() - tstart > STUB_TIMEOUT) {
+			m_fpga->writeio(R_ZIPCTRL, CPU_HALT);
+			return false;
+		}
+	} return true;
+}
+
+//
+// onboard_check
+//
+// Has the CPU checksum each block on board, and marks in match[] those blocks
+// that already hold what we intend to load.  Once the stub has halted, the
+// results for one block are collected in the same bus sequence that starts
+// the next.
+//
+void	onboard_check(const unsigned stub, const unsigned nblk, LOADBLK *blk,
+		bool *match) {
+	BUSOP	ops[18];
+
+	for(unsigned k=0; k<=nblk; k++) {
+		int	n = 0, nc;
+		bool	halted = true;
+
+		if (k > 0) {
+			halted = wait_halt();
+			getop(ops[n++], R_ZIPCTRL);
+			setop(ops[n++], R_ZIPCTRL, CPU_HALT|1);
+			getop(ops[n++], R_ZIPDATA);
+			setop(ops[n++], R_ZIPCTRL, CPU_HALT|3);
+			getop(ops[n++], R_ZIPDATA);
+			setop(ops[n++], R_ZIPCTRL, CPU_HALT|5);
+			getop(ops[n++], R_ZIPDATA);
+		} if (k < nblk) {
+			const unsigned	regs[5] = { 1, 2, 3, 5, CPU_sPC };
+			const unsigned	vals[5] = { blk[k].m_addr,
+					blk[k].m_addr + 4*blk[k].m_len,
+					0, 0, stub };
+
+			for(int r=0; r<5; r++) {
+				setop(ops[n++], R_ZIPCTRL, CPU_HALT|regs[r]);
+				setop(ops[n++], R_ZIPDATA, vals[r]);
+			} setop(ops[n++], R_ZIPCTRL, CPU_GO|CPU_sPC);
+		}
+
+		nc = m_fpga->ioseq(n, ops);
+		if (nc < n)
+			throw BUSERR(ops[nc].m_addr);
+
+		if (k > 0) {
+			LOADBLK	*bp = ready(blk, k-1);
+
+			// A stub that never halted, or that halted short of
+			// the end of the block on a bus error, is no match.
+			if (!halted)
+				fprintf(stderr, "WARNING: Checksum of %08x timed out\n",
+					bp->m_addr);
+			match[k-1] = (halted)
+				&&(ops[2].m_data == bp->m_addr + 4*bp->m_len)
+				&&(ops[4].m_data == bp->m_suma)
+				&&(ops[6].m_data == bp->m_sumb);
+		}
+	}
 }
 
 int main(int argc, char **argv) {
@@ -77,7 +299,8 @@ int main(int argc, char **argv) {
 	return	EXIT_FAILURE;
 #else
 	int		skp=0;
-	bool		start_when_finished = false, verbose = false;
+	bool		start_when_finished = false, verbose = false,
+			skip_matching = false, verify = false;
 	unsigned	entry = 0;
 #ifdef	FLASH_ACCESS
 	FLASHDRVR	*flash = NULL;
@@ -100,9 +323,15 @@ int main(int argc, char **argv) {
 			case 'r':
 				start_when_finished = true;
 				break;
+			case 's':
+				skip_matching = true;
+				break;
 			case 'v':
 				verbose = true;
 				break;
+			case 'V':
+				verify = true;
+				break;
 			default:
 				fprintf(stderr, "Unknown option, -%c\n\n",
 					argv[argn+skp][0]);
@@ -202,7 +431,8 @@ int main(int argc, char **argv) {
 #endif
 
 	if (codef) try {
-		ELFSECTION	**secpp = NULL, *secp;
+		ELFFILE			*elf = NULL;
+		const ELFSEGMENT	*segs, *segp;
 #ifdef	FLASH_ACCESS
 		unsigned	startaddr = RESET_ADDRESS;
 		unsigned	codelen = 0;
@@ -211,113 +441,167 @@ int main(int argc, char **argv) {
 
 
 		if(iself(codef)) {
-			// zip-readelf will help with both of these ...
-			elfread(codef, entry, secpp);
+			elf   = new ELFFILE(codef);
+			entry = elf->entry();
+			segs  = elf->segments();
 		} else {
 			fprintf(stderr, "ERR: %s is not in ELF format\n", codef);
 			exit(EXIT_FAILURE);
 		}
 
 		printf("Loading: %s\n", codef);
-		// assert(secpp[1]->m_len = 0);
-		for(int i=0; secpp[i]->m_len; i++) {
+		for(int i=0; segs[i].m_len; i++) {
 			bool	valid = false;
-			secp=  secpp[i];
+			segp = &segs[i];
 
 			// Make sure our section is either within block RAM
 #ifdef	BKRAM_ACCESS
-			if ((secp->m_start >= BKRAMBASE)
-				&&(secp->m_start+secp->m_len
+			if ((segp->m_start >= BKRAMBASE)
+				&&(segp->m_start+segp->m_len
 						<= BKRAMBASE+BKRAMLEN))
 				valid = true;
 #endif
 
 #ifdef	FLASH_ACCESS
 			// Flash
-			if ((secp->m_start >= RESET_ADDRESS)
-				&&(secp->m_start+secp->m_len
+			if ((segp->m_start >= RESET_ADDRESS)
+				&&(segp->m_start+segp->m_len
 						<= FLASHBASE+FLASHLEN))
 				valid = uses_flash = true;
 #endif
 
 #ifdef	SDRAM_ACCESS
 			// Or SDRAM
-			if ((secp->m_start >= SDRAMBASE)
-				&&(secp->m_start+secp->m_len
+			if ((segp->m_start >= SDRAMBASE)
+				&&(segp->m_start+segp->m_len
 						<= SDRAMBASE+SDRAMLEN))
 				valid = true;
 #endif
 			if (!valid) {
 				fprintf(stderr, "No such memory on board: 0x%08x - %08x\n",
-					secp->m_start, secp->m_start+secp->m_len);
+					segp->m_start, segp->m_start+segp->m_len);
 				exit(EXIT_FAILURE);
 			}
 		}
 
-		for(int i=0; secpp[i]->m_len; i++) {
-			secp = secpp[i];
-
-#ifdef	SDRAM_ACCESS
-			if ((secp->m_start >= SDRAMBASE)
-				&&(secp->m_start+secp->m_len
-						<= SDRAMBASE+SDRAMLEN)) {
-				if (verbose)
-					printf("Writing to SDRAM: %08x-%08x\n",
-						secp->m_start,
-						secp->m_start+secp->m_len);
-				unsigned ln = (secp->m_len+3)&-4;
-				uint32_t	*bswapd = new uint32_t[ln>>2];
-				if (ln != (secp->m_len&-4))
-					memset(bswapd, 0, ln);
-				memcpy(bswapd, secp->m_data,  ln);
-				byteswapbuf(ln>>2, bswapd);
-				m_fpga->writei(secp->m_start, ln>>2, bswapd);
+		// Break the RAM sections into blocks.  Only what's in the file
+		// gets sent: the BSS at the end of a section is left for the
+		// C startup code to clear.
+		unsigned	nblk = 0, nwords = 0;
+		for(int i=0; segs[i].m_len; i++) {
+			segp = &segs[i];
+			if (!inram(segp->m_start, segp->m_len))
+				continue;
+			unsigned nw = (segp->m_len+3)>>2;
+			nblk   += (nw+LDBLKW-1)/LDBLKW;
+			nwords += nw;
+		}
 
+		LOADBLK		*blk = new LOADBLK[nblk];
+		uint32_t	*wbuf = new uint32_t[nwords];
+		nblk = nwords = 0;
+		for(int i=0; segs[i].m_len; i++) {
+			segp = &segs[i];
+			if (!inram(segp->m_start, segp->m_len))
 				continue;
+			if (verbose)
+				printf("Writing to RAM: %08x-%08x\n",
+					segp->m_start,
+					segp->m_start+segp->m_len);
+			for(unsigned pos=0; pos<segp->m_len; pos+=4*LDBLKW) {
+				LOADBLK	*bp = &blk[nblk++];
+				unsigned ln = segp->m_len - pos;
+
+				if (ln > 4*LDBLKW)
+					ln = 4*LDBLKW;
+				bp->m_addr   = segp->m_start + pos;
+				bp->m_len    = (ln+3)>>2;
+				bp->m_src    = &segp->m_data[pos];
+				bp->m_srclen = ln;
+				bp->m_data   = &wbuf[nwords];
+				nwords += bp->m_len;
 			}
-#endif
+		}
 
-#ifdef	BKRAM_ACCESS
-			if ((secp->m_start >= BKRAMBASE)
-				  &&(secp->m_start+secp->m_len
-						<= BKRAMBASE+BKRAMLEN)) {
-				if (verbose)
-					printf("Writing to MEM: %08x-%08x\n",
-						secp->m_start,
-						secp->m_start+secp->m_len);
-				unsigned ln = (secp->m_len+3)&-4;
-				uint32_t	*bswapd = new uint32_t[ln>>2];
-				if (ln != (secp->m_len&-4))
-					memset(bswapd, 0, ln);
-				memcpy(bswapd, secp->m_data,  ln);
-				byteswapbuf(ln>>2, bswapd);
-				m_fpga->writei(secp->m_start, ln>>2, bswapd);
-				continue;
+		std::thread	prep(prepare, nblk, blk);
+		prep.detach();
+
+		bool		*match = new bool[nblk];
+		unsigned	stub = 0;
+		for(unsigned k=0; k<nblk; k++)
+			match[k] = false;
+		if (((skip_matching)||(verify))&&(nblk > 0)) {
+			stub = stubaddr(segs);
+			if (stub == 0)
+				fprintf(stderr, "WARNING: No room for the checksum stub, RAM will not be skipped or verified\n");
+			else {
+				m_fpga->writei(stub, HASHSTUBLEN, HASHSTUB);
+				m_fpga->writeio(R_ZIPCTRL, CPU_HALT|CPU_CLRCACHE);
 			}
-#endif
+		}
+
+		double		tstart = now(), tload;
+		unsigned	nsent = 0;
+
+		if ((stub)&&(skip_matching))
+			onboard_check(stub, nblk, blk, match);
+		for(unsigned k=0; k<nblk; k++) {
+			LOADBLK	*bp = ready(blk, k);
+
+			if (match[k])
+				continue;
+			m_fpga->writei(bp->m_addr, bp->m_len, bp->m_data);
+			nsent += bp->m_len;
+		} tload = now() - tstart;
+
+		if (nblk > 0) {
+			printf("Loaded %u bytes of RAM (%u sent, %u skipped) in %.2f s: %.1f kB/s\n",
+				nwords*4, nsent*4, (nwords-nsent)*4, tload,
+				(tload > 0) ? nwords*4/tload/1e3 : 0.0);
+		}
+
+		if ((stub)&&(verify)) {
+			unsigned	nbad = 0;
+
+			m_fpga->writeio(R_ZIPCTRL, CPU_HALT|CPU_CLRCACHE);
+			onboard_check(stub, nblk, blk, match);
+			for(unsigned k=0; k<nblk; k++) {
+				if (match[k])
+					continue;
+				fprintf(stderr, "ERR: Verify failed, %08x-%08x\n",
+					blk[k].m_addr,
+					blk[k].m_addr+4*blk[k].m_len);
+				nbad++;
+			} if (nbad > 0)
+				exit(EXIT_FAILURE);
+			printf("Verified %u bytes of RAM\n", nwords*4);
+		}
+
+		for(int i=0; segs[i].m_len; i++) {
+			segp = &segs[i];
 
 #ifdef	FLASH_ACCESS
-			if ((secp->m_start >= FLASHBASE)
-				  &&(secp->m_start+secp->m_len
+			if ((segp->m_start >= FLASHBASE)
+				  &&(segp->m_start+segp->m_len
 						<= FLASHBASE+FLASHLEN)) {
 				// Otherwise writing to flash
-				if (secp->m_start < startaddr) {
+				if (segp->m_start < startaddr) {
 					// Keep track of the first address in
 					// flash, as well as the last address
 					// that we will write
-					codelen += (startaddr-secp->m_start);
-					startaddr = secp->m_start;
-				} if (secp->m_start+secp->m_len > startaddr+codelen) {
-					codelen = secp->m_start+secp->m_len-startaddr;
+					codelen += (startaddr-segp->m_start);
+					startaddr = segp->m_start;
+				} if (segp->m_start+segp->m_len > startaddr+codelen) {
+					codelen = segp->m_start+segp->m_len-startaddr;
 				} if (verbose)
 					printf("Sending to flash: %08x-%08x\n",
-						secp->m_start,
-						secp->m_start+secp->m_len);
+						segp->m_start,
+						segp->m_start+segp->m_len);
 
 				// Copy this data into our copy of what we want
 				// the flash to look like.
-				memcpy(&fbuf[secp->m_start-FLASHBASE],
-					secp->m_data, secp->m_len);
+				memcpy(&fbuf[segp->m_start-FLASHBASE],
+					segp->m_data, segp->m_len);
 			}
 #endif
 		}
@@ -339,9 +623,17 @@ int main(int argc, char **argv) {
 
 		// Now ... how shall we start this CPU?
 		printf("Clearing the CPUs registers\n");
-		for(int i=0; i<32; i++) {
-			m_fpga->writeio(R_ZIPCTRL, CPU_HALT|i);
-			m_fpga->writeio(R_ZIPDATA, 0);
+		{
+			BUSOP	ops[64];
+			int	nc;
+
+			for(int i=0; i<32; i++) {
+				setop(ops[2*i  ], R_ZIPCTRL, CPU_HALT|i);
+				setop(ops[2*i+1], R_ZIPDATA, 0);
+			}
+			nc = m_fpga->ioseq(64, ops);
+			if (nc < 64)
+				throw BUSERR(ops[nc].m_addr);
 		}
 
 		m_fpga->writeio(R_ZIPCTRL, CPU_HALT|CPU_CLRCACHE);
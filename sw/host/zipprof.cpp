@@ -0,0 +1,500 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	zipprof.cpp
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	To analyze the profile file written by automaster_tb's -f
+//		option.  That file is nothing more than a long list of
+//	(pc, ticks) pairs, one per instruction retired, where ticks is the
+//	number of clocks since the prior instruction was retired.
+//
+//	From this we build:
+//	- The number of cycles spent, and the CPI, within each function,
+//	- Basic blocks, and the number of cycles spent within each, and
+//	- The hottest loops, together with their disassembly
+//
+//	The profile file is memory mapped, and split among several threads
+//	for the initial aggregation.  Given the ELF file that produced the
+//	profile, basic blocks are split at every branch (found via
+//	zop_early_branch) and at every function entry, whether or not the
+//	branch was taken.  Without it, blocks are split only where the trace
+//	shows a jump.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015-2019, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "zipelf.h"
+#include "zopcodes.h"
+#include "byteswap.h"
+
+// One record, as written by automaster_tb in the host's byte order
+typedef	struct {
+	uint32_t	m_pc, m_ticks;
+} PROFREC;
+
+typedef	struct {
+	unsigned long	m_count, m_ticks;
+} PCSTAT;
+
+typedef	std::unordered_map<uint32_t, PCSTAT>		PCMAP;
+// Non-sequential transitions, (from << 32) | to, and how often each was taken
+typedef	std::unordered_map<uint64_t, unsigned long>	EDGEMAP;
+
+class	PROFSTATS {
+public:
+	PCMAP	m_pcs;
+	EDGEMAP	m_edges;
+
+	// Accumulate records [first, last).  The transition out of the last
+	// record is counted here as well, so nrec is needed to know if there
+	// is one.
+	void	add(const PROFREC *rec, size_t first, size_t last,
+			size_t nrec) {
+		PCSTAT		*st = NULL;
+		uint32_t	lastpc = 0;
+
+		for(size_t i=first; i<last; i++) {
+			uint32_t	pc = rec[i].m_pc;
+
+			// Loops will hit the same address many times in a
+			// row, so skip the hash when we can
+			if ((st == NULL)||(pc != lastpc))
+				st = &m_pcs[pc];
+			st->m_count++;
+			st->m_ticks += rec[i].m_ticks;
+			lastpc = pc;
+
+			if ((i+1 < nrec)&&(rec[i+1].m_pc != pc+4))
+				m_edges[((uint64_t)pc<<32)|rec[i+1].m_pc]++;
+		}
+	}
+
+	void	merge(const PROFSTATS &o) {
+		for(auto it = o.m_pcs.begin(); it != o.m_pcs.end(); it++) {
+			PCSTAT	&st = m_pcs[it->first];
+			st.m_count += it->second.m_count;
+			st.m_ticks += it->second.m_ticks;
+		} for(auto it = o.m_edges.begin(); it != o.m_edges.end(); it++)
+			m_edges[it->first] += it->second;
+	}
+};
+
+typedef	struct {
+	uint32_t	m_start, m_end;		// Addresses of first/last insn
+	unsigned long	m_entries, m_insns, m_ticks;
+} BLOCK;
+
+typedef	struct {
+	uint32_t	m_head, m_tail;		// Branch from m_tail to m_head
+	unsigned long	m_iterations, m_insns, m_ticks;
+} LOOP;
+
+ELFFILE		*elf = NULL;
+const ELFSYMBOL	*symbols = NULL;
+int		nsymbols = 0;
+
+bool	getinsn(uint32_t pc, ZIPI &ins) {
+	if (!elf)
+		return false;
+	for(int i=0; elf->segments()[i].m_len; i++) {
+		const ELFSEGMENT *s = &elf->segments()[i];
+		if ((pc >= s->m_start)&&(pc + 4 <= s->m_start + s->m_len)) {
+			ins = buildword((const unsigned char *)
+					&s->m_data[pc - s->m_start]);
+			return true;
+		}
+	} return false;
+}
+
+// Returns the function containing pc, or NULL if there isn't one
+const ELFSYMBOL	*getsymbol(uint32_t pc) {
+	return (elf) ? elf->symbol(pc) : NULL;
+}
+
+// Returns " (file:line)" for pc, or an empty string if the ELF file
+// carries no line table covering it
+const char	*srcline(uint32_t pc, char *buf) {
+	const ELFLINE	*ln = (elf) ? elf->line(pc) : NULL;
+
+	if (!ln)
+		return "";
+	sprintf(buf, " (%.80s:%u)", ln->m_file, ln->m_line);
+	return buf;
+}
+
+const char	*symname(uint32_t pc, char *buf) {
+	const ELFSYMBOL	*sym = getsymbol(pc);
+
+	if (!sym)
+		return "";
+	if (pc == sym->m_addr)
+		return sym->m_name;
+	sprintf(buf, "%.60s+0x%x", sym->m_name, pc - sym->m_addr);
+	return buf;
+}
+
+double	percent(unsigned long v, unsigned long total) {
+	return (total) ? 100.0 * v / (double)total : 0.0;
+}
+
+void	usage(void) {
+	printf("USAGE: zipprof [-h] [-e <elf-file>] [-j <threads>] [-n <count>] [pfile.bin]\n");
+	printf("\n"
+"\t-e <elf-file>\tThe program that produced the profile.  This is used\n"
+"\t\tto find functions, to split basic blocks at branches that\n"
+"\t\twere never taken, and to disassemble the hottest loops.\n"
+"\t-h\tDisplay this usage statement\n"
+"\t-j <threads>\tThe number of threads to aggregate the profile with.\n"
+"\t\tDefaults to the number of CPUs.\n"
+"\t-n <count>\tThe number of basic blocks and loops to report.\n"
+"\t\tDefaults to 20.\n"
+"\n"
+"\tThe profile file is produced by automaster_tb -f, and defaults to\n"
+"\tpfile.bin.\n");
+}
+
+int	main(int argc, char **argv) {
+	const char	*elffile = NULL, *proffile = "pfile.bin";
+	unsigned	nthreads = std::thread::hardware_concurrency(),
+			ntop = 20;
+	int		opt;
+
+	while((opt = getopt(argc, argv, "e:hj:n:")) != -1) {
+		switch(opt) {
+		case 'e': elffile = optarg; break;
+		case 'h': usage(); exit(EXIT_SUCCESS); break;
+		case 'j': nthreads = atoi(optarg); break;
+		case 'n': ntop = atoi(optarg); break;
+		default:
+			usage();
+			exit(EXIT_FAILURE);
+		}
+	} if (optind < argc)
+		proffile = argv[optind++];
+	if (optind < argc) {
+		fprintf(stderr, "Too many files given\n");
+		usage();
+		exit(EXIT_FAILURE);
+	} if (nthreads < 1)
+		nthreads = 1;
+
+	if (elffile) {
+		if (!iself(elffile)) {
+			fprintf(stderr, "%s is not an ELF file\n", elffile);
+			exit(EXIT_FAILURE);
+		}
+		elf = new ELFFILE(elffile);
+		symbols  = elf->symbols();
+		nsymbols = elf->nsymbols();
+	}
+
+	//
+	// Map the profile into memory
+	//
+	int		fd;
+	struct stat	sb;
+	const PROFREC	*rec;
+	size_t		nrec;
+
+	if ((fd = open(proffile, O_RDONLY)) < 0) {
+		fprintf(stderr, "Could not open %s\n", proffile);
+		perror("O/S Err:");
+		exit(EXIT_FAILURE);
+	} if (fstat(fd, &sb) != 0) {
+		perror("O/S Err:");
+		exit(EXIT_FAILURE);
+	}
+
+	nrec = sb.st_size / sizeof(PROFREC);
+	if (nrec == 0) {
+		fprintf(stderr, "%s is empty\n", proffile);
+		exit(EXIT_FAILURE);
+	}
+
+	rec = (const PROFREC *)mmap(NULL, nrec * sizeof(PROFREC), PROT_READ,
+			MAP_PRIVATE, fd, 0);
+	if (rec == (const PROFREC *)MAP_FAILED) {
+		fprintf(stderr, "Could not map %s\n", proffile);
+		perror("O/S Err:");
+		exit(EXIT_FAILURE);
+	}
+	madvise((void *)rec, nrec * sizeof(PROFREC), MADV_SEQUENTIAL);
+
+	//
+	// Aggregate by address, in parallel
+	//
+	std::vector<PROFSTATS>		stats(nthreads);
+	std::vector<std::thread>	threads;
+
+	for(unsigned t=0; t<nthreads; t++) {
+		size_t	first = nrec * t / nthreads,
+			last  = nrec * (t+1) / nthreads;
+		threads.push_back(std::thread(&PROFSTATS::add, &stats[t],
+			rec, first, last, nrec));
+	} for(unsigned t=0; t<nthreads; t++) {
+		threads[t].join();
+		if (t > 0)
+			stats[0].merge(stats[t]);
+	}
+
+	PROFSTATS	&prof = stats[0];
+	unsigned long	total_insns = 0, total_ticks = 0;
+
+	munmap((void *)rec, nrec * sizeof(PROFREC));
+	close(fd);
+
+	// Sort the addresses, keeping a running sum of ticks and instructions
+	// so we can quickly find the totals over any address range
+	std::vector<uint32_t>		pcs;
+	std::vector<unsigned long>	cumticks, cuminsns;
+
+	pcs.reserve(prof.m_pcs.size());
+	for(auto it = prof.m_pcs.begin(); it != prof.m_pcs.end(); it++)
+		pcs.push_back(it->first);
+	std::sort(pcs.begin(), pcs.end());
+
+	cumticks.push_back(0);
+	cuminsns.push_back(0);
+	for(size_t k=0; k<pcs.size(); k++) {
+		const PCSTAT	&st = prof.m_pcs[pcs[k]];
+		total_insns += st.m_count;
+		total_ticks += st.m_ticks;
+		cuminsns.push_back(total_insns);
+		cumticks.push_back(total_ticks);
+	}
+
+	printf("Profile: %s\n", proffile);
+	printf("  %lu instructions, %lu cycles, CPI %.3f\n\n",
+		total_insns, total_ticks,
+		(total_insns) ? total_ticks / (double)total_insns : 0.0);
+
+	//
+	// Find the start of every basic block
+	//
+	std::set<uint32_t>	leaders;
+
+	for(auto it = prof.m_edges.begin(); it != prof.m_edges.end(); it++) {
+		uint32_t	from = it->first >> 32, to = (uint32_t)it->first;
+		leaders.insert(to);
+		leaders.insert(from+4);
+	} for(int k=0; k<nsymbols; k++)
+		leaders.insert(symbols[k].m_addr);
+	for(size_t k=0; k<pcs.size(); k++) {
+		ZIPI		ins;
+		uint32_t	target;
+
+		if (!getinsn(pcs[k], ins))
+			continue;
+		target = zop_early_branch(pcs[k], ins);
+		if (target != pcs[k]+4) {
+			leaders.insert(target);
+			leaders.insert(pcs[k]+4);
+		}
+	}
+
+	//
+	// Build the basic blocks
+	//
+	std::vector<BLOCK>	blocks;
+
+	for(size_t k=0; k<pcs.size(); k++) {
+		const PCSTAT	&st = prof.m_pcs[pcs[k]];
+
+		if ((k == 0)||(pcs[k] != pcs[k-1]+4)
+				||(leaders.count(pcs[k]))) {
+			BLOCK	b;
+			b.m_start   = pcs[k];
+			b.m_entries = st.m_count;
+			b.m_insns   = 0;
+			b.m_ticks   = 0;
+			blocks.push_back(b);
+		}
+
+		BLOCK	&b = blocks.back();
+		b.m_end    = pcs[k];
+		b.m_insns += st.m_count;
+		b.m_ticks += st.m_ticks;
+	}
+
+	//
+	// Functions
+	//
+	if (nsymbols > 0) {
+		std::vector<PCSTAT>	fns(nsymbols+1);
+		std::vector<int>	order;
+
+		for(int k=0; k<=nsymbols; k++) {
+			fns[k].m_count = 0;
+			fns[k].m_ticks = 0;
+		}
+
+		for(size_t k=0; k<pcs.size(); k++) {
+			const ELFSYMBOL	*sym = getsymbol(pcs[k]);
+			const PCSTAT	&st = prof.m_pcs[pcs[k]];
+			int	fn = (sym) ? (int)(sym - symbols) : nsymbols;
+
+			fns[fn].m_count += st.m_count;
+			fns[fn].m_ticks += st.m_ticks;
+		}
+
+		for(int k=0; k<=nsymbols; k++)
+			if (fns[k].m_count)
+				order.push_back(k);
+		std::sort(order.begin(), order.end(), [&fns](int a, int b) {
+			return fns[a].m_ticks > fns[b].m_ticks; });
+
+		printf("Functions, by cycles\n");
+		printf("  %12s %6s %12s %7s  %s\n",
+			"Cycles", "%", "Insns", "CPI", "Function");
+		for(size_t k=0; k<order.size(); k++) {
+			const PCSTAT	&f = fns[order[k]];
+			printf("  %12lu %6.2f %12lu %7.3f  %s\n",
+				f.m_ticks, percent(f.m_ticks, total_ticks),
+				f.m_count, f.m_ticks / (double)f.m_count,
+				(order[k] < nsymbols) ? symbols[order[k]].m_name
+					: "(unknown)");
+		} printf("\n");
+	}
+
+	//
+	// The hottest basic blocks
+	//
+	{
+		char	namebuf[80];
+
+		std::sort(blocks.begin(), blocks.end(),
+			[](const BLOCK &a, const BLOCK &b) {
+				return a.m_ticks > b.m_ticks; });
+
+		printf("Basic blocks, by cycles\n");
+		printf("  %-8s %-8s %10s %5s %12s %6s %9s  %s\n",
+			"Start", "End", "Entries", "Insns", "Cycles", "%",
+			"Cyc/entry", "Function");
+		for(size_t k=0; (k<blocks.size())&&(k<ntop); k++) {
+			const BLOCK	&b = blocks[k];
+			printf("  %08x %08x %10lu %5u %12lu %6.2f %9.2f  %s\n",
+				b.m_start, b.m_end, b.m_entries,
+				(b.m_end - b.m_start)/4 + 1, b.m_ticks,
+				percent(b.m_ticks, total_ticks),
+				(b.m_entries) ? b.m_ticks / (double)b.m_entries
+					: 0.0,
+				symname(b.m_start, namebuf));
+		} printf("\n");
+	}
+
+	//
+	// The hottest loops: any backwards jump, from the loop's tail to its
+	// head.  We charge the loop with everything executed from its head
+	// through its tail, which includes any inner loops.
+	//
+	{
+		std::vector<LOOP>	loops;
+		char	namebuf[80], linebuf[96];
+
+		for(auto it=prof.m_edges.begin(); it!=prof.m_edges.end(); it++){
+			uint32_t	from = it->first >> 32,
+					to = (uint32_t)it->first;
+			LOOP		lp;
+			size_t		lo, hi;
+
+			if ((to > from)||(getsymbol(to) != getsymbol(from)))
+				continue;
+			lo = std::lower_bound(pcs.begin(), pcs.end(), to)
+					- pcs.begin();
+			hi = std::upper_bound(pcs.begin(), pcs.end(), from)
+					- pcs.begin();
+
+			lp.m_head  = to;
+			lp.m_tail  = from;
+			lp.m_iterations = it->second;
+			lp.m_insns = cuminsns[hi] - cuminsns[lo];
+			lp.m_ticks = cumticks[hi] - cumticks[lo];
+			loops.push_back(lp);
+		}
+
+		std::sort(loops.begin(), loops.end(),
+			[](const LOOP &a, const LOOP &b) {
+				return a.m_ticks > b.m_ticks; });
+
+		printf("Hottest loops\n");
+		for(size_t k=0; (k<loops.size())&&(k<ntop); k++) {
+			const LOOP	&lp = loops[k];
+
+			printf("\n  Loop %08x-%08x %s%s: %lu iterations, %lu cycles (%.2f%%), %.2f cycles/iteration, CPI %.3f\n",
+				lp.m_head, lp.m_tail,
+				symname(lp.m_head, namebuf),
+				srcline(lp.m_head, linebuf),
+				lp.m_iterations, lp.m_ticks,
+				percent(lp.m_ticks, total_ticks),
+				lp.m_ticks / (double)lp.m_iterations,
+				(lp.m_insns)?lp.m_ticks/(double)lp.m_insns:0.0);
+
+			// List only those instructions that were executed, since
+			// a loop may well contain a large (unused) error path
+			size_t	lo = std::lower_bound(pcs.begin(), pcs.end(),
+						lp.m_head) - pcs.begin();
+			for(size_t i=lo; (i<pcs.size())&&(pcs[i]<=lp.m_tail);
+					i++) {
+				uint32_t	pc = pcs[i];
+				const PCSTAT	&st = prof.m_pcs[pc];
+				char	la[80], lb[80];
+				ZIPI	ins;
+
+				if ((i > lo)&&(pc != pcs[i-1]+4))
+					printf("    ...\n");
+				printf("    %08x: %10lu %12lu", pc,
+					st.m_count, st.m_ticks);
+				if (getinsn(pc, ins)) {
+					zipi_to_double_string(pc, ins, la, lb);
+					printf("  %08x  %-25s%s%s", ins, la,
+						(lb[0])?" | ":"", lb);
+				} printf("\n");
+			}
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -510,8 +510,188 @@ zip_getbits(const ZIPI ins, const int which)
 	}
 }
 
+//
+// ZOPDECODE
+//
+// Rather than testing every opcode in the list against each instruction, we
+// build a table (once) indexed by ten bits of the instruction word.  Each
+// table entry lists, in their original order, only those opcodes that might
+// match an instruction with those ten bits.  The first of these that matches
+// is the same opcode a linear search would've found, but we now only need to
+// check a couple of candidates instead of a couple hundred.
+//
+// At the same time, we classify each opcode by how its operands are to be
+// printed, so that we needn't compare opcode names on every instruction.
+//
+#define	ZOP_LGTBL	10
+#define	ZOP_TBLSZ	(1<<ZOP_LGTBL)
+
+typedef	enum { ZOP_GENERIC, ZOP_LOAD, ZOP_STORE, ZOP_LJMP, ZOP_BRANCH
+	} ZOPKIND;
+
+class	ZOPDECODE {
+public:
+	const ZOPCODE	*m_list;
+	int		m_shift;
+	// For bucket b, the candidates are m_cand[m_start[b]] up to (but not
+	// including) m_cand[m_start[b+1]]
+	unsigned	m_start[ZOP_TBLSZ+1];
+	unsigned short	*m_cand;
+	ZOPKIND		*m_kind;
+
+	ZOPDECODE(const ZOPCODE *listp, int shift) : m_list(listp),
+			m_shift(shift) {
+		const	ZIPI	idxmask = (ZOP_TBLSZ-1) << shift;
+		int	nlist, ncand = 0;
+
+		// The list ends with a catch-all (mask == 0) ILL opcode,
+		// which we never match
+		for(nlist=0; listp[nlist].s_mask != 0; nlist++) {
+			if (((~listp[nlist].s_mask)&listp[nlist].s_val)!=0) {
+				printf("Instruction %d, %s, fails consistency check\n",
+					nlist, listp[nlist].s_opstr);
+				printf("%08x & %08x = %08x != %08x\n",
+					listp[nlist].s_mask,
+					listp[nlist].s_val,
+					(~listp[nlist].s_mask)&listp[nlist].s_val,
+					0);
+				assert(((~listp[nlist].s_mask)&listp[nlist].s_val)==0);
+			}
+		}
+
+		m_kind = new ZOPKIND[nlist];
+		for(int i=0; i<nlist; i++)
+			m_kind[i] = classify(listp[i].s_opstr);
+
+		// Count the candidates first, so we can allocate them all at
+		// once
+		for(unsigned b=0; b<ZOP_TBLSZ; b++)
+			for(int i=0; i<nlist; i++)
+				if (compatible(listp[i], (b<<shift), idxmask))
+					ncand++;
+
+		m_cand = new unsigned short[ncand];
+		ncand = 0;
+		for(unsigned b=0; b<ZOP_TBLSZ; b++) {
+			m_start[b] = ncand;
+			for(int i=0; i<nlist; i++)
+				if (compatible(listp[i], (b<<shift), idxmask))
+					m_cand[ncand++] = i;
+		} m_start[ZOP_TBLSZ] = ncand;
+	}
+
+	~ZOPDECODE(void) {
+		delete[] m_cand;
+		delete[] m_kind;
+	}
+
+	static	bool	compatible(const ZOPCODE &op, ZIPI v, ZIPI idxmask) {
+		return (((v ^ op.s_val) & op.s_mask & idxmask)==0);
+	}
+
+	static	ZOPKIND	classify(const char *opstr) {
+		// Stores are printed as Rx,off(Ry)
+		if ((strncasecmp("SW",opstr, 2)==0)
+				||(strncasecmp("SH",opstr, 2)==0)
+				||(strncasecmp("SB",opstr, 2)==0))
+			return ZOP_STORE;
+		// Long jumps print nothing but their name, since the target
+		// is found in the next word
+		if (strncasecmp("LJMP",opstr, 3)==0)
+			return ZOP_LJMP;
+		// Branch instructions start with B, but BUSY, BREV (bit
+		// reverse), and BRK (break) aren't branches
+		if ((opstr[0]=='B')
+				&&(strcasecmp(opstr,"BUSY")!=0)
+				&&(strcasecmp(opstr,"BREV")!=0)
+				&&(strcasecmp(opstr,"BRK")!=0))
+			return ZOP_BRANCH;
+		// Loads: LW, LH, and LB
+		if (('L'==toupper(opstr[0]))
+				&&(('W'==toupper(opstr[1]))
+				 ||('H'==toupper(opstr[1]))
+				 ||('B'==toupper(opstr[1])))
+				&&(!opstr[2]))
+			return ZOP_LOAD;
+		return ZOP_GENERIC;
+	}
+
+	// Returns the index of the matching opcode within the list, or -1
+	// if the instruction is illegal
+	int	lookup(const ZIPI ins) const {
+		unsigned	b = (ins >> m_shift) & (ZOP_TBLSZ-1);
+
+		for(unsigned k=m_start[b]; k<m_start[b+1]; k++) {
+			const ZOPCODE	*op = &m_list[m_cand[k]];
+			if ((ins & op->s_mask) == op->s_val)
+				return m_cand[k];
+		} return -1;
+	}
+};
+
+static	const ZOPDECODE	&
+zop_decoder(const ZOPCODE *listp) {
+	// 32-bit instructions, and the first half of CIS instructions, are
+	// decoded by bits 31:22 (the CIS flag, register, and opcode).  The
+	// second half of a CIS instruction is decoded by bits 14:5.
+	static	const ZOPDECODE	top(zip_oplist_raw, 22),
+				bottom(zip_opbottomlist_raw, 5);
+
+	return (listp == zip_opbottomlist) ? bottom : top;
+}
+
+//
+// A couple of quick string helpers, to replace sprintf() in the disassembler.
+// Each appends to the string at p, and returns a pointer to the new end of
+// the string--which is always left NUL terminated.
+//
+static inline char *
+zop_puts(char *p, const char *s) {
+	while(*s)
+		*p++ = *s++;
+	*p = '\0';
+	return p;
+}
+
+static inline char *
+zop_pad(char *line, char *p, const unsigned width) {
+	while(p < line + width)
+		*p++ = ' ';
+	*p = '\0';
+	return p;
+}
+
+static char *
+zop_putd(char *p, const int v) {
+	char		tmp[12], *t = tmp;
+	unsigned	u = (v < 0) ? -(unsigned)v : v;
+
+	do {
+		*t++ = '0' + (u % 10);
+		u /= 10;
+	} while(u);
+	if (v < 0)
+		*p++ = '-';
+	while(t > tmp)
+		*p++ = *--t;
+	*p = '\0';
+	return p;
+}
+
+// Eight hex digits, without any 0x prefix
+static char *
+zop_putx(char *p, const uint32_t v) {
+	static const char	hex[] = "0123456789abcdef";
+
+	for(int k=28; k>=0; k-=4)
+		*p++ = hex[(v>>k)&0x0f];
+	*p = '\0';
+	return p;
+}
+
 static	void
 zipi_to_halfstring(const uint32_t addr, const ZIPI ins, char *line, const ZOPCODE *listp) {
+	char	*p = line;
 
 	if (OFFSET_PC_MOV(ins)) {
 		int	cv = zip_getbits(ins, ZIP_BITFIELD(3,19));
@@ -521,126 +701,119 @@ zipi_to_halfstring(const uint32_t addr, const ZIPI ins, char *line, const ZOPCOD
 
 		ref = (iv<<2) + addr + 4;
 
-		sprintf(line, "%s%s", "MOV", zip_ccstr[cv]);
-		sprintf(line, "%-11s", line);
-		sprintf(line, "%s0x%08x", line, ref);
-		sprintf(line, "%s,%s", line, zip_regstr[dv]);
+		p = zop_puts(p, "MOV");
+		p = zop_puts(p, zip_ccstr[cv]);
+		p = zop_pad(line, p, 11);
+		p = zop_puts(p, "0x");
+		p = zop_putx(p, ref);
+		*p++ = ',';
+		p = zop_puts(p, zip_regstr[dv]);
 
 		return;
 	}
 
-	int	i;
-	for(i=0; i<nzip_oplist; i++) {
-		if (((~zip_oplist[i].s_mask)&zip_oplist[i].s_val)!=0) {
-			printf("Instruction %d, %s, fails consistency check\n",
-				i, zip_oplist[i].s_opstr);
-			printf("%08x & %08x = %08x != %08x\n",
-				zip_oplist[i].s_mask,
-				zip_oplist[i].s_val,
-				(~zip_oplist[i].s_mask)&zip_oplist[i].s_val,
-				0);
-			assert(((~zip_oplist[i].s_mask)&zip_oplist[i].s_val)==0);
+	const ZOPDECODE	&dec = zop_decoder(listp);
+	int	i = dec.lookup(ins);
+
+	if (i < 0) {
+		p = zop_puts(p, "ILL ");
+		p = zop_putx(p, ins);
+		return;
+	}
+
+	const ZOPCODE	*op = &listp[i];
+
+	// Write the opcode onto our line
+	p = zop_puts(p, op->s_opstr);
+	if (op->s_cf != ZIP_OPUNUSED) {
+		int bv = zip_getbits(ins, op->s_cf);
+		p = zop_puts(p, zip_ccstr[bv]);
+	} p = zop_pad(line, p, 11); // Pad it to 11 chars
+
+	int	ra = -1, rb = -1, rr = -1, imv = 0;
+
+	if (op->s_result != ZIP_OPUNUSED)
+		rr = zip_getbits(ins, op->s_result);
+	if (op->s_ra != ZIP_OPUNUSED)
+		ra = zip_getbits(ins, op->s_ra);
+	if (op->s_rb != ZIP_OPUNUSED)
+		rb = zip_getbits(ins, op->s_rb);
+	if (op->s_i != ZIP_OPUNUSED)
+		imv = zip_getbits(ins, op->s_i);
+
+	if ((op->s_rb != ZIP_OPUNUSED)&&(rb == 15))
+		imv <<= 2;
+
+	ZOPKIND	kind = dec.m_kind[i];
+	if ((kind == ZOP_BRANCH)&&(addr == 0))
+		kind = ZOP_GENERIC;
+
+	switch(kind) {
+	case ZOP_STORE:
+		// Treat stores special
+		p = zop_puts(p, zip_regstr[ra]);
+		*p++ = ',';
+		*p = '\0';
+
+		if (op->s_i != ZIP_OPUNUSED) {
+			if (op->s_rb == ZIP_OPUNUSED) {
+				p = zop_puts(p, "($");
+				p = zop_putd(p, imv);
+				p = zop_puts(p, ")");
+			} else if (imv != 0) {
+				*p++ = '$';
+				p = zop_putd(p, imv);
+			}
+		} if (op->s_rb != ZIP_OPUNUSED) {
+			*p++ = '(';
+			p = zop_puts(p, zip_regstr[rb]);
+			p = zop_puts(p, ")");
 		}
-	} line[0] = '\0';
-	for(i=0; (listp[i].s_mask != 0); i++) {
-		// printf("%2d: %6s %08x & %08x == %08x\n",
-			// i, zip_oplist[i].s_opstr, ins,
-			// zip_oplist[i].s_mask, zip_oplist[i].s_val);
-		if ((ins & listp[i].s_mask) == listp[i].s_val) {
-			// Write the opcode onto our line
-			sprintf(line, "%s", listp[i].s_opstr);
-			if (listp[i].s_cf != ZIP_OPUNUSED) {
-				int bv = zip_getbits(ins, listp[i].s_cf);
-				strcat(line, zip_ccstr[bv]);
-			} sprintf(line, "%-11s", line); // Pad it to 11 chars
-
-			int	ra = -1, rb = -1, rr = -1, imv = 0;
-
-			if (listp[i].s_result != ZIP_OPUNUSED)
-				rr = zip_getbits(ins, listp[i].s_result);
-			if (listp[i].s_ra != ZIP_OPUNUSED)
-				ra = zip_getbits(ins, listp[i].s_ra);
-			if (listp[i].s_rb != ZIP_OPUNUSED)
-				rb = zip_getbits(ins, listp[i].s_rb);
-			if (listp[i].s_i != ZIP_OPUNUSED)
-				imv = zip_getbits(ins, listp[i].s_i);
-
-			if ((listp[i].s_rb != ZIP_OPUNUSED)&&(rb == 15))
-				imv <<= 2;
-
-			// Treat stores special
-			if ((strncasecmp("SW",listp[i].s_opstr, 2)==0)
-				||(strncasecmp("SH",listp[i].s_opstr, 2)==0)
-				||(strncasecmp("SB",listp[i].s_opstr, 2)==0)) {
-				strcat(line, zip_regstr[ra]);
-				strcat(line, ",");
-					
-				if (listp[i].s_i != ZIP_OPUNUSED) {
-					if (listp[i].s_rb == ZIP_OPUNUSED)
-						sprintf(&line[strlen(line)],
-							"($%d)", imv);
-					else if (imv != 0)
-						sprintf(&line[strlen(line)],
-							"$%d", imv);
-				} if (listp[i].s_rb != ZIP_OPUNUSED) {
-					sprintf(&line[strlen(line)],
-						"(%s)", zip_regstr[rb]);
-				}
-			// Treat long jumps special
-			} else if (strncasecmp("LJMP",listp[i].s_opstr, 3)==0) {
-			// Treat relative jumps (branches) specially as well
-			} else if ((toupper(listp[i].s_opstr[0]=='B'))
-				&&(strcasecmp(listp[i].s_opstr,"BUSY")!=0)
-				&&(strcasecmp(listp[i].s_opstr,"BREV")!=0)
-				&&(strcasecmp(listp[i].s_opstr,"BRK")!=0)
-				&&(addr != 0)) {
-				// Branch instruction: starts with B and isn't
-				// BREV (bit reverse), BRK (break), or 
-				// BUSY
-				uint32_t target = addr;
-
-				target += zip_getbits(ins, listp[i].s_i)+4;
-				sprintf(&line[strlen(line)], "@0x%08x", target);
-			} else {
-				int memop = 0;
-				if (('L'==toupper(listp[i].s_opstr[0]))
-					&&(('W'==toupper(listp[i].s_opstr[1]))
-					 ||('H'==toupper(listp[i].s_opstr[1]))
-					 ||('B'==toupper(listp[i].s_opstr[1])))
-					&&(!listp[i].s_opstr[2]))
-					memop = 1;
-
-				if (listp[i].s_i != ZIP_OPUNUSED) {
-					if((memop)&&(listp[i].s_rb == ZIP_OPUNUSED))
-						sprintf(&line[strlen(line)],
-							"($%d)", imv);
-					else if((memop)&&(imv != 0))
-						sprintf(&line[strlen(line)],
-							"%d", imv);
-					else if((!memop)&&((imv != 0)||(listp[i].s_rb == ZIP_OPUNUSED)))
-						sprintf(&line[strlen(line)],
-							"$%d%s", imv,
-							(listp[i].s_rb!=ZIP_OPUNUSED)?"+":"");
-				} if (listp[i].s_rb != ZIP_OPUNUSED) {
-					if (memop)
-						sprintf(&line[strlen(line)],
-							"(%s)", zip_regstr[rb]);
-					else
-						strcat(line, zip_regstr[rb]);
-				} if(((listp[i].s_i != ZIP_OPUNUSED)||(listp[i].s_rb != ZIP_OPUNUSED))
-					&&((listp[i].s_ra != ZIP_OPUNUSED)||(listp[i].s_result != ZIP_OPUNUSED)))
-					strcat(line, ",");
-
-				if (listp[i].s_ra != ZIP_OPUNUSED) {
-					strcat(line, zip_regstr[ra]);
-				} else if (listp[i].s_result != ZIP_OPUNUSED) {
-					strcat(line, zip_regstr[rr]);
-				}
+		break;
+	case ZOP_LJMP:
+		// Treat long jumps special
+		break;
+	case ZOP_BRANCH: {
+		// Treat relative jumps (branches) specially as well
+		uint32_t target = addr;
+
+		target += zip_getbits(ins, op->s_i)+4;
+		p = zop_puts(p, "@0x");
+		p = zop_putx(p, target);
+		} break;
+	default: {
+		int memop = (kind == ZOP_LOAD);
+
+		if (op->s_i != ZIP_OPUNUSED) {
+			if((memop)&&(op->s_rb == ZIP_OPUNUSED)) {
+				p = zop_puts(p, "($");
+				p = zop_putd(p, imv);
+				p = zop_puts(p, ")");
+			} else if((memop)&&(imv != 0))
+				p = zop_putd(p, imv);
+			else if((!memop)&&((imv != 0)||(op->s_rb == ZIP_OPUNUSED))) {
+				*p++ = '$';
+				p = zop_putd(p, imv);
+				if (op->s_rb!=ZIP_OPUNUSED)
+					p = zop_puts(p, "+");
 			}
-			break;
+		} if (op->s_rb != ZIP_OPUNUSED) {
+			if (memop) {
+				*p++ = '(';
+				p = zop_puts(p, zip_regstr[rb]);
+				p = zop_puts(p, ")");
+			} else
+				p = zop_puts(p, zip_regstr[rb]);
+		} if(((op->s_i != ZIP_OPUNUSED)||(op->s_rb != ZIP_OPUNUSED))
+			&&((op->s_ra != ZIP_OPUNUSED)||(op->s_result != ZIP_OPUNUSED)))
+			p = zop_puts(p, ",");
+
+		if (op->s_ra != ZIP_OPUNUSED) {
+			p = zop_puts(p, zip_regstr[ra]);
+		} else if (op->s_result != ZIP_OPUNUSED) {
+			p = zop_puts(p, zip_regstr[rr]);
 		}
-	} if (line[0] == '\0') {
-		sprintf(line, "ILL %08x", ins);
+		} break;
 	}
 }
 
@@ -654,6 +827,40 @@ zipi_to_double_string(const uint32_t addr, const ZIPI ins, char *la, char *lb) {
 	}
 }
 
+//
+// zip_disassemble
+//
+// Disassembles a whole buffer of instructions, such as a firmware image or
+// a captured trace, one line per instruction word:
+//
+//	address: word  first-half | second-half
+//
+// The second half is only present for compressed (CIS) instruction words.
+//
+void
+zip_disassemble(FILE *fp, const uint32_t addr, const ZIPI *ins,
+		const unsigned n) {
+	char	line[128], la[64], lb[64];
+
+	for(unsigned k=0; k<n; k++) {
+		uint32_t	a = addr + 4*k;
+		char		*p = line;
+
+		zipi_to_double_string(a, ins[k], la, lb);
+		p = zop_putx(p, a);
+		p = zop_puts(p, ": ");
+		p = zop_putx(p, ins[k]);
+		p = zop_puts(p, "  ");
+		p = zop_puts(p, la);
+		if (lb[0]) {
+			p = zop_pad(line, p, 8+2+8+2+25);
+			p = zop_puts(p, "| ");
+			p = zop_puts(p, lb);
+		} *p++ = '\n';
+		fwrite(line, 1, p-line, fp);
+	}
+}
+
 unsigned int	zop_early_branch(const unsigned int pc, const ZIPI insn) {
 	if ((insn & 0xf8000000) != 0x78000000)
 		return pc+4;
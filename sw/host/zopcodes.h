@@ -39,6 +39,7 @@
 #ifndef	ZOPCODES_H
 #define	ZOPCODES_H
 
+#include <stdio.h>
 #include <stdint.h>
 
 // MACROS used in the instruction definition list.
@@ -82,6 +83,9 @@ extern	const int	nzip_oplist, nzip_opbottom;
 
 // Disassemble an opcode
 extern	void zipi_to_double_string(const uint32_t, const ZIPI, char *, char *);
+// Disassemble a whole buffer of instructions, starting at the given address
+extern	void zip_disassemble(FILE *fp, const uint32_t addr, const ZIPI *ins,
+		const unsigned n);
 extern	const	char	*zop_regstr[];
 extern	const	char	*zop_ccstr[];
 extern	unsigned int	zop_early_branch(const unsigned int pc, const ZIPI ins);
@@ -0,0 +1,178 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	memcpy.c
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	memcpy() and memmove(), written for the ZipCPU rather than
+//		taken from newlib's generic C.  Since this library is linked
+//	ahead of the C library, these are the versions every program gets.
+//
+//	Once the destination is word aligned, the copy moves eight words at a
+//	time: eight loads back to back, so the CPU can issue them as one
+//	pipelined bus burst, followed by eight stores.  If the source is not
+//	aligned the same way as the destination, it is still read a word at a
+//	time, and each pair of words is shifted together into the word the
+//	destination wants.  Only the odd bytes at either end are moved one
+//	at a time.
+//
+//	This file needs to be built with -fno-tree-loop-distribute-patterns,
+//	lest GCC turn the byte loops back into calls to memcpy().
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "memword.h"
+
+// Copy upwards, from the bottom of the buffers to the top.  This is also safe
+// for memmove() whenever the destination is below the source, since nothing is
+// ever stored on top of source bytes that haven't yet been read.
+static void
+fwdcopy(char *dc, const char *sc, size_t n) {
+	if (n >= 16) {
+		MWORD	*dw;
+
+		while((uintptr_t)dc & WORDMASK) {
+			*dc++ = *sc++;
+			n--;
+		}
+
+		dw = (MWORD *)dc;
+		if (((uintptr_t)sc & WORDMASK)==0) {
+			const MWORD	*sw = (const MWORD *)sc;
+
+			for(; n >= 32; n -= 32, sw += 8, dw += 8) {
+				MWORD	a = sw[0], b = sw[1], c = sw[2], d = sw[3],
+					e = sw[4], f = sw[5], g = sw[6], h = sw[7];
+
+				dw[0] = a; dw[1] = b; dw[2] = c; dw[3] = d;
+				dw[4] = e; dw[5] = f; dw[6] = g; dw[7] = h;
+			}
+
+			for(; n >= 4; n -= 4)
+				*dw++ = *sw++;
+			sc = (const char *)sw;
+		} else {
+			// The source is misaligned.  Read it by aligned words
+			// anyway, since the word holding the next byte we want
+			// can always be read, and shift them into place.
+			int		lsh = ((uintptr_t)sc & WORDMASK) * 8,
+					rsh = 32 - lsh;
+			const MWORD	*sw = (const MWORD *)
+						((uintptr_t)sc & ~WORDMASK);
+			MWORD		w0 = *sw++;
+
+			for(; n >= 16; n -= 16, sw += 4, dw += 4) {
+				MWORD	a = sw[0], b = sw[1], c = sw[2], d = sw[3];
+
+				dw[0] = WORDMERGE(w0, a, lsh, rsh);
+				dw[1] = WORDMERGE(a,  b, lsh, rsh);
+				dw[2] = WORDMERGE(b,  c, lsh, rsh);
+				dw[3] = WORDMERGE(c,  d, lsh, rsh);
+				w0 = d;
+			}
+
+			for(; n >= 4; n -= 4) {
+				MWORD	a = *sw++;
+
+				*dw++ = WORDMERGE(w0, a, lsh, rsh);
+				w0 = a;
+			}
+
+			// w0 came from the word before sw, and we've used all
+			// but the last (32-lsh)/8 bytes of it
+			sc = (const char *)(sw - 1) + (lsh >> 3);
+		}
+		dc = (char *)dw;
+	}
+
+	while(n > 0) {
+		*dc++ = *sc++;
+		n--;
+	}
+}
+
+void *
+memcpy(void *restrict dst, const void *restrict src, size_t n) {
+	fwdcopy((char *)dst, (const char *)src, n);
+	return dst;
+}
+
+void *
+memmove(void *dst, const void *src, size_t n) {
+	char		*dc = (char *)dst;
+	const char	*sc = (const char *)src;
+
+	// If the destination is below the source, or doesn't overlap it, a
+	// forward copy will do
+	if ((uintptr_t)dc - (uintptr_t)sc >= n) {
+		fwdcopy(dc, sc, n);
+		return dst;
+	}
+
+	// Otherwise copy downwards, from the top
+	dc += n;
+	sc += n;
+	if ((n >= 16)&&((((uintptr_t)dc ^ (uintptr_t)sc) & WORDMASK)==0)) {
+		MWORD		*dw;
+		const MWORD	*sw;
+
+		while((uintptr_t)dc & WORDMASK) {
+			*--dc = *--sc;
+			n--;
+		}
+
+		dw = (MWORD *)dc;
+		sw = (const MWORD *)sc;
+		for(; n >= 32; n -= 32) {
+			MWORD	a, b, c, d, e, f, g, h;
+
+			sw -= 8;
+			a = sw[0]; b = sw[1]; c = sw[2]; d = sw[3];
+			e = sw[4]; f = sw[5]; g = sw[6]; h = sw[7];
+			dw -= 8;
+			dw[0] = a; dw[1] = b; dw[2] = c; dw[3] = d;
+			dw[4] = e; dw[5] = f; dw[6] = g; dw[7] = h;
+		}
+
+		for(; n >= 4; n -= 4)
+			*--dw = *--sw;
+
+		dc = (char *)dw;
+		sc = (const char *)sw;
+	}
+
+	// Overlapping copies with mismatched alignment are rare enough to be
+	// left a byte at a time
+	while(n > 0) {
+		*--dc = *--sc;
+		n--;
+	}
+
+	return dst;
+}
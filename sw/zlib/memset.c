@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	memset.c
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	memset(), written for the ZipCPU rather than taken from
+//		newlib's generic C.  Once the pointer is word aligned, the
+//	fill value is stored eight words at a time.
+//
+//	As with memcpy.c, this needs -fno-tree-loop-distribute-patterns, or
+//	GCC will turn the byte loops into calls to memset() itself.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "memword.h"
+
+void *
+memset(void *dst, int c, size_t n) {
+	char	*dc = (char *)dst;
+
+	if (n >= 16) {
+		MWORD	*dw, w;
+
+		while((uintptr_t)dc & WORDMASK) {
+			*dc++ = (char)c;
+			n--;
+		}
+
+		w = (c & 0x0ff) * 0x01010101u;
+		dw = (MWORD *)dc;
+		for(; n >= 32; n -= 32, dw += 8) {
+			dw[0] = w; dw[1] = w; dw[2] = w; dw[3] = w;
+			dw[4] = w; dw[5] = w; dw[6] = w; dw[7] = w;
+		}
+
+		for(; n >= 4; n -= 4)
+			*dw++ = w;
+		dc = (char *)dw;
+	}
+
+	while(n > 0) {
+		*dc++ = (char)c;
+		n--;
+	}
+
+	return dst;
+}
@@ -1,10 +1,11 @@
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Filename:	zipelf.h
+// Filename:	memword.h
 //
 // Project:	OpenArty, an entirely open SoC based upon the Arty platform
 //
-// Purpose:	
+// Purpose:	Definitions shared between memcpy.c and memset.c, for moving
+//		memory a word at a time.
 //
 //
 // Creator:	Dan Gisselquist, Ph.D.
@@ -12,7 +13,7 @@
 //
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Copyright (C) 2015-2020, Gisselquist Technology, LLC
+// Copyright (C) 2020, Gisselquist Technology, LLC
 //
 // This program is free software (firmware): you can redistribute it and/or
 // modify it under the terms of  the GNU General Public License as published
@@ -24,11 +25,6 @@
 // FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
 // for more details.
 //
-// You should have received a copy of the GNU General Public License along
-// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
-// target there if the PDF file isn't present.)  If not, see
-// <http://www.gnu.org/licenses/> for a copy.
-//
 // License:	GPL, v3, as defined and found on www.gnu.org,
 //		http://www.gnu.org/licenses/gpl.html
 //
@@ -36,18 +32,25 @@
 ////////////////////////////////////////////////////////////////////////////////
 //
 //
-#ifndef	ZIPELF_H
-#define	ZIPELF_H
+#ifndef	MEMWORD_H
+#define	MEMWORD_H
 
 #include <stdint.h>
 
-class	ELFSECTION {
-public:
-	uint32_t	m_start, m_len;
-	char		m_data[4];
-};
+// Words are read from, and written to, byte buffers.  may_alias tells GCC
+// that they may overlap any other type.
+typedef	uint32_t __attribute__((__may_alias__))	MWORD;
+
+#define	WORDMASK	((uintptr_t)3)
 
-bool	iself(const char *fname);
-void	elfread(const char *fname, uint32_t &entry, ELFSECTION **&sections);
+// Build one destination word from two consecutive aligned source words, when
+// the source sits lsh/8 bytes further into its word than the destination.
+// The ZipCPU is big endian: the byte at the lowest address is the most
+// significant.  The other case is only here for testing on a host.
+#if	defined(__BYTE_ORDER__)&&(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define	WORDMERGE(A,B,LSH,RSH)	(((A) >> (LSH)) | ((B) << (RSH)))
+#else
+#define	WORDMERGE(A,B,LSH,RSH)	(((A) << (LSH)) | ((B) >> (RSH)))
+#endif
 
 #endif
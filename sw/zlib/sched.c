@@ -0,0 +1,284 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	sched.c
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	A small priority scheduler for user tasks.  See sched.h for
+//		how it's used.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include "zipcpu.h"
+#include "zipsys.h"
+#include "sched.h"
+
+unsigned	sched_faults = 0;
+
+static	TASK	m_tasks[SCHED_MAXTASKS];
+static	struct	{
+	unsigned	i_mask;
+	void		(*i_fn)(void);
+} m_isrs[SCHED_MAXISRS];
+static	int	m_nisrs = 0;
+static	int	(*m_trap)(int *) = NULL;
+
+// The index of the task last run, or -1 for the idle task
+static	int	m_current = -1;
+
+// The idle task runs, in user mode, whenever no other task is ready
+static	int	m_idle_context[16], m_idle_stack[16];
+static	void	sched_idle(void) {
+	while(1)
+		zip_idle();
+}
+
+/*
+ * sched_task()
+ *
+ * Adds a task to run once sched_run() is called, starting at entry(arg) with
+ * the given stack.  Tasks with larger priorities run first.  Returns the
+ * task's index, or -1 if there's no room for it.
+ */
+int	sched_task(void (*entry)(void *), void *arg, int *stack,
+			int stackwords, int priority) {
+	for(int k=0; k<SCHED_MAXTASKS; k++) {
+		TASK	*t = &m_tasks[k];
+
+		if ((t->t_state != TASK_FREE)&&(t->t_state != TASK_DONE))
+			continue;
+
+		for(int i=0; i<16; i++)
+			t->t_context[i] = 0;
+		t->t_context[0]  = (int)task_exit;	// Return address
+		t->t_context[1]  = (int)arg;
+		t->t_context[13] = (int)&stack[stackwords];
+		t->t_context[15] = (int)entry;
+		t->t_priority = priority;
+		t->t_waitmask = 0;
+		t->t_sleep    = 0;
+		t->t_state    = TASK_READY;
+		return k;
+	}
+
+	return -1;
+}
+
+/*
+ * sched_isr()
+ *
+ * Calls isr(), from the supervisor, whenever any of the interrupts in intmask
+ * are seen.  The handler is responsible for enabling and disabling these
+ * interrupts itself.
+ */
+int	sched_isr(unsigned intmask, void (*isr)(void)) {
+	if (m_nisrs >= SCHED_MAXISRS)
+		return -1;
+	m_isrs[m_nisrs].i_mask = intmask;
+	m_isrs[m_nisrs].i_fn   = isr;
+	m_nisrs++;
+	return 0;
+}
+
+/*
+ * sched_trap()
+ *
+ * Passes any trap ID the scheduler doesn't know to handler(), together with
+ * the task's registers.  Register one holds the trap ID, two through four its
+ * arguments, and whatever is left in register one is returned to the task.
+ * If the handler returns non-zero, or there is no handler, the task is
+ * stopped as though it had faulted.
+ */
+void	sched_trap(int (*handler)(int *context)) {
+	m_trap = handler;
+}
+
+// Pick the next task to run: the ready task with the highest priority, taking
+// turns with any others of the same priority
+static	int	pick(void) {
+	int	best = -1;
+
+	for(int i=1; i<=SCHED_MAXTASKS; i++) {
+		int	k = (m_current + i + SCHED_MAXTASKS) % SCHED_MAXTASKS;
+
+		if (m_tasks[k].t_state != TASK_READY)
+			continue;
+		if ((best < 0)||(m_tasks[k].t_priority > m_tasks[best].t_priority))
+			best = k;
+	}
+
+	return best;
+}
+
+// Handle a trap from task t
+static	void	trap(TASK *t) {
+	int	*ctx = t->t_context;
+
+	ctx[14] &= ~CC_TRAP;
+	switch(ctx[1]) {
+	case KTRAPID_YIELD:
+		ctx[1] = 0;
+		break;
+	case KTRAPID_WAIT:
+		t->t_waitmask = ctx[2] & 0x07fff;
+		t->t_sleep    = ctx[3];
+		ctx[1] = 0;
+		if ((t->t_waitmask)||(t->t_sleep))
+			t->t_state = TASK_WAITING;
+		break;
+	case KTRAPID_EXIT:
+		t->t_state = TASK_DONE;
+		break;
+	default:
+		if ((!m_trap)||(m_trap(ctx) != 0)) {
+			t->t_state = TASK_DONE;
+			sched_faults++;
+		}
+	}
+}
+
+/*
+ * sched_run()
+ *
+ * Runs the tasks, from the supervisor, until every one of them has exited.
+ * quantum is the number of clocks a task may run before another of the same
+ * priority gets a turn, and also the unit task_wait() sleeps in.  A quantum
+ * of zero leaves timer B alone, and tasks then only change when they wait,
+ * yield, or exit.
+ */
+void	sched_run(unsigned quantum) {
+	unsigned	enabled = 0;
+
+	for(int i=0; i<16; i++)
+		m_idle_context[i] = 0;
+	m_idle_context[13] = (int)&m_idle_stack[16];
+	m_idle_context[15] = (int)sched_idle;
+
+	if (quantum)
+		_zip->z_tmb = TMR_INTERVAL | quantum;
+
+	while(1) {
+		unsigned	want, picv, fired, ucc;
+		int		cur, *ctx, live = 0;
+
+		cur = pick();
+		for(int k=0; k<SCHED_MAXTASKS; k++)
+			if ((m_tasks[k].t_state == TASK_READY)
+				||(m_tasks[k].t_state == TASK_WAITING))
+				live = 1;
+		if (!live)
+			break;
+
+		if (cur >= 0) {
+			m_current = cur;
+			ctx = m_tasks[cur].t_context;
+		} else
+			ctx = m_idle_context;
+
+		// Turn on the interrupts the waiting tasks need, together with
+		// the timer, and turn off any no longer needed
+		want = (quantum) ? SYSINT_TMB : 0;
+		for(int k=0; k<SCHED_MAXTASKS; k++)
+			if (m_tasks[k].t_state == TASK_WAITING)
+				want |= m_tasks[k].t_waitmask;
+		if (enabled & ~want)
+			_zip->z_pic = DINT(enabled & ~want);
+		_zip->z_pic = EINT(want);
+		enabled = want;
+
+		restore_context(ctx);
+		if ((_zip->z_pic & INTNOW)==0)
+			zip_rtu();
+		save_context(ctx);
+
+		// Acknowledge only those interrupts someone is waiting on, or
+		// that have a handler and are turned on.  Any others stay
+		// pending, for whoever waits on them next.
+		picv = _zip->z_pic;
+		fired = picv & want;
+		for(int i=0; i<m_nisrs; i++)
+			fired |= picv & (picv >> 16) & m_isrs[i].i_mask;
+		fired &= 0x07fff;
+		if (fired)
+			_zip->z_pic = fired;
+
+		ucc = zip_ucc();
+		if (cur >= 0) {
+			if (ucc & CC_FAULT) {
+				m_tasks[cur].t_state = TASK_DONE;
+				sched_faults++;
+			} else if (ucc & CC_TRAP)
+				trap(&m_tasks[cur]);
+		}
+
+		for(int i=0; i<m_nisrs; i++)
+			if (fired & m_isrs[i].i_mask)
+				m_isrs[i].i_fn();
+
+		// Wake any task whose interrupt has come, or whose time is up
+		for(int k=0; k<SCHED_MAXTASKS; k++) {
+			TASK	*t = &m_tasks[k];
+			unsigned hit;
+
+			if (t->t_state != TASK_WAITING)
+				continue;
+			hit = fired & t->t_waitmask;
+			if ((!hit)&&((t->t_sleep == 0)||((fired & SYSINT_TMB)==0)
+					||(--t->t_sleep != 0)))
+				continue;
+
+			t->t_context[1] = hit;
+			t->t_waitmask = 0;
+			t->t_sleep = 0;
+			t->t_state = TASK_READY;
+		}
+	}
+
+	if (quantum)
+		_zip->z_tmb = 0;
+	_zip->z_pic = DINT(enabled);
+}
+
+/*
+ * task_wait()
+ *
+ * Called from a task.  Waits until one of the interrupts in intmask occurs,
+ * returning those that did, or until quanta timer ticks have passed,
+ * returning zero.  A quanta of zero waits on the interrupts alone.
+ */
+unsigned task_wait(unsigned intmask, unsigned quanta) {
+	return syscall(KTRAPID_WAIT, intmask, quanta, 0);
+}
+
+void	task_yield(void) {
+	syscall(KTRAPID_YIELD, 0, 0, 0);
+}
+
+void	task_exit(void) {
+	syscall(KTRAPID_EXIT, 0, 0, 0);
+	while(1)
+		;
+}
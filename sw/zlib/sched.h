@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	sched.h
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	A small priority scheduler, so that one program may run
+//		several user tasks at once--one for the network, one for the
+//	GPS, one for the display--each waiting on its own interrupts rather
+//	than polling.
+//
+//	The supervisor sets up its tasks with sched_task(), and then hands the
+//	CPU over to sched_run().  From then on, the highest priority task that
+//	is ready runs, in user mode.  Tasks of equal priority take turns, one
+//	quantum (timer B interval) at a time.  A task gives up the CPU by
+//	calling task_wait(), to wait for any of a set of interrupts and/or a
+//	number of quanta, task_yield(), or task_exit().  Returning from the
+//	task's function is the same as calling task_exit().
+//
+//	Interrupts that need attention before any task can run, such as
+//	refilling the console's FIFO, may be given supervisor handlers with
+//	sched_isr().  Such handlers enable and disable their own interrupt
+//	sources.  The scheduler only turns on those interrupts that a task is
+//	waiting upon, together with the timer.
+//
+//	The scheduler switches tasks with save_context() and restore_context(),
+//	and traps into the supervisor with syscall().  Programs using it need
+//	to link with zipcpu.o from the board directory.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	SCHED_H
+#define	SCHED_H
+
+#define	SCHED_MAXTASKS	8
+#define	SCHED_MAXISRS	4
+
+// Trap ID's used by the task calls below
+#define	KTRAPID_YIELD	0x100
+#define	KTRAPID_WAIT	0x101
+#define	KTRAPID_EXIT	0x102
+
+// Task states
+#define	TASK_FREE	0
+#define	TASK_READY	1
+#define	TASK_WAITING	2
+#define	TASK_DONE	3
+
+typedef	struct	TASK_S {
+	int		t_context[16];	// Registers, while the task isn't running
+	int		t_state, t_priority;
+	unsigned	t_waitmask;	// Interrupts that will wake the task
+	unsigned	t_sleep;	// Quanta left before the task wakes anyway
+} TASK;
+
+extern	unsigned	sched_faults;
+
+// Supervisor calls
+extern	int	sched_task(void (*entry)(void *), void *arg, int *stack,
+			int stackwords, int priority);
+extern	int	sched_isr(unsigned intmask, void (*isr)(void));
+extern	void	sched_trap(int (*handler)(int *context));
+extern	void	sched_run(unsigned quantum);
+
+// Task (user mode) calls
+extern	unsigned task_wait(unsigned intmask, unsigned quanta);
+extern	void	task_yield(void);
+extern	void	task_exit(void) __attribute__((noreturn));
+#define	task_sleep(QUANTA)	task_wait(0, (QUANTA))
+
+#endif
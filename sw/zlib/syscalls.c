@@ -42,6 +42,7 @@
 #include "board.h"
 #include "bootloader.h"
 #include "zipcpu.h"
+#include "txbuf.h"
 
 #ifdef	_BOARD_HAS_BUSCONSOLE
 #define	_ZIP_HAS_WBUART
@@ -67,18 +68,8 @@
 void
 _outbyte(char v) {
 #ifdef	UARTTX
-	if (v == '\n') {
-		// Depend upon the WBUART, not the PIC
-		while(TXWAIT)
-			;
-		UARTTX = (unsigned)'\r';
-	}
-
-	// Depend upon the WBUART, not the PIC
-	while(TXWAIT)
-		;
-	uint8_t c = v;
-	UARTTX = c;
+	// Newlines become carriage return, newline pairs within txbuf
+	txbuf_send(&v, 1);
 #endif
 }
 
@@ -356,9 +347,9 @@ _times(struct tms *buf) {
 int
 _write_r(struct _reent * reent, int fd, const void *buf, size_t nbytes) {
 	if ((STDOUT_FILENO == fd)||(STDERR_FILENO == fd)) {
-		const	char *cbuf = buf;
-		for(int i=0; i<nbytes; i++)
-			_outbyte(cbuf[i]);
+		// Only waits if the ring is full, once the console's
+		// interrupt is in use
+		txbuf_send((const char *)buf, nbytes);
 		return nbytes;
 	}
 #ifdef	_ZIP_HAS_SDCARD_NOTYET
@@ -405,6 +396,7 @@ void	_exit(int rcode) {
 #endif
 
 	// Wait for any serial ports to flush their buffers
+	txbuf_flush();
 #ifdef	TXBUSY
 	while(TXBUSY)
 		;
@@ -0,0 +1,332 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	txbuf.c
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	The console's transmit ring buffer, and a small printf-like
+//		formatter that writes straight into it.  See txbuf.h.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdarg.h>
+#include "board.h"
+#include "zipcpu.h"
+#include "zipsys.h"
+#include "txbuf.h"
+
+unsigned	txbuf_dropped = 0;
+
+#ifdef	_BOARD_HAS_BUSCONSOLE
+// The number of empty slots in the UART's transmit FIFO
+#define	TXFIFO_SPACE	((_uart->u_fifo >> 18) & 0x03ff)
+
+static	volatile char	m_ring[TXBUFLN];
+// m_head is only ever written by those adding to the ring, m_tail by whoever
+// is moving characters from the ring to the UART.  Both count characters,
+// and are only reduced modulo TXBUFLN when indexing.
+static	volatile unsigned	m_head = 0, m_tail = 0;
+static	int		m_useint = 0, m_last_was_cr = 0;
+
+// Set while a user task is part way through changing the ring.  A user task
+// can't turn interrupts off, so the supervisor may find the ring this way--
+// from a fault, say--and can't wait for the task to finish either.  It goes
+// around the ring instead, straight to the UART.
+static	volatile int	m_user_busy = 0;
+
+#define	IN_USER		((zip_cc() & CC_GIE)!=0)
+
+// Once the interrupt is in use, only the supervisor may move characters from
+// the ring to the UART, lest it interrupt a user task in the middle of doing
+// the same.  Without it, the supervisor must leave the ring alone while a
+// user task might be draining it.
+#define	CAN_DRAIN	((IN_USER) ? (!m_useint) : ((m_useint)||(!m_user_busy)))
+
+static	void	user_enter(void) {
+	if (IN_USER)
+		m_user_busy = 1;
+}
+
+static	void	user_exit(void) {
+	if (IN_USER)
+		m_user_busy = 0;
+}
+
+// Move as much as the UART will take from the ring into its FIFO
+static	void	drain(void) {
+	unsigned	tail = m_tail, n = TXFIFO_SPACE;
+
+	while((n > 0)&&(tail != m_head)) {
+		_uart->u_tx = (unsigned)(unsigned char)m_ring[tail & (TXBUFLN-1)];
+		tail++;
+		n--;
+	} m_tail = tail;
+}
+
+// Start the ring emptying, if it isn't already
+static	void	kick(void) {
+	if (CAN_DRAIN)
+		drain();
+	if ((m_useint)&&(m_head != m_tail))
+		_zip->z_pic = EINT(SYSPIC_UARTTXF);
+}
+
+void	txbuf_useint(int useint) {
+	m_useint = useint;
+	if (!useint)
+		_zip->z_pic = DINT(SYSPIC_UARTTXF);
+}
+
+int	txbuf_intmode(void) {
+	return m_useint;
+}
+
+//
+// Adds a character to the ring, turning any newline into a carriage return
+// and newline pair.  Returns 0 if there wasn't room for it.
+//
+static	int	putring(int ch) {
+	unsigned	head = m_head, space = TXBUFLN - (head - m_tail);
+
+	if ((m_user_busy)&&(!IN_USER)) {
+		// The supervisor, having interrupted a user task in the
+		// middle of adding to the ring
+		if ((ch == '\n')&&(!m_last_was_cr)) {
+			while(TXFIFO_SPACE == 0)
+				;
+			_uart->u_tx = '\r';
+		}
+		while(TXFIFO_SPACE == 0)
+			;
+		_uart->u_tx = (unsigned)(unsigned char)ch;
+		m_last_was_cr = (ch == '\r');
+		return 1;
+	}
+
+	if ((ch == '\n')&&(!m_last_was_cr)) {
+		if (space < 2)
+			return 0;
+		m_ring[(head++) & (TXBUFLN-1)] = '\r';
+	} else if (space < 1)
+		return 0;
+
+	m_ring[(head++) & (TXBUFLN-1)] = ch;
+	m_last_was_cr = (ch == '\r');
+	m_head = head;
+	return 1;
+}
+
+/*
+ * txbuf_write()
+ *
+ * Adds as much of buf to the ring as will fit, and returns how many
+ * characters that was.  Never waits.
+ */
+int	txbuf_write(const char *buf, int len) {
+	int	nw = 0;
+
+	user_enter();
+	while((nw < len)&&(putring(buf[nw])))
+		nw++;
+	kick();
+	user_exit();
+	return nw;
+}
+
+/*
+ * txbuf_flush()
+ *
+ * Waits until everything in the ring has been handed to the UART.
+ */
+void	txbuf_flush(void) {
+	user_enter();
+	while(m_head != m_tail) {
+		if (CAN_DRAIN)
+			drain();
+		else if (!IN_USER)
+			// The supervisor can't wait on the user task it
+			// interrupted
+			break;
+	}
+	user_exit();
+}
+
+/*
+ * txbuf_send()
+ *
+ * Adds all of buf to the ring, waiting only for room to do so.  Unless the
+ * interrupt is in use, this then waits for it all to reach the UART.
+ */
+void	txbuf_send(const char *buf, int len) {
+	int	nw = 0;
+
+	while(nw < len) {
+		nw += txbuf_write(&buf[nw], len-nw);
+		if (nw < len)
+			txbuf_flush();
+	}
+
+	if (!m_useint)
+		txbuf_flush();
+}
+
+/*
+ * txbuf_isr()
+ *
+ * To be called by the supervisor on the console's TX FIFO interrupt.  Refills
+ * the FIFO from the ring, and turns the interrupt off once the ring is empty.
+ */
+void	txbuf_isr(void) {
+	drain();
+	if (m_head == m_tail)
+		_zip->z_pic = DINT(SYSPIC_UARTTXF);
+	else
+		_zip->z_pic = EINT(SYSPIC_UARTTXF);
+}
+
+//
+// The formatter adds characters to the ring one at a time, dropping any that
+// don't fit
+//
+static	void	fmtchr(int ch) {
+	if (!putring(ch))
+		txbuf_dropped++;
+}
+
+static	void	fmtnum(unsigned long v, int base, int neg, int width, int zero,
+			int upper) {
+	char	tmp[24];
+	int	nc = 0;
+
+	do {
+		int	d = v % base;
+		tmp[nc++] = (d < 10) ? ('0'+d) : ((upper ? 'A':'a') + d - 10);
+		v /= base;
+	} while(v > 0);
+
+	if (neg)
+		width--;
+	if ((neg)&&(zero))
+		fmtchr('-');
+	for(; width > nc; width--)
+		fmtchr((zero) ? '0' : ' ');
+	if ((neg)&&(!zero))
+		fmtchr('-');
+	while(nc > 0)
+		fmtchr(tmp[--nc]);
+}
+
+/*
+ * txbuf_printf()
+ *
+ * A printf() that never waits, for logging from code whose timing matters.
+ * Only %c, %s, %d, %u, %x, %X and %%, with an optional '0' flag, field
+ * width, and 'l' for long, are understood.  Returns the number of characters
+ * that were dropped for want of room.
+ */
+int	txbuf_printf(const char *fmt, ...) {
+	va_list		ap;
+	unsigned	dropped = txbuf_dropped;
+
+	user_enter();
+	va_start(ap, fmt);
+	for(; *fmt; fmt++) {
+		int	zero = 0, width = 0, lng = 0;
+
+		if (*fmt != '%') {
+			fmtchr(*fmt);
+			continue;
+		}
+
+		fmt++;
+		if (*fmt == '0') {
+			zero = 1;
+			fmt++;
+		} while((*fmt >= '0')&&(*fmt <= '9'))
+			width = width * 10 + (*fmt++ - '0');
+		if (*fmt == 'l') {
+			lng = 1;
+			fmt++;
+		}
+
+		switch(*fmt) {
+		case 'c':
+			fmtchr(va_arg(ap, int));
+			break;
+		case 's': {
+			const char *s = va_arg(ap, const char *);
+			int	ln = 0;
+
+			while(s[ln])
+				ln++;
+			for(; width > ln; width--)
+				fmtchr(' ');
+			while(*s)
+				fmtchr(*s++);
+			} break;
+		case 'd': {
+			long	v = (lng) ? va_arg(ap, long) : va_arg(ap, int);
+
+			if (v < 0)
+				fmtnum(-(unsigned long)v, 10, 1, width, zero, 0);
+			else
+				fmtnum(v, 10, 0, width, zero, 0);
+			} break;
+		case 'u':
+			fmtnum((lng) ? va_arg(ap, unsigned long)
+				: va_arg(ap, unsigned), 10, 0, width, zero, 0);
+			break;
+		case 'x': case 'X':
+			fmtnum((lng) ? va_arg(ap, unsigned long)
+				: va_arg(ap, unsigned), 16, 0, width, zero,
+				(*fmt == 'X'));
+			break;
+		case '\0':
+			fmt--;
+			break;
+		default:
+			fmtchr(*fmt);
+			break;
+		}
+	}
+	va_end(ap);
+
+	kick();
+	user_exit();
+	return txbuf_dropped - dropped;
+}
+
+#else	// _BOARD_HAS_BUSCONSOLE
+
+// Without a console, there's nowhere for anything to go
+void	txbuf_useint(int useint) { }
+int	txbuf_intmode(void) { return 0; }
+int	txbuf_write(const char *buf, int len) { return len; }
+void	txbuf_send(const char *buf, int len) { }
+void	txbuf_flush(void) { }
+void	txbuf_isr(void) { }
+int	txbuf_printf(const char *fmt, ...) { return 0; }
+
+#endif	// _BOARD_HAS_BUSCONSOLE
@@ -0,0 +1,66 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	txbuf.h
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	A ring buffer in front of the console's transmit FIFO, so
+//		that writing to the console needn't wait on the baud rate.
+//
+//	Until txbuf_useint(1) is called, characters are moved from the ring
+//	into the UART by whoever is writing, and txbuf_send() waits for them
+//	all to get there--much as before, only without waiting on each
+//	character.  Once a program takes the console's TX FIFO interrupt,
+//	and calls txbuf_isr() from it, the ring is emptied from the interrupt
+//	instead and txbuf_send() only waits if the ring is full.
+//
+//	txbuf_printf() never waits.  Anything that doesn't fit is dropped,
+//	and counted in txbuf_dropped.
+//
+//	Both user tasks and the supervisor may write.  Should the supervisor
+//	interrupt a user task part way through, as from a fault, whatever it
+//	writes goes straight to the UART instead, ahead of anything still in
+//	the ring.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	TXBUF_H
+#define	TXBUF_H
+
+// The size of the ring, in characters.  Must be a power of two.
+#define	TXBUFLN		1024
+
+extern	unsigned	txbuf_dropped;
+
+extern	void	txbuf_useint(int useint);
+extern	int	txbuf_intmode(void);
+extern	int	txbuf_write(const char *buf, int len);
+extern	void	txbuf_send(const char *buf, int len);
+extern	void	txbuf_flush(void);
+extern	void	txbuf_isr(void);
+extern	int	txbuf_printf(const char *fmt, ...)
+			__attribute__((format(printf, 1, 2)));
+
+#endif
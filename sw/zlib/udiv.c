@@ -8,6 +8,17 @@
 //		capability is merged into GCC.  Right now, GCC has no way of
 //	dividing two 64-bit numbers, and this routine provides that capability.
 //
+//	The work is done in __udivmoddi4(), which produces both quotient and
+//	remainder.  Rather than shifting out one quotient bit at a time, it
+//	builds on the CPU's 32-bit DIVU instruction: a 64-bit by 32-bit divide
+//	takes (at most) three DIVU's, two of which divide by a normalized
+//	16-bit half of the divisor as in Knuth's algorithm D (Hacker's Delight,
+//	divlu).  A 64-bit divisor is handled by estimating the quotient from
+//	the top 32-bits of the divisor, which is never off by more than one.
+//
+//	udivconst() handles repeated division by the same 32-bit number without
+//	any DIVU's at all, using a precomputed reciprocal (Moller and Granlund,
+//	"Improved division by invariant integers", 2011).
 //
 // Creator:	Dan Gisselquist, Ph.D.
 //		Gisselquist Technology, LLC
@@ -39,134 +50,201 @@
 //
 //
 #include <stdint.h>
+#include "udiv.h"
 
+//
+// Count the leading zeros of a 32-bit word.  The ZipCPU can do each of these
+// steps with conditional instructions, so there's no need to bit reverse the
+// word first.
+//
+static inline int
+clz32(uint32_t v) {
+	int	n = 0;
 
-
-#ifdef	__ZIPCPU__
-#include "zipcpu.h"
-#else
-uint32_t zip_bitrev(const uint32_t a) {
-	uint32_t	r, b = a;
-	r = 0;
-	for(int i=0; i<32; i++) {
-		r = (r<<1) | (b&1);
-		b >>= 1;
-	} return r;
+	if ((v & 0xffff0000)==0) { n += 16; v <<= 16; }
+	if ((v & 0xff000000)==0) { n +=  8; v <<=  8; }
+	if ((v & 0xf0000000)==0) { n +=  4; v <<=  4; }
+	if ((v & 0xc0000000)==0) { n +=  2; v <<=  2; }
+	if ((v & 0x80000000)==0) { n +=  1; }
+	return n;
 }
-#endif
-
-extern	int	cltz(unsigned long);
-
-#ifdef	__ZIPCPU__
-#define	ASMCLTZ
-#endif
-
-#ifdef	ASMCLTZ
-asm("\t.section\t.text\n\t.global\tcltz\n"
-"\t.type\tcltz,@function\n"
-"cltz:\n"
-	"\tMOV	R1,R3\n"
-	"\tCLR	R1\n"
-	"\tCMP	0,R3\n"
-	"\tMOV.Z R2,R3\n"
-	"\tADD.Z 32,R1\n"
-	"\tBREV	R3\n"
-	"\tTEST	0x0ffff,R3\n"
-	"\tADD.Z 16,R1\n"
-	"\tLSR.Z 16,R3\n"
-	"\tTEST	0x0ff,R3\n"
-	"\tADD.Z 8,R1\n"
-	"\tLSR.Z 8,R3\n"
-	"\tTEST	0x0f,R3\n"
-	"\tADD.Z 4,R1\n"
-	"\tLSR.Z 4,R3\n"
-	"\tTEST	0x03,R3\n"
-	"\tADD.Z 2,R1\n"
-	"\tLSR.Z 2,R3\n"
-	"\tTEST	0x01,R3\n"
-	"\tADD.Z 1,R1\n"
-	"\tRETN\n");
-#else
-int
-cltz(unsigned long v) {
-	uint32_t	hv;
-	int		cnt = 0;
-
-	hv = v >> 32;
-	if (hv == 0) {
-		cnt += 32;
-		hv = v & 0x0ffffffff;
-	}
 
-	hv = zip_bitrev(hv);
-	if ((hv & 0x0ffff)==0) {
-		cnt += 16;
-		hv = hv >> 16;
+//
+// divlu
+//
+// Divide the 64-bit number u1:u0 by v, where u1 < v so that the quotient fits
+// in 32-bits.  The divisor is normalized, and then split into 16-bit digits
+// so that each quotient digit can be estimated with a single 32-bit DIVU.
+// The estimate is corrected at most twice.
+//
+static uint32_t
+divlu(uint32_t u1, uint32_t u0, uint32_t v, uint32_t *rem) {
+	const uint32_t	b = 0x10000;
+	uint32_t	vn1, vn0, un32, un21, un10, un1, un0, q1, q0, rhat;
+	int		s;
+
+	s = clz32(v);
+	v <<= s;
+	vn1 = v >> 16;
+	vn0 = v & 0x0ffff;
+
+	un32 = (s) ? ((u1 << s) | (u0 >> (32-s))) : u1;
+	un10 = u0 << s;
+	un1 = un10 >> 16;
+	un0 = un10 & 0x0ffff;
+
+	q1 = un32 / vn1;
+	rhat = un32 - q1 * vn1;
+	while((q1 >= b)||(q1 * vn0 > ((rhat << 16) | un1))) {
+		q1--;
+		rhat += vn1;
+		if (rhat >= b)
+			break;
 	}
-	if ((hv & 0x0ff)==0) {
-		cnt += 8;
-		hv = hv >> 8;
+
+	un21 = (un32 << 16) + un1 - q1 * v;
+
+	q0 = un21 / vn1;
+	rhat = un21 - q0 * vn1;
+	while((q0 >= b)||(q0 * vn0 > ((rhat << 16) | un0))) {
+		q0--;
+		rhat += vn1;
+		if (rhat >= b)
+			break;
 	}
-	if ((hv & 0x0f)==0) {
-		cnt += 4;
-		hv = hv >> 4;
+
+	*rem = ((un21 << 16) + un0 - q0 * v) >> s;
+	return (q1 << 16) | q0;
+}
+
+unsigned long
+__udivmoddi4(unsigned long a, unsigned long b, unsigned long *rem) {
+	uint32_t	ah = (uint32_t)(a >> 32), al = (uint32_t)a,
+			bh = (uint32_t)(b >> 32), bl = (uint32_t)b;
+	unsigned long	q;
+
+	if (bh == 0) {
+		uint32_t	qh, ql, r;
+
+		if (ah == 0) {
+			// Both fit in 32-bits, so the hardware can do it all
+			ql = al / bl;
+			r  = al - ql * bl;
+			q  = ql;
+		} else if (ah < bl) {
+			// The quotient fits in 32-bits
+			q = divlu(ah, al, bl, &r);
+		} else {
+			// Divide the upper word, then the remainder
+			// together with the lower word
+			qh = ah / bl;
+			ql = divlu(ah - qh * bl, al, bl, &r);
+			q = ((unsigned long)qh << 32) | ql;
+		}
+
+		if (rem)
+			*rem = r;
+		return q;
+	} else if (a < b) {
+		if (rem)
+			*rem = a;
+		return 0;
 	}
-	if ((hv & 0x03)==0) {
-		cnt += 2;
-		hv = hv >> 2;
+
+	// The divisor has more than 32-bits, so the quotient has fewer.  Divide
+	// a/2 by the top 32-bits of the normalized divisor.  The result is
+	// either right, or one too large, once shifted back and decremented.
+	uint32_t	v1, q1, r1;
+	unsigned long	r;
+	int		n;
+
+	n = clz32(bh);
+	v1 = (uint32_t)((b << n) >> 32);
+	q1 = divlu((uint32_t)(a >> 33), (uint32_t)(a >> 1), v1, &r1);
+	q = ((unsigned long)q1 << n) >> 31;
+	if (q != 0)
+		q--;
+	r = a - q * b;
+	if (r >= b) {
+		q++;
+		r -= b;
 	}
-	if ((hv & 0x01)==0)
-		cnt ++;
-	return cnt;
+
+	if (rem)
+		*rem = r;
+	return q;
 }
-#endif
 
 unsigned long
 __udivdi3(unsigned long a, unsigned long b) {
-	unsigned long	r;
+	return __udivmoddi4(a, b, (unsigned long *)0);
+}
 
-	if (a < b)
-		return 0;
-	if (((b>>32)==0)&&((a>>32)==0)) {
-		uint32_t	ia, ib, ir;
-
-		ia = (uint32_t) a;
-		ib = (uint32_t) b;
-		ir = ia / ib;
-		r = (unsigned long)ir;
-		return r;
+//
+// udivconst_init
+//
+// Calculate the reciprocal of d, once, so that any number of divisions by d
+// may then be made with multiplies.  d must not be zero.
+//
+void
+udivconst_init(UDIVCONST *k, uint32_t d) {
+	k->k_s = clz32(d);
+	k->k_d = d << k->k_s;
+	// The quotient lies between 2^32 and 2^33-1, so dropping the top bit
+	// subtracts 2^32
+	k->k_v = (uint32_t)(__udivdi3(~0ul, k->k_d));
+}
+
+//
+// Divide u1:u0 by the (normalized) k->k_d, where u1 < k->k_d
+//
+static inline uint32_t
+udivconst_step(const UDIVCONST *k, uint32_t u1, uint32_t u0, uint32_t *rem) {
+	unsigned long	p;
+	uint32_t	q1, q0, r;
+
+	p  = (unsigned long)k->k_v * u1;
+	p += ((unsigned long)u1 << 32) | u0;
+	q1 = (uint32_t)(p >> 32) + 1;
+	q0 = (uint32_t)p;
+
+	r = u0 - q1 * k->k_d;
+	if (r > q0) {
+		q1--;
+		r += k->k_d;
+	}
+	if (r >= k->k_d) {
+		q1++;
+		r -= k->k_d;
 	}
 
-	int	la = cltz(a), lb = cltz(b);
-	a <<= la;
-	unsigned long	m;
-	if ((lb - la < 32)&&(((b<<la)&0x0ffffffff)==0)) {
-		// Problem is now to divide
-		//	[a * 2^(la-32)] / [b * 2^(la-32)] * 2^(la-la)
-		//
-		uint32_t	ia, ib, ir;
-		b <<= la;
-		ia = (uint32_t)(a>>32);
-		ib = (uint32_t)(b>>32);
-		ir = ia / ib;
-		r = ir;
-		return r;
+	*rem = r;
+	return q1;
+}
+
+unsigned long
+udivconst(const UDIVCONST *k, unsigned long a, uint32_t *rem) {
+	uint32_t	ah = (uint32_t)(a >> 32), al = (uint32_t)a,
+			n2, n1, n0, qh, ql, r;
+	int		s = k->k_s;
+
+	// Shift the dividend up by as much as the divisor was shifted, making
+	// it three words long
+	if (s) {
+		n2 = ah >> (32-s);
+		n1 = (ah << s) | (al >> (32-s));
 	} else {
-		// Problem is now to divide
-		//	[a * 2^(la)] / [b * 2^(lb)] * 2^(lb-la)
-		//
-		r = 0;
-		b <<= lb;
-		m = (1ul<<(lb-la));
-		while(m > 0) {
-			if (a >= b) {
-				r |= m;
-				a -= b;
-			}
-			m>>= 1;
-			b >>= 1;
-		} return r;
+		n2 = 0;
+		n1 = ah;
 	}
+	n0 = al << s;
+
+	qh = udivconst_step(k, n2, n1, &r);
+	ql = udivconst_step(k, r, n0, &r);
+
+	if (rem)
+		*rem = r >> s;
+	return ((unsigned long)qh << 32) | ql;
 }
 
 //
@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	udiv.h
+//
+// Project:	OpenArty, an entirely open SoC based upon the Arty platform
+//
+// Purpose:	The 64-bit division routines found in udiv.c and umod.c.
+//		GCC calls __udivdi3, __umoddi3, and __divdi3 on its own, so
+//	these are only of interest to code that wants both the quotient and
+//	remainder at once, or that divides many times by the same number.
+//
+//	For the latter, udivconst_init() works out a reciprocal of a 32-bit
+//	divisor once, after which udivconst() divides a 64-bit number by it
+//	using two multiplies rather than any divides.  The divisor may not be
+//	zero.  This is the sort of thing that converting microseconds to
+//	seconds, or clocks to microseconds, wants.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	UDIV_H
+#define	UDIV_H
+
+#include <stdint.h>
+
+typedef	struct	UDIVCONST_S {
+	uint32_t	k_d;	// The divisor, shifted up until its MSB is set
+	uint32_t	k_v;	// floor((2^64-1)/k_d) - 2^32
+	int		k_s;	// How far the divisor was shifted
+} UDIVCONST;
+
+extern	unsigned long	__udivmoddi4(unsigned long a, unsigned long b,
+				unsigned long *rem);
+extern	unsigned long	__udivdi3(unsigned long a, unsigned long b);
+extern	unsigned long	__umoddi3(unsigned long a, unsigned long b);
+
+extern	void		udivconst_init(UDIVCONST *k, uint32_t d);
+extern	unsigned long	udivconst(const UDIVCONST *k, unsigned long a,
+				uint32_t *rem);
+
+#endif
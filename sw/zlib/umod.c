@@ -45,18 +45,14 @@
 //
 //
 #include <stdint.h>
-
-
-unsigned long __udivdi3(unsigned long, unsigned long);
+#include "udiv.h"
 
 __attribute((noinline))
 unsigned long __umoddi3(unsigned long a, unsigned long b) {
 	unsigned long	r;
 
-	// Return a modulo b, or a%b in C syntax
-	r = __udivdi3(a, b);
-	r = r * b;
-	r = a - r;
+	// Return a modulo b, or a%b in C syntax.  The division leaves the
+	// remainder behind, so there's no need to multiply it back out.
+	__udivmoddi4(a, b, &r);
 	return r;
 }
-
@@ -76,6 +76,12 @@ extern int	zip_bitrev(int v);
 extern unsigned	zip_cc(void);
 extern unsigned	zip_ucc(void);
 
+// The upper 32-bits of an unsigned 32x32-bit product.  GCC turns this into a
+// single MPYUHI instruction.
+static inline unsigned	zip_mpyuhi(unsigned a, unsigned b) {
+	return (unsigned)(((unsigned long)a * b) >> 32);
+}
+
 extern	void	save_context(int *);
 extern	void	restore_context(int *);
 extern	int	syscall(int,int,int,int);